@@ -1,170 +1,309 @@
 #pragma once
 #include <unordered_map>
+#include <deque>
 
 typedef u32 ID_TYPE;
 
-class IDData
+// IDs of the emulated objects: lv2 objects, handles of the HLE modules, CPU threads.
+// An ID is the index of an entry of the table and the generation of the entry, an ID
+// destroyed isn't found again when its entry is reused. The table grows by chunks which are
+// never moved nor freed, so lookups don't take a lock: they take a reference on the entry and
+// check its ID. A lookup never takes a reference on an entry whose count has dropped to 0, so
+// the count of an entry reaches 0 once per generation. RemoveID() unlinks the entry and the
+// object is deleted when the last reference is released; IDRef holds a reference for the time
+// an object is used.
+// The type of an ID is a tag of the name of the module which created it (GetTypeTag).
+class IdManager
 {
-protected:
-	void* m_ptr;
-	std::function<void(void*)> m_destr;
+	static const u32 index_bits = 16;
+	static const u32 index_mask = (1 << index_bits) - 1;
+	static const u32 generation_mask = 0x7fff; // IDs stay positive
+	static const u32 chunk_shift = 10;
+	static const u32 chunk_size = 1 << chunk_shift;
+	static const u32 chunk_count = (1 << index_bits) / chunk_size;
 
 public:
-	IDData(void* ptr, std::function<void(void*)> destr)
-		: m_ptr(ptr)
-		, m_destr(destr)
+	struct Entry
 	{
-	}
-
-	~IDData()
+		std::atomic<u32> id;       // 0 while free or removed
+		std::atomic<u32> refs;     // the table (while linked) and the lookups in progress
+		void* ptr;
+		void (*destroy)(void*);
+		u32 type;
+		u32 attr;
+		u32 index;
+		u32 generation;            // written with m_mtx_alloc
+	};
+
+private:
+	std::atomic<Entry*> m_chunks[chunk_count];
+	std::mutex m_mtx_alloc;        // allocation of the entries
+	std::deque<u32> m_free;        // free indices, reused in order
+	u32 m_used;                    // entries allocated so far (index 0 is never used)
+	std::atomic<u32> m_count;      // linked entries
+
+	Entry& GetEntry(const u32 index)
 	{
-		m_destr(m_ptr);
+		return m_chunks[index >> chunk_shift].load(std::memory_order_relaxed)[index & (chunk_size - 1)];
 	}
 
-	template<typename T> T* get()
+	void Destroy(Entry& e)
 	{
-		return (T*)m_ptr;
-	}
+		if(e.ptr) e.destroy(e.ptr);
 
-	template<typename T> const T* get() const
-	{
-		return (const T*)m_ptr;
+		std::lock_guard<std::mutex> lock(m_mtx_alloc);
+		e.generation = (e.generation + 1) & generation_mask;
+		m_free.push_back(e.index);
 	}
-};
-
-struct ID
-{
-	std::string m_name;
-	u32 m_attr;
-	IDData* m_data;
 
-	template<typename T>
-	ID(const std::string& name, T* data, const u32 attr)
-		: m_name(name)
-		, m_attr(attr)
+public:
+	IdManager() : m_used(1), m_count(0)
 	{
-		m_data = new IDData(data, [](void *ptr) -> void { delete (T*)ptr; });
+		for(u32 i = 0; i < chunk_count; i++) m_chunks[i] = nullptr;
 	}
 
-	ID() : m_data(nullptr)
+	~IdManager()
 	{
+		Clear();
+
+		for(u32 i = 0; i < chunk_count; i++) delete[] m_chunks[i].load();
 	}
 
-	ID(ID&& other)
+	// tag of the type name (never 0)
+	static u32 GetTypeTag(const std::string& name)
 	{
-		m_name = other.m_name;
-		m_attr = other.m_attr;
-		m_data = other.m_data;
-		other.m_data = nullptr;
+		static std::mutex mutex;
+		static std::unordered_map<std::string, u32> tags;
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto f = tags.find(name);
+		if(f != tags.end()) return f->second;
+
+		const u32 tag = tags.size() + 1;
+		tags[name] = tag;
+		return tag;
 	}
 
-	void Kill()
+	// takes a reference on the entry of the ID, nullptr if it doesn't exist or has another type (0: any)
+	Entry* Acquire(const ID_TYPE id, const u32 type = 0)
 	{
-		delete m_data;
-	}
-};
+		const u32 index = id & index_mask;
+		if(!index || (id >> index_bits) > generation_mask) return nullptr;
 
-class IdManager
-{
-	static const ID_TYPE s_first_id = 1;
-	static const ID_TYPE s_max_id = -1;
+		Entry* chunk = m_chunks[index >> chunk_shift].load(std::memory_order_acquire);
+		if(!chunk) return nullptr;
 
-	std::unordered_map<ID_TYPE, ID> m_id_map;
-	std::mutex m_mtx_main;
+		Entry& e = chunk[index & (chunk_size - 1)];
+		if(e.id.load(std::memory_order_acquire) != id) return nullptr;
 
-	ID_TYPE m_cur_id;
+		// an entry without reference is being destroyed or free: it must not be revived
+		u32 refs = e.refs.load();
+		do
+		{
+			if(!refs) return nullptr;
+		}
+		while(!e.refs.compare_exchange_weak(refs, refs + 1));
 
-public:
-	IdManager() : m_cur_id(s_first_id)
-	{
+		if(e.id.load(std::memory_order_acquire) != id || (type && e.type != type))
+		{
+			Release(e);
+			return nullptr;
+		}
+
+		return &e;
 	}
-	
-	~IdManager()
+
+	void Release(Entry& e)
 	{
-		Clear();
+		if(--e.refs == 0) Destroy(e);
 	}
 
-	bool CheckID(const ID_TYPE id)
+	bool CheckID(const ID_TYPE id, const u32 type = 0)
 	{
-		std::lock_guard<std::mutex> lock(m_mtx_main);
+		Entry* e = Acquire(id, type);
+		if(!e) return false;
 
-		return m_id_map.find(id) != m_id_map.end();
+		Release(*e);
+		return true;
 	}
 
 	void Clear()
 	{
-		std::lock_guard<std::mutex> lock(m_mtx_main);
+		std::vector<Entry*> entries;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mtx_alloc);
+
+			for(u32 i = 1; i < m_used; i++)
+			{
+				Entry& e = GetEntry(i);
+				const u32 id = e.id.exchange(0);
+				if(id) entries.push_back(&e);
+			}
+		}
+
+		for(u32 i = 0; i < entries.size(); i++)
+		{
+			m_count--;
+			Release(*entries[i]);
+		}
+
+		// the next IDs start from 1 again if no object is still referenced
+		std::lock_guard<std::mutex> lock(m_mtx_alloc);
 
-		for(auto& i : m_id_map)
+		for(u32 i = 1; i < m_used; i++)
 		{
-			i.second.Kill();
+			if(GetEntry(i).refs) return;
 		}
 
-		m_id_map.clear();
-		m_cur_id = s_first_id;
+		for(u32 i = 1; i < m_used; i++)
+		{
+			GetEntry(i).generation = 0;
+		}
+
+		m_free.clear();
+		m_used = 1;
 	}
-	
-	template<typename T 
-#ifdef __GNUG__ 
+
+	// returns 0 if the table is full, the caller keeps the ownership of the data then
+	template<typename T
+#ifdef __GNUG__
 		= char
 #endif
 	>
 	ID_TYPE GetNewID(const std::string& name = "", T* data = nullptr, const u32 attr = 0)
 	{
-		std::lock_guard<std::mutex> lock(m_mtx_main);
+		const u32 type = GetTypeTag(name);
+		std::lock_guard<std::mutex> lock(m_mtx_alloc);
 
-		m_id_map[m_cur_id] = std::move(ID(name, data, attr));
+		u32 index;
 
-		return m_cur_id++;
-	}
-	
-	ID& GetID(const ID_TYPE id)
-	{
-		std::lock_guard<std::mutex> lock(m_mtx_main);
+		if(m_free.size())
+		{
+			index = m_free.front();
+			m_free.pop_front();
+		}
+		else
+		{
+			// table full: 0 is never a valid ID
+			if(m_used > index_mask)
+			{
+				return 0;
+			}
+
+			index = m_used++;
+
+			if(!m_chunks[index >> chunk_shift].load())
+			{
+				Entry* chunk = new Entry[chunk_size];
+
+				for(u32 i = 0; i < chunk_size; i++)
+				{
+					chunk[i].id = 0;
+					chunk[i].refs = 0;
+					chunk[i].ptr = nullptr;
+					chunk[i].index = ((index >> chunk_shift) << chunk_shift) | i;
+					chunk[i].generation = 0;
+				}
+
+				m_chunks[index >> chunk_shift].store(chunk, std::memory_order_release);
+			}
+		}
 
-		return m_id_map[id];
+		Entry& e = GetEntry(index);
+		const ID_TYPE id = (e.generation << index_bits) | index;
+
+		// a free entry has no reference left: lookups of its old IDs can't take one any more
+		e.refs = 1;
+		e.ptr = data;
+		e.destroy = [](void* ptr) { delete (T*)ptr; };
+		e.type = type;
+		e.attr = attr;
+		e.id.store(id, std::memory_order_release);
+		m_count++;
+
+		return id;
 	}
 
 	template<typename T>
-	bool GetIDData(const ID_TYPE id, T*& result)
+	bool GetIDData(const ID_TYPE id, T*& result, const u32 type = 0)
 	{
-		std::lock_guard<std::mutex> lock(m_mtx_main);
-
-		auto f = m_id_map.find(id);
+		Entry* e = Acquire(id, type);
+		if(!e) return false;
 
-		if(f == m_id_map.end())
-		{
-			return false;
-		}
+		result = (T*)e->ptr;
+		Release(*e);
+		return true;
+	}
 
-		result = f->second.m_data->get<T>();
+	bool GetIDAttr(const ID_TYPE id, u32& attr, const u32 type = 0)
+	{
+		Entry* e = Acquire(id, type);
+		if(!e) return false;
 
+		attr = e->attr;
+		Release(*e);
 		return true;
 	}
 
 	bool HasID(const s64 id)
 	{
-		{
-			std::lock_guard<std::mutex> lock(m_mtx_main);
+		if(id == wxID_ANY) return m_count != 0;
 
-			if(id == wxID_ANY)
-				return m_id_map.begin() != m_id_map.end();
-		}
-
-		return CheckID(id);
+		return CheckID((ID_TYPE)id);
 	}
 
 	bool RemoveID(const ID_TYPE id)
 	{
-		std::lock_guard<std::mutex> lock(m_mtx_main);
+		Entry* e = Acquire(id);
+		if(!e) return false;
+
+		u32 expected = id;
+		const bool removed = e->id.compare_exchange_strong(expected, 0);
+
+		if(removed)
+		{
+			m_count--;
+			Release(*e); // the reference of the table
+		}
 
-		auto item = m_id_map.find(id);
+		Release(*e);
+		return removed;
+	}
+};
 
-		if(item == m_id_map.end()) return false;
+// reference on an ID: the object isn't deleted while it exists, even if the ID is removed
+template<typename T>
+class IDRef
+{
+	IdManager* m_manager;
+	IdManager::Entry* m_entry;
 
-		item->second.Kill();
-		m_id_map.erase(item);
+	IDRef(const IDRef&);
+	IDRef& operator=(const IDRef&);
 
-		return true;
+public:
+	IDRef(IdManager& manager, const ID_TYPE id, const u32 type = 0)
+		: m_manager(&manager)
+		, m_entry(manager.Acquire(id, type))
+	{
+	}
+
+	IDRef(IDRef&& other)
+		: m_manager(other.m_manager)
+		, m_entry(other.m_entry)
+	{
+		other.m_entry = nullptr;
 	}
+
+	~IDRef()
+	{
+		if(m_entry) m_manager->Release(*m_entry);
+	}
+
+	T* get() const { return m_entry ? (T*)m_entry->ptr : nullptr; }
+	T* operator->() const { return get(); }
+	T& operator*() const { return *get(); }
+	operator bool() const { return m_entry != nullptr; }
 };
@@ -1,9 +1,24 @@
 #include <stdafx.h>
 #include <Utilities/SMutex.h>
 
-__forceinline void SM_Sleep()
+u64 SM_PrepareWait(const void* owner)
 {
-	Sleep(1);
+	return g_parking_lot.Prepare(ParkingLot::ObjectKey(owner));
+}
+
+void SM_CancelWait(const void* owner)
+{
+	g_parking_lot.Cancel(ParkingLot::ObjectKey(owner));
+}
+
+void SM_Wait(const void* owner, u64 generation, u32 timeout_ms)
+{
+	g_parking_lot.Wait(ParkingLot::ObjectKey(owner), generation, SPIN_WAIT_SYNC, timeout_ms);
+}
+
+void SM_Notify(const void* owner)
+{
+	g_parking_lot.Notify(ParkingLot::ObjectKey(owner));
 }
 
 #ifdef _WIN32
@@ -1,6 +1,11 @@
 #pragma once
 
-extern void SM_Sleep();
+// waiting for the owner of a mutex to change: the threads sleep until an unlock notifies the
+// address of the owner (the parking lot of the emulator, Emu/CPU/SpinWait.h)
+extern u64 SM_PrepareWait(const void* owner);
+extern void SM_CancelWait(const void* owner);
+extern void SM_Wait(const void* owner, u64 generation, u32 timeout_ms);
+extern void SM_Notify(const void* owner);
 extern size_t SM_GetCurrentThreadId();
 extern u32 SM_GetCurrentCPUThreadId();
 extern be_t<u32> SM_GetCurrentCPUThreadIdBE();
@@ -21,14 +26,16 @@ template
 <
 	typename T,
 	u64 free_value = 0,
-	u64 dead_value = 0xffffffff,
-	void (*wait)() = SM_Sleep
+	u64 dead_value = 0xffffffff
 >
 class SMutexBase
 {
 	static_assert(sizeof(T) == sizeof(std::atomic<T>), "Invalid SMutexBase type");
 	std::atomic<T> owner;
 
+	// the longest wait (ms) before the owner is checked again: the emulator may have stopped
+	static const u32 sm_wait_timeout = 10;
+
 public:
 	SMutexBase()
 		: owner((T)free_value)
@@ -38,6 +45,7 @@ public:
 	void initialize()
 	{
 		(T&)owner = free_value;
+		SM_Notify(&owner);
 	}
 
 	~SMutexBase()
@@ -107,27 +115,53 @@ public:
 			return SMR_PERMITTED;
 		}
 
+		if (to != tid)
+		{
+			SM_Notify(&owner);
+		}
+
 		return SMR_OK;
 	}
 
+	// timeout: milliseconds, 0 for none
 	SMutexResult lock(T tid, u64 timeout = 0)
 	{
-		u64 counter = 0;
+		// uncontended: no waiter registration
+		SMutexResult res = trylock(tid);
+		if (res != SMR_FAILED)
+		{
+			return res;
+		}
+
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
 
 		while (true)
 		{
-			switch (SMutexResult res = trylock(tid))
+			// registered before the check: an unlock after it wakes the wait
+			const u64 generation = SM_PrepareWait(&owner);
+
+			switch (res = trylock(tid))
 			{
 				case SMR_FAILED: break;
-				default: return res;
+				default: SM_CancelWait(&owner); return res;
 			}
 
-			wait();
+			u32 wait = sm_wait_timeout;
 
-			if (timeout && counter++ > timeout)
+			if (timeout)
 			{
-				return SMR_TIMEOUT;
+				const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+
+				if (left <= 0)
+				{
+					SM_CancelWait(&owner);
+					return SMR_TIMEOUT;
+				}
+
+				if (left < (s64)wait) wait = (u32)left;
 			}
+
+			SM_Wait(&owner, generation, wait);
 		}
 	}
 };
@@ -1,9 +1,12 @@
 #pragma once
+#include <mutex>
+#include <condition_variable>
 
 template<typename T, u32 SQSize = 666>
 class SQueue
 {
-	SMutexGeneral m_mutex;
+	std::mutex m_mutex;
+	std::condition_variable m_cond; // signaled on every push, pop and clear
 	u32 m_pos;
 	u32 m_count;
 	T m_data[SQSize];
@@ -22,66 +25,40 @@ public:
 
 	bool Push(const T& data)
 	{
-		while (true)
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (!WaitWhileRunning(m_cond, lock, [this](){ return m_count < SQSize; }))
 		{
-			if (m_mutex.GetOwner() == m_mutex.GetDeadValue())
-			{
-				return false;
-			}
-
-			if (m_count >= SQSize)
-			{
-				if (Emu.IsStopped())
-				{
-					return false;
-				}
-				Sleep(1);
-				continue;
-			}
-
-			{
-				SMutexGeneralLocker lock(m_mutex);
-
-				if (m_count >= SQSize) continue;
-
-				m_data[(m_pos + m_count++) % SQSize] = data;
-
-				return true;
-			}
+			return false;
 		}
+
+		m_data[(m_pos + m_count++) % SQSize] = data;
+		m_cond.notify_all();
+		return true;
 	}
 
 	bool Pop(T& data)
 	{
-		while (true)
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (!WaitWhileRunning(m_cond, lock, [this](){ return m_count != 0; }))
 		{
-			if (m_mutex.GetOwner() == m_mutex.GetDeadValue())
-			{
-				return false;
-			}
-
-			if (!m_count)
-			{
-				if (Emu.IsStopped())
-				{
-					return false;
-				}
-				Sleep(1);
-				continue;
-			}
-
-			{
-				SMutexGeneralLocker lock(m_mutex);
-
-				if (!m_count) continue;
-
-				data = m_data[m_pos];
-				m_pos = (m_pos + 1) % SQSize;
-				m_count--;
-
-				return true;
-			}
+			return false;
 		}
+
+		data = m_data[m_pos];
+		m_pos = (m_pos + 1) % SQSize;
+		m_count--;
+		m_cond.notify_all();
+		return true;
+	}
+
+	// blocks until the queue is empty (all elements were popped)
+	bool WaitEmpty()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		return WaitWhileRunning(m_cond, lock, [this](){ return m_count == 0; });
 	}
 
 	volatile u32 GetCount() // may be not safe
@@ -96,34 +73,16 @@ public:
 
 	void Clear()
 	{
-		SMutexGeneralLocker lock(m_mutex);
+		std::lock_guard<std::mutex> lock(m_mutex);
 		m_count = 0;
+		m_cond.notify_all();
 	}
 
 	T& Peek(u32 pos = 0)
 	{
-		while (true)
-		{
-			if (m_mutex.GetOwner() == m_mutex.GetDeadValue())
-			{
-				break;
-			}
-
-			if (!m_count)
-			{
-				if (Emu.IsStopped())
-				{
-					break;
-				}
-				Sleep(1);
-				continue;
-			}
-
-			{
-				SMutexGeneralLocker lock(m_mutex);
-				if (m_count) break;
-			}
-		}
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		WaitWhileRunning(m_cond, lock, [this](){ return m_count != 0; });
 		return m_data[(m_pos + pos) % SQSize];
 	}
 };
@@ -0,0 +1,156 @@
+#pragma once
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+
+// SSE2 is the baseline of every supported host. SSSE3 and SSE4.1 instructions are only
+// executed after a runtime check and live in functions compiled for that instruction set
+// (GCC needs the target attribute, MSVC allows the intrinsics anywhere).
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SSSE3_FUNC
+#define SSE41_FUNC
+#else
+#include <cpuid.h>
+#define SSSE3_FUNC __attribute__((__target__("ssse3")))
+#define SSE41_FUNC __attribute__((__target__("sse4.1")))
+#endif
+
+inline u32 HostCPUIDFeatures()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return info[2];
+#else
+	unsigned int eax, ebx, ecx, edx;
+	return __get_cpuid(1, &eax, &ebx, &ecx, &edx) ? ecx : 0;
+#endif
+}
+
+inline bool HostHasSSSE3()
+{
+	static const bool has = (HostCPUIDFeatures() & (1 << 9)) != 0;
+	return has;
+}
+
+inline bool HostHasSSE41()
+{
+	static const bool has = (HostCPUIDFeatures() & (1 << 19)) != 0;
+	return has;
+}
+
+// pshufb: _u8[i] = index._u8[i] & 0x80 ? 0 : v._u8[index._u8[i] & 0xf]
+SSSE3_FUNC inline __m128i ShuffleSSSE3(__m128i v, __m128i index)
+{
+	return _mm_shuffle_epi8(v, index);
+}
+
+inline __m128i ShuffleSSE2(__m128i v, __m128i index)
+{
+	_CRT_ALIGN(16) u8 src[16], sel[16], res[16];
+	_mm_store_si128((__m128i*)src, v);
+	_mm_store_si128((__m128i*)sel, index);
+
+	for (int b = 0; b < 16; b++)
+		res[b] = (sel[b] & 0x80) ? 0 : src[sel[b] & 0xf];
+
+	return _mm_load_si128((__m128i*)res);
+}
+
+// roundps
+SSE41_FUNC inline __m128 FloorSSE41(__m128 v)
+{
+	return _mm_round_ps(v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+}
+
+SSE41_FUNC inline __m128 CeilSSE41(__m128 v)
+{
+	return _mm_round_ps(v, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC);
+}
+
+SSE41_FUNC inline __m128 TruncSSE41(__m128 v)
+{
+	return _mm_round_ps(v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+}
+
+inline __m128i ShuffleBytes(__m128i v, __m128i index)
+{
+	return HostHasSSSE3() ? ShuffleSSSE3(v, index) : ShuffleSSE2(v, index);
+}
+
+// mask ? a : b (bitwise)
+inline __m128i SelectBits(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// unsigned compares
+inline __m128i CmpGtU32(__m128i a, __m128i b)
+{
+	const __m128i sign = _mm_set1_epi32(0x80000000);
+	return _mm_cmpgt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+}
+
+inline __m128i CmpGtU16(__m128i a, __m128i b)
+{
+	const __m128i sign = _mm_set1_epi16((s16)0x8000);
+	return _mm_cmpgt_epi16(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+}
+
+inline __m128i CmpGtU8(__m128i a, __m128i b)
+{
+	const __m128i sign = _mm_set1_epi8((s8)0x80);
+	return _mm_cmpgt_epi8(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+}
+
+// unsigned 16 x 16 -> 32 multiplication of the low halfwords of every word (the high halfwords must be 0)
+inline __m128i MulU16(__m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_mullo_epi16(a, b), _mm_slli_epi32(_mm_mulhi_epu16(a, b), 16));
+}
+
+// denormals are replaced by zero (the sign is kept)
+inline __m128 FlushDenormals(__m128 v)
+{
+	const __m128i exp = _mm_and_si128(_mm_castps_si128(v), _mm_set1_epi32(0x7f800000));
+	const __m128i denormal = _mm_and_si128(_mm_cmpeq_epi32(exp, _mm_setzero_si128()), _mm_set1_epi32(0x7fffffff));
+	return _mm_castsi128_ps(_mm_andnot_si128(denormal, _mm_castps_si128(v)));
+}
+
+// the register as a 128-bit integer (_u8[15] is the most significant byte): byte rotation/shifts
+inline __m128i RotateBytes(__m128i v, int s) // s = 0..15
+{
+	const __m128i index = _mm_sub_epi8(_mm_set_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), _mm_set1_epi8(s));
+	return ShuffleBytes(v, _mm_and_si128(index, _mm_set1_epi8(0xf)));
+}
+
+inline __m128i ShiftBytesLeft(__m128i v, int s) // s = 0..31
+{
+	// negative indices have the high bit set and give 0
+	const __m128i index = _mm_sub_epi8(_mm_set_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), _mm_set1_epi8(s));
+	return ShuffleBytes(v, index);
+}
+
+inline __m128i ShiftBytesRight(__m128i v, int s) // s = 0..31
+{
+	const __m128i index = _mm_add_epi8(_mm_set_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), _mm_set1_epi8(s));
+	return ShuffleBytes(v, _mm_or_si128(index, _mm_cmpgt_epi8(index, _mm_set1_epi8(15))));
+}
+
+// bit rotation/shifts, t = 0..7
+inline __m128i RotateBits(__m128i v, int t)
+{
+	return _mm_or_si128(_mm_sll_epi64(v, _mm_cvtsi32_si128(t)), _mm_srl_epi64(_mm_shuffle_epi32(v, 0x4e), _mm_cvtsi32_si128(64 - t)));
+}
+
+inline __m128i ShiftBitsLeft(__m128i v, int t)
+{
+	return _mm_or_si128(_mm_sll_epi64(v, _mm_cvtsi32_si128(t)), _mm_srl_epi64(_mm_slli_si128(v, 8), _mm_cvtsi32_si128(64 - t)));
+}
+
+inline __m128i ShiftBitsRight(__m128i v, int t)
+{
+	return _mm_or_si128(_mm_srl_epi64(v, _mm_cvtsi32_si128(t)), _mm_sll_epi64(_mm_srli_si128(v, 8), _mm_cvtsi32_si128(64 - t)));
+}
@@ -56,6 +56,7 @@ void ThreadBase::Start()
 			Task();
 
 			m_alive = false;
+			ConLog.ReleaseThreadBuffer();
 		});
 }
 
@@ -136,6 +137,8 @@ void thread::start(std::function<void()> func)
 			ConLog.Error("Crash :(");
 			//std::terminate();
 		}
+
+		ConLog.ReleaseThreadBuffer();
 	});
 }
 
@@ -0,0 +1,590 @@
+#include "stdafx.h"
+#include "Emu/Cell/PPUDecoder.h"
+#include "Emu/Cell/PPUInterpreter.h"
+#include "Emu/Cell/SPUThread.h"
+#include "Emu/Cell/SPUDecoder.h"
+#include "Emu/Cell/SPUInterpreter.h"
+#include "Emu/GS/RSXThread.h"
+#include "Crypto/utils.h"
+#include "Utilities/SMutex.h"
+#include "Utilities/SQueue.h"
+#include <wx/init.h>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+// rpcs3_bench: microbenchmarks of the emulator core.
+// Usage: rpcs3_bench [--filter <substring>] [--min-time <seconds>] [--json <file>]
+// Every benchmark is repeated with a growing iteration count until one run takes at least
+// min-time; the last run is reported as JSON (stdout or the given file) so runs can be
+// compared between builds. wxWidgets is initialized with a console application object, so no
+// display is needed.
+
+static const u32 bench_mem_size = 0x10000; // working set of the memory benchmarks (power of 2)
+static const u32 bench_io_size = 0x100000; // mapped into RSXIOMem (1 MB granularity)
+
+static volatile u64 g_bench_sink; // keeps the benchmarked results alive
+
+struct Benchmark
+{
+	std::string name;
+	u32 threads;
+	u64 bytes_per_op; // 0 if only operations are counted
+	std::function<void(u64 iterations)> func;
+};
+
+struct BenchResult
+{
+	const Benchmark* bench;
+	u64 iterations;
+	double seconds;
+};
+
+static BenchResult RunBenchmark(const Benchmark& bench, double min_time)
+{
+	BenchResult res;
+	res.bench = &bench;
+
+	u64 iterations = 1;
+	Timer timer;
+
+	while (true)
+	{
+		timer.Start();
+		bench.func(iterations);
+		timer.Stop();
+
+		const double elapsed = timer.GetElapsedTimeInSec();
+		if (elapsed >= min_time || iterations >= (1ull << 40))
+		{
+			res.iterations = iterations;
+			res.seconds = elapsed;
+			return res;
+		}
+
+		// aim slightly past min_time, but grow at most 10x per round
+		const u64 next = elapsed > 0.0 ? (u64)(iterations * min_time * 1.2 / elapsed) : iterations * 10;
+		iterations = std::max(iterations + 1, std::min(next, iterations * 10));
+	}
+}
+
+// splits the iterations between the threads and waits for all of them
+static void RunThreads(u32 threads, u64 iterations, const std::function<void(u64 count)>& func)
+{
+	std::vector<std::thread> list;
+
+	for (u32 i = 0; i < threads; i++)
+	{
+		const u64 count = iterations / threads + (i < iterations % threads ? 1 : 0);
+		list.push_back(std::thread(func, count));
+	}
+
+	for (auto& t : list)
+	{
+		t.join();
+	}
+}
+
+// Memory
+
+static void BenchRead32(u64 addr, u64 iterations)
+{
+	u32 sum = 0;
+	for (u64 i = 0; i < iterations; i++)
+	{
+		sum += Memory.Read32(addr + ((i * 4) & (bench_mem_size - 1)));
+	}
+	g_bench_sink = sum;
+}
+
+static void BenchWrite32(u64 addr, u64 iterations)
+{
+	for (u64 i = 0; i < iterations; i++)
+	{
+		Memory.Write32(addr + ((i * 4) & (bench_mem_size - 1)), (u32)i);
+	}
+}
+
+static void BenchRead128(u64 addr, u64 iterations)
+{
+	u64 sum = 0;
+	for (u64 i = 0; i < iterations; i++)
+	{
+		sum += Memory.Read128(addr + ((i * 16) & (bench_mem_size - 1))).lo;
+	}
+	g_bench_sink = sum;
+}
+
+static void BenchAllocFree(u64 iterations)
+{
+	// keeps 64 blocks of pseudo-random sizes alive, replacing the oldest one every iteration
+	u64 slots[64] = {};
+	u32 seed = 1;
+
+	for (u64 i = 0; i < iterations; i++)
+	{
+		u64& slot = slots[i % 64];
+		if (slot)
+		{
+			Memory.MainMem.Free(slot);
+		}
+
+		seed = seed * 1103515245 + 12345;
+		slot = Memory.MainMem.AllocAlign(0x100 + (seed >> 16) % 0x10000, 0x80);
+	}
+
+	for (u32 i = 0; i < 64; i++)
+	{
+		if (slots[i])
+		{
+			Memory.MainMem.Free(slots[i]);
+		}
+	}
+}
+
+// Locks
+
+static void BenchSMutex(u32 threads, u64 iterations)
+{
+	SMutexGeneral mutex;
+	u64 counter = 0;
+
+	RunThreads(threads, iterations, [&](u64 count)
+	{
+		const size_t tid = SM_GetCurrentThreadId();
+
+		for (u64 i = 0; i < count; i++)
+		{
+			mutex.lock(tid);
+			counter++;
+			mutex.unlock(tid);
+		}
+	});
+
+	g_bench_sink = counter;
+}
+
+static void BenchSQueue(u32 threads, u64 iterations)
+{
+	// half of the threads push, the rest pop the same number of elements
+	std::unique_ptr<SQueue<u64>> queue(new SQueue<u64>());
+	const u32 producers = threads / 2;
+	const u32 consumers = threads - producers;
+	std::vector<std::thread> list;
+
+	for (u32 i = 0; i < producers; i++)
+	{
+		const u64 count = iterations / producers + (i < iterations % producers ? 1 : 0);
+		list.push_back(std::thread([&queue, count]()
+		{
+			for (u64 j = 0; j < count; j++)
+			{
+				queue->Push(j);
+			}
+		}));
+	}
+
+	for (u32 i = 0; i < consumers; i++)
+	{
+		const u64 count = iterations / consumers + (i < iterations % consumers ? 1 : 0);
+		list.push_back(std::thread([&queue, count]()
+		{
+			u64 data, sum = 0;
+			for (u64 j = 0; j < count; j++)
+			{
+				queue->Pop(data);
+				sum += data;
+			}
+			g_bench_sink = sum;
+		}));
+	}
+
+	for (auto& t : list)
+	{
+		t.join();
+	}
+}
+
+// Interpreters: straight-line instruction mixes decoded and executed one by one (no branches)
+
+static const u32 bench_ppu_int[] =
+{
+	0x38630001, // addi r3,r3,1
+	0x7c841a14, // add r4,r4,r3
+	0x54851838, // rlwinm r5,r4,3,0,28
+	0x60a61234, // ori r6,r5,0x1234
+	0x7ce619d6, // mullw r7,r6,r3
+	0x7c032000, // cmpw cr0,r3,r4
+	0x7d041814, // addc r8,r4,r3
+	0x7d432051, // subf. r10,r3,r4
+};
+
+static const u32 bench_ppu_mem[] =
+{
+	0x81690000, // lwz r11,0(r9)
+	0x91690004, // stw r11,4(r9)
+	0xe9890008, // ld r12,8(r9)
+	0xf9890010, // std r12,16(r9)
+	0x89a90003, // lbz r13,3(r9)
+	0xb1a90018, // sth r13,24(r9)
+};
+
+static const u32 bench_ppu_fpu[] =
+{
+	0xfc21102a, // fadd f1,f1,f2
+	0xfc6100b2, // fmul f3,f1,f2
+	0xfc8118ba, // fmadd f4,f1,f2,f3
+	0xfca41024, // fdiv f5,f4,f2
+	0xecc40828, // fsubs f6,f4,f1
+	0xfc811000, // fcmpu cr1,f1,f2
+};
+
+static const u32 bench_ppu_vmx[] =
+{
+	0x1021100a, // vaddfp v1,v1,v2
+	0x106110ee, // vmaddfp v3,v1,v3,v2
+	0x10811404, // vand v4,v1,v2
+	0x10a1112b, // vperm v5,v1,v2,v4
+	0x10c61080, // vadduwm v6,v6,v2
+	0x10e11086, // vcmpequw v7,v1,v2
+	0x1103324c, // vsplth v8,v6,3
+	0x112934c4, // vxor v9,v9,v6
+};
+
+static const u32 bench_spu_mix[] =
+{
+	0x18010183, // a $3,$3,$4
+	0x1c004204, // ai $4,$4,1
+	0x18210185, // and $5,$3,$4
+	0x7800c286, // ceq $6,$5,$3
+	0x0f60c187, // shli $7,$3,3
+	0x3f814388, // rotqbyi $8,$7,5
+	0xc1210185, // mpya $9,$3,$4,$5
+	0x3400010a, // lqd $10,0($2)
+	0x2400410a, // stqd $10,1($2)
+	0x5883058b, // fa $11,$11,$12
+	0x58c3058d, // fm $13,$11,$12
+	0xe1c3058d, // fma $14,$11,$12,$13
+	0xb1e10190, // shufb $15,$3,$4,$16
+};
+
+static void BenchPPU(const u32* codes, u32 count, u64 data_addr, u64 iterations)
+{
+	PPUThread ppu;
+	PPUDecoder dec(new PPUInterpreter(ppu));
+
+	ppu.GPR[3] = 1;
+	ppu.GPR[4] = 2;
+	ppu.GPR[9] = data_addr;
+	ppu.FPR[1] = 1.5;
+	ppu.FPR[2] = 0.75;
+	for (u32 i = 0; i < 10; i++)
+	{
+		for (u32 j = 0; j < 4; j++)
+		{
+			ppu.VPR[i]._f[j] = 1.0f + i + j * 0.25f;
+		}
+	}
+
+	for (u64 i = 0; i < iterations; i++)
+	{
+		dec.Decode(codes[i % count]);
+	}
+
+	g_bench_sink = ppu.GPR[4];
+}
+
+static void BenchSPU(u64 ls_addr, u64 iterations)
+{
+	SPUThread spu;
+	SPUDecoder dec(*new SPUInterpreter(spu));
+	const u32 count = sizeof(bench_spu_mix) / sizeof(u32);
+
+	spu.SetOffset(ls_addr);
+	spu.GPR[2]._u32[3] = 0x1000;
+	for (u32 i = 3; i < 17; i++)
+	{
+		for (u32 j = 0; j < 4; j++)
+		{
+			spu.GPR[i]._u32[j] = i * 0x01010101 + j;
+		}
+	}
+
+	for (u64 i = 0; i < iterations; i++)
+	{
+		dec.Decode(bench_spu_mix[i % count]);
+	}
+
+	g_bench_sink = spu.GPR[3]._u32[3];
+}
+
+// RSX: the FIFO parser and the state methods of DoCmd, no rendering
+
+class BenchRSXThread : public RSXThread
+{
+public:
+	BenchRSXThread(u32 ctrl_addr)
+	{
+		m_ctrl = (CellGcmControl*)&Memory[ctrl_addr];
+	}
+
+	void Parse(u32 end)
+	{
+		m_ctrl->get = 0;
+		while (m_ctrl->get != end)
+		{
+			ExecFIFOCommand(m_ctrl->get);
+		}
+	}
+
+protected:
+	virtual void OnInit() {}
+	virtual void OnInitThread() {}
+	virtual void OnExitThread() {}
+	virtual void OnReset() {}
+	virtual void ExecCMD() {}
+	virtual void Flip() {}
+};
+
+// writes a command buffer at the start of the io space, returns its end offset
+static u32 BuildRSXFifo(u64 io_addr)
+{
+	static const u32 sub_offset = bench_io_size / 2;
+	u32 pos = 0;
+
+	auto put = [&](u32 value)
+	{
+		Memory.Write32(io_addr + pos, value);
+		pos += 4;
+	};
+	auto method = [&](u32 method, u32 count)
+	{
+		put(count << 18 | method);
+	};
+
+	for (u32 i = 0; i < 256; i++)
+	{
+		method(NV4097_SET_COLOR_MASK, 1);           put(0x01010101);
+		method(NV4097_SET_BLEND_ENABLE, 1);         put(i & 1);
+		method(NV4097_SET_ALPHA_FUNC, 2);           put(0x207); put(0x80);
+		method(NV4097_SET_VIEWPORT_HORIZONTAL, 2);  put(1280 << 16); put(720 << 16);
+		method(NV4097_SET_DEPTH_FUNC, 1);           put(0x203);
+		method(NV4097_SET_DEPTH_TEST_ENABLE, 1);    put(1);
+		method(NV4097_SET_CULL_FACE, 1);            put(0x405);
+		method(NV4097_SET_BLEND_FUNC_SFACTOR, 2);   put(0x03020302); put(0x03030303);
+		method(NV4097_SET_STENCIL_FUNC, 3);         put(0x207); put(0); put(0xff);
+		method(NV4097_SET_BLEND_COLOR, 1);          put(i);
+
+		if (i % 16 == 0)
+		{
+			put(CELL_GCM_METHOD_FLAG_CALL | sub_offset);
+		}
+	}
+
+	put(CELL_GCM_METHOD_FLAG_JUMP | (pos + 4));
+	const u32 end = pos;
+
+	pos = sub_offset;
+	method(NV4097_SET_DEPTH_TEST_ENABLE, 1);        put(0);
+	method(NV4097_SET_COLOR_MASK, 1);               put(0x01000000);
+	put(CELL_GCM_METHOD_FLAG_RETURN);
+
+	return end;
+}
+
+static void PrintJSON(std::ostream& out, const std::vector<BenchResult>& results)
+{
+	out << "{\n\t\"benchmarks\": [\n";
+
+	for (u32 i = 0; i < results.size(); i++)
+	{
+		const BenchResult& r = results[i];
+		const double ops = r.seconds > 0.0 ? r.iterations / r.seconds : 0.0;
+
+		out << fmt::Format("\t\t{\"name\": \"%s\", \"threads\": %u, \"iterations\": %llu, \"seconds\": %.6f, \"ns_per_op\": %.3f, \"ops_per_sec\": %.1f, \"bytes_per_sec\": %.1f}",
+			r.bench->name.c_str(), r.bench->threads, r.iterations, r.seconds,
+			r.iterations ? r.seconds * 1e9 / r.iterations : 0.0, ops, ops * r.bench->bytes_per_op);
+		out << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+
+	out << "\t]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+	std::string filter;
+	std::string json_path;
+	double min_time = 0.5;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "--filter" && i + 1 < argc)
+		{
+			filter = argv[++i];
+		}
+		else if (arg == "--min-time" && i + 1 < argc)
+		{
+			min_time = atof(argv[++i]);
+		}
+		else if (arg == "--json" && i + 1 < argc)
+		{
+			json_path = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--filter <substring>] [--min-time <seconds>] [--json <file>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// a console application object: initializing the GUI toolkit would require a display
+	wxApp::SetInstance(new wxAppConsole());
+	wxInitializer initializer(argc, argv);
+	if (!initializer.IsOk())
+	{
+		fprintf(stderr, "Failed to initialize wxWidgets\n");
+		return 1;
+	}
+
+	Ini.Load();
+
+	Memory.Init(Memory_PS3);
+	Memory.MemoryBlocks.push_back(Memory.RSXIOMem.SetRange(0x50000000, 0x10000000));
+
+	// SMutex and SQueue abort their waits while the emulator is stopped
+	Emu.SetStatus(Running);
+
+	const u64 main_addr = Memory.MainMem.AllocAlign(bench_mem_size, 0x1000);
+	const u64 stack_addr = Memory.StackMem.AllocAlign(bench_mem_size, 0x1000);
+	const u64 ls_addr = Memory.MainMem.AllocAlign(0x40000, 0x1000);
+	const u64 io_real = Memory.MainMem.AllocAlign(bench_io_size, bench_io_size);
+	const u64 io_addr = Memory.RSXIOMem.Map(io_real, bench_io_size);
+	const u64 ctrl_addr = Memory.MainMem.AllocAlign(sizeof(CellGcmControl), 0x10);
+
+	std::vector<u8> buf(bench_mem_size);
+	std::unique_ptr<BenchRSXThread> rsx(new BenchRSXThread(ctrl_addr));
+	const u32 fifo_end = BuildRSXFifo(io_addr);
+
+	std::vector<Benchmark> list;
+	auto add = [&](const std::string& name, u32 threads, u64 bytes_per_op, std::function<void(u64)> func)
+	{
+		Benchmark bench = { name, threads, bytes_per_op, func };
+		list.push_back(bench);
+	};
+
+	add("mem_read32_main", 1, 4, [=](u64 n) { BenchRead32(main_addr, n); });
+	add("mem_read32_stack", 1, 4, [=](u64 n) { BenchRead32(stack_addr, n); });
+	add("mem_read32_rsxio", 1, 4, [=](u64 n) { BenchRead32(io_addr, n); });
+	add("mem_write32_main", 1, 4, [=](u64 n) { BenchWrite32(main_addr, n); });
+	add("mem_write32_stack", 1, 4, [=](u64 n) { BenchWrite32(stack_addr, n); });
+	add("mem_read128_main", 1, 16, [=](u64 n) { BenchRead128(main_addr, n); });
+	add("mem_copy_to_real", 1, bench_mem_size, [&](u64 n) { for (u64 i = 0; i < n; i++) Memory.CopyToReal(&buf[0], main_addr, bench_mem_size); });
+	add("mem_copy_from_real", 1, bench_mem_size, [&](u64 n) { for (u64 i = 0; i < n; i++) Memory.CopyFromReal(stack_addr, &buf[0], bench_mem_size); });
+	add("mem_copy_main_to_stack", 1, bench_mem_size, [=](u64 n) { for (u64 i = 0; i < n; i++) Memory.Copy(stack_addr, main_addr, bench_mem_size); });
+	add("mem_alloc_free_main", 1, 0, BenchAllocFree);
+
+	for (u32 threads = 2; threads <= 16; threads *= 2)
+	{
+		add(fmt::Format("smutex_lock_unlock_%ut", threads), threads, 0, [=](u64 n) { BenchSMutex(threads, n); });
+		add(fmt::Format("squeue_push_pop_%ut", threads), threads, 0, [=](u64 n) { BenchSQueue(threads, n); });
+	}
+
+	add("ppu_interp_int", 1, 0, [=](u64 n) { BenchPPU(bench_ppu_int, sizeof(bench_ppu_int) / sizeof(u32), main_addr, n); });
+	add("ppu_interp_mem", 1, 0, [=](u64 n) { BenchPPU(bench_ppu_mem, sizeof(bench_ppu_mem) / sizeof(u32), main_addr, n); });
+	add("ppu_interp_fpu", 1, 0, [=](u64 n) { BenchPPU(bench_ppu_fpu, sizeof(bench_ppu_fpu) / sizeof(u32), main_addr, n); });
+	add("ppu_interp_vmx", 1, 0, [=](u64 n) { BenchPPU(bench_ppu_vmx, sizeof(bench_ppu_vmx) / sizeof(u32), main_addr, n); });
+	add("spu_interp_mix", 1, 0, [=](u64 n) { BenchSPU(ls_addr, n); });
+
+	add("rsx_fifo_parse", 1, fifo_end, [&](u64 n) { for (u64 i = 0; i < n; i++) rsx->Parse(fifo_end); });
+
+	add("aes128_cbc_decrypt", 1, bench_mem_size, [&](u64 n)
+	{
+		u8 key[16] = {}, iv[16] = {};
+		for (u64 i = 0; i < n; i++) aescbc128_decrypt(key, iv, &buf[0], &buf[0], bench_mem_size);
+	});
+	add("aes128_ecb_encrypt_block", 1, 16, [&](u64 n)
+	{
+		u8 key[16] = {};
+		for (u64 i = 0; i < n; i++) aesecb128_encrypt(key, &buf[(i * 16) & (bench_mem_size - 1)], &buf[0]);
+	});
+	add("aes128_cmac", 1, bench_mem_size, [&](u64 n)
+	{
+		u8 key[16] = {}, out[16];
+		aes_context ctx;
+		aes_setkey_enc(&ctx, key, 128);
+		for (u64 i = 0; i < n; i++) aes_cmac(&ctx, bench_mem_size, &buf[0], out);
+	});
+	add("sha1", 1, bench_mem_size, [&](u64 n)
+	{
+		u8 out[20];
+		for (u64 i = 0; i < n; i++) sha1(&buf[0], bench_mem_size, out);
+	});
+	add("sha1_hmac", 1, bench_mem_size, [&](u64 n)
+	{
+		u8 key[20] = {}, out[20];
+		for (u64 i = 0; i < n; i++) sha1_hmac(key, sizeof(key), &buf[0], bench_mem_size, out);
+	});
+
+	// lz_decompress keeps pointers in int variables, it only works in 32-bit builds
+	if (sizeof(void*) == 4)
+	{
+		add("lz_decompress", 1, bench_mem_size, [&](u64 n)
+		{
+			// arbitrary input: the range decoder stops at the end of the output at the latest
+			std::vector<u8> in(bench_mem_size * 16 + 64);
+			std::vector<u8> out(bench_mem_size);
+			u32 seed = 1;
+			for (u32 i = 0; i < in.size(); i++)
+			{
+				seed = seed * 1103515245 + 12345;
+				in[i] = seed >> 24;
+			}
+			in[0] = 0;
+
+			for (u64 i = 0; i < n; i++) lz_decompress(&out[0], &in[0], bench_mem_size);
+		});
+	}
+	else
+	{
+		fprintf(stderr, "lz_decompress: skipped (64-bit build)\n");
+	}
+
+	std::vector<BenchResult> results;
+
+	for (u32 i = 0; i < list.size(); i++)
+	{
+		if (!filter.empty() && list[i].name.find(filter) == std::string::npos)
+		{
+			continue;
+		}
+
+		results.push_back(RunBenchmark(list[i], min_time));
+
+		const BenchResult& r = results.back();
+		fprintf(stderr, "%-28s %12.3f ns/op %14llu iterations\n", r.bench->name.c_str(), r.seconds * 1e9 / r.iterations, r.iterations);
+	}
+
+	if (json_path.empty())
+	{
+		PrintJSON(std::cout, results);
+	}
+	else
+	{
+		std::ofstream out(json_path);
+		if (!out)
+		{
+			fprintf(stderr, "Can't create '%s'\n", json_path.c_str());
+			return 1;
+		}
+		PrintJSON(out, results);
+	}
+
+	rsx.reset();
+	Emu.SetStatus(Stopped);
+	Memory.Close();
+
+	return 0;
+}
@@ -220,3 +220,105 @@ int Unpack(wxFile& pkg_f, std::string src, std::string dst)
 
 	return 0;
 }
+
+// Random access.
+bool PKGReader::Open(const std::string& path)
+{
+	if (!m_file.Open(fmt::FromUTF8(path), wxFile::read) || !LoadHeader(m_file, &m_header))
+	{
+		m_file.Close();
+		return false;
+	}
+
+	memset(m_debug_key, 0, 0x40);
+	memcpy(m_debug_key+0x00, &m_header.qa_digest[0], 8);
+	memcpy(m_debug_key+0x08, &m_header.qa_digest[0], 8);
+	memcpy(m_debug_key+0x10, &m_header.qa_digest[8], 8);
+	memcpy(m_debug_key+0x18, &m_header.qa_digest[8], 8);
+	aes_setkey_enc(&m_aes, PKG_AES_KEY, 128);
+
+	std::vector<PKGEntry> table(m_header.file_count);
+	if (table.empty() || Read(0, &table[0], sizeof(PKGEntry) * table.size()) != sizeof(PKGEntry) * table.size() ||
+		table[0].name_offset / sizeof(PKGEntry) != m_header.file_count)
+	{
+		ConLog.Error("PKG: Entries are damaged!");
+		m_file.Close();
+		return false;
+	}
+
+	entries.resize(table.size());
+	m_index.clear();
+
+	for (size_t i = 0; i < table.size(); i++)
+	{
+		Entry& entry = entries[i];
+		entry.name.resize(table[i].name_size);
+		if (!entry.name.empty())
+			Read(table[i].name_offset, &entry.name[0], entry.name.size());
+
+		entry.name = entry.name.c_str(); // names may be padded with zeros
+		entry.offset = table[i].file_offset;
+		entry.size = table[i].file_size;
+		entry.type = table[i].type;
+		m_index[entry.name] = i;
+	}
+
+	return true;
+}
+
+const PKGReader::Entry* PKGReader::Find(const std::string& name) const
+{
+	auto found = m_index.find(name);
+	return found == m_index.end() ? nullptr : &entries[found->second];
+}
+
+void PKGReader::Crypt(u64 offset, u8* buf, u64 size)
+{
+	u64 block = offset / HASH_LEN;
+	u32 pos = offset % HASH_LEN;
+
+	for (u64 i = 0; i < size; block++, pos = 0)
+	{
+		u8 ctr[0x14];
+
+		if (m_header.pkg_type == PKG_RELEASE_TYPE_DEBUG)
+		{
+			u8 key[0x40];
+			memcpy(key, m_debug_key, 0x40);
+			*(be_t<u64>*)&key[0x38] += block;
+			sha1(key, 0x40, ctr);
+		}
+		else
+		{
+			u8 iv[HASH_LEN];
+			const u64 iv_lo = *(be_t<u64>*)&m_header.klicensee[8];
+			const u64 lo = iv_lo + block;
+			*(be_t<u64>*)&iv[0] = *(be_t<u64>*)&m_header.klicensee[0] + (lo < iv_lo ? 1 : 0);
+			*(be_t<u64>*)&iv[8] = lo;
+			aes_crypt_ecb(&m_aes, AES_ENCRYPT, iv, ctr);
+		}
+
+		for (; pos < HASH_LEN && i < size; pos++, i++)
+		{
+			buf[i] ^= ctr[pos];
+		}
+	}
+}
+
+u64 PKGReader::Read(u64 offset, void* dst, u64 size)
+{
+	if (offset >= m_header.data_size)
+		return 0;
+
+	size = min<u64>(size, m_header.data_size - offset);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_file.Seek(m_header.data_offset + offset);
+	const ssize_t read = m_file.Read(dst, size);
+	if (read <= 0)
+		return 0;
+
+	Crypt(offset, (u8*)dst, read);
+	return read;
+}
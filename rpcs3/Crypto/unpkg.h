@@ -1,6 +1,7 @@
 #pragma once
 #include "utils.h"
 #include "key_vault.h"
+#include <unordered_map>
 
 // Constants
 #define PKG_HEADER_SIZE 0xC0 //sizeof(pkg_header) + sizeof(pkg_unk_checksum)
@@ -47,4 +48,41 @@ struct PKGEntry
 	be_t<u32> pad;          // Padding (zeros)
 };
 
-extern int Unpack(wxFile& dec_pkg_f, std::string src, std::string dst);
\ No newline at end of file
+extern int Unpack(wxFile& dec_pkg_f, std::string src, std::string dst);
+
+// Random access to the contents of a package without extracting it.
+// The entry table is decrypted and indexed once; file data is decrypted on demand,
+// since both the AES-CTR (retail) and SHA1 (debug) keystreams can be generated
+// for any 16-byte block of the data area.
+class PKGReader
+{
+	wxFile m_file;
+	PKGHeader m_header;
+	u8 m_debug_key[0x40];
+	aes_context m_aes;
+	std::unordered_map<std::string, size_t> m_index;
+	std::mutex m_mutex;
+
+	void Crypt(u64 offset, u8* buf, u64 size);
+
+public:
+	struct Entry
+	{
+		std::string name;
+		u64 offset;
+		u64 size;
+		u32 type;
+	};
+
+	std::vector<Entry> entries;
+
+	bool Open(const std::string& path);
+	bool IsOpened() const { return m_file.IsOpened(); }
+	const PKGHeader& GetHeader() const { return m_header; }
+
+	// returns the entry with the given name (relative to the package root, '/' separated)
+	const Entry* Find(const std::string& name) const;
+
+	// read `size` decrypted bytes at `offset` of the data area
+	u64 Read(u64 offset, void* dst, u64 size);
+};
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "stdafx.h"
+#include "BreakPoints.h"
+#include "Emu/CPU/CPUThread.h"
+
+BreakPointManager::BreakPointManager()
+	: m_break_count(0)
+	, m_watch_count(0)
+{
+	memset(m_break_pages, 0, sizeof(m_break_pages));
+	memset(m_watch_pages, 0, sizeof(m_watch_pages));
+}
+
+void BreakPointManager::SetPage(u32* pages, const u32 page, const bool value)
+{
+	if(value)
+		pages[page / 32] |= 1 << (page % 32);
+	else
+		pages[page / 32] &= ~(1 << (page % 32));
+}
+
+void BreakPointManager::UpdateBreakPage(const u32 page)
+{
+	const u64 start = (u64)page << page_shift;
+	auto it = m_breaks.lower_bound(start);
+	SetPage(m_break_pages, page, it != m_breaks.end() && *it < start + (1 << page_shift));
+}
+
+void BreakPointManager::UpdateWatchPages()
+{
+	memset(m_watch_pages, 0, sizeof(m_watch_pages));
+
+	for(u32 i = 0; i < m_watches.size(); i++)
+	{
+		const WatchPoint& w = m_watches[i];
+		for(u64 page = w.addr >> page_shift; page <= ((u64)w.addr + w.size - 1) >> page_shift && page < page_count; page++)
+		{
+			SetPage(m_watch_pages, (u32)page, true);
+		}
+	}
+
+	m_watch_count = m_watches.size();
+}
+
+bool BreakPointManager::HasBreakPoint(const u64 addr)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_breaks.count(addr) != 0;
+}
+
+void BreakPointManager::AddBreakPoint(const u64 addr)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if(!m_breaks.insert(addr).second) return;
+
+	UpdateBreakPage((u32)addr >> page_shift);
+	m_break_count = m_breaks.size();
+}
+
+bool BreakPointManager::RemoveBreakPoint(const u64 addr)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if(!m_breaks.erase(addr)) return false;
+
+	UpdateBreakPage((u32)addr >> page_shift);
+	m_break_count = m_breaks.size();
+	return true;
+}
+
+std::vector<u64> BreakPointManager::GetBreakPoints()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return std::vector<u64>(m_breaks.begin(), m_breaks.end());
+}
+
+void BreakPointManager::AddWatchPoint(const u32 addr, const u32 size, const u32 type)
+{
+	if(!size || !(type & WATCH_ACCESS)) return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for(u32 i = 0; i < m_watches.size(); i++)
+	{
+		if(m_watches[i].addr == addr)
+		{
+			m_watches.erase(m_watches.begin() + i);
+			break;
+		}
+	}
+
+	WatchPoint w;
+	w.addr = addr;
+	w.size = size;
+	w.type = type & WATCH_ACCESS;
+	m_watches.push_back(w);
+
+	UpdateWatchPages();
+}
+
+bool BreakPointManager::RemoveWatchPoint(const u32 addr)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for(u32 i = 0; i < m_watches.size(); i++)
+	{
+		if(m_watches[i].addr == addr)
+		{
+			m_watches.erase(m_watches.begin() + i);
+			UpdateWatchPages();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::vector<WatchPoint> BreakPointManager::GetWatchPoints()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_watches;
+}
+
+void BreakPointManager::OnAccess(const u64 addr, const u32 size, const u32 type, const u64 value)
+{
+	std::string hit;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for(u32 i = 0; i < m_watches.size(); i++)
+		{
+			const WatchPoint& w = m_watches[i];
+			if(!(w.type & type) || addr + size <= w.addr || addr >= (u64)w.addr + w.size) continue;
+
+			CPUThread* thr = GetCurrentCPUThread();
+
+			if(type == WATCH_WRITE)
+			{
+				hit = fmt::Format("Write%d [0x%llx] = 0x%llx", size * 8, addr, value);
+			}
+			else
+			{
+				hit = fmt::Format("Read%d [0x%llx]", size * 8, addr);
+			}
+
+			hit += fmt::Format(" (watchpoint 0x%x, %d bytes)", w.addr, w.size);
+			if(thr) hit += fmt::Format(" by %s at PC 0x%llx", thr->GetFName().c_str(), thr->PC);
+
+			m_last_hit = hit;
+			break;
+		}
+	}
+
+	if(hit.empty()) return;
+
+	ConLog.Warning("Watchpoint: %s", hit.c_str());
+	Emu.Pause();
+}
+
+std::string BreakPointManager::GetLastHit()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_last_hit;
+}
+
+void BreakPointManager::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_breaks.clear();
+	m_watches.clear();
+	m_last_hit.clear();
+	memset(m_break_pages, 0, sizeof(m_break_pages));
+	m_break_count = 0;
+	UpdateWatchPages();
+}
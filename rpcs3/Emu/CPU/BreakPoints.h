@@ -0,0 +1,88 @@
+#pragma once
+#include <set>
+
+enum WatchPointType
+{
+	WATCH_READ   = 1,
+	WATCH_WRITE  = 2,
+	WATCH_ACCESS = WATCH_READ | WATCH_WRITE,
+};
+
+struct WatchPoint
+{
+	u32 addr;
+	u32 size;
+	u32 type; // WatchPointType
+};
+
+// Code breakpoints and data watchpoints of the debugger.
+// The CPU threads (every instruction) and the MemoryBase accessors (every access) only test a
+// bitmap with a bit per 4 KB page of the 32-bit guest address space, the lock is taken when the
+// page contains a point. Without any point the test is a single load of a counter.
+// Watchpoints cover the guest accesses done through MemoryBase::Read/Write (interpreters, DMA,
+// HLE functions using them), not the direct pointers to guest memory.
+class BreakPointManager
+{
+	static const u32 page_shift = 12;
+	static const u32 page_count = 1 << (32 - page_shift);
+
+	std::mutex m_mutex; // everything below, the bitmaps are only written with it
+	std::set<u64> m_breaks;
+	std::vector<WatchPoint> m_watches;
+	std::string m_last_hit;
+	std::atomic<u32> m_break_count;
+	std::atomic<u32> m_watch_count;
+	u32 m_break_pages[page_count / 32];
+	u32 m_watch_pages[page_count / 32];
+
+	static __forceinline bool TestPage(const u32* pages, const u64 addr)
+	{
+		const u32 page = (u32)addr >> page_shift;
+		return (pages[page / 32] & (1 << (page % 32))) != 0;
+	}
+
+	static void SetPage(u32* pages, const u32 page, const bool value);
+	void UpdateBreakPage(const u32 page);
+	void UpdateWatchPages();
+	void OnAccess(const u64 addr, const u32 size, const u32 type, const u64 value);
+
+public:
+	BreakPointManager();
+
+	// code breakpoints
+	__forceinline bool IsBreakPoint(const u64 addr)
+	{
+		return m_break_count && TestPage(m_break_pages, addr) && HasBreakPoint(addr);
+	}
+
+	bool HasBreakPoint(const u64 addr);
+	void AddBreakPoint(const u64 addr);
+	bool RemoveBreakPoint(const u64 addr);
+	std::vector<u64> GetBreakPoints();
+
+	// data watchpoints: the emulator is paused after the access
+	__forceinline void CheckRead(const u64 addr, const u32 size)
+	{
+		if(m_watch_count && (TestPage(m_watch_pages, addr) || TestPage(m_watch_pages, addr + size - 1)))
+		{
+			OnAccess(addr, size, WATCH_READ, 0);
+		}
+	}
+
+	__forceinline void CheckWrite(const u64 addr, const u32 size, const u64 value)
+	{
+		if(m_watch_count && (TestPage(m_watch_pages, addr) || TestPage(m_watch_pages, addr + size - 1)))
+		{
+			OnAccess(addr, size, WATCH_WRITE, value);
+		}
+	}
+
+	void AddWatchPoint(const u32 addr, const u32 size, const u32 type);
+	bool RemoveWatchPoint(const u32 addr);
+	std::vector<WatchPoint> GetWatchPoints();
+
+	// description of the last watchpoint hit (empty if none)
+	std::string GetLastHit();
+
+	void Clear();
+};
@@ -1,11 +1,22 @@
 #include "stdafx.h"
 #include "CPUThread.h"
+#include "Emu/SysCalls/HLEProfiler.h"
+#include "GuestProfiler.h"
+#include "Headless.h"
 
 reservation_struct reservation;
 
+// set by Task(): the other named threads (RSX, HLE, GUI) aren't CPU threads
+#ifdef _WIN32
+__declspec(thread)
+#else
+thread_local
+#endif
+CPUThread* g_tls_cpu_thread = nullptr;
+
 CPUThread* GetCurrentCPUThread()
 {
-	return (CPUThread*)GetCurrentNamedThread();
+	return g_tls_cpu_thread;
 }
 
 CPUThread::CPUThread(CPUThreadType type)
@@ -20,7 +31,13 @@ CPUThread::CPUThread(CPUThreadType type)
 	, m_dec(nullptr)
 	, m_is_step(false)
 	, m_is_branch(false)
+	, m_block_pc(0)
 	, m_status(Stopped)
+	, m_spin_start(0)
+	, m_spin_end(0)
+	, m_spin_count(0)
+	, m_spin_key(0)
+	, m_spin_rejected(false)
 {
 }
 
@@ -48,6 +65,10 @@ void CPUThread::Reset()
 	SetPc(0);
 	cycle = 0;
 	m_is_branch = false;
+	m_block_pc = 0;
+	CancelSpin();
+	m_spin_start = m_spin_end = 0;
+	m_spin_count = 0;
 
 	m_status = Stopped;
 	m_error = 0;
@@ -149,6 +170,7 @@ void CPUThread::SetBranch(const u64 pc, bool record_branch)
 
 	m_is_branch = true;
 	nPC = pc;
+	m_block_pc = pc;
 
 	if(record_branch)
 		CallStackBranch(pc);
@@ -182,6 +204,60 @@ wxArrayString CPUThread::ErrorToString(const u32 error)
 	return earr;
 }
 
+void CPUThread::CheckSpin(const u64 start, const u64 end)
+{
+	if(start != m_spin_start || end != m_spin_end)
+	{
+		CancelSpin();
+
+		m_spin_start = start;
+		m_spin_end = end;
+		m_spin_count = 0;
+		m_spin_rejected = end - start >= ParkingLot::max_loop_size;
+		return;
+	}
+
+	if(m_spin_rejected)
+	{
+		return;
+	}
+
+	if(m_spin_key)
+	{
+		// the key wasn't notified while the last iteration polled: nothing will change before it is
+		const u64 key = m_spin_key;
+		m_spin_key = 0;
+		m_spin_count = 0;
+		g_parking_lot.Wait(key, m_spin_generation, m_spin_kind);
+		return;
+	}
+
+	if(++m_spin_count < ParkingLot::park_threshold)
+	{
+		return;
+	}
+
+	m_spin_key = GetSpinKey(start, end, m_spin_kind);
+
+	if(m_spin_key)
+	{
+		m_spin_generation = g_parking_lot.Prepare(m_spin_key);
+	}
+	else
+	{
+		m_spin_rejected = true;
+	}
+}
+
+void CPUThread::CancelSpin()
+{
+	if(m_spin_key)
+	{
+		g_parking_lot.Cancel(m_spin_key);
+		m_spin_key = 0;
+	}
+}
+
 void CPUThread::Run()
 {
 	if(!IsStopped())
@@ -190,7 +266,7 @@ void CPUThread::Run()
 	Reset();
 	
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_START_THREAD, this);
+	SendDbgCommand(DID_START_THREAD, this);
 #endif
 
 	m_status = Running;
@@ -202,7 +278,7 @@ void CPUThread::Run()
 	Emu.CheckStatus();
 
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_STARTED_THREAD, this);
+	SendDbgCommand(DID_STARTED_THREAD, this);
 #endif
 }
 
@@ -211,7 +287,7 @@ void CPUThread::Resume()
 	if(!IsPaused()) return;
 
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_RESUME_THREAD, this);
+	SendDbgCommand(DID_RESUME_THREAD, this);
 #endif
 
 	m_status = Running;
@@ -221,7 +297,7 @@ void CPUThread::Resume()
 	ThreadBase::Start();
 
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_RESUMED_THREAD, this);
+	SendDbgCommand(DID_RESUMED_THREAD, this);
 #endif
 }
 
@@ -230,7 +306,7 @@ void CPUThread::Pause()
 	if(!IsRunning()) return;
 
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_PAUSE_THREAD, this);
+	SendDbgCommand(DID_PAUSE_THREAD, this);
 #endif
 
 	m_status = Paused;
@@ -239,7 +315,7 @@ void CPUThread::Pause()
 
 	// ThreadBase::Stop(); // "Abort() called" exception
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_PAUSED_THREAD, this);
+	SendDbgCommand(DID_PAUSED_THREAD, this);
 #endif
 }
 
@@ -248,7 +324,7 @@ void CPUThread::Stop()
 	if(IsStopped()) return;
 
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_STOP_THREAD, this);
+	SendDbgCommand(DID_STOP_THREAD, this);
 #endif
 
 	m_status = Stopped;
@@ -264,7 +340,7 @@ void CPUThread::Stop()
 	Emu.CheckStatus();
 
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_STOPED_THREAD, this);
+	SendDbgCommand(DID_STOPED_THREAD, this);
 #endif
 }
 
@@ -272,7 +348,7 @@ void CPUThread::Exec()
 {
 	m_is_step = false;
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_EXEC_THREAD, this);
+	SendDbgCommand(DID_EXEC_THREAD, this);
 #endif
 
 	if(IsRunning())
@@ -283,15 +359,15 @@ void CPUThread::ExecOnce()
 {
 	m_is_step = true;
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_EXEC_THREAD, this);
+	SendDbgCommand(DID_EXEC_THREAD, this);
 #endif
 	m_status = Running;
 	ThreadBase::Start();
 	ThreadBase::Stop(true,false);
 	m_status = Paused;
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_PAUSE_THREAD, this);
-	wxGetApp().SendDbgCommand(DID_PAUSED_THREAD, this);
+	SendDbgCommand(DID_PAUSE_THREAD, this);
+	SendDbgCommand(DID_PAUSED_THREAD, this);
 #endif
 }
 
@@ -299,17 +375,16 @@ void CPUThread::Task()
 {
 	if (Ini.HLELogging.GetValue()) ConLog.Write("%s enter", CPUThread::GetFName().c_str());
 
-	const std::vector<u64>& bp = Emu.GetBreakPoints();
+	g_tls_cpu_thread = this;
+	BreakPointManager& bp = Emu.GetBreakPoints();
+	GuestOpCounts* op_counts = g_guest_profiler.AcquireOpCounts(m_type);
+	const bool spin_wait = Ini.CPUThreadParking.GetValue();
 
 	try
 	{
-		for(uint i=0; i<bp.size(); ++i)
+		if(bp.IsBreakPoint(m_offset + PC))
 		{
-			if(bp[i] == m_offset + PC)
-			{
-				Emu.Pause();
-				break;
-			}
+			Emu.Pause();
 		}
 
 		while(true)
@@ -327,8 +402,12 @@ void CPUThread::Task()
 				continue;
 			}
 
+			if(op_counts) op_counts->Count(Memory.Read32(PC + m_offset));
+
+			const u64 pc = PC;
 			Step();
 			NextPc(m_dec->DecodeMemory(PC + m_offset));
+			cycle++;
 
 			if(status == CPUThread_Step)
 			{
@@ -336,13 +415,14 @@ void CPUThread::Task()
 				break;
 			}
 
-			for(uint i=0; i<bp.size(); ++i)
+			if(spin_wait && PC <= pc)
 			{
-				if(bp[i] == PC)
-				{
-					Emu.Pause();
-					break;
-				}
+				CheckSpin(PC, pc);
+			}
+
+			if(bp.IsBreakPoint(PC))
+			{
+				Emu.Pause();
 			}
 		}
 	}
@@ -359,6 +439,12 @@ void CPUThread::Task()
 		ConLog.Success("Exit Code: %d", exitcode);
 	}
 
+	CancelSpin();
+	g_guest_profiler.ReleaseOpCounts(op_counts);
+	g_hle_profiler.ReleaseThread();
+	if (g_headless_report.IsEnabled()) g_headless_report.AddThread(GetFName(), GetTypeString(), cycle);
+	g_tls_cpu_thread = nullptr;
+
 	if (Ini.HLELogging.GetValue()) ConLog.Write("%s leave", CPUThread::GetFName().c_str());
 }
 
@@ -61,6 +61,15 @@ protected:
 
 	CPUDecoder* m_dec;
 
+	// busy-wait detection (see SpinWait.h)
+	u64 m_spin_start; // branch target of the repeated loop
+	u64 m_spin_end; // address of its backward branch
+	u32 m_spin_count; // consecutive iterations
+	u64 m_spin_key; // parking key prepared during the last iteration (0 if none)
+	u64 m_spin_generation;
+	SpinWaitKind m_spin_kind;
+	bool m_spin_rejected; // the loop doesn't only poll
+
 public:
 	virtual void InitRegs()=0;
 
@@ -122,8 +131,9 @@ public:
 	u64 entry;
 	u64 PC;
 	u64 nPC;
-	u64 cycle;
+	u64 cycle; // instructions executed since the last Reset()
 	bool m_is_branch;
+	u64 m_block_pc; // target of the last taken branch (start of the current block)
 
 protected:
 	CPUThread(CPUThreadType type);
@@ -247,6 +257,14 @@ protected:
 	virtual void DoResume()=0;
 	virtual void DoStop()=0;
 
+	// called after a backward branch from end to start
+	void CheckSpin(const u64 start, const u64 end);
+	void CancelSpin();
+
+	// the parking key of the loop [start, end] (end is the address of its backward branch) if
+	// it only polls the guest memory or a channel without any other effect, 0 otherwise
+	virtual u64 GetSpinKey(const u64 start, const u64 end, SpinWaitKind& kind) { return 0; }
+
 protected:
 	virtual void Step() {}
 	virtual void Task();
@@ -36,11 +36,19 @@ CPUThread& CPUThreadManager::AddThread(CPUThreadType type)
 	default: assert(0);
 	}
 	
-	new_thread->SetId(Emu.GetIdManager().GetNewID(fmt::Format("%s Thread", new_thread->GetTypeString().c_str()), new_thread));
+	const u32 id = Emu.GetIdManager().GetNewID(fmt::Format("%s Thread", new_thread->GetTypeString().c_str()), new_thread);
+	if(!id)
+	{
+		// the thread stays owned by the manager: RemoveThread(0) deletes it
+		ConLog.Error("AddThread(): no ID left");
+		Emu.Pause();
+	}
+
+	new_thread->SetId(id);
 
 	m_threads.push_back(new_thread);
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_CREATE_THREAD, new_thread);
+	SendDbgCommand(DID_CREATE_THREAD, new_thread);
 #endif
 
 	return *new_thread;
@@ -70,11 +78,14 @@ void CPUThreadManager::RemoveThread(const u32 id)
 	if (thr)
 	{
 #ifndef QT_UI
-		wxGetApp().SendDbgCommand(DID_REMOVE_THREAD, thr);
+		SendDbgCommand(DID_REMOVE_THREAD, thr);
 #endif
 		thr->Close();
 
 		m_threads.erase(m_threads.begin() + thread_index);
+
+		// a thread without ID isn't deleted by the ID manager
+		if (!id) delete thr;
 	}
 
 	// Removing the ID should trigger the actual deletion of the thread
@@ -22,6 +22,17 @@ public:
 	s32 GetThreadNumById(CPUThreadType type, u32 id);
 	CPUThread* GetThread(u32 id);
 
+	// calls func for every thread while holding the thread list lock
+	template<typename F> void ForEachThread(F func)
+	{
+		std::lock_guard<std::mutex> lock(m_mtx_thread);
+
+		for(u32 i=0; i<m_threads.size(); ++i)
+		{
+			func(*m_threads[i]);
+		}
+	}
+
 	void Exec();
 	void Task();
 };
@@ -0,0 +1,446 @@
+#include "stdafx.h"
+#include "GuestProfiler.h"
+#include "Emu/CPU/CPUThreadManager.h"
+#include "Emu/Cell/PPUDecoder.h"
+#include "Emu/Cell/PPUDisAsm.h"
+#include "Emu/Cell/SPUThread.h"
+#include "Emu/Cell/SPUDecoder.h"
+#include "Emu/Cell/SPUDisAsm.h"
+#include <algorithm>
+#include <fstream>
+
+GuestProfiler g_guest_profiler;
+
+u32 GuestProfiler::OpcodeKey(CPUThreadType type, u32 code)
+{
+	if (type == CPU_THREAD_PPU)
+	{
+		// primary opcode and the extended opcode field of the instruction forms that have one
+		const u32 primary = code >> 26;
+		u32 ext = 0;
+
+		switch (primary)
+		{
+		case 4: ext = code & 0x7ff; break;
+		case 19:
+		case 31:
+		case 63: ext = (code >> 1) & 0x3ff; break;
+		case 30: ext = (code >> 1) & 0xf; break;
+		case 58:
+		case 62: ext = code & 0x3; break;
+		case 59: ext = (code >> 1) & 0x1f; break;
+		}
+
+		return primary << 11 | ext;
+	}
+
+	// SPU opcodes are 4 to 11 bits long: keys of short opcodes include operand bits and
+	// are merged by mnemonic in the report
+	return code >> 21;
+}
+
+u32 GuestProfiler::OpcodeKeyCount(CPUThreadType type)
+{
+	switch (type)
+	{
+	case CPU_THREAD_PPU: return 64 << 11;
+	case CPU_THREAD_SPU:
+	case CPU_THREAD_RAW_SPU: return 1 << 11;
+	}
+
+	return 0;
+}
+
+GuestOpCounts::GuestOpCounts(CPUThreadType type)
+	: type(type)
+	, counts(GuestProfiler::OpcodeKeyCount(type))
+	, sample(GuestProfiler::OpcodeKeyCount(type))
+{
+}
+
+void GuestOpCounts::Count(u32 code)
+{
+	const u32 key = GuestProfiler::OpcodeKey(type, code);
+
+	if (!counts[key]++)
+	{
+		sample[key] = code;
+	}
+}
+
+void GuestOpCounts::Merge(const GuestOpCounts& other)
+{
+	for (u32 i = 0; i < counts.size(); i++)
+	{
+		if (other.counts[i])
+		{
+			if (!counts[i]) sample[i] = other.sample[i];
+			counts[i] += other.counts[i];
+		}
+	}
+}
+
+GuestProfiler::GuestProfiler()
+	: m_sampling(false)
+	, m_count_opcodes(false)
+	, m_period_ms(1)
+	, m_sampler(nullptr)
+	, m_symbols_sorted(true)
+	, m_total_samples(0)
+	, m_retired_ppu(new GuestOpCounts(CPU_THREAD_PPU))
+	, m_retired_spu(new GuestOpCounts(CPU_THREAD_SPU))
+{
+}
+
+GuestProfiler::~GuestProfiler()
+{
+	EnableSampling(false);
+}
+
+void GuestProfiler::AddFunction(u64 addr, u64 size, const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Symbol sym = { addr, size, name };
+	m_functions.push_back(sym);
+	m_symbols_sorted = false;
+}
+
+void GuestProfiler::AddSegment(u64 addr, u64 size, const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Symbol sym = { addr, size, name };
+	m_segments.push_back(sym);
+	m_symbols_sorted = false;
+}
+
+void GuestProfiler::ClearSymbols()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_functions.clear();
+	m_segments.clear();
+}
+
+void GuestProfiler::SortSymbols()
+{
+	if (m_symbols_sorted) return;
+
+	auto by_addr = [](const Symbol& a, const Symbol& b) { return a.addr < b.addr; };
+	std::sort(m_functions.begin(), m_functions.end(), by_addr);
+	std::sort(m_segments.begin(), m_segments.end(), by_addr);
+	m_symbols_sorted = true;
+}
+
+const GuestProfiler::Symbol* GuestProfiler::Find(const std::vector<Symbol>& list, u64 addr) const
+{
+	// last range starting at or before addr
+	auto it = std::upper_bound(list.begin(), list.end(), addr, [](u64 addr, const Symbol& sym) { return addr < sym.addr; });
+
+	if (it != list.begin() && addr - (--it)->addr < it->size)
+	{
+		return &*it;
+	}
+
+	return nullptr;
+}
+
+std::string GuestProfiler::Symbolize(u64 addr)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	SortSymbols();
+
+	if (const Symbol* func = Find(m_functions, addr))
+	{
+		return addr == func->addr ? func->name : fmt::Format("%s+0x%llx", func->name.c_str(), addr - func->addr);
+	}
+
+	if (const Symbol* seg = Find(m_segments, addr))
+	{
+		return fmt::Format("%s+0x%llx", seg->name.c_str(), addr - seg->addr);
+	}
+
+	return fmt::Format("0x%llx", addr);
+}
+
+void GuestProfiler::EnableSampling(bool enable, u32 period_ms)
+{
+	thread* sampler = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_period_ms = std::max<u32>(period_ms, 1);
+		if (enable == m_sampling) return;
+
+		m_sampling = enable;
+
+		if (enable)
+		{
+			m_sampler = new thread("Guest Profiler", std::bind(&GuestProfiler::SamplerTask, this));
+			return;
+		}
+
+		std::swap(sampler, m_sampler);
+	}
+
+	sampler->join();
+	delete sampler;
+}
+
+void GuestProfiler::SamplerTask()
+{
+	while (m_sampling)
+	{
+		if (Emu.IsRunning())
+		{
+			Emu.GetCPU().ForEachThread([this](CPUThread& thr)
+			{
+				if (thr.IsRunning())
+				{
+					Sample(thr);
+				}
+			});
+		}
+
+		Sleep(m_period_ms);
+	}
+}
+
+void GuestProfiler::Sample(CPUThread& thr)
+{
+	// registers of a running thread: the values may be slightly inconsistent with each other,
+	// which doesn't matter for statistics
+	const u64 pc = thr.PC;
+	const u64 block = thr.m_block_pc;
+	u64 caller = 0;
+	std::string block_name, caller_name;
+
+	switch (thr.GetType())
+	{
+	case CPU_THREAD_PPU:
+		caller = static_cast<PPUThread&>(thr).LR;
+		block_name = Symbolize(block ? block : pc);
+		caller_name = Symbolize(caller);
+	break;
+
+	case CPU_THREAD_SPU:
+	case CPU_THREAD_RAW_SPU:
+		// local store addresses
+		caller = static_cast<SPUThread&>(thr).GPR[0]._u32[3];
+		block_name = fmt::Format("ls:0x%05llx", block ? block : pc);
+		caller_name = fmt::Format("ls:0x%05llx", caller);
+	break;
+
+	default:
+		block_name = fmt::Format("0x%llx", block ? block : pc);
+		caller_name = "?";
+	break;
+	}
+
+	const std::string name = thr.GetFName();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_stacks[name + ";" + caller_name + ";" + block_name]++;
+	m_blocks[std::make_pair(name, block ? block : pc)]++;
+	m_total_samples++;
+}
+
+GuestOpCounts* GuestProfiler::AcquireOpCounts(CPUThreadType type)
+{
+	if (!m_count_opcodes || !OpcodeKeyCount(type))
+	{
+		return nullptr;
+	}
+
+	GuestOpCounts* counts = new GuestOpCounts(type);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_op_counts.push_back(counts);
+	return counts;
+}
+
+void GuestProfiler::ReleaseOpCounts(GuestOpCounts* counts)
+{
+	if (!counts) return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	(counts->type == CPU_THREAD_PPU ? m_retired_ppu : m_retired_spu)->Merge(*counts);
+	m_op_counts.erase(std::find(m_op_counts.begin(), m_op_counts.end(), counts));
+	delete counts;
+}
+
+void GuestProfiler::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_stacks.clear();
+	m_blocks.clear();
+	m_total_samples = 0;
+	m_retired_ppu.reset(new GuestOpCounts(CPU_THREAD_PPU));
+	m_retired_spu.reset(new GuestOpCounts(CPU_THREAD_SPU));
+
+	// counters of running threads are owned by them: leave them alone
+}
+
+u64 GuestProfiler::GetTotalSamples()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_total_samples;
+}
+
+std::vector<GuestBlockStats> GuestProfiler::GetHotBlocks(u32 count)
+{
+	std::vector<GuestBlockStats> res;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto& it : m_blocks)
+		{
+			GuestBlockStats stats = { it.first.first, it.first.second, it.second };
+			res.push_back(stats);
+		}
+	}
+
+	std::sort(res.begin(), res.end(), [](const GuestBlockStats& a, const GuestBlockStats& b)
+	{
+		return a.samples > b.samples;
+	});
+
+	if (res.size() > count)
+	{
+		res.resize(count);
+	}
+
+	return res;
+}
+
+std::vector<std::pair<std::string, u64>> GuestProfiler::CollectOpcodes(CPUThreadType type)
+{
+	GuestOpCounts total(type);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		total.Merge(type == CPU_THREAD_PPU ? *m_retired_ppu : *m_retired_spu);
+		for (u32 i = 0; i < m_op_counts.size(); i++)
+		{
+			const bool is_ppu = m_op_counts[i]->type == CPU_THREAD_PPU;
+			if (is_ppu == (type == CPU_THREAD_PPU))
+			{
+				total.Merge(*m_op_counts[i]);
+			}
+		}
+	}
+
+	// name the keys with the disassembler, merge keys of the same mnemonic
+	std::unique_ptr<PPCDecoder> decoder;
+	CPUDisAsm* disasm;
+
+	if (type == CPU_THREAD_PPU)
+	{
+		PPUDisAsm* dis_asm = new PPUDisAsm(CPUDisAsm_CompilerElfMode);
+		decoder.reset(new PPUDecoder(dis_asm));
+		disasm = dis_asm;
+	}
+	else
+	{
+		SPUDisAsm& dis_asm = *new SPUDisAsm(CPUDisAsm_CompilerElfMode);
+		decoder.reset(new SPUDecoder(dis_asm));
+		disasm = &dis_asm;
+	}
+
+	disasm->dump_pc = 0;
+
+	std::map<std::string, u64> by_name;
+	for (u32 i = 0; i < total.counts.size(); i++)
+	{
+		if (!total.counts[i]) continue;
+
+		disasm->last_opcode.clear();
+		decoder->Decode(total.sample[i]);
+
+		const std::string& text = disasm->last_opcode;
+		const size_t end = text.find_first_of(" \t\n");
+		const std::string name = text.empty() ? fmt::Format("?%08x", total.sample[i]) : text.substr(0, end);
+
+		by_name[name] += total.counts[i];
+	}
+
+	std::vector<std::pair<std::string, u64>> res(by_name.begin(), by_name.end());
+	std::sort(res.begin(), res.end(), [](const std::pair<std::string, u64>& a, const std::pair<std::string, u64>& b)
+	{
+		return a.second > b.second;
+	});
+
+	return res;
+}
+
+bool GuestProfiler::ExportFolded(const std::string& path)
+{
+	std::ofstream out(path);
+	if (!out)
+	{
+		ConLog.Error("GuestProfiler: can't create '%s'", path.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (auto& it : m_stacks)
+	{
+		// frame names must not contain spaces or semicolons, thread names may
+		std::string stack = it.first;
+		std::replace(stack.begin(), stack.end(), ' ', '_');
+
+		out << stack << " " << it.second << "\n";
+	}
+
+	return true;
+}
+
+bool GuestProfiler::ExportReport(const std::string& path, u32 top_count)
+{
+	std::ofstream out(path);
+	if (!out)
+	{
+		ConLog.Error("GuestProfiler: can't create '%s'", path.c_str());
+		return false;
+	}
+
+	const u64 total = std::max<u64>(GetTotalSamples(), 1);
+	const std::vector<GuestBlockStats> blocks = GetHotBlocks(top_count);
+
+	out << fmt::Format("Hot blocks (top %d, %llu samples):\n", top_count, GetTotalSamples());
+	out << "  samples       %  block               symbol / thread\n";
+
+	for (u32 i = 0; i < blocks.size(); i++)
+	{
+		const GuestBlockStats& b = blocks[i];
+		const bool is_spu = b.thread.compare(0, 3, "SPU") == 0 || b.thread.compare(0, 6, "RawSPU") == 0;
+
+		out << fmt::Format("%9llu  %5.2f%%  0x%016llx  %s  [%s]\n", b.samples, b.samples * 100.0 / total, b.block,
+			is_spu ? fmt::Format("ls:0x%05llx", b.block).c_str() : Symbolize(b.block).c_str(), b.thread.c_str());
+	}
+
+	const CPUThreadType types[] = { CPU_THREAD_PPU, CPU_THREAD_SPU };
+	for (u32 t = 0; t < 2; t++)
+	{
+		const std::vector<std::pair<std::string, u64>> ops = CollectOpcodes(types[t]);
+		if (ops.empty()) continue;
+
+		u64 executed = 0;
+		for (u32 i = 0; i < ops.size(); i++) executed += ops[i].second;
+
+		out << fmt::Format("\n%s opcodes (%llu executed):\n", t ? "SPU" : "PPU", executed);
+		for (u32 i = 0; i < ops.size(); i++)
+		{
+			out << fmt::Format("%14llu  %5.2f%%  %s\n", ops[i].second, ops[i].second * 100.0 / executed, ops[i].first.c_str());
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <map>
+#include <unordered_map>
+
+class CPUThread;
+enum CPUThreadType : unsigned char;
+
+// Sampling profiler for guest code.
+// A host thread periodically snapshots PC, the start of the current block (target of the
+// last taken branch) and the link register (PPU: LR, SPU: $0) of every running CPUThread.
+// Samples are symbolized against ranges registered by the loaders: HLE import stubs,
+// statically hooked functions and loaded segments. Optionally, every thread also counts
+// executed opcodes (one extra memory read per instruction while enabled).
+// Results: folded stacks ("thread;caller;block count", for flamegraph.pl) and a text report
+// with the top-N hot blocks and the opcode histogram.
+
+// per-thread opcode counters, written by the owner thread only
+struct GuestOpCounts
+{
+	CPUThreadType type;
+	std::vector<u64> counts; // indexed by GuestProfiler::OpcodeKey()
+	std::vector<u32> sample; // an instruction word of every counted key (for naming)
+
+	GuestOpCounts(CPUThreadType type);
+
+	void Count(u32 code);
+	void Merge(const GuestOpCounts& other);
+};
+
+struct GuestBlockStats
+{
+	std::string thread;
+	u64 block;
+	u64 samples;
+};
+
+class GuestProfiler
+{
+	struct Symbol
+	{
+		u64 addr;
+		u64 size;
+		std::string name;
+	};
+
+	std::atomic<bool> m_sampling;
+	std::atomic<bool> m_count_opcodes;
+	u32 m_period_ms;
+
+	std::mutex m_mutex; // everything below
+	thread* m_sampler;
+	std::vector<Symbol> m_functions; // sorted by address (on use)
+	std::vector<Symbol> m_segments;
+	bool m_symbols_sorted;
+
+	// "thread;caller;block" -> samples
+	std::unordered_map<std::string, u64> m_stacks;
+	// (thread, block) -> samples
+	std::map<std::pair<std::string, u64>, u64> m_blocks;
+	u64 m_total_samples;
+
+	std::vector<GuestOpCounts*> m_op_counts;
+	std::unique_ptr<GuestOpCounts> m_retired_ppu;
+	std::unique_ptr<GuestOpCounts> m_retired_spu;
+
+	void SamplerTask();
+	void Sample(CPUThread& thr);
+	void SortSymbols();
+	const Symbol* Find(const std::vector<Symbol>& list, u64 addr) const;
+	std::vector<std::pair<std::string, u64>> CollectOpcodes(CPUThreadType type);
+
+public:
+	GuestProfiler();
+	~GuestProfiler();
+
+	// symbol ranges (guest addresses); cleared when a new executable is loaded
+	void AddFunction(u64 addr, u64 size, const std::string& name);
+	void AddSegment(u64 addr, u64 size, const std::string& name);
+	void ClearSymbols();
+	std::string Symbolize(u64 addr);
+
+	void EnableSampling(bool enable, u32 period_ms = 1);
+	bool IsSampling() const { return m_sampling; }
+
+	// takes effect for threads started afterwards
+	void EnableOpcodeCounts(bool enable) { m_count_opcodes = enable; }
+	bool IsCountingOpcodes() const { return m_count_opcodes; }
+
+	// called by CPU threads around their execution loop
+	GuestOpCounts* AcquireOpCounts(CPUThreadType type);
+	void ReleaseOpCounts(GuestOpCounts* counts);
+
+	void Reset();
+
+	u64 GetTotalSamples();
+	std::vector<GuestBlockStats> GetHotBlocks(u32 count);
+
+	bool ExportFolded(const std::string& path);
+	bool ExportReport(const std::string& path, u32 top_count = 100);
+
+	static u32 OpcodeKey(CPUThreadType type, u32 code);
+	static u32 OpcodeKeyCount(CPUThreadType type);
+};
+
+extern GuestProfiler g_guest_profiler;
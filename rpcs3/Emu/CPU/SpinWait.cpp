@@ -0,0 +1,128 @@
+#include "stdafx.h"
+#include "SpinWait.h"
+#include "Emu/SysCalls/lv2/SC_Time.h"
+#include "Headless.h"
+
+ParkingLot g_parking_lot;
+
+ParkingLot::ParkingLot()
+	: m_waiters(0)
+{
+	for(u32 i = 0; i < bucket_count; i++)
+	{
+		m_buckets[i].generation = 0;
+		m_buckets[i].waiters = 0;
+	}
+
+	ResetStats();
+}
+
+u64 ParkingLot::Prepare(const u64 key)
+{
+	Bucket& b = GetBucket(key);
+	std::lock_guard<std::mutex> lock(b.mutex);
+
+	b.waiters++;
+	m_waiters++;
+	return b.generation;
+}
+
+bool ParkingLot::Wait(const u64 key, const u64 generation, const SpinWaitKind kind, const u32 timeout_ms)
+{
+	Bucket& b = GetBucket(key);
+	const u64 start = get_system_time();
+	bool notified;
+
+	{
+		std::unique_lock<std::mutex> lock(b.mutex);
+
+		notified = b.cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&]() { return b.generation != generation; });
+
+		b.waiters--;
+		m_waiters--;
+	}
+
+	m_parks[kind]++;
+	if(notified) m_notified++;
+	m_wait_us += get_system_time() - start;
+
+	return notified;
+}
+
+bool ParkingLot::IsEmuStopped()
+{
+	return Emu.IsStopped();
+}
+
+void ParkingLot::Cancel(const u64 key)
+{
+	Bucket& b = GetBucket(key);
+	std::lock_guard<std::mutex> lock(b.mutex);
+
+	b.waiters--;
+	m_waiters--;
+}
+
+void ParkingLot::NotifySlow(const u64 key)
+{
+	Bucket& b = GetBucket(key);
+	if(!b.waiters) return;
+
+	std::lock_guard<std::mutex> lock(b.mutex);
+
+	b.generation++;
+	b.cond.notify_all();
+}
+
+void ParkingLot::NotifyAll()
+{
+	for(u32 i = 0; i < bucket_count; i++)
+	{
+		Bucket& b = m_buckets[i];
+		std::lock_guard<std::mutex> lock(b.mutex);
+
+		b.generation++;
+		b.cond.notify_all();
+	}
+}
+
+SpinWaitStats ParkingLot::GetStats() const
+{
+	SpinWaitStats stats;
+
+	for(u32 i = 0; i < SPIN_WAIT_KIND_COUNT; i++)
+	{
+		stats.parks[i] = m_parks[i];
+	}
+
+	stats.notified = m_notified;
+	stats.wait_us = m_wait_us;
+	return stats;
+}
+
+void ParkingLot::ResetStats()
+{
+	for(u32 i = 0; i < SPIN_WAIT_KIND_COUNT; i++)
+	{
+		m_parks[i] = 0;
+	}
+
+	m_notified = 0;
+	m_wait_us = 0;
+}
+
+void ParkingLot::ReportStats(const std::string& title)
+{
+	const SpinWaitStats stats = GetStats();
+	u64 total = 0;
+	for(u32 i = 0; i < SPIN_WAIT_KIND_COUNT; i++) total += stats.parks[i];
+
+	if(total)
+	{
+		ConLog.Write("Spin wait (%s): %llu parks (memory: %llu, reservation: %llu, channel: %llu, sync: %llu), %llu notified, %.3f s parked",
+			title.c_str(), total, stats.parks[SPIN_WAIT_MEMORY], stats.parks[SPIN_WAIT_RESERVATION], stats.parks[SPIN_WAIT_CHANNEL],
+			stats.parks[SPIN_WAIT_SYNC], stats.notified, stats.wait_us / 1000000.0);
+	}
+
+	if(g_headless_report.IsEnabled()) g_headless_report.SetSpinWait(stats);
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+// Busy-wait detection support.
+// A CPUThread repeating a short loop asks its type (GetSpinKey) whether the loop only polls:
+// loads from one 128-byte line of guest memory, a SPU channel count or a GETLLAR reservation,
+// without stores, calls or state carried between iterations. Such a thread is parked on the
+// key of what it polls until the key is notified (guest memory writes through MemoryBase,
+// DMA, SPU channel updates) or a timeout expires, then it resumes the loop. Writes done
+// through direct pointers to guest memory are only seen after the timeout.
+// The HLE synchronization objects (cellSync, SMutex) wait on the same keys (WaitUntil): their
+// updates notify the key, and the guest stores to an address in guest memory notify its line.
+
+enum SpinWaitKind
+{
+	SPIN_WAIT_MEMORY,      // plain loads (PPU, SPU local storage)
+	SPIN_WAIT_RESERVATION, // lwarx/ldarx, GETLLAR
+	SPIN_WAIT_CHANNEL,     // SPU channel count (rchcnt) or blocking channel access
+	SPIN_WAIT_SYNC,        // HLE synchronization object (WaitUntil)
+	SPIN_WAIT_KIND_COUNT,
+};
+
+struct SpinWaitStats
+{
+	u64 parks[SPIN_WAIT_KIND_COUNT];
+	u64 notified; // woken by a notification (the rest timed out)
+	u64 wait_us;  // total time spent parked
+};
+
+class ParkingLot
+{
+	static const u32 bucket_count = 256;
+
+	struct Bucket
+	{
+		std::mutex mutex;
+		std::condition_variable cond;
+		u64 generation; // incremented by every notification of a key of the bucket
+		std::atomic<u32> waiters;
+	};
+
+	Bucket m_buckets[bucket_count];
+	std::atomic<u32> m_waiters;
+
+	std::atomic<u64> m_parks[SPIN_WAIT_KIND_COUNT];
+	std::atomic<u64> m_notified;
+	std::atomic<u64> m_wait_us;
+
+	Bucket& GetBucket(const u64 key)
+	{
+		return m_buckets[(key ^ (key >> 7) ^ (key >> 17)) % bucket_count];
+	}
+
+	void NotifySlow(const u64 key);
+	static bool IsEmuStopped();
+
+public:
+	// the longest loop considered (bytes) and the iterations repeated before parking
+	static const u32 max_loop_size = 32 * 4;
+	static const u32 park_threshold = 64;
+	// the longest park (ms): the guest is still polling, slowly
+	static const u32 park_timeout = 1;
+	// the longest wait of WaitUntil (ms) before the condition is checked again
+	static const u32 sync_timeout = 10;
+
+	ParkingLot();
+
+	// keys: 128-byte lines of guest memory or host objects (SPU channels)
+	static u64 LineKey(const u64 addr) { return (addr & 0xffffffff) & ~127ULL; }
+	static u64 ObjectKey(const void* ptr) { return (u64)ptr | (1ULL << 63); }
+
+	// registers a waiter of the key and returns its generation: a notification of the key
+	// after Prepare() makes the following Wait() return immediately
+	u64 Prepare(const u64 key);
+	// blocks until the key is notified or the timeout expires, returns true if notified
+	bool Wait(const u64 key, const u64 generation, const SpinWaitKind kind, const u32 timeout_ms = park_timeout);
+	// unregisters a waiter that doesn't call Wait()
+	void Cancel(const u64 key);
+
+	// blocks until pred() is true, returns false if the emulator is stopped first; the key must
+	// be notified after the changes of the condition (a change without notification is seen
+	// after sync_timeout), timeout_ms: 0 for none (returns false when it expires)
+	template<typename F> bool WaitUntil(const u64 key, F pred, const u32 timeout_ms = 0)
+	{
+		if(pred()) return true;
+
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+		while(true)
+		{
+			const u64 generation = Prepare(key);
+
+			if(pred())
+			{
+				Cancel(key);
+				return true;
+			}
+
+			u32 wait = sync_timeout;
+
+			if(timeout_ms)
+			{
+				const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+				if(left < (s64)wait) wait = left > 0 ? (u32)left : 0;
+			}
+
+			if(IsEmuStopped() || !wait)
+			{
+				Cancel(key);
+				return false;
+			}
+
+			Wait(key, generation, SPIN_WAIT_SYNC, wait);
+		}
+	}
+
+	__forceinline void Notify(const u64 key)
+	{
+		if(m_waiters) NotifySlow(key);
+	}
+
+	__forceinline void NotifyWrite(const u64 addr, const u32 size)
+	{
+		if(m_waiters && size)
+		{
+			// in key space: the lines wrap at 4 GB like the keys
+			const u64 last = LineKey(addr + size - 1);
+			for(u64 line = LineKey(addr); ; line = (line + 128) & 0xffffffff)
+			{
+				NotifySlow(line);
+				if(line == last) break;
+			}
+		}
+	}
+
+	// wakes every parked thread (emulator paused or stopped)
+	void NotifyAll();
+
+	SpinWaitStats GetStats() const;
+	void ResetStats();
+	// logs the statistics of the title run and adds them to the headless report
+	void ReportStats(const std::string& title);
+};
+
+extern ParkingLot g_parking_lot;
@@ -34,10 +34,17 @@ PPCThread& PPCThreadManager::AddThread(PPCThreadType type)
 	default: assert(0);
 	}
 	
-	new_thread->SetId(Emu.GetIdManager().GetNewID(fmt::Format("%s Thread", name), new_thread));
+	const u32 id = Emu.GetIdManager().GetNewID(fmt::Format("%s Thread", name), new_thread);
+	if(!id)
+	{
+		ConLog.Error("AddThread(): no ID left");
+		Emu.Pause();
+	}
+
+	new_thread->SetId(id);
 
 	m_threads.push_back(new_thread);
-	wxGetApp().SendDbgCommand(DID_CREATE_THREAD, new_thread);
+	SendDbgCommand(DID_CREATE_THREAD, new_thread);
 
 	return *new_thread;
 }
@@ -57,7 +64,7 @@ void PPCThreadManager::RemoveThread(const u32 id)
 		if(m_threads[i]->GetId() != id) continue;
 
 		PPCThread* thr = m_threads[i];
-		wxGetApp().SendDbgCommand(DID_REMOVE_THREAD, thr);
+		SendDbgCommand(DID_REMOVE_THREAD, thr);
 		if(thr->IsAlive())
 		{
 			thr->Close();
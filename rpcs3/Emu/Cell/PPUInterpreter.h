@@ -4,7 +4,9 @@
 #include "Emu/Memory/Memory.h"
 #include "Emu/Cell/PPUThread.h"
 #include "Emu/SysCalls/SysCalls.h"
+#include "Emu/Clock.h"
 #include "rpcs3.h"
+#include "Utilities/SSE.h"
 #include <stdint.h>
 #ifdef _MSC_VER
 #include <intrin.h>
@@ -96,20 +98,55 @@ private:
 		//__asm nop
 	}
 
-	float CheckVSCR_NJ(const float v) const
+	// VSCR.NJ: denormal operands and results of the vector float instructions are replaced by zero
+	__m128 CheckVSCR_NJ(__m128 v) const
 	{
-		if(!CPU.VSCR.NJ) return v;
+		return CPU.VSCR.NJ ? FlushDenormals(v) : v;
+	}
 
-		const int fpc = _fpclass(v);
-#ifdef __GNUG__
-		if(fpc == FP_SUBNORMAL)
-			return std::signbit(v) ? -0.0f : 0.0f;
-#else
-		if(fpc & _FPCLASS_ND) return -0.0f;
-		if(fpc & _FPCLASS_PD) return  0.0f;
-#endif
+	// VSCR.SAT is sticky: set if any element of the mask is set
+	void SetSAT(__m128i mask)
+	{
+		if(_mm_movemask_epi8(mask)) CPU.VSCR.SAT = 1;
+	}
+
+	// set VSCR.SAT if the saturated result differs from the exact one
+	void CheckSAT(__m128i saturated, __m128i exact)
+	{
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(saturated, exact)) != 0xffff) CPU.VSCR.SAT = 1;
+	}
 
-		return v;
+	// CR6 of the vector compares with Rc: all elements true (0x8), none true (0x2)
+	void UpdateCR6(__m128i result)
+	{
+		const int mask = _mm_movemask_epi8(result);
+		CPU.CR.cr6 = (mask == 0xffff ? 0x8 : 0) | (mask == 0 ? 0x2 : 0);
+	}
+
+	// signed 32-bit saturating add/sub
+	__m128i AddSatS32(__m128i a, __m128i b)
+	{
+		const __m128i result = _mm_add_epi32(a, b);
+		const __m128i over = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(a, result), _mm_xor_si128(b, result)), 31);
+		SetSAT(over);
+		return SelectBits(over, _mm_xor_si128(_mm_srai_epi32(a, 31), _mm_set1_epi32(0x7fffffff)), result);
+	}
+
+	__m128i SubSatS32(__m128i a, __m128i b)
+	{
+		const __m128i result = _mm_sub_epi32(a, b);
+		const __m128i over = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(a, b), _mm_xor_si128(a, result)), 31);
+		SetSAT(over);
+		return SelectBits(over, _mm_xor_si128(_mm_srai_epi32(a, 31), _mm_set1_epi32(0x7fffffff)), result);
+	}
+
+	// packssdw: _s16[0..3] from lo, _s16[4..7] from hi
+	__m128i PackSS32(__m128i lo, __m128i hi)
+	{
+		const __m128i result = _mm_packs_epi32(lo, hi);
+		CheckSAT(_mm_srai_epi32(_mm_unpacklo_epi16(result, result), 16), lo);
+		CheckSAT(_mm_srai_epi32(_mm_unpackhi_epi16(result, result), 16), hi);
+		return result;
 	}
 
 	bool CheckCondition(u32 bo, u32 bi)
@@ -183,622 +220,277 @@ private:
 	}
 	void VADDCUW(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = ~CPU.VPR[va]._u32[w] < CPU.VPR[vb]._u32[w];
-		}
+		CPU.VPR[vd]._m128i = _mm_srli_epi32(CmpGtU32(CPU.VPR[vb]._m128i, _mm_xor_si128(CPU.VPR[va]._m128i, _mm_set1_epi32(-1))), 31);
 	}
 	void VADDFP(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._f[w] = CPU.VPR[va]._f[w] + CPU.VPR[vb]._f[w];
-		}
+		CPU.VPR[vd]._m128 = CheckVSCR_NJ(_mm_add_ps(CheckVSCR_NJ(CPU.VPR[va]._m128), CheckVSCR_NJ(CPU.VPR[vb]._m128)));
 	}
 	void VADDSBS(u32 vd, u32 va, u32 vb)
 	{
-		for(u32 b=0; b<16; ++b)
-		{
-			s16 result = (s16)CPU.VPR[va]._s8[b] + (s16)CPU.VPR[vb]._s8[b];
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		const __m128i result = _mm_adds_epi8(a, b);
 
-			if (result > 0x7f)
-			{
-				CPU.VPR[vd]._s8[b] = 0x7f;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result < -0x80)
-			{
-				CPU.VPR[vd]._s8[b] = -0x80;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._s8[b] = result;
-		}
+		CheckSAT(result, _mm_add_epi8(a, b));
+		CPU.VPR[vd]._m128i = result;
 	}
 	void VADDSHS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			s32 result = (s32)CPU.VPR[va]._s16[h] + (s32)CPU.VPR[vb]._s16[h];
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		const __m128i result = _mm_adds_epi16(a, b);
 
-			if (result > 0x7fff)
-			{
-				CPU.VPR[vd]._s16[h] = 0x7fff;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result < -0x8000)
-			{
-				CPU.VPR[vd]._s16[h] = -0x8000;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._s16[h] = result;
-		}
+		CheckSAT(result, _mm_add_epi16(a, b));
+		CPU.VPR[vd]._m128i = result;
 	}
 	void VADDSWS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			s64 result = (s64)CPU.VPR[va]._s32[w] + (s64)CPU.VPR[vb]._s32[w];
-
-			if (result > 0x7fffffff)
-			{
-				CPU.VPR[vd]._s32[w] = 0x7fffffff;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result < (s32)0x80000000)
-			{
-				CPU.VPR[vd]._s32[w] = 0x80000000;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._s32[w] = result;
-		}
+		CPU.VPR[vd]._m128i = AddSatS32(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VADDUBM(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-		{
-			CPU.VPR[vd]._u8[b] = CPU.VPR[va]._u8[b] + CPU.VPR[vb]._u8[b];
-		}
+		CPU.VPR[vd]._m128i = _mm_add_epi8(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VADDUBS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-		{
-			u16 result = (u16)CPU.VPR[va]._u8[b] + (u16)CPU.VPR[vb]._u8[b];
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		const __m128i result = _mm_adds_epu8(a, b);
 
-			if (result > 0xff)
-			{
-				CPU.VPR[vd]._u8[b] = 0xff;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._u8[b] = result;
-		}
+		CheckSAT(result, _mm_add_epi8(a, b));
+		CPU.VPR[vd]._m128i = result;
 	}
 	void VADDUHM(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u16[h] = CPU.VPR[va]._u16[h] + CPU.VPR[vb]._u16[h];
-		}
+		CPU.VPR[vd]._m128i = _mm_add_epi16(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VADDUHS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			u32 result = (u32)CPU.VPR[va]._u16[h] + (u32)CPU.VPR[vb]._u16[h];
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		const __m128i result = _mm_adds_epu16(a, b);
 
-			if (result > 0xffff)
-			{
-				CPU.VPR[vd]._u16[h] = 0xffff;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._u16[h] = result;
-		}
+		CheckSAT(result, _mm_add_epi16(a, b));
+		CPU.VPR[vd]._m128i = result;
 	}
 	void VADDUWM(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = CPU.VPR[va]._u32[w] + CPU.VPR[vb]._u32[w];
-		}
+		CPU.VPR[vd]._m128i = _mm_add_epi32(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VADDUWS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			u64 result = (u64)CPU.VPR[va]._u32[w] + (u64)CPU.VPR[vb]._u32[w];
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i result = _mm_add_epi32(a, CPU.VPR[vb]._m128i);
+		const __m128i carry = CmpGtU32(a, result);
 
-			if (result > 0xffffffff)
-			{
-				CPU.VPR[vd]._u32[w] = 0xffffffff;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._u32[w] = result;
-		}
+		SetSAT(carry);
+		CPU.VPR[vd]._m128i = _mm_or_si128(result, carry);
 	}
 	void VAND(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = CPU.VPR[va]._u32[w] & CPU.VPR[vb]._u32[w];
-		}
+		CPU.VPR[vd]._m128i = _mm_and_si128(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VANDC(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = CPU.VPR[va]._u32[w] & (~CPU.VPR[vb]._u32[w]);
-		}
+		CPU.VPR[vd]._m128i = _mm_andnot_si128(CPU.VPR[vb]._m128i, CPU.VPR[va]._m128i);
 	}
 	void VAVGSB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-		{
-			CPU.VPR[vd]._s8[b] = (CPU.VPR[va]._s8[b] + CPU.VPR[vb]._s8[b] + 1) >> 1;
-		}
+		const __m128i bias = _mm_set1_epi8((s8)0x80);
+		CPU.VPR[vd]._m128i = _mm_xor_si128(_mm_avg_epu8(_mm_xor_si128(CPU.VPR[va]._m128i, bias), _mm_xor_si128(CPU.VPR[vb]._m128i, bias)), bias);
 	}
 	void VAVGSH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._s16[h] = (CPU.VPR[va]._s16[h] + CPU.VPR[vb]._s16[h] + 1) >> 1;
-		}
+		const __m128i bias = _mm_set1_epi16((s16)0x8000);
+		CPU.VPR[vd]._m128i = _mm_xor_si128(_mm_avg_epu16(_mm_xor_si128(CPU.VPR[va]._m128i, bias), _mm_xor_si128(CPU.VPR[vb]._m128i, bias)), bias);
 	}
 	void VAVGSW(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._s32[w] = ((s64)CPU.VPR[va]._s32[w] + (s64)CPU.VPR[vb]._s32[w] + 1) >> 1;
-		}
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		// (a + b + 1) >> 1 without the overflow
+		CPU.VPR[vd]._m128i = _mm_sub_epi32(_mm_or_si128(a, b), _mm_srai_epi32(_mm_xor_si128(a, b), 1));
 	}
 	void VAVGUB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-			CPU.VPR[vd]._u8[b] = (CPU.VPR[va]._u8[b] + CPU.VPR[vb]._u8[b] + 1) >> 1;
+		CPU.VPR[vd]._m128i = _mm_avg_epu8(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VAVGUH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u16[h] = (CPU.VPR[va]._u16[h] + CPU.VPR[vb]._u16[h] + 1) >> 1;
-		}
+		CPU.VPR[vd]._m128i = _mm_avg_epu16(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VAVGUW(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = ((u64)CPU.VPR[va]._u32[w] + (u64)CPU.VPR[vb]._u32[w] + 1) >> 1;
-		}
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		CPU.VPR[vd]._m128i = _mm_sub_epi32(_mm_or_si128(a, b), _mm_srli_epi32(_mm_xor_si128(a, b), 1));
 	}
 	void VCFSX(u32 vd, u32 uimm5, u32 vb)
 	{
-		u32 scale = 1 << uimm5;
-			
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._f[w] = ((float)CPU.VPR[vb]._s32[w]) / scale;
-		}
+		CPU.VPR[vd]._m128 = _mm_mul_ps(_mm_cvtepi32_ps(CPU.VPR[vb]._m128i), _mm_set1_ps(1.0f / (1ull << uimm5)));
 	}
 	void VCFUX(u32 vd, u32 uimm5, u32 vb)
 	{
-		u32 scale = 1 << uimm5;
-			
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._f[w] = ((float)CPU.VPR[vb]._u32[w]) / scale;
-		}
+		const __m128i b = CPU.VPR[vb]._m128i;
+
+		// both halves convert exactly, the sum is rounded once
+		const __m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(b, 16)), _mm_set1_ps(65536.0f));
+		const __m128 lo = _mm_cvtepi32_ps(_mm_and_si128(b, _mm_set1_epi32(0xffff)));
+		CPU.VPR[vd]._m128 = _mm_mul_ps(_mm_add_ps(hi, lo), _mm_set1_ps(1.0f / (1ull << uimm5)));
 	}
 	void VCMPBFP(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			u32 mask = 0;
-
-			const float A = CheckVSCR_NJ(CPU.VPR[va]._f[w]);
-			const float B = CheckVSCR_NJ(CPU.VPR[vb]._f[w]);
-
-			if (A >  B) mask |= 1 << 31;
-			if (A < -B) mask |= 1 << 30;
+		const __m128 A = CheckVSCR_NJ(CPU.VPR[va]._m128);
+		const __m128 B = CheckVSCR_NJ(CPU.VPR[vb]._m128);
 
-			CPU.VPR[vd]._u32[w] = mask;
-		}
+		// A > B: bit 0, A < -B: bit 1
+		const __m128i gt = _mm_castps_si128(_mm_cmpgt_ps(A, B));
+		const __m128i lt = _mm_castps_si128(_mm_cmplt_ps(A, _mm_xor_ps(B, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)))));
+		CPU.VPR[vd]._m128i = _mm_or_si128(_mm_and_si128(gt, _mm_set1_epi32(0x80000000)), _mm_and_si128(lt, _mm_set1_epi32(0x40000000)));
 	}
 	void VCMPBFP_(u32 vd, u32 va, u32 vb)
 	{
-		bool allInBounds = true;
-
-		for (uint w = 0; w < 4; w++)
-		{
-			u32 mask = 0;
-
-			const float A = CheckVSCR_NJ(CPU.VPR[va]._f[w]);
-			const float B = CheckVSCR_NJ(CPU.VPR[vb]._f[w]);
-
-			if (A >  B) mask |= 1 << 31;
-			if (A < -B) mask |= 1 << 30;
-
-			CPU.VPR[vd]._u32[w] = mask;
-
-			if (mask)
-				allInBounds = false;
-		}
+		VCMPBFP(vd, va, vb);
 
 		// Bit n2 of CR6
-		CPU.SetCRBit(6, 0x2, allInBounds);
+		CPU.SetCRBit(6, 0x2, _mm_movemask_epi8(_mm_cmpeq_epi32(CPU.VPR[vd]._m128i, _mm_setzero_si128())) == 0xffff);
 	}
 	void VCMPEQFP(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = CPU.VPR[va]._f[w] == CPU.VPR[vb]._f[w] ? 0xffffffff : 0;
-		}
+		CPU.VPR[vd]._m128i = _mm_castps_si128(_mm_cmpeq_ps(CPU.VPR[va]._m128, CPU.VPR[vb]._m128));
 	}
 	void VCMPEQFP_(u32 vd, u32 va, u32 vb)
 	{
-		int all_equal = 0x8;
-		int none_equal = 0x2;
-
-		for (uint w = 0; w < 4; w++)
-		{
-			if (CPU.VPR[va]._f[w] == CPU.VPR[vb]._f[w])
-			{
-				CPU.VPR[vd]._u32[w] = 0xffffffff;
-				none_equal = 0;
-			}
-			else
-			{
-				CPU.VPR[vd]._u32[w] = 0;
-				all_equal = 0;
-			}
-		}
-
-		CPU.CR.cr6 = all_equal | none_equal;
+		VCMPEQFP(vd, va, vb);
+		UpdateCR6(CPU.VPR[vd]._m128i);
 	}
 	void VCMPEQUB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-		{
-			CPU.VPR[vd]._u8[b] = CPU.VPR[va]._u8[b] == CPU.VPR[vb]._u8[b] ? 0xff : 0;
-		}
+		CPU.VPR[vd]._m128i = _mm_cmpeq_epi8(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VCMPEQUB_(u32 vd, u32 va, u32 vb)
 	{
-		int all_equal = 0x8;
-		int none_equal = 0x2;
-			
-		for (uint b = 0; b < 16; b++)
-		{
-			if (CPU.VPR[va]._u8[b] == CPU.VPR[vb]._u8[b])
-			{
-				CPU.VPR[vd]._u8[b] = 0xff;
-				none_equal = 0;
-			}
-			else
-			{
-				CPU.VPR[vd]._u8[b] = 0;
-				all_equal = 0;
-			}
-		}
-
-		CPU.CR.cr6 = all_equal | none_equal;
+		VCMPEQUB(vd, va, vb);
+		UpdateCR6(CPU.VPR[vd]._m128i);
 	}
 	void VCMPEQUH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u16[h] = CPU.VPR[va]._u16[h] == CPU.VPR[vb]._u16[h] ? 0xffff : 0;
-		}
+		CPU.VPR[vd]._m128i = _mm_cmpeq_epi16(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VCMPEQUH_(u32 vd, u32 va, u32 vb)
 	{
-		int all_equal = 0x8;
-		int none_equal = 0x2;
-			
-		for (uint h = 0; h < 8; h++)
-		{
-			if (CPU.VPR[va]._u16[h] == CPU.VPR[vb]._u16[h])
-			{
-				CPU.VPR[vd]._u16[h] = 0xffff;
-				none_equal = 0;
-			}
-			else
-			{
-				CPU.VPR[vd]._u16[h] = 0;
-				all_equal = 0;
-			}
-		}
-			
-		CPU.CR.cr6 = all_equal | none_equal;
+		VCMPEQUH(vd, va, vb);
+		UpdateCR6(CPU.VPR[vd]._m128i);
 	}
 	void VCMPEQUW(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = CPU.VPR[va]._u32[w] == CPU.VPR[vb]._u32[w] ? 0xffffffff : 0;
-		}
+		CPU.VPR[vd]._m128i = _mm_cmpeq_epi32(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VCMPEQUW_(u32 vd, u32 va, u32 vb)
 	{
-		int all_equal = 0x8;
-		int none_equal = 0x2;
-			
-		for (uint w = 0; w < 4; w++)
-		{
-			if (CPU.VPR[va]._u32[w] == CPU.VPR[vb]._u32[w])
-			{
-				CPU.VPR[vd]._u32[w] = 0xffffffff;
-				none_equal = 0;
-			}
-			else
-			{
-				CPU.VPR[vd]._u32[w] = 0;
-				all_equal = 0;
-			}
-		}
-
-		CPU.CR.cr6 = all_equal | none_equal;
+		VCMPEQUW(vd, va, vb);
+		UpdateCR6(CPU.VPR[vd]._m128i);
 	}
 	void VCMPGEFP(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = CPU.VPR[va]._f[w] >= CPU.VPR[vb]._f[w] ? 0xffffffff : 0;
-		}
+		CPU.VPR[vd]._m128i = _mm_castps_si128(_mm_cmpge_ps(CPU.VPR[va]._m128, CPU.VPR[vb]._m128));
 	}
 	void VCMPGEFP_(u32 vd, u32 va, u32 vb)
 	{
-		int all_ge = 0x8;
-		int none_ge = 0x2;
-			
-		for (uint w = 0; w < 4; w++)
-		{
-			if (CPU.VPR[va]._f[w] >= CPU.VPR[vb]._f[w])
-			{
-				CPU.VPR[vd]._u32[w] = 0xffffffff;
-				none_ge = 0;
-			}
-			else
-			{
-				CPU.VPR[vd]._u32[w] = 0;
-				all_ge = 0;
-			}
-		}
-
-		CPU.CR.cr6 = all_ge | none_ge;
+		VCMPGEFP(vd, va, vb);
+		UpdateCR6(CPU.VPR[vd]._m128i);
 	}
 	void VCMPGTFP(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = CPU.VPR[va]._f[w] > CPU.VPR[vb]._f[w] ? 0xffffffff : 0;
-		}
+		CPU.VPR[vd]._m128i = _mm_castps_si128(_mm_cmpgt_ps(CPU.VPR[va]._m128, CPU.VPR[vb]._m128));
 	}
 	void VCMPGTFP_(u32 vd, u32 va, u32 vb)
 	{
-		int all_ge = 0x8;
-		int none_ge = 0x2;
-			
-		for (uint w = 0; w < 4; w++)
-		{
-			if (CPU.VPR[va]._f[w] > CPU.VPR[vb]._f[w])
-			{
-				CPU.VPR[vd]._u32[w] = 0xffffffff;
-				none_ge = 0;
-			}
-			else
-			{
-				CPU.VPR[vd]._u32[w] = 0;
-				all_ge = 0;
-			}
-		}
-
-		CPU.CR.cr6 = all_ge | none_ge;
+		VCMPGTFP(vd, va, vb);
+		UpdateCR6(CPU.VPR[vd]._m128i);
 	}
 	void VCMPGTSB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-		{
-			CPU.VPR[vd]._u8[b] = CPU.VPR[va]._s8[b] > CPU.VPR[vb]._s8[b] ? 0xff : 0;
-		}
+		CPU.VPR[vd]._m128i = _mm_cmpgt_epi8(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VCMPGTSB_(u32 vd, u32 va, u32 vb)
 	{
-		int all_gt = 0x8;
-		int none_gt = 0x2;
-			
-		for (uint b = 0; b < 16; b++)
-		{
-			if (CPU.VPR[va]._s8[b] > CPU.VPR[vb]._s8[b])
-			{
-				CPU.VPR[vd]._u8[b] = 0xff;
-				none_gt = 0;
-			}
-			else
-			{
-				CPU.VPR[vd]._u8[b] = 0;
-				all_gt = 0;
-			}
-		}
-
-		CPU.CR.cr6 = all_gt | none_gt;
+		VCMPGTSB(vd, va, vb);
+		UpdateCR6(CPU.VPR[vd]._m128i);
 	}
 	void VCMPGTSH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u16[h] = CPU.VPR[va]._s16[h] > CPU.VPR[vb]._s16[h] ? 0xffff : 0;
-		}
+		CPU.VPR[vd]._m128i = _mm_cmpgt_epi16(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VCMPGTSH_(u32 vd, u32 va, u32 vb)
 	{
-		int all_gt = 0x8;
-		int none_gt = 0x2;
-			
-		for (uint h = 0; h < 8; h++)
-		{
-			if (CPU.VPR[va]._s16[h] > CPU.VPR[vb]._s16[h])
-			{
-				CPU.VPR[vd]._u16[h] = 0xffff;
-				none_gt = 0;
-			}
-			else
-			{
-				CPU.VPR[vd]._u16[h] = 0;
-				all_gt = 0;
-			}
-		}
-
-		CPU.CR.cr6 = all_gt | none_gt;
+		VCMPGTSH(vd, va, vb);
+		UpdateCR6(CPU.VPR[vd]._m128i);
 	}
 	void VCMPGTSW(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = CPU.VPR[va]._s32[w] > CPU.VPR[vb]._s32[w] ? 0xffffffff : 0;
-		}
+		CPU.VPR[vd]._m128i = _mm_cmpgt_epi32(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VCMPGTSW_(u32 vd, u32 va, u32 vb)
 	{
-		int all_gt = 0x8;
-		int none_gt = 0x2;
-			
-		for (uint w = 0; w < 4; w++)
-		{
-			if (CPU.VPR[va]._s32[w] > CPU.VPR[vb]._s32[w])
-			{
-				CPU.VPR[vd]._u32[w] = 0xffffffff;
-				none_gt = 0;
-			}
-			else
-			{
-				CPU.VPR[vd]._u32[w] = 0;
-				all_gt = 0;
-			}
-		}
-
-		CPU.CR.cr6 = all_gt | none_gt;
+		VCMPGTSW(vd, va, vb);
+		UpdateCR6(CPU.VPR[vd]._m128i);
 	}
 	void VCMPGTUB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-		{
-			CPU.VPR[vd]._u8[b] = CPU.VPR[va]._u8[b] > CPU.VPR[vb]._u8[b] ? 0xff : 0;
-		}
+		CPU.VPR[vd]._m128i = CmpGtU8(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VCMPGTUB_(u32 vd, u32 va, u32 vb)
 	{
-		int all_gt = 0x8;
-		int none_gt = 0x2;
-
-		for (uint b = 0; b < 16; b++)
-		{
-			if (CPU.VPR[va]._u8[b] > CPU.VPR[vb]._u8[b])
-			{
-				CPU.VPR[vd]._u8[b] = 0xff;
-				none_gt = 0;
-			}
-			else
-			{
-				CPU.VPR[vd]._u8[b] = 0;
-				all_gt = 0;
-			}
-		}
-
-		CPU.CR.cr6 = all_gt | none_gt;
+		VCMPGTUB(vd, va, vb);
+		UpdateCR6(CPU.VPR[vd]._m128i);
 	}
 	void VCMPGTUH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u16[h] = CPU.VPR[va]._u16[h] > CPU.VPR[vb]._u16[h] ? 0xffff : 0;
-		}
+		CPU.VPR[vd]._m128i = CmpGtU16(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VCMPGTUH_(u32 vd, u32 va, u32 vb)
 	{
-		int all_gt = 0x8;
-		int none_gt = 0x2;
-			
-		for (uint h = 0; h < 8; h++)
-		{
-			if (CPU.VPR[va]._u16[h] > CPU.VPR[vb]._u16[h])
-			{
-				CPU.VPR[vd]._u16[h] = 0xffff;
-				none_gt = 0;
-			}
-			else
-			{
-				CPU.VPR[vd]._u16[h] = 0;
-				all_gt = 0;
-			}
-		}
-
-		CPU.CR.cr6 = all_gt | none_gt;
+		VCMPGTUH(vd, va, vb);
+		UpdateCR6(CPU.VPR[vd]._m128i);
 	}
 	void VCMPGTUW(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = CPU.VPR[va]._u32[w] > CPU.VPR[vb]._u32[w] ? 0xffffffff : 0;
-		}
+		CPU.VPR[vd]._m128i = CmpGtU32(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VCMPGTUW_(u32 vd, u32 va, u32 vb)
 	{
-		int all_gt = 0x8;
-		int none_gt = 0x2;
-			
-		for (uint w = 0; w < 4; w++)
-		{
-			if (CPU.VPR[va]._u32[w] > CPU.VPR[vb]._u32[w])
-			{
-				CPU.VPR[vd]._u32[w] = 0xffffffff;
-				none_gt = 0;
-			}
-			else
-			{
-				CPU.VPR[vd]._u32[w] = 0;
-				all_gt = 0;
-			}
-		}
-
-		CPU.CR.cr6 = all_gt | none_gt;
+		VCMPGTUW(vd, va, vb);
+		UpdateCR6(CPU.VPR[vd]._m128i);
 	}
 	void VCTSXS(u32 vd, u32 uimm5, u32 vb)
 	{
-		int nScale = 1 << uimm5;
-			
-		for (uint w = 0; w < 4; w++)
-		{		
-			float result = CPU.VPR[vb]._f[w] * nScale;
+		const __m128 scaled = _mm_mul_ps(CPU.VPR[vb]._m128, _mm_set1_ps((float)(1ull << uimm5)));
 
-			if (result > INT_MAX)
-				CPU.VPR[vd]._s32[w] = (int)INT_MAX;
-			else if (result < INT_MIN)
-				CPU.VPR[vd]._s32[w] = (int)INT_MIN;
-			else // C rounding = Round towards 0
-				CPU.VPR[vd]._s32[w] = (int)result;
-		}
+		// cvttps2dq gives 0x80000000 for NaN and out of range values
+		const __m128i over = _mm_castps_si128(_mm_cmpge_ps(scaled, _mm_set1_ps(2147483648.0f)));
+		const __m128i under = _mm_castps_si128(_mm_cmplt_ps(scaled, _mm_set1_ps(-2147483648.0f)));
+		const __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(scaled, scaled));
+
+		SetSAT(_mm_or_si128(_mm_or_si128(over, under), nan));
+		CPU.VPR[vd]._m128i = _mm_andnot_si128(nan, _mm_xor_si128(_mm_cvttps_epi32(scaled), over));
 	}
 	void VCTUXS(u32 vd, u32 uimm5, u32 vb)
 	{
-		int nScale = 1 << uimm5;
+		const __m128 scaled = _mm_mul_ps(CPU.VPR[vb]._m128, _mm_set1_ps((float)(1ull << uimm5)));
+		const __m128 clamped = _mm_max_ps(scaled, _mm_setzero_ps()); // NaN gives 0
 
-		for (uint w = 0; w < 4; w++)
-		{
-			// C rounding = Round towards 0
-			s64 result = (s64)(CPU.VPR[vb]._f[w] * nScale);
+		// values from 2^31 are converted from value - 2^31
+		const __m128 big = _mm_cmpge_ps(clamped, _mm_set1_ps(2147483648.0f));
+		const __m128i result = _mm_xor_si128(_mm_cvttps_epi32(_mm_sub_ps(clamped, _mm_and_ps(big, _mm_set1_ps(2147483648.0f)))),
+			_mm_and_si128(_mm_castps_si128(big), _mm_set1_epi32(0x80000000)));
+		const __m128i over = _mm_castps_si128(_mm_cmpge_ps(scaled, _mm_set1_ps(4294967296.0f)));
+		const __m128i under = _mm_castps_si128(_mm_cmple_ps(scaled, _mm_set1_ps(-1.0f)));
+		const __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(scaled, scaled));
 
-			if (result > UINT_MAX)
-				CPU.VPR[vd]._u32[w] = (u32)UINT_MAX;
-			else if (result < 0)
-				CPU.VPR[vd]._u32[w] = 0;
-			else
-				CPU.VPR[vd]._u32[w] = (u32)result;
-		}
+		SetSAT(_mm_or_si128(_mm_or_si128(over, under), nan));
+		CPU.VPR[vd]._m128i = _mm_or_si128(result, over);
 	}
 	void VEXPTEFP(u32 vd, u32 vb)
 	{
@@ -821,235 +513,149 @@ private:
 	}
 	void VMADDFP(u32 vd, u32 va, u32 vc, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._f[w] = CPU.VPR[va]._f[w] * CPU.VPR[vc]._f[w] + CPU.VPR[vb]._f[w];
-		}
+		CPU.VPR[vd]._m128 = CheckVSCR_NJ(_mm_add_ps(_mm_mul_ps(CheckVSCR_NJ(CPU.VPR[va]._m128), CheckVSCR_NJ(CPU.VPR[vc]._m128)), CheckVSCR_NJ(CPU.VPR[vb]._m128)));
 	}
 	void VMAXFP(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._f[w] = max(CPU.VPR[va]._f[w], CPU.VPR[vb]._f[w]);
-		}
+		CPU.VPR[vd]._m128 = _mm_max_ps(CheckVSCR_NJ(CPU.VPR[vb]._m128), CheckVSCR_NJ(CPU.VPR[va]._m128));
 	}
 	void VMAXSB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-			CPU.VPR[vd]._s8[b] = max(CPU.VPR[va]._s8[b], CPU.VPR[vb]._s8[b]);
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		CPU.VPR[vd]._m128i = SelectBits(_mm_cmpgt_epi8(a, b), a, b);
 	}
 	void VMAXSH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._s16[h] = max(CPU.VPR[va]._s16[h], CPU.VPR[vb]._s16[h]);
-		}
+		CPU.VPR[vd]._m128i = _mm_max_epi16(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VMAXSW(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._s32[w] = max(CPU.VPR[va]._s32[w], CPU.VPR[vb]._s32[w]);
-		}
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		CPU.VPR[vd]._m128i = SelectBits(_mm_cmpgt_epi32(a, b), a, b);
 	}
 	void VMAXUB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-			CPU.VPR[vd]._u8[b] = max(CPU.VPR[va]._u8[b], CPU.VPR[vb]._u8[b]);
+		CPU.VPR[vd]._m128i = _mm_max_epu8(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VMAXUH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u16[h] = max(CPU.VPR[va]._u16[h], CPU.VPR[vb]._u16[h]);
-		}
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		CPU.VPR[vd]._m128i = SelectBits(CmpGtU16(a, b), a, b);
 	}
 	void VMAXUW(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = max(CPU.VPR[va]._u32[w], CPU.VPR[vb]._u32[w]);
-		}
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		CPU.VPR[vd]._m128i = SelectBits(CmpGtU32(a, b), a, b);
 	}
 	void VMHADDSHS(u32 vd, u32 va, u32 vb, u32 vc)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			s32 result = (s32)CPU.VPR[va]._s16[h] * (s32)CPU.VPR[vb]._s16[h] + (s32)CPU.VPR[vc]._s16[h];
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		const __m128i c = CPU.VPR[vc]._m128i;
+		const __m128i lo = _mm_mullo_epi16(a, b);
+		const __m128i hi = _mm_mulhi_epi16(a, b);
 
-			if (result > INT16_MAX)
-			{
-				CPU.VPR[vd]._s16[h] = (s16)INT16_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result < INT16_MIN)
-			{
-				CPU.VPR[vd]._s16[h] = (s16)INT16_MIN;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._s16[h] = (s16)result;
-		}
+		// ((a * b) >> 15) + c in 32 bits, saturated to 16 bits
+		const __m128i r0 = _mm_add_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15), _mm_srai_epi32(_mm_unpacklo_epi16(c, c), 16));
+		const __m128i r1 = _mm_add_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15), _mm_srai_epi32(_mm_unpackhi_epi16(c, c), 16));
+		CPU.VPR[vd]._m128i = PackSS32(r0, r1);
 	}
 	void VMHRADDSHS(u32 vd, u32 va, u32 vb, u32 vc)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			s32 result = (s32)CPU.VPR[va]._s16[h] * (s32)CPU.VPR[vb]._s16[h] + (s32)CPU.VPR[vc]._s16[h] + 0x4000;
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		const __m128i c = CPU.VPR[vc]._m128i;
+		const __m128i lo = _mm_mullo_epi16(a, b);
+		const __m128i hi = _mm_mulhi_epi16(a, b);
+		const __m128i round = _mm_set1_epi32(0x4000);
 
-			if (result > INT16_MAX)
-			{
-				CPU.VPR[vd]._s16[h] = (s16)INT16_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result < INT16_MIN)
-			{
-				CPU.VPR[vd]._s16[h] = (s16)INT16_MIN;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._s16[h] = (s16)result;
-		}
+		// ((a * b + 0x4000) >> 15) + c in 32 bits, saturated to 16 bits
+		const __m128i r0 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 15), _mm_srai_epi32(_mm_unpacklo_epi16(c, c), 16));
+		const __m128i r1 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 15), _mm_srai_epi32(_mm_unpackhi_epi16(c, c), 16));
+		CPU.VPR[vd]._m128i = PackSS32(r0, r1);
 	}
 	void VMINFP(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._f[w] = min(CPU.VPR[va]._f[w], CPU.VPR[vb]._f[w]);
-		}
+		CPU.VPR[vd]._m128 = _mm_min_ps(CheckVSCR_NJ(CPU.VPR[vb]._m128), CheckVSCR_NJ(CPU.VPR[va]._m128));
 	}
 	void VMINSB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-		{
-			CPU.VPR[vd]._s8[b] = min(CPU.VPR[va]._s8[b], CPU.VPR[vb]._s8[b]);
-		}
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		CPU.VPR[vd]._m128i = SelectBits(_mm_cmpgt_epi8(a, b), b, a);
 	}
 	void VMINSH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._s16[h] = min(CPU.VPR[va]._s16[h], CPU.VPR[vb]._s16[h]);
-		}
+		CPU.VPR[vd]._m128i = _mm_min_epi16(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VMINSW(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._s32[w] = min(CPU.VPR[va]._s32[w], CPU.VPR[vb]._s32[w]);
-		}
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		CPU.VPR[vd]._m128i = SelectBits(_mm_cmpgt_epi32(a, b), b, a);
 	}
 	void VMINUB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-		{
-			CPU.VPR[vd]._u8[b] = min(CPU.VPR[va]._u8[b], CPU.VPR[vb]._u8[b]);
-		}
+		CPU.VPR[vd]._m128i = _mm_min_epu8(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VMINUH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u16[h] = min(CPU.VPR[va]._u16[h], CPU.VPR[vb]._u16[h]);
-		}
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		CPU.VPR[vd]._m128i = SelectBits(CmpGtU16(a, b), b, a);
 	}
 	void VMINUW(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = min(CPU.VPR[va]._u32[w], CPU.VPR[vb]._u32[w]);
-		}
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		CPU.VPR[vd]._m128i = SelectBits(CmpGtU32(a, b), b, a);
 	}
 	void VMLADDUHM(u32 vd, u32 va, u32 vb, u32 vc)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u16[h] = CPU.VPR[va]._u16[h] * CPU.VPR[vb]._u16[h] + CPU.VPR[vc]._u16[h];
-		}
+		CPU.VPR[vd]._m128i = _mm_add_epi16(_mm_mullo_epi16(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i), CPU.VPR[vc]._m128i);
 	}
 	void VMRGHB(u32 vd, u32 va, u32 vb)
 	{
-		VPR_reg VA = CPU.VPR[va];
-		VPR_reg VB = CPU.VPR[vb];
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u8[15 - h*2] = VA._u8[15 - h];
-			CPU.VPR[vd]._u8[15 - h*2 - 1] = VB._u8[15 - h];
-		}
+		CPU.VPR[vd]._m128i = _mm_unpackhi_epi8(CPU.VPR[vb]._m128i, CPU.VPR[va]._m128i);
 	}
 	void VMRGHH(u32 vd, u32 va, u32 vb)
 	{
-		VPR_reg VA = CPU.VPR[va];
-		VPR_reg VB = CPU.VPR[vb];
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u16[7 - w*2] = VA._u16[7 - w];
-			CPU.VPR[vd]._u16[7 - w*2 - 1] = VB._u16[7 - w];
-		}
+		CPU.VPR[vd]._m128i = _mm_unpackhi_epi16(CPU.VPR[vb]._m128i, CPU.VPR[va]._m128i);
 	}
 	void VMRGHW(u32 vd, u32 va, u32 vb)
 	{
-		VPR_reg VA = CPU.VPR[va];
-		VPR_reg VB = CPU.VPR[vb];
-		for (uint d = 0; d < 2; d++)
-		{
-			CPU.VPR[vd]._u32[3 - d*2] = VA._u32[3 - d];
-			CPU.VPR[vd]._u32[3 - d*2 - 1] = VB._u32[3 - d];
-		}
+		CPU.VPR[vd]._m128i = _mm_unpackhi_epi32(CPU.VPR[vb]._m128i, CPU.VPR[va]._m128i);
 	}
 	void VMRGLB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u8[15 - h*2] = CPU.VPR[va]._u8[7 - h];
-			CPU.VPR[vd]._u8[15 - h*2 - 1] = CPU.VPR[vb]._u8[7 - h];
-		}
+		CPU.VPR[vd]._m128i = _mm_unpacklo_epi8(CPU.VPR[vb]._m128i, CPU.VPR[va]._m128i);
 	}
 	void VMRGLH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u16[7 - w*2] = CPU.VPR[va]._u16[3 - w];
-			CPU.VPR[vd]._u16[7 - w*2 - 1] = CPU.VPR[vb]._u16[3 - w];
-		}
+		CPU.VPR[vd]._m128i = _mm_unpacklo_epi16(CPU.VPR[vb]._m128i, CPU.VPR[va]._m128i);
 	}
 	void VMRGLW(u32 vd, u32 va, u32 vb)
 	{
-		for (uint d = 0; d < 2; d++)
-		{
-			CPU.VPR[vd]._u32[3 - d*2] = CPU.VPR[va]._u32[1 - d];
-			CPU.VPR[vd]._u32[3 - d*2 - 1] = CPU.VPR[vb]._u32[1 - d];
-		}
+		CPU.VPR[vd]._m128i = _mm_unpacklo_epi32(CPU.VPR[vb]._m128i, CPU.VPR[va]._m128i);
 	}
 	void VMSUMMBM(u32 vd, u32 va, u32 vb, u32 vc)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			s32 result = 0;
-
-			for (uint b = 0; b < 4; b++)
-			{
-				result += CPU.VPR[va]._s8[w*4 + b] * CPU.VPR[vb]._u8[w*4 + b];
-			}
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
 
-			result += CPU.VPR[vc]._s32[w];
-			CPU.VPR[vd]._s32[w] = result;
-		}
+		// signed x unsigned byte products fit in 16 bits
+		const __m128i even = _mm_mullo_epi16(_mm_srai_epi16(_mm_slli_epi16(a, 8), 8), _mm_and_si128(b, _mm_set1_epi16(0xff)));
+		const __m128i odd = _mm_mullo_epi16(_mm_srai_epi16(a, 8), _mm_srli_epi16(b, 8));
+		const __m128i ones = _mm_set1_epi16(1);
+		CPU.VPR[vd]._m128i = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(even, ones), _mm_madd_epi16(odd, ones)), CPU.VPR[vc]._m128i);
 	}
 	void VMSUMSHM(u32 vd, u32 va, u32 vb, u32 vc)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			s32 result = 0;
-
-			for (uint h = 0; h < 2; h++)
-			{
-				result += CPU.VPR[va]._s16[w*2 + h] * CPU.VPR[vb]._s16[w*2 + h];
-			}
-
-			result += CPU.VPR[vc]._s32[w];
-			CPU.VPR[vd]._s32[w] = result;
-		}
+		CPU.VPR[vd]._m128i = _mm_add_epi32(_mm_madd_epi16(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i), CPU.VPR[vc]._m128i);
 	}
 	void VMSUMSHS(u32 vd, u32 va, u32 vb, u32 vc)
 	{
@@ -1083,148 +689,96 @@ private:
 	}
 	void VMSUMUBM(u32 vd, u32 va, u32 vb, u32 vc)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			u32 result = 0;
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
 
-			for (uint b = 0; b < 4; b++)
-			{
-				result += CPU.VPR[va]._u8[w*4 + b] * CPU.VPR[vb]._u8[w*4 + b];
-			}
-
-			result += CPU.VPR[vc]._u32[w];
-			CPU.VPR[vd]._u32[w] = result;
-		}
+		const __m128i low = _mm_set1_epi16(0xff);
+		const __m128i even = _mm_mullo_epi16(_mm_and_si128(a, low), _mm_and_si128(b, low));
+		const __m128i odd = _mm_mullo_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+		const __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(even, _mm_set1_epi32(0xffff)), _mm_srli_epi32(even, 16)),
+			_mm_add_epi32(_mm_and_si128(odd, _mm_set1_epi32(0xffff)), _mm_srli_epi32(odd, 16)));
+		CPU.VPR[vd]._m128i = _mm_add_epi32(sum, CPU.VPR[vc]._m128i);
 	}
 	void VMSUMUHM(u32 vd, u32 va, u32 vb, u32 vc)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			u32 result = 0;
-
-			for (uint h = 0; h < 2; h++)
-			{
-				result += CPU.VPR[va]._u16[w*2 + h] * CPU.VPR[vb]._u16[w*2 + h];
-			}
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
 
-			result += CPU.VPR[vc]._u32[w];
-			CPU.VPR[vd]._u32[w] = result;
-		}
+		const __m128i low = _mm_set1_epi32(0xffff);
+		const __m128i even = MulU16(_mm_and_si128(a, low), _mm_and_si128(b, low));
+		const __m128i odd = MulU16(_mm_srli_epi32(a, 16), _mm_srli_epi32(b, 16));
+		CPU.VPR[vd]._m128i = _mm_add_epi32(_mm_add_epi32(even, odd), CPU.VPR[vc]._m128i);
 	}
 	void VMSUMUHS(u32 vd, u32 va, u32 vb, u32 vc)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			u64 result = 0;
-			u32 saturated = 0;
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
 
-			for (uint h = 0; h < 2; h++)
-			{
-				result += CPU.VPR[va]._u16[w*2 + h] * CPU.VPR[vb]._u16[w*2 + h];
-			}
-
-			result += CPU.VPR[vc]._u32[w];
-
-			if (result > UINT_MAX)
-			{
-				saturated = UINT_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				saturated = (u32)result;
+		const __m128i low = _mm_set1_epi32(0xffff);
+		const __m128i even = MulU16(_mm_and_si128(a, low), _mm_and_si128(b, low));
+		const __m128i odd = MulU16(_mm_srli_epi32(a, 16), _mm_srli_epi32(b, 16));
+		const __m128i sum = _mm_add_epi32(even, odd);
+		const __m128i result = _mm_add_epi32(sum, CPU.VPR[vc]._m128i);
+		const __m128i carry = _mm_or_si128(CmpGtU32(even, sum), CmpGtU32(sum, result));
 
-			CPU.VPR[vd]._u32[w] = saturated;
-		}
+		SetSAT(carry);
+		CPU.VPR[vd]._m128i = _mm_or_si128(result, carry);
 	}
 	void VMULESB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._s16[h] = (s16)CPU.VPR[va]._s8[h*2+1] * (s16)CPU.VPR[vb]._s8[h*2+1];
-		}
+		CPU.VPR[vd]._m128i = _mm_mullo_epi16(_mm_srai_epi16(CPU.VPR[va]._m128i, 8), _mm_srai_epi16(CPU.VPR[vb]._m128i, 8));
 	}
 	void VMULESH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._s32[w] = (s32)CPU.VPR[va]._s16[w*2+1] * (s32)CPU.VPR[vb]._s16[w*2+1];
-		}
+		CPU.VPR[vd]._m128i = _mm_madd_epi16(_mm_srli_epi32(CPU.VPR[va]._m128i, 16), _mm_srli_epi32(CPU.VPR[vb]._m128i, 16));
 	}
 	void VMULEUB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u16[h] = (u16)CPU.VPR[va]._u8[h*2+1] * (u16)CPU.VPR[vb]._u8[h*2+1];
-		}
+		CPU.VPR[vd]._m128i = _mm_mullo_epi16(_mm_srli_epi16(CPU.VPR[va]._m128i, 8), _mm_srli_epi16(CPU.VPR[vb]._m128i, 8));
 	}
 	void VMULEUH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = (u32)CPU.VPR[va]._u16[w*2+1] * (u32)CPU.VPR[vb]._u16[w*2+1];
-		}
+		CPU.VPR[vd]._m128i = MulU16(_mm_srli_epi32(CPU.VPR[va]._m128i, 16), _mm_srli_epi32(CPU.VPR[vb]._m128i, 16));
 	}
 	void VMULOSB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._s16[h] = (s16)CPU.VPR[va]._s8[h*2] * (s16)CPU.VPR[vb]._s8[h*2];
-		}
+		CPU.VPR[vd]._m128i = _mm_mullo_epi16(_mm_srai_epi16(_mm_slli_epi16(CPU.VPR[va]._m128i, 8), 8), _mm_srai_epi16(_mm_slli_epi16(CPU.VPR[vb]._m128i, 8), 8));
 	}
 	void VMULOSH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._s32[w] = (s32)CPU.VPR[va]._s16[w*2] * (s32)CPU.VPR[vb]._s16[w*2];
-		}
+		CPU.VPR[vd]._m128i = _mm_madd_epi16(_mm_and_si128(CPU.VPR[va]._m128i, _mm_set1_epi32(0xffff)), CPU.VPR[vb]._m128i);
 	}
 	void VMULOUB(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u16[h] = (u16)CPU.VPR[va]._u8[h*2] * (u16)CPU.VPR[vb]._u8[h*2];
-		}
+		const __m128i low = _mm_set1_epi16(0xff);
+		CPU.VPR[vd]._m128i = _mm_mullo_epi16(_mm_and_si128(CPU.VPR[va]._m128i, low), _mm_and_si128(CPU.VPR[vb]._m128i, low));
 	}
 	void VMULOUH(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = (u32)CPU.VPR[va]._u16[w*2] * (u32)CPU.VPR[vb]._u16[w*2];
-		}
+		const __m128i low = _mm_set1_epi32(0xffff);
+		CPU.VPR[vd]._m128i = MulU16(_mm_and_si128(CPU.VPR[va]._m128i, low), _mm_and_si128(CPU.VPR[vb]._m128i, low));
 	}
 	void VNMSUBFP(u32 vd, u32 va, u32 vc, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._f[w] = -(CPU.VPR[va]._f[w] * CPU.VPR[vc]._f[w] - CPU.VPR[vb]._f[w]);
-		}
+		const __m128 sign = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+		CPU.VPR[vd]._m128 = CheckVSCR_NJ(_mm_xor_ps(_mm_sub_ps(_mm_mul_ps(CheckVSCR_NJ(CPU.VPR[va]._m128), CheckVSCR_NJ(CPU.VPR[vc]._m128)), CheckVSCR_NJ(CPU.VPR[vb]._m128)), sign));
 	}
 	void VNOR(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = ~(CPU.VPR[va]._u32[w] | CPU.VPR[vb]._u32[w]);
-		}
+		CPU.VPR[vd]._m128i = _mm_xor_si128(_mm_or_si128(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i), _mm_set1_epi32(-1));
 	}
 	void VOR(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = CPU.VPR[va]._u32[w] | CPU.VPR[vb]._u32[w];
-		}
+		CPU.VPR[vd]._m128i = _mm_or_si128(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VPERM(u32 vd, u32 va, u32 vb, u32 vc)
 	{
-		u8 tmpSRC[32];
-		memcpy(tmpSRC, CPU.VPR[vb]._u8, 16);
-		memcpy(tmpSRC + 16, CPU.VPR[va]._u8, 16);
+		const __m128i c = CPU.VPR[vc]._m128i;
 
-		for (uint b = 0; b < 16; b++)
-		{
-			u8 index = CPU.VPR[vc]._u8[b] & 0x1f;
-				
-			CPU.VPR[vd]._u8[b] = tmpSRC[0x1f - index];
-		}
+		// 0x00-0x0f select a byte of va, 0x10-0x1f a byte of vb (byte n is _u8[15 - n])
+		const __m128i index = _mm_xor_si128(_mm_and_si128(c, _mm_set1_epi8(0xf)), _mm_set1_epi8(0xf));
+		const __m128i from_b = _mm_cmpeq_epi8(_mm_and_si128(c, _mm_set1_epi8(0x10)), _mm_set1_epi8(0x10));
+		CPU.VPR[vd]._m128i = SelectBits(from_b, ShuffleBytes(CPU.VPR[vb]._m128i, index), ShuffleBytes(CPU.VPR[va]._m128i, index));
 	}
 	void VPKPX(u32 vd, u32 va, u32 vb)
 	{
@@ -1245,219 +799,96 @@ private:
 	}
 	void VPKSHSS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 8; b++)
-		{
-			s16 result = CPU.VPR[va]._s16[b];
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
 
-			if (result > INT8_MAX)
-			{
-				result = INT8_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result < INT8_MIN)
-			{
-				result = INT8_MIN;
-				CPU.VSCR.SAT = 1;
-			}
-				
-			CPU.VPR[vd]._s8[b+8] = result;
-
-			result = CPU.VPR[vb]._s16[b];
-
-			if (result > INT8_MAX)
-			{
-				result = INT8_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result < INT8_MIN)
-			{
-				result = INT8_MIN;
-				CPU.VSCR.SAT = 1;
-			}
-
-			CPU.VPR[vd]._s8[b] = result;
-		}
+		const __m128i max = _mm_set1_epi16(INT8_MAX), min = _mm_set1_epi16(INT8_MIN);
+		SetSAT(_mm_or_si128(_mm_or_si128(_mm_cmpgt_epi16(a, max), _mm_cmplt_epi16(a, min)), _mm_or_si128(_mm_cmpgt_epi16(b, max), _mm_cmplt_epi16(b, min))));
+		CPU.VPR[vd]._m128i = _mm_packs_epi16(b, a);
 	}
-	void VPKSHUS(u32 vd, u32 va, u32 vb)
-	{
-		for (uint b = 0; b < 8; b++)
-		{
-			s16 result = CPU.VPR[va]._s16[b];
-
-			if (result > UINT8_MAX)
-			{
-				result = UINT8_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result < 0)
-			{
-				result = 0;
-				CPU.VSCR.SAT = 1;
-			}
-				
-			CPU.VPR[vd]._u8[b+8] = result;
-
-			result = CPU.VPR[vb]._s16[b];
-
-			if (result > UINT8_MAX)
-			{
-				result = UINT8_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result < 0)
-			{
-				result = 0;
-				CPU.VSCR.SAT = 1;
-			}
-				
-			CPU.VPR[vd]._u8[b] = result;
-		}
+	void VPKSHUS(u32 vd, u32 va, u32 vb)
+	{
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+
+		const __m128i max = _mm_set1_epi16(UINT8_MAX), min = _mm_setzero_si128();
+		SetSAT(_mm_or_si128(_mm_or_si128(_mm_cmpgt_epi16(a, max), _mm_cmplt_epi16(a, min)), _mm_or_si128(_mm_cmpgt_epi16(b, max), _mm_cmplt_epi16(b, min))));
+		CPU.VPR[vd]._m128i = _mm_packus_epi16(b, a);
 	}
 	void VPKSWSS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 4; h++)
-		{
-			s32 result = CPU.VPR[va]._s32[h];
-
-			if (result > INT16_MAX)
-			{
-				result = INT16_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result < INT16_MIN)
-			{
-				result = INT16_MIN;
-				CPU.VSCR.SAT = 1;
-			}
-				
-			CPU.VPR[vd]._s16[h+4] = result;
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
 
-			result = CPU.VPR[vb]._s32[h];
-
-			if (result > INT16_MAX)
-			{
-				result = INT16_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result < INT16_MIN)
-			{
-				result = INT16_MIN;
-				CPU.VSCR.SAT = 1;
-			}
-				
-			CPU.VPR[vd]._s16[h] = result;
-		}
+		const __m128i max = _mm_set1_epi32(INT16_MAX), min = _mm_set1_epi32(INT16_MIN);
+		SetSAT(_mm_or_si128(_mm_or_si128(_mm_cmpgt_epi32(a, max), _mm_cmplt_epi32(a, min)), _mm_or_si128(_mm_cmpgt_epi32(b, max), _mm_cmplt_epi32(b, min))));
+		CPU.VPR[vd]._m128i = _mm_packs_epi32(b, a);
 	}
 	void VPKSWUS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 4; h++)
-		{
-			s32 result = CPU.VPR[va]._s32[h];
-
-			if (result > UINT16_MAX)
-			{
-				result = UINT16_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result < 0)
-			{
-				result = 0;
-				CPU.VSCR.SAT = 1;
-			}
-				
-			CPU.VPR[vd]._u16[h+4] = result;
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
 
-			result = CPU.VPR[vb]._s32[h];
+		const __m128i max = _mm_set1_epi32(UINT16_MAX), min = _mm_setzero_si128();
+		const __m128i a_over = _mm_cmpgt_epi32(a, max), a_under = _mm_cmplt_epi32(a, min);
+		const __m128i b_over = _mm_cmpgt_epi32(b, max), b_under = _mm_cmplt_epi32(b, min);
+		SetSAT(_mm_or_si128(_mm_or_si128(a_over, a_under), _mm_or_si128(b_over, b_under)));
 
-			if (result > UINT16_MAX)
-			{
-				result = UINT16_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result < 0)
-			{
-				result = 0;
-				CPU.VSCR.SAT = 1;
-			}
-				
-			CPU.VPR[vd]._u16[h] = result;
-		}
+		// clamp, then pack the biased values with signed saturation
+		const __m128i bias = _mm_set1_epi32(0x8000);
+		const __m128i a_clamped = _mm_sub_epi32(_mm_andnot_si128(a_under, SelectBits(a_over, max, a)), bias);
+		const __m128i b_clamped = _mm_sub_epi32(_mm_andnot_si128(b_under, SelectBits(b_over, max, b)), bias);
+		CPU.VPR[vd]._m128i = _mm_xor_si128(_mm_packs_epi32(b_clamped, a_clamped), _mm_set1_epi16((s16)0x8000));
 	}
 	void VPKUHUM(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 8; b++)
-		{
-			CPU.VPR[vd]._u8[b+8] = CPU.VPR[va]._u8[b*2];
-			CPU.VPR[vd]._u8[b  ] = CPU.VPR[vb]._u8[b*2];
-		}
+		const __m128i low = _mm_set1_epi16(0xff);
+		CPU.VPR[vd]._m128i = _mm_packus_epi16(_mm_and_si128(CPU.VPR[vb]._m128i, low), _mm_and_si128(CPU.VPR[va]._m128i, low));
 	}
 	void VPKUHUS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 8; b++)
-		{
-			u16 result = CPU.VPR[va]._u16[b];
-
-			if (result > UINT8_MAX)
-			{
-				result = UINT8_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-				
-			CPU.VPR[vd]._u8[b+8] = result;
-
-			result = CPU.VPR[vb]._u16[b];
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
 
-			if (result > UINT8_MAX)
-			{
-				result = UINT8_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-				
-			CPU.VPR[vd]._u8[b] = result;
-		}
+		const __m128i high = _mm_set1_epi16((s16)0xff00);
+		const __m128i a_over = _mm_xor_si128(_mm_cmpeq_epi16(_mm_and_si128(a, high), _mm_setzero_si128()), _mm_set1_epi32(-1));
+		const __m128i b_over = _mm_xor_si128(_mm_cmpeq_epi16(_mm_and_si128(b, high), _mm_setzero_si128()), _mm_set1_epi32(-1));
+		const __m128i low = _mm_set1_epi16(0xff);
+		SetSAT(_mm_or_si128(a_over, b_over));
+		CPU.VPR[vd]._m128i = _mm_packus_epi16(_mm_and_si128(_mm_or_si128(b, b_over), low), _mm_and_si128(_mm_or_si128(a, a_over), low));
 	}
 	void VPKUWUM(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 4; h++)
-		{
-			CPU.VPR[vd]._u16[h+4] = CPU.VPR[va]._u16[h*2];
-			CPU.VPR[vd]._u16[h  ] = CPU.VPR[vb]._u16[h*2];
-		}
+		CPU.VPR[vd]._m128i = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(CPU.VPR[vb]._m128i, 16), 16), _mm_srai_epi32(_mm_slli_epi32(CPU.VPR[va]._m128i, 16), 16));
 	}
 	void VPKUWUS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 4; h++)
-		{
-			u32 result = CPU.VPR[va]._u32[h];
-
-			if (result > UINT16_MAX)
-			{
-				result = UINT16_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-				
-			CPU.VPR[vd]._u16[h+4] = result;
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
 
-			result = CPU.VPR[vb]._u32[h];
+		const __m128i high = _mm_set1_epi32(0xffff0000);
+		const __m128i a_over = _mm_xor_si128(_mm_cmpeq_epi32(_mm_and_si128(a, high), _mm_setzero_si128()), _mm_set1_epi32(-1));
+		const __m128i b_over = _mm_xor_si128(_mm_cmpeq_epi32(_mm_and_si128(b, high), _mm_setzero_si128()), _mm_set1_epi32(-1));
+		SetSAT(_mm_or_si128(a_over, b_over));
 
-			if (result > UINT16_MAX)
-			{
-				result = UINT16_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-				
-			CPU.VPR[vd]._u16[h] = result;
-		}
+		// clamp, then pack the biased values with signed saturation
+		const __m128i low = _mm_set1_epi32(0xffff), bias = _mm_set1_epi32(0x8000);
+		const __m128i a_clamped = _mm_sub_epi32(_mm_and_si128(_mm_or_si128(a, a_over), low), bias);
+		const __m128i b_clamped = _mm_sub_epi32(_mm_and_si128(_mm_or_si128(b, b_over), low), bias);
+		CPU.VPR[vd]._m128i = _mm_xor_si128(_mm_packs_epi32(b_clamped, a_clamped), _mm_set1_epi16((s16)0x8000));
 	}
 	void VREFP(u32 vd, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._f[w] = 1.0f / CPU.VPR[vb]._f[w];
-		}
+		CPU.VPR[vd]._m128 = _mm_div_ps(_mm_set1_ps(1.0f), CPU.VPR[vb]._m128);
 	}
 	void VRFIM(u32 vd, u32 vb)
 	{
+		if (HostHasSSE41())
+		{
+			CPU.VPR[vd]._m128 = FloorSSE41(CPU.VPR[vb]._m128);
+			return;
+		}
+
 		for (uint w = 0; w < 4; w++)
 		{
 			CPU.VPR[vd]._f[w] = floor(CPU.VPR[vb]._f[w]);
@@ -1465,6 +896,12 @@ private:
 	}
 	void VRFIN(u32 vd, u32 vb)
 	{
+		if (HostHasSSE41())
+		{
+			CPU.VPR[vd]._m128 = FloorSSE41(_mm_add_ps(CPU.VPR[vb]._m128, _mm_set1_ps(0.5f)));
+			return;
+		}
+
 		for (uint w = 0; w < 4; w++)
 		{
 			CPU.VPR[vd]._f[w] = floor(CPU.VPR[vb]._f[w] + 0.5f);
@@ -1472,6 +909,12 @@ private:
 	}
 	void VRFIP(u32 vd, u32 vb)
 	{
+		if (HostHasSSE41())
+		{
+			CPU.VPR[vd]._m128 = CeilSSE41(CPU.VPR[vb]._m128);
+			return;
+		}
+
 		for (uint w = 0; w < 4; w++)
 		{
 			CPU.VPR[vd]._f[w] = ceil(CPU.VPR[vb]._f[w]);
@@ -1479,6 +922,12 @@ private:
 	}
 	void VRFIZ(u32 vd, u32 vb)
 	{
+		if (HostHasSSE41())
+		{
+			CPU.VPR[vd]._m128 = TruncSSE41(CPU.VPR[vb]._m128);
+			return;
+		}
+
 		for (uint w = 0; w < 4; w++)
 		{
 			float f;
@@ -1511,46 +960,27 @@ private:
 	}
 	void VRSQRTEFP(u32 vd, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			//TODO: accurate div
-			CPU.VPR[vd]._f[w] = 1.0f / sqrtf(CPU.VPR[vb]._f[w]);
-		}
+		//TODO: accurate div
+		CPU.VPR[vd]._m128 = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(CPU.VPR[vb]._m128));
 	}
 	void VSEL(u32 vd, u32 va, u32 vb, u32 vc)
 	{
-		for (uint b = 0; b < 16; b++)
-		{
-			CPU.VPR[vd]._u8[b] = (CPU.VPR[vb]._u8[b] & CPU.VPR[vc]._u8[b]) | (CPU.VPR[va]._u8[b] & (~CPU.VPR[vc]._u8[b]));
-		}
+		CPU.VPR[vd]._m128i = SelectBits(CPU.VPR[vc]._m128i, CPU.VPR[vb]._m128i, CPU.VPR[va]._m128i);
 	}
 	void VSL(u32 vd, u32 va, u32 vb)
 	{
-		u8 sh = CPU.VPR[vb]._u8[0] & 0x7;
-
-		u32 t = 1;
-
-		for (uint b = 0; b < 16; b++)
-		{
-			t &= (CPU.VPR[vb]._u8[b] & 0x7) == sh;
-		}
+		const __m128i b = CPU.VPR[vb]._m128i;
+		const int sh = CPU.VPR[vb]._u8[0] & 0x7;
 
-		if(t)
+		// the shift count must be the same in every byte
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(b, _mm_set1_epi8(0x7)), _mm_set1_epi8(sh))) == 0xffff)
 		{
-			CPU.VPR[vd]._u8[0] = CPU.VPR[va]._u8[0] << sh;
-
-			for (uint b = 1; b < 16; b++)
-			{
-				CPU.VPR[vd]._u8[b] = (CPU.VPR[va]._u8[b] << sh) | (CPU.VPR[va]._u8[b-1] >> (8 - sh));
-			}
+			CPU.VPR[vd]._m128i = ShiftBitsLeft(CPU.VPR[va]._m128i, sh);
 		}
 		else
 		{
 			//undefined
-			CPU.VPR[vd]._u32[0] = 0xCDCDCDCD;
-			CPU.VPR[vd]._u32[1] = 0xCDCDCDCD;
-			CPU.VPR[vd]._u32[2] = 0xCDCDCDCD;
-			CPU.VPR[vd]._u32[3] = 0xCDCDCDCD;
+			CPU.VPR[vd]._m128i = _mm_set1_epi32(0xCDCDCDCD);
 		}
 	}
 	void VSLB(u32 vd, u32 va, u32 vb)
@@ -1562,14 +992,8 @@ private:
 	}
 	void VSLDOI(u32 vd, u32 va, u32 vb, u32 sh)
 	{
-		u8 tmpSRC[32];
-		memcpy(tmpSRC, CPU.VPR[vb]._u8, 16);
-		memcpy(tmpSRC + 16, CPU.VPR[va]._u8, 16);
-
-		for(uint b=0; b<16; b++)
-		{
-			CPU.VPR[vd]._u8[15 - b] = tmpSRC[31 - (b + sh)];
-		}
+		// the high 16 bytes of va:vb shifted left by sh bytes
+		CPU.VPR[vd]._m128i = _mm_or_si128(ShiftBytesLeft(CPU.VPR[va]._m128i, sh), ShiftBytesRight(CPU.VPR[vb]._m128i, 16 - sh));
 	}
 	void VSLH(u32 vd, u32 va, u32 vb)
 	{
@@ -1580,14 +1004,7 @@ private:
 	}
 	void VSLO(u32 vd, u32 va, u32 vb)
 	{
-		u8 nShift = (CPU.VPR[vb]._u8[0] >> 3) & 0xf;
-
-		CPU.VPR[vd].Clear();
-
-		for (u8 b = 0; b < 16 - nShift; b++)
-		{
-			CPU.VPR[vd]._u8[15 - b] = CPU.VPR[va]._u8[15 - (b + nShift)];
-		}
+		CPU.VPR[vd]._m128i = ShiftBytesLeft(CPU.VPR[va]._m128i, (CPU.VPR[vb]._u8[0] >> 3) & 0xf);
 	}
 	void VSLW(u32 vd, u32 va, u32 vb)
 	{
@@ -1598,82 +1015,46 @@ private:
 	}
 	void VSPLTB(u32 vd, u32 uimm5, u32 vb)
 	{
-		u8 byte = CPU.VPR[vb]._u8[15 - uimm5];
-			
-		for (uint b = 0; b < 16; b++)
-		{
-			CPU.VPR[vd]._u8[b] = byte;
-		}
+		CPU.VPR[vd]._m128i = _mm_set1_epi8(CPU.VPR[vb]._u8[15 - uimm5]);
 	}
 	void VSPLTH(u32 vd, u32 uimm5, u32 vb)
 	{
 		assert(uimm5 < 8);
-			
-		u16 hword = CPU.VPR[vb]._u16[7 - uimm5];
 
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u16[h] = hword;
-		}
+		CPU.VPR[vd]._m128i = _mm_set1_epi16(CPU.VPR[vb]._u16[7 - uimm5]);
 	}
 	void VSPLTISB(u32 vd, s32 simm5)
 	{
-		for (uint b = 0; b < 16; b++)
-		{
-			CPU.VPR[vd]._u8[b] = simm5;
-		}
+		CPU.VPR[vd]._m128i = _mm_set1_epi8(simm5);
 	}
 	void VSPLTISH(u32 vd, s32 simm5)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u16[h] = (s16)simm5;
-		}
+		CPU.VPR[vd]._m128i = _mm_set1_epi16(simm5);
 	}
 	void VSPLTISW(u32 vd, s32 simm5)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = (s32)simm5;
-		}
+		CPU.VPR[vd]._m128i = _mm_set1_epi32(simm5);
 	}
 	void VSPLTW(u32 vd, u32 uimm5, u32 vb)
 	{
 		assert(uimm5 < 4);
 
-		u32 word = CPU.VPR[vb]._u32[3 - uimm5];
-			
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = word;
-		}
+		CPU.VPR[vd]._m128i = _mm_set1_epi32(CPU.VPR[vb]._u32[3 - uimm5]);
 	}
 	void VSR(u32 vd, u32 va, u32 vb)
 	{
-		u8 sh = CPU.VPR[vb]._u8[0] & 0x7;
-		u32 t = 1;
-
-		for (uint b = 0; b < 16; b++)
-		{
-			t &= (CPU.VPR[vb]._u8[b] & 0x7) == sh;
-		}
+		const __m128i b = CPU.VPR[vb]._m128i;
+		const int sh = CPU.VPR[vb]._u8[0] & 0x7;
 
-		if(t)
+		// the shift count must be the same in every byte
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(b, _mm_set1_epi8(0x7)), _mm_set1_epi8(sh))) == 0xffff)
 		{
-			CPU.VPR[vd]._u8[15] = CPU.VPR[va]._u8[15] >> sh;
-
-			for (uint b = 14; ~b; b--)
-			{
-				CPU.VPR[vd]._u8[b] = (CPU.VPR[va]._u8[b] >> sh) | (CPU.VPR[va]._u8[b+1] << (8 - sh));
-			}
+			CPU.VPR[vd]._m128i = ShiftBitsRight(CPU.VPR[va]._m128i, sh);
 		}
 		else
 		{
 			//undefined
-			CPU.VPR[vd]._u32[0] = 0xCDCDCDCD;
-			CPU.VPR[vd]._u32[1] = 0xCDCDCDCD;
-			CPU.VPR[vd]._u32[2] = 0xCDCDCDCD;
-			CPU.VPR[vd]._u32[3] = 0xCDCDCDCD;
+			CPU.VPR[vd]._m128i = _mm_set1_epi32(0xCDCDCDCD);
 		}
 	}
 	void VSRAB(u32 vd, u32 va, u32 vb)
@@ -1713,14 +1094,7 @@ private:
 	}
 	void VSRO(u32 vd, u32 va, u32 vb)
 	{
-		u8 nShift = (CPU.VPR[vb]._u8[0] >> 3) & 0xf;
-
-		CPU.VPR[vd].Clear();
-
-		for (u8 b = 0; b < 16 - nShift; b++)
-		{
-			CPU.VPR[vd]._u8[b] = CPU.VPR[va]._u8[b + nShift];
-		}
+		CPU.VPR[vd]._m128i = ShiftBytesRight(CPU.VPR[va]._m128i, (CPU.VPR[vb]._u8[0] >> 3) & 0xf);
 	}
 	void VSRW(u32 vd, u32 va, u32 vb)
 	{
@@ -1731,143 +1105,72 @@ private:
 	}
 	void VSUBCUW(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = CPU.VPR[va]._u32[w] < CPU.VPR[vb]._u32[w] ? 0 : 1;
-		}
+		CPU.VPR[vd]._m128i = _mm_andnot_si128(CmpGtU32(CPU.VPR[vb]._m128i, CPU.VPR[va]._m128i), _mm_set1_epi32(1));
 	}
 	void VSUBFP(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._f[w] = CPU.VPR[va]._f[w] - CPU.VPR[vb]._f[w];
-		}
+		CPU.VPR[vd]._m128 = CheckVSCR_NJ(_mm_sub_ps(CheckVSCR_NJ(CPU.VPR[va]._m128), CheckVSCR_NJ(CPU.VPR[vb]._m128)));
 	}
 	void VSUBSBS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-		{
-			s16 result = (s16)CPU.VPR[va]._s8[b] - (s16)CPU.VPR[vb]._s8[b];
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		const __m128i result = _mm_subs_epi8(a, b);
 
-			if (result < INT8_MIN)
-			{
-				CPU.VPR[vd]._s8[b] = INT8_MIN;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result > INT8_MAX)
-			{
-				CPU.VPR[vd]._s8[b] = INT8_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._s8[b] = (s8)result;
-		}
+		CheckSAT(result, _mm_sub_epi8(a, b));
+		CPU.VPR[vd]._m128i = result;
 	}
 	void VSUBSHS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			s32 result = (s32)CPU.VPR[va]._s16[h] - (s32)CPU.VPR[vb]._s16[h];
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		const __m128i result = _mm_subs_epi16(a, b);
 
-			if (result < INT16_MIN)
-			{
-				CPU.VPR[vd]._s16[h] = (s16)INT16_MIN;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result > INT16_MAX)
-			{
-				CPU.VPR[vd]._s16[h] = (s16)INT16_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._s16[h] = (s16)result;
-		}
+		CheckSAT(result, _mm_sub_epi16(a, b));
+		CPU.VPR[vd]._m128i = result;
 	}
 	void VSUBSWS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			s64 result = (s64)CPU.VPR[va]._s32[w] - (s64)CPU.VPR[vb]._s32[w];
-
-			if (result < INT32_MIN)
-			{
-				CPU.VPR[vd]._s32[w] = (s32)INT32_MIN;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (result > INT32_MAX)
-			{
-				CPU.VPR[vd]._s32[w] = (s32)INT32_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._s32[w] = (s32)result;
-		}
+		CPU.VPR[vd]._m128i = SubSatS32(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VSUBUBM(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-		{
-			CPU.VPR[vd]._u8[b] = (u8)((CPU.VPR[va]._u8[b] - CPU.VPR[vb]._u8[b]) & 0xff);
-		}
+		CPU.VPR[vd]._m128i = _mm_sub_epi8(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VSUBUBS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint b = 0; b < 16; b++)
-		{
-				s16 result = (s16)CPU.VPR[va]._u8[b] - (s16)CPU.VPR[vb]._u8[b];
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		const __m128i result = _mm_subs_epu8(a, b);
 
-				if (result < 0)
-				{
-				CPU.VPR[vd]._u8[b] = 0;
-				CPU.VSCR.SAT = 1;
-				}
-				else
-					CPU.VPR[vd]._u8[b] = (u8)result;
-		}
+		CheckSAT(result, _mm_sub_epi8(a, b));
+		CPU.VPR[vd]._m128i = result;
 	}
 	void VSUBUHM(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._u16[h] = CPU.VPR[va]._u16[h] - CPU.VPR[vb]._u16[h];
-		}
+		CPU.VPR[vd]._m128i = _mm_sub_epi16(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VSUBUHS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			s32 result = (s32)CPU.VPR[va]._u16[h] - (s32)CPU.VPR[vb]._u16[h];
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		const __m128i result = _mm_subs_epu16(a, b);
 
-			if (result < 0)
-			{
-				CPU.VPR[vd]._u16[h] = 0;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._u16[h] = (u16)result;
-		}
+		CheckSAT(result, _mm_sub_epi16(a, b));
+		CPU.VPR[vd]._m128i = result;
 	}
 	void VSUBUWM(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._u32[w] = CPU.VPR[va]._u32[w] - CPU.VPR[vb]._u32[w];
-		}
+		CPU.VPR[vd]._m128i = _mm_sub_epi32(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void VSUBUWS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			s64 result = (s64)CPU.VPR[va]._u32[w] - (s64)CPU.VPR[vb]._u32[w];
+		const __m128i a = CPU.VPR[va]._m128i;
+		const __m128i b = CPU.VPR[vb]._m128i;
+		const __m128i borrow = CmpGtU32(b, a);
 
-			if (result < 0)
-			{
-				CPU.VPR[vd]._u32[w] = 0;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._u32[w] = (u32)result;
-		}
+		SetSAT(borrow);
+		CPU.VPR[vd]._m128i = _mm_andnot_si128(borrow, _mm_sub_epi32(a, b));
 	}
 	void VSUMSWS(u32 vd, u32 va, u32 vb)
 	{
@@ -1917,73 +1220,29 @@ private:
 	}
 	void VSUM4SBS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			s64 sum = CPU.VPR[vb]._s32[w];
+		const __m128i a = CPU.VPR[va]._m128i;
 
-			for (uint b = 0; b < 4; b++)
-			{
-				sum += CPU.VPR[va]._s8[w*4 + b];
-			}
-
-			if (sum > INT32_MAX)
-			{
-				CPU.VPR[vd]._s32[w] = (s32)INT32_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (sum < INT32_MIN)
-			{
-				CPU.VPR[vd]._s32[w] = (s32)INT32_MIN;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._s32[w] = (s32)sum;
-		}
+		// sums of the 4 bytes of every word
+		const __m128i pairs = _mm_add_epi16(_mm_srai_epi16(_mm_slli_epi16(a, 8), 8), _mm_srai_epi16(a, 8));
+		CPU.VPR[vd]._m128i = AddSatS32(_mm_madd_epi16(pairs, _mm_set1_epi16(1)), CPU.VPR[vb]._m128i);
 	}
 	void VSUM4SHS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			s64 sum = CPU.VPR[vb]._s32[w];
-
-			for (uint h = 0; h < 2; h++)
-			{
-				sum += CPU.VPR[va]._s16[w*2 + h];
-			}
-
-			if (sum > INT32_MAX)
-			{
-				CPU.VPR[vd]._s32[w] = (s32)INT32_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else if (sum < INT32_MIN)
-			{
-				CPU.VPR[vd]._s32[w] = (s32)INT32_MIN;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._s32[w] = (s32)sum;
-		}
+		CPU.VPR[vd]._m128i = AddSatS32(_mm_madd_epi16(CPU.VPR[va]._m128i, _mm_set1_epi16(1)), CPU.VPR[vb]._m128i);
 	}
 	void VSUM4UBS(u32 vd, u32 va, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			u64 sum = CPU.VPR[vb]._u32[w];
+		const __m128i a = CPU.VPR[va]._m128i;
 
-			for (uint b = 0; b < 4; b++)
-			{
-				sum += CPU.VPR[va]._u8[w*4 + b];
-			}
+		// sums of the 4 bytes of every word
+		const __m128i low = _mm_set1_epi16(0xff);
+		const __m128i pairs = _mm_add_epi16(_mm_and_si128(a, low), _mm_srli_epi16(a, 8));
+		const __m128i sum = _mm_add_epi32(_mm_and_si128(pairs, _mm_set1_epi32(0xffff)), _mm_srli_epi32(pairs, 16));
+		const __m128i result = _mm_add_epi32(sum, CPU.VPR[vb]._m128i);
+		const __m128i carry = CmpGtU32(sum, result);
 
-			if (sum > UINT32_MAX)
-			{
-				CPU.VPR[vd]._u32[w] = (u32)UINT32_MAX;
-				CPU.VSCR.SAT = 1;
-			}
-			else
-				CPU.VPR[vd]._u32[w] = (u32)sum;
-		}
+		SetSAT(carry);
+		CPU.VPR[vd]._m128i = _mm_or_si128(result, carry);
 	}
 	void VUPKHPX(u32 vd, u32 vb)
 	{
@@ -1997,17 +1256,13 @@ private:
 	}
 	void VUPKHSB(u32 vd, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._s16[h] = CPU.VPR[vb]._s8[h];
-		}
+		const __m128i b = CPU.VPR[vb]._m128i;
+		CPU.VPR[vd]._m128i = _mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8);
 	}
 	void VUPKHSH(u32 vd, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._s32[w] = CPU.VPR[vb]._s16[w];
-		}
+		const __m128i b = CPU.VPR[vb]._m128i;
+		CPU.VPR[vd]._m128i = _mm_srai_epi32(_mm_unpackhi_epi16(b, b), 16);
 	}
 	void VUPKLPX(u32 vd, u32 vb)
 	{
@@ -2021,24 +1276,17 @@ private:
 	}
 	void VUPKLSB(u32 vd, u32 vb)
 	{
-		for (uint h = 0; h < 8; h++)
-		{
-			CPU.VPR[vd]._s16[h] = CPU.VPR[vb]._s8[8 + h];
-		}
+		const __m128i b = CPU.VPR[vb]._m128i;
+		CPU.VPR[vd]._m128i = _mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8);
 	}
 	void VUPKLSH(u32 vd, u32 vb)
 	{
-		for (uint w = 0; w < 4; w++)
-		{
-			CPU.VPR[vd]._s32[w] = CPU.VPR[vb]._s16[4 + w];
-		}
+		const __m128i b = CPU.VPR[vb]._m128i;
+		CPU.VPR[vd]._m128i = _mm_srai_epi32(_mm_unpacklo_epi16(b, b), 16);
 	}
 	void VXOR(u32 vd, u32 va, u32 vb)
 	{
-		CPU.VPR[vd]._u32[0] = CPU.VPR[va]._u32[0] ^ CPU.VPR[vb]._u32[0];
-		CPU.VPR[vd]._u32[1] = CPU.VPR[va]._u32[1] ^ CPU.VPR[vb]._u32[1];
-		CPU.VPR[vd]._u32[2] = CPU.VPR[va]._u32[2] ^ CPU.VPR[vb]._u32[2];
-		CPU.VPR[vd]._u32[3] = CPU.VPR[va]._u32[3] ^ CPU.VPR[vb]._u32[3];
+		CPU.VPR[vd]._m128i = _mm_xor_si128(CPU.VPR[va]._m128i, CPU.VPR[vb]._m128i);
 	}
 	void MULLI(u32 rd, u32 ra, s32 simm16)
 	{
@@ -2383,6 +1631,7 @@ private:
 		else
 		{
 		*/
+		CPU.SyncCR0();
 		CPU.GPR[rd] = CPU.CR.CR;
 		//}
 	}
@@ -2646,6 +1895,8 @@ private:
 	}
 	void MTOCRF(u32 l, u32 crm, u32 rs)
 	{
+		CPU.SyncCR0();
+
 		if(l)
 		{
 			u32 n = 0, count = 0;
@@ -2691,6 +1942,7 @@ private:
 			// Memory.Write32(addr, CPU.GPR[rs]);
 			CPU.SetCR_EQ(0, InterlockedCompareExchange((volatile long*) (Memory + addr), re((u32) CPU.GPR[rs]), re(reservation.data32)) == re(reservation.data32));
 			reservation.clear();
+			g_parking_lot.NotifyWrite(addr, 4);
 		}
 		else
 		{
@@ -2752,6 +2004,7 @@ private:
 			// Memory.Write64(addr, CPU.GPR[rs]);
 			CPU.SetCR_EQ(0, InterlockedCompareExchange64((volatile long long*)(Memory + addr), re(CPU.GPR[rs]), re(reservation.data64)) == re(reservation.data64));
 			reservation.clear();
+			g_parking_lot.NotifyWrite(addr, 8);
 		}
 		else
 		{
@@ -2870,6 +2123,8 @@ private:
 	{
 		const u32 n = (spr >> 5) | ((spr & 0x1f) << 5);
 
+		CPU.TB = g_host_clock.GetTimebase();
+
 		switch(n)
 		{
 		case 0x10C: CPU.GPR[rd] = CPU.TB; break;
@@ -3453,25 +2708,25 @@ private:
 			}
 		}
 
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fdivs.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FSUBS(u32 frd, u32 fra, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = static_cast<float>(CPU.FPR[fra] - CPU.FPR[frb]);
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fsubs.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FADDS(u32 frd, u32 fra, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = static_cast<float>(CPU.FPR[fra] + CPU.FPR[frb]);
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fadds.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FSQRTS(u32 frd, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = static_cast<float>(sqrt(CPU.FPR[frb]));
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fsqrts.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FRES(u32 frd, u32 frb, bool rc)
@@ -3488,31 +2743,31 @@ private:
 		CPU.FPR[frd] = static_cast<float>(CPU.FPR[fra] * CPU.FPR[frc]);
 		CPU.FPSCR.FI = 0;
 		CPU.FPSCR.FR = 0;
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fmuls.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FMADDS(u32 frd, u32 fra, u32 frc, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = static_cast<float>(CPU.FPR[fra] * CPU.FPR[frc] + CPU.FPR[frb]);
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fmadds.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FMSUBS(u32 frd, u32 fra, u32 frc, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = static_cast<float>(CPU.FPR[fra] * CPU.FPR[frc] - CPU.FPR[frb]);
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fmsubs.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FNMSUBS(u32 frd, u32 fra, u32 frc, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = static_cast<float>(-(CPU.FPR[fra] * CPU.FPR[frc] - CPU.FPR[frb]));
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fnmsubs.");////CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FNMADDS(u32 frd, u32 fra, u32 frc, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = static_cast<float>(-(CPU.FPR[fra] * CPU.FPR[frc] + CPU.FPR[frb]));
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fnmadds.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void STD(u32 rs, u32 ra, s32 d)
@@ -3528,6 +2783,7 @@ private:
 	}
 	void MTFSB1(u32 crbd, bool rc)
 	{
+		CPU.SyncFPRF();
 		u64 mask = (1ULL << crbd);
 		if ((crbd == 29) && !CPU.FPSCR.NI) ConLog.Warning("Non-IEEE mode enabled");
 		CPU.FPSCR.FPSCR |= mask;
@@ -3537,11 +2793,13 @@ private:
 	void MCRFS(u32 crbd, u32 crbs)
 	{
 		u64 mask = (1ULL << crbd);
+		CPU.SyncFlags();
 		CPU.CR.CR &= ~mask;
 		CPU.CR.CR |= CPU.FPSCR.FPSCR & mask;
 	}
 	void MTFSB0(u32 crbd, bool rc)
 	{
+		CPU.SyncFPRF();
 		u64 mask = (1ULL << crbd);
 		if ((crbd == 29) && !CPU.FPSCR.NI) ConLog.Warning("Non-IEEE mode disabled");
 		CPU.FPSCR.FPSCR &= ~mask;
@@ -3550,6 +2808,7 @@ private:
 	}
 	void MTFSFI(u32 crfd, u32 i, bool rc)
 	{
+		CPU.SyncFPRF();
 		u64 mask = (0x1ULL << crfd);
 
 		if(i)
@@ -3567,11 +2826,13 @@ private:
 	}
 	void MFFS(u32 frd, bool rc)
 	{
+		CPU.SyncFPRF();
 		(u64&)CPU.FPR[frd] = CPU.FPSCR.FPSCR;
 		if(rc) UNIMPLEMENTED();
 	}
 	void MTFSF(u32 flm, u32 frb, bool rc)
 	{
+		CPU.SyncFPRF();
 		u32 mask = 0;
 		for(u32 i=0; i<8; ++i)
 		{
@@ -3601,7 +2862,7 @@ private:
 			}
 		}
 
-		CPU.FPSCR.FPRF = cmp_res;
+		CPU.SetFPRF(cmp_res);
 		CPU.SetCR(crfd, cmp_res);
 	}
 	void FRSP(u32 frd, u32 frb, bool rc)
@@ -3615,7 +2876,7 @@ private:
 		const double r = static_cast<float>(b0);
 		CPU.FPSCR.FR = fabs(r) > fabs(b);
 		CPU.SetFPSCR_FI(b != r);
-		CPU.FPSCR.FPRF = PPCdouble(r).GetType();
+		CPU.UpdateFPRF(r);
 		CPU.FPR[frd] = r;
 	}
 	void FCTIW(u32 frd, u32 frb, bool rc)
@@ -3760,25 +3021,25 @@ private:
 		}
 
 		CPU.FPR[frd] = res;
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fdiv.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FSUB(u32 frd, u32 fra, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = CPU.FPR[fra] - CPU.FPR[frb];
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fsub.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FADD(u32 frd, u32 fra, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = CPU.FPR[fra] + CPU.FPR[frb];
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fadd.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FSQRT(u32 frd, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = sqrt(CPU.FPR[frb]);
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fsqrt.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FSEL(u32 frd, u32 fra, u32 frc, u32 frb, bool rc)
@@ -3788,23 +3049,28 @@ private:
 	}
 	void FMUL(u32 frd, u32 fra, u32 frc, bool rc)
 	{
-		if((FPRdouble::IsINF(CPU.FPR[fra]) && CPU.FPR[frc] == 0.0) || (FPRdouble::IsINF(CPU.FPR[frc]) && CPU.FPR[fra] == 0.0))
+		const double res = CPU.FPR[fra] * CPU.FPR[frc];
+
+		// the invalid operation exceptions can only happen when the result is a NaN
+		const bool nan = FPRdouble::IsNaN(res);
+
+		if(nan && ((FPRdouble::IsINF(CPU.FPR[fra]) && CPU.FPR[frc] == 0.0) || (FPRdouble::IsINF(CPU.FPR[frc]) && CPU.FPR[fra] == 0.0)))
 		{
 			CPU.SetFPSCRException(FPSCR_VXIMZ);
 			CPU.FPR[frd] = FPR_NAN;
 			CPU.FPSCR.FI = 0;
 			CPU.FPSCR.FR = 0;
-			CPU.FPSCR.FPRF = FPR_QNAN;
+			CPU.SetFPRF(FPR_QNAN);
 		}
 		else
 		{
-			if(FPRdouble::IsSNaN(CPU.FPR[fra]) || FPRdouble::IsSNaN(CPU.FPR[frc]))
+			if(nan && (FPRdouble::IsSNaN(CPU.FPR[fra]) || FPRdouble::IsSNaN(CPU.FPR[frc])))
 			{
 				CPU.SetFPSCRException(FPSCR_VXSNAN);
 			}
 
-			CPU.FPR[frd] = CPU.FPR[fra] * CPU.FPR[frc];
-			CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+			CPU.FPR[frd] = res;
+			CPU.UpdateFPRF(CPU.FPR[frd]);
 		}
 
 		if(rc) UNK("fmul.");//CPU.UpdateCR1(CPU.FPR[frd]);
@@ -3821,25 +3087,25 @@ private:
 	void FMSUB(u32 frd, u32 fra, u32 frc, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = CPU.FPR[fra] * CPU.FPR[frc] - CPU.FPR[frb];
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fmsub.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FMADD(u32 frd, u32 fra, u32 frc, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = CPU.FPR[fra] * CPU.FPR[frc] + CPU.FPR[frb];
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fmadd.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FNMSUB(u32 frd, u32 fra, u32 frc, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = -(CPU.FPR[fra] * CPU.FPR[frc] - CPU.FPR[frb]);
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fnmsub.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FNMADD(u32 frd, u32 fra, u32 frc, u32 frb, bool rc)
 	{
 		CPU.FPR[frd] = -(CPU.FPR[fra] * CPU.FPR[frc] + CPU.FPR[frb]);
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fnmadd.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 	void FCMPO(u32 crfd, u32 fra, u32 frb)
@@ -3861,7 +3127,7 @@ private:
 			CPU.FPSCR.FX = 1;
 		}
 
-		CPU.FPSCR.FPRF = cmp_res;
+		CPU.SetFPRF(cmp_res);
 		CPU.SetCR(crfd, cmp_res);
 	}
 	void FNEG(u32 frd, u32 frb, bool rc)
@@ -4004,7 +3270,7 @@ private:
 
 		CPU.FPR[frd] = bf;
 
-		CPU.FPSCR.FPRF = CPU.FPR[frd].GetType();
+		CPU.UpdateFPRF(CPU.FPR[frd]);
 		if(rc) UNK("fcfid.");//CPU.UpdateCR1(CPU.FPR[frd]);
 	}
 
@@ -4021,6 +3287,8 @@ private:
 
 		Emu.Pause();
 
+		CPU.SyncFlags();
+
 		for(uint i=0; i<32; ++i) ConLog.Write("r%d = 0x%llx", i, CPU.GPR[i]);
 		for(uint i=0; i<32; ++i) ConLog.Write("f%d = %llf", i, CPU.FPR[i]);
 		for(uint i=0; i<32; ++i) ConLog.Write("v%d = 0x%s [%s]", i, CPU.VPR[i].ToString(true).c_str(), CPU.VPR[i].ToString().c_str());
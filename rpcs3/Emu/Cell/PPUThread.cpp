@@ -44,6 +44,10 @@ void PPUThread::DoReset()
 	FPSCR.FPSCR = 0;
 	VSCR.VSCR   = 0;
 
+	m_strict_flags = Ini.CPUStrictFlags.GetValue();
+	m_cr0_pending  = false;
+	m_fprf_pending = false;
+
 	cycle = 0;
 }
 
@@ -140,6 +144,83 @@ u64 PPUThread::GetFreeStackSize() const
 	return (GetStackAddr() + GetStackSize()) - GPR[1];
 }
 
+u64 PPUThread::FastCall(const u64 addr, const u64 a1, const u64 a2, const u64 a3, const u64 a4)
+{
+	SyncFlags();
+
+	u64 old_gpr[32];
+	PPCdouble old_fpr[32];
+	VPR_reg old_vpr[32];
+	memcpy(old_gpr, GPR, sizeof(GPR));
+	memcpy(old_fpr, FPR, sizeof(FPR));
+	memcpy(old_vpr, VPR, sizeof(VPR));
+	const CRhdr old_cr = CR;
+	const FPSCRhdr old_fpscr = FPSCR;
+	const XERhdr old_xer = XER;
+	const VSCRhdr old_vscr = VSCR;
+	const u64 old_lr = LR;
+	const u64 old_ctr = CTR;
+	const u64 old_pc = PC;
+	const u64 old_npc = nPC;
+	const bool old_is_branch = m_is_branch;
+	const u64 old_block_pc = m_block_pc;
+
+	const u32 ret = Emu.GetCallbackExecutor().GetReturnAddr();
+
+	// the frame of the callback is below the protected zone of the interrupted code
+	const u64 sp = (GPR[1] - CallbackExecutor::fast_call_frame) & ~0xfULL;
+	Memory.Write64(sp, GPR[1]);
+
+	GPR[1] = sp;
+	GPR[2] = Memory.Read32(addr + 4);
+	GPR[3] = a1;
+	GPR[4] = a2;
+	GPR[5] = a3;
+	GPR[6] = a4;
+	LR = ret;
+	m_is_branch = false;
+	SetPc(Memory.Read32(addr));
+
+	while(PC != ret)
+	{
+		if(Emu.IsStopped() || IsStopped())
+		{
+			ConLog.Warning("%s: callback 0x%llx aborted", GetFName().c_str(), addr);
+			break;
+		}
+
+		// the host thread can't leave the syscall: a paused thread waits here
+		if(Emu.IsPaused() || IsPaused() || Sync())
+		{
+			Sleep(1);
+			continue;
+		}
+
+		Step();
+		NextPc(m_dec->DecodeMemory(PC + m_offset));
+		cycle++;
+	}
+
+	const u64 result = GPR[3];
+
+	SyncFlags();
+	memcpy(GPR, old_gpr, sizeof(GPR));
+	memcpy(FPR, old_fpr, sizeof(FPR));
+	memcpy(VPR, old_vpr, sizeof(VPR));
+	CR = old_cr;
+	FPSCR = old_fpscr;
+	XER = old_xer;
+	VSCR = old_vscr;
+	LR = old_lr;
+	CTR = old_ctr;
+	PC = old_pc;
+	nPC = old_npc;
+	m_is_branch = old_is_branch;
+	m_block_pc = old_block_pc;
+
+	return result;
+}
+
 void PPUThread::DoRun()
 {
 	switch(Ini.CPUDecoderMode.GetValue())
@@ -206,3 +287,226 @@ int FPRdouble::Cmp(PPCdouble a, PPCdouble b)
 
 	return CR_SO;
 }
+
+// operands of an instruction of a polling loop: GPR 0-31 and CR fields (32-39) as bit masks
+struct PPUSpinOp
+{
+	u64 defs;
+	u64 uses;
+	bool load; // address: (ra|0) + (indexed ? rb : disp)
+	bool reservation;
+	bool indexed;
+	u32 ra, rb;
+	s64 disp;
+	bool branch;
+	bool indirect; // bclr
+	u64 target;
+};
+
+#define SPIN_GPR(r) (1ULL << (r))
+#define SPIN_CR(f) (1ULL << (32 + (f)))
+
+// decodes the instructions allowed in a polling loop: loads, compares, integer operations and
+// branches without link or CTR update
+static bool DecodeSpinOp(const u32 code, const u64 pc, PPUSpinOp& op)
+{
+	const u32 rd = (code >> 21) & 0x1f; // rs, bo, crfD
+	const u32 ra = (code >> 16) & 0x1f; // bi
+	const u32 rb = (code >> 11) & 0x1f;
+	const u64 ra0 = ra ? SPIN_GPR(ra) : 0;
+	const u64 rc = (code & 1) ? SPIN_CR(0) : 0;
+
+	op.defs = op.uses = 0;
+	op.load = op.reservation = op.indexed = op.branch = op.indirect = false;
+	op.ra = ra;
+	op.rb = rb;
+	op.disp = 0;
+
+	switch(code >> 26)
+	{
+	case 10: // cmpli
+	case 11: // cmpi
+		op.uses = SPIN_GPR(ra); op.defs = SPIN_CR(rd >> 2); return true;
+
+	case 14: // addi
+	case 15: // addis
+		op.uses = ra0; op.defs = SPIN_GPR(rd); return true;
+
+	case 16: // bc
+		if((code & 1) || !(rd & 4)) return false; // link, CTR
+		op.uses = (rd & 0x10) ? 0 : SPIN_CR(ra >> 2);
+		op.branch = true;
+		op.target = ((code & 2) ? 0 : pc) + (s16)(code & 0xfffc);
+		return true;
+
+	case 18: // b
+		if(code & 1) return false;
+		op.branch = true;
+		op.target = ((code & 2) ? 0 : pc) + ((s32)((code & 0x03fffffc) << 6) >> 6);
+		return true;
+
+	case 19:
+		switch((code >> 1) & 0x3ff)
+		{
+		case 16: // bclr
+			if((code & 1) || !(rd & 4)) return false;
+			op.uses = (rd & 0x10) ? 0 : SPIN_CR(ra >> 2);
+			op.branch = op.indirect = true;
+			return true;
+
+		case 150: return true; // isync
+		}
+		return false;
+
+	case 20: // rlwimi
+		op.uses = SPIN_GPR(rd) | SPIN_GPR(ra); op.defs = SPIN_GPR(ra) | rc; return true;
+
+	case 21: // rlwinm
+	case 24: // ori
+	case 25: // oris
+	case 26: // xori
+	case 27: // xoris
+		if(code == 0x60000000) return true; // nop
+		op.uses = SPIN_GPR(rd); op.defs = SPIN_GPR(ra) | ((code >> 26) == 21 ? rc : 0); return true;
+
+	case 23: // rlwnm
+		op.uses = SPIN_GPR(rd) | SPIN_GPR(rb); op.defs = SPIN_GPR(ra) | rc; return true;
+
+	case 28: // andi.
+	case 29: // andis.
+		op.uses = SPIN_GPR(rd); op.defs = SPIN_GPR(ra) | SPIN_CR(0); return true;
+
+	case 30: // rldicl, rldicr, rldic, rldimi, rldcl, rldcr
+		switch((code >> 2) & 7)
+		{
+		case 0: case 1: case 2: op.uses = SPIN_GPR(rd); break;
+		case 3: op.uses = SPIN_GPR(rd) | SPIN_GPR(ra); break;
+		case 4: op.uses = SPIN_GPR(rd) | SPIN_GPR(rb); break;
+		default: return false;
+		}
+		op.defs = SPIN_GPR(ra) | rc;
+		return true;
+
+	case 31:
+		switch((code >> 1) & 0x3ff)
+		{
+		case 0: // cmp
+		case 32: // cmpl
+			op.uses = SPIN_GPR(ra) | SPIN_GPR(rb); op.defs = SPIN_CR(rd >> 2); return true;
+
+		case 20: // lwarx
+		case 84: // ldarx
+			op.reservation = true;
+			// fallthrough
+		case 21: // ldx
+		case 23: // lwzx
+		case 87: // lbzx
+		case 279: // lhzx
+		case 343: // lhax
+			op.uses = ra0 | SPIN_GPR(rb); op.defs = SPIN_GPR(rd); op.load = op.indexed = true; return true;
+
+		case 24: // slw
+		case 27: // sld
+		case 28: // and
+		case 60: // andc
+		case 124: // nor
+		case 284: // eqv
+		case 316: // xor
+		case 412: // orc
+		case 444: // or
+		case 476: // nand
+		case 536: // srw
+		case 539: // srd
+			op.uses = SPIN_GPR(rd) | SPIN_GPR(rb); op.defs = SPIN_GPR(ra) | rc; return true;
+
+		case 26: // cntlzw
+		case 58: // cntlzd
+		case 922: // extsh
+		case 954: // extsb
+		case 986: // extsw
+			op.uses = SPIN_GPR(rd); op.defs = SPIN_GPR(ra) | rc; return true;
+
+		case 40: // subf
+		case 266: // add
+			op.uses = SPIN_GPR(ra) | SPIN_GPR(rb); op.defs = SPIN_GPR(rd) | rc; return true;
+
+		case 104: // neg
+			op.uses = SPIN_GPR(ra); op.defs = SPIN_GPR(rd) | rc; return true;
+
+		case 598: // sync
+		case 854: // eieio
+			return true;
+		}
+		return false;
+
+	case 32: // lwz
+	case 34: // lbz
+	case 40: // lhz
+	case 42: // lha
+		op.uses = ra0; op.defs = SPIN_GPR(rd); op.load = true; op.disp = (s16)code; return true;
+
+	case 58: // ld, lwa
+		if((code & 3) != 0 && (code & 3) != 2) return false;
+		op.uses = ra0; op.defs = SPIN_GPR(rd); op.load = true; op.disp = (s16)(code & ~3); return true;
+	}
+
+	return false;
+}
+
+u64 PPUThread::GetSpinKey(const u64 start, const u64 end, SpinWaitKind& kind)
+{
+	// every register read must be loop-invariant or written earlier in the same iteration
+	u64 written = 0, defined = 0;
+	bool reservation = false, has_line = false;
+	u64 line = 0;
+
+	for(u32 pass = 0; pass < 2; pass++)
+	{
+		for(u64 pc = start; pc <= end; pc += 4)
+		{
+			PPUSpinOp op;
+			if(!DecodeSpinOp(Memory.Read32(pc), pc, op))
+			{
+				return 0;
+			}
+
+			if(pass == 0)
+			{
+				// only the last instruction branches back, the others can only leave the loop
+				if(op.branch ? pc != end && !op.indirect && op.target >= start && op.target <= end : pc == end)
+				{
+					return 0;
+				}
+
+				written |= op.defs;
+				continue;
+			}
+
+			if(op.uses & written & ~defined)
+			{
+				return 0;
+			}
+
+			if(op.load)
+			{
+				// the address must be the same in every iteration
+				if((op.ra && (written & SPIN_GPR(op.ra))) || (op.indexed && (written & SPIN_GPR(op.rb))))
+				{
+					return 0;
+				}
+
+				const u64 addr = (op.ra ? GPR[op.ra] : 0) + (op.indexed ? GPR[op.rb] : op.disp);
+				if(has_line && line != ParkingLot::LineKey(addr)) return 0;
+
+				line = ParkingLot::LineKey(addr);
+				has_line = true;
+				reservation |= op.reservation;
+			}
+
+			defined |= op.defs;
+		}
+	}
+
+	kind = reservation ? SPIN_WAIT_RESERVATION : SPIN_WAIT_MEMORY;
+	return has_line ? line : 0;
+}
@@ -340,15 +340,12 @@ struct PPCdouble
 		};
 	};
 
-	FPRType type;
-	
 	operator double&() { return _double; }
 	operator const double&() const { return _double; }
 
 	PPCdouble& operator = (const PPCdouble& r)
 	{
 		_u64 = r._u64;
-		type = UpdateType();
 		return *this;
 	}
 
@@ -386,7 +383,7 @@ struct PPCdouble
 
 	FPRType GetType() const
 	{
-		return type;
+		return UpdateType();
 	}
 
 	u32 To32() const
@@ -472,7 +469,8 @@ struct FPRdouble
 
 union VPR_reg
 {
-	//__m128i _m128i;
+	__m128i _m128i;
+	__m128 _m128;
 	u128 _u128;
 	s128 _s128;
 	u64 _u64[2];
@@ -585,6 +583,16 @@ public:
 
 	VSCRhdr VSCR; // Vector Status and Control Register
 
+	// Lazy flags: the record forms (Rc = 1) and the FP arithmetic instructions only save their
+	// result, CR0 and FPSCR.FPRF are computed from it when they're read (SyncCR0/SyncFPRF).
+	// The strict mode (CPU/StrictFlags) computes them immediately.
+	bool m_strict_flags;
+	bool m_cr0_pending;
+	bool m_cr0_so;
+	s64 m_cr0_result;
+	bool m_fprf_pending;
+	u64 m_fprf_result;
+
 	u64 LR;     //SPR 0x008 : Link Register
 	u64 CTR;    //SPR 0x009 : Count Register
 
@@ -606,17 +614,38 @@ public:
 		};
 	};
 
-	u64 cycle;
-
 public:
 	PPUThread();
 	virtual ~PPUThread();
 
-	inline u8 GetCR(const u8 n) const
+	void SyncCR0()
+	{
+		if(!m_cr0_pending) return;
+
+		m_cr0_pending = false;
+		CR.cr0 = (m_cr0_result < 0 ? CR_LT : m_cr0_result > 0 ? CR_GT : CR_EQ) | (m_cr0_so ? CR_SO : 0);
+	}
+
+	void SyncFPRF()
+	{
+		if(!m_fprf_pending) return;
+
+		m_fprf_pending = false;
+		FPSCR.FPRF = PPCdouble(m_fprf_result).GetType();
+	}
+
+	// must be called before CR or FPSCR are accessed directly
+	void SyncFlags()
+	{
+		SyncCR0();
+		SyncFPRF();
+	}
+
+	inline u8 GetCR(const u8 n)
 	{
 		switch(n)
 		{
-		case 0: return CR.cr0;
+		case 0: SyncCR0(); return CR.cr0;
 		case 1: return CR.cr1;
 		case 2: return CR.cr2;
 		case 3: return CR.cr3;
@@ -633,7 +662,7 @@ public:
 	{
 		switch(n)
 		{
-		case 0: CR.cr0 = value; break;
+		case 0: m_cr0_pending = false; CR.cr0 = value; break;
 		case 1: CR.cr1 = value; break;
 		case 2: CR.cr2 = value; break;
 		case 3: CR.cr3 = value; break;
@@ -648,7 +677,7 @@ public:
 	{
 		switch(n)
 		{
-		case 0: CR.cr0 = (value ? CR.cr0 | bit : CR.cr0 & ~bit); break;
+		case 0: SyncCR0(); CR.cr0 = (value ? CR.cr0 | bit : CR.cr0 & ~bit); break;
 		case 1: CR.cr1 = (value ? CR.cr1 | bit : CR.cr1 & ~bit); break;
 		case 2: CR.cr2 = (value ? CR.cr2 | bit : CR.cr2 & ~bit); break;
 		case 3: CR.cr3 = (value ? CR.cr3 | bit : CR.cr3 & ~bit); break;
@@ -664,9 +693,9 @@ public:
 	inline void SetCR_LT(const u8 n, const bool value) { SetCRBit(n, CR_LT, value); }	
 	inline void SetCR_SO(const u8 n, const bool value) { SetCRBit(n, CR_SO, value); }
 
-	inline bool IsCR_EQ(const u8 n) const { return (GetCR(n) & CR_EQ) ? 1 : 0; }
-	inline bool IsCR_GT(const u8 n) const { return (GetCR(n) & CR_GT) ? 1 : 0; }
-	inline bool IsCR_LT(const u8 n) const { return (GetCR(n) & CR_LT) ? 1 : 0; }
+	inline bool IsCR_EQ(const u8 n) { return (GetCR(n) & CR_EQ) ? 1 : 0; }
+	inline bool IsCR_GT(const u8 n) { return (GetCR(n) & CR_GT) ? 1 : 0; }
+	inline bool IsCR_LT(const u8 n) { return (GetCR(n) & CR_LT) ? 1 : 0; }
 
 	template<typename T> void UpdateCRn(const u8 n, const T a, const T b)
 	{
@@ -701,9 +730,13 @@ public:
 		}
 	}
 
-	template<typename T> void UpdateCR0(const T val)
+	template<typename T> void UpdateCR0(const T val) // T is signed
 	{
-		UpdateCRn<T>(0, val, 0);
+		m_cr0_result = val;
+		m_cr0_so = XER.SO;
+		m_cr0_pending = true;
+
+		if(m_strict_flags) SyncCR0();
 	}
 
 	template<typename T> void UpdateCR1()
@@ -719,7 +752,7 @@ public:
 	void SetCRBit (const u32 bit, bool set) { SetCRBit(bit >> 2, GetCRBit(bit), set); }
 	void SetCRBit2(const u32 bit, bool set) { SetCRBit(bit >> 2, 0x8 >> (bit & 3), set); }
 
-	const u8 IsCR(const u32 bit) const { return (GetCR(bit >> 2) & GetCRBit(bit)) ? 1 : 0; }
+	const u8 IsCR(const u32 bit) { return (GetCR(bit >> 2) & GetCRBit(bit)) ? 1 : 0; }
 
 	bool IsCarry(const u64 a, const u64 b) { return a > (a + b); }
 
@@ -729,6 +762,20 @@ public:
 		FPSCR.FPSCR |= mask;
 	}
 
+	void UpdateFPRF(const PPCdouble& result)
+	{
+		m_fprf_result = result._u64;
+		m_fprf_pending = true;
+
+		if(m_strict_flags) SyncFPRF();
+	}
+
+	void SetFPRF(const u32 type)
+	{
+		m_fprf_pending = false;
+		FPSCR.FPRF = type;
+	}
+
 	void SetFPSCR_FI(const u32 val)
 	{
 		if(val) SetFPSCRException(FPSCR_XX);
@@ -739,6 +786,8 @@ public:
 	{
 		std::string ret = "Registers:\n=========\n";
 
+		SyncFlags();
+
 		for(uint i=0; i<32; ++i) ret += fmt::Format("GPR[%d] = 0x%llx\n", i, GPR[i]);
 		for(uint i=0; i<32; ++i) ret += fmt::Format("FPR[%d] = %.6G\n", i, (double)FPR[i]);
 		for(uint i=0; i<32; ++i) ret += fmt::Format("VPR[%d] = 0x%s [%s]\n", i, (const char*)VPR[i].ToString(true).c_str(), (const char*)VPR[i].ToString().c_str());
@@ -765,6 +814,8 @@ public:
 
 	virtual std::string ReadRegString(const std::string& reg)
 	{
+		SyncFlags();
+
 		std::string::size_type first_brk = reg.find('[');
 		if (first_brk != std::string::npos)
 		{
@@ -783,6 +834,8 @@ public:
 	}
 
 	bool WriteRegString(const std::string& reg, std::string value) {
+		SyncFlags();
+
 		while (value.length() < 32) value = "0"+value;
 		std::string::size_type first_brk = reg.find('[');
 		try
@@ -840,7 +893,13 @@ public:
 	virtual void InitRegs(); 
 	virtual u64 GetFreeStackSize() const;
 
+	// calls the function (descriptor address) on this thread from a syscall and returns its r3,
+	// the state of the code which called the syscall is restored after the call
+	u64 FastCall(const u64 addr, const u64 a1 = 0, const u64 a2 = 0, const u64 a3 = 0, const u64 a4 = 0);
+
 protected:
+	virtual u64 GetSpinKey(const u64 start, const u64 end, SpinWaitKind& kind) override;
+
 	virtual void DoReset() override;
 	virtual void DoRun() override;
 	virtual void DoPause() override;
@@ -850,11 +909,7 @@ protected:
 protected:
 	virtual void Step() override
 	{
-		//if(++cycle > 20)
-		{
-			TB++;
-			//cycle = 0;
-		}
+		// TB is read from the host clock by mftb
 	}
 };
 
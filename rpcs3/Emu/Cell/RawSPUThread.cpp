@@ -1,5 +1,7 @@
 #include "stdafx.h"
 #include "Emu/Cell/RawSPUThread.h"
+#include "Emu/CPU/GuestProfiler.h"
+#include "Headless.h"
 
 RawSPUThread::RawSPUThread(u32 index, CPUThreadType type)
 	: SPUThread(type)
@@ -253,17 +255,15 @@ void RawSPUThread::Task()
 {
 	if (Ini.HLELogging.GetValue()) ConLog.Write("%s enter", PPCThread::GetFName().c_str());
 
-	const std::vector<u64>& bp = Emu.GetBreakPoints();
+	BreakPointManager& bp = Emu.GetBreakPoints();
+	GuestOpCounts* op_counts = g_guest_profiler.AcquireOpCounts(m_type);
+	const bool spin_wait = Ini.CPUThreadParking.GetValue();
 
 	try
 	{
-		for(uint i=0; i<bp.size(); ++i)
+		if(bp.IsBreakPoint(m_offset + PC))
 		{
-			if(bp[i] == m_offset + PC)
-			{
-				Emu.Pause();
-				break;
-			}
+			Emu.Pause();
 		}
 
 		bool is_last_paused = true;
@@ -306,8 +306,12 @@ void RawSPUThread::Task()
 				ConLog.Warning("Starting RawSPU...");
 			}
 
+			if(op_counts) op_counts->Count(Memory.Read32(PC + m_offset));
+
+			const u64 pc = PC;
 			Step();
 			NextPc(m_dec->DecodeMemory(PC + m_offset));
+			cycle++;
 
 			if(status == CPUThread_Step)
 			{
@@ -315,13 +319,14 @@ void RawSPUThread::Task()
 				continue;
 			}
 
-			for(uint i=0; i<bp.size(); ++i)
+			if(spin_wait && PC <= pc)
 			{
-				if(bp[i] == PC)
-				{
-					Emu.Pause();
-					continue;
-				}
+				CheckSpin(PC, pc);
+			}
+
+			if(bp.IsBreakPoint(PC))
+			{
+				Emu.Pause();
 			}
 		}
 	}
@@ -334,5 +339,9 @@ void RawSPUThread::Task()
 		ConLog.Error("Exception: %s", e);
 	}
 
+	CancelSpin();
+	g_guest_profiler.ReleaseOpCounts(op_counts);
+	if (g_headless_report.IsEnabled()) g_headless_report.AddThread(PPCThread::GetFName(), PPCThread::GetTypeString(), cycle);
+
 	if (Ini.HLELogging.GetValue()) ConLog.Write("%s leave", PPCThread::GetFName().c_str());
 }
@@ -3,7 +3,9 @@
 #include "Emu/Cell/SPUOpcodes.h"
 #include "Emu/Memory/Memory.h"
 #include "Emu/Cell/SPUThread.h"
+#include "Emu/Cell/SPURSManager.h"
 #include "Emu/SysCalls/SysCalls.h"
+#include "Utilities/SSE.h"
 
 #define UNIMPLEMENTED() UNK(__FUNCTION__)
 
@@ -25,6 +27,25 @@ public:
 	}
 
 private:
+	// byte n of the result is 0xff if bit n of mask is set (FSMB)
+	static __m128i ExpandBits(u32 mask)
+	{
+		const __m128i bits = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+		const __m128i pref = _mm_set_epi32(((mask >> 8) & 0xff) * 0x01010101, ((mask >> 8) & 0xff) * 0x01010101,
+			(mask & 0xff) * 0x01010101, (mask & 0xff) * 0x01010101);
+		return _mm_cmpeq_epi8(_mm_and_si128(pref, bits), bits);
+	}
+
+	// adds scale to the exponent field, clamped to 0..255 (CFLTS/CFLTU/CSFLT/CUFLT)
+	static __m128 ScaleExponent(__m128 v, s32 scale)
+	{
+		const __m128i bits = _mm_castps_si128(v);
+		__m128i exp = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xff)), _mm_set1_epi32(scale));
+		exp = _mm_andnot_si128(_mm_cmplt_epi32(exp, _mm_setzero_si128()), exp);
+		exp = SelectBits(_mm_cmpgt_epi32(exp, _mm_set1_epi32(255)), _mm_set1_epi32(255), exp);
+		return _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x807fffff)), _mm_slli_epi32(exp, 23)));
+	}
+
 	void SysCall()
 	{
 	}
@@ -34,6 +55,9 @@ private:
 	{
 		CPU.SetExitStatus(code); // exit code (not status)
 
+		// kernel SPU of a SPURS instance: the tasks return to the native kernel
+		if (CPU.spurs && CPU.spurs->HandleStop(CPU, code)) return;
+
 		switch (code)
 		{
 		case 0x110: /* ===== sys_spu_thread_receive_event ===== */
@@ -174,41 +198,29 @@ private:
 	}
 	void SF(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u32[0] = CPU.GPR[rb]._u32[0] - CPU.GPR[ra]._u32[0];
-		CPU.GPR[rt]._u32[1] = CPU.GPR[rb]._u32[1] - CPU.GPR[ra]._u32[1];
-		CPU.GPR[rt]._u32[2] = CPU.GPR[rb]._u32[2] - CPU.GPR[ra]._u32[2];
-		CPU.GPR[rt]._u32[3] = CPU.GPR[rb]._u32[3] - CPU.GPR[ra]._u32[3];
+		CPU.GPR[rt]._m128i = _mm_sub_epi32(CPU.GPR[rb]._m128i, CPU.GPR[ra]._m128i);
 	}
 	void OR(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u32[0] = CPU.GPR[ra]._u32[0] | CPU.GPR[rb]._u32[0];
-		CPU.GPR[rt]._u32[1] = CPU.GPR[ra]._u32[1] | CPU.GPR[rb]._u32[1];
-		CPU.GPR[rt]._u32[2] = CPU.GPR[ra]._u32[2] | CPU.GPR[rb]._u32[2];
-		CPU.GPR[rt]._u32[3] = CPU.GPR[ra]._u32[3] | CPU.GPR[rb]._u32[3];
+		CPU.GPR[rt]._m128i = _mm_or_si128(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void BG(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u32[0] = CPU.GPR[ra]._u32[0] > CPU.GPR[rb]._u32[0] ? 0 : 1;
-		CPU.GPR[rt]._u32[1] = CPU.GPR[ra]._u32[1] > CPU.GPR[rb]._u32[1] ? 0 : 1;
-		CPU.GPR[rt]._u32[2] = CPU.GPR[ra]._u32[2] > CPU.GPR[rb]._u32[2] ? 0 : 1;
-		CPU.GPR[rt]._u32[3] = CPU.GPR[ra]._u32[3] > CPU.GPR[rb]._u32[3] ? 0 : 1;
+		CPU.GPR[rt]._m128i = _mm_andnot_si128(CmpGtU32(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i), _mm_set1_epi32(1));
 	}
 	void SFH(u32 rt, u32 ra, u32 rb)
 	{
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._u16[h] = CPU.GPR[rb]._u16[h] - CPU.GPR[ra]._u16[h];
+		CPU.GPR[rt]._m128i = _mm_sub_epi16(CPU.GPR[rb]._m128i, CPU.GPR[ra]._m128i);
 	}
 	void NOR(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u32[0] = ~(CPU.GPR[ra]._u32[0] | CPU.GPR[rb]._u32[0]);
-		CPU.GPR[rt]._u32[1] = ~(CPU.GPR[ra]._u32[1] | CPU.GPR[rb]._u32[1]);
-		CPU.GPR[rt]._u32[2] = ~(CPU.GPR[ra]._u32[2] | CPU.GPR[rb]._u32[2]);
-		CPU.GPR[rt]._u32[3] = ~(CPU.GPR[ra]._u32[3] | CPU.GPR[rb]._u32[3]);
+		CPU.GPR[rt]._m128i = _mm_xor_si128(_mm_or_si128(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i), _mm_set1_epi32(-1));
 	}
 	void ABSDB(u32 rt, u32 ra, u32 rb)
 	{
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._u8[b] = CPU.GPR[rb]._u8[b] > CPU.GPR[ra]._u8[b] ? CPU.GPR[rb]._u8[b] - CPU.GPR[ra]._u8[b] : CPU.GPR[ra]._u8[b] - CPU.GPR[rb]._u8[b];
+		const __m128i a = CPU.GPR[ra]._m128i;
+		const __m128i b = CPU.GPR[rb]._m128i;
+		CPU.GPR[rt]._m128i = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
 	}
 	void ROT(u32 rt, u32 ra, u32 rb)
 	{
@@ -261,99 +273,70 @@ private:
 	void ROTI(u32 rt, u32 ra, s32 i7)
 	{
 		const int nRot = i7 & 0x1f;
-		CPU.GPR[rt]._u32[0] = (CPU.GPR[ra]._u32[0] << nRot) | (CPU.GPR[ra]._u32[0] >> (32 - nRot));
-		CPU.GPR[rt]._u32[1] = (CPU.GPR[ra]._u32[1] << nRot) | (CPU.GPR[ra]._u32[1] >> (32 - nRot));
-		CPU.GPR[rt]._u32[2] = (CPU.GPR[ra]._u32[2] << nRot) | (CPU.GPR[ra]._u32[2] >> (32 - nRot));
-		CPU.GPR[rt]._u32[3] = (CPU.GPR[ra]._u32[3] << nRot) | (CPU.GPR[ra]._u32[3] >> (32 - nRot));
+		const __m128i a = CPU.GPR[ra]._m128i;
+		CPU.GPR[rt]._m128i = _mm_or_si128(_mm_sll_epi32(a, _mm_cvtsi32_si128(nRot)), _mm_srl_epi32(a, _mm_cvtsi32_si128(32 - nRot)));
 	}
 	void ROTMI(u32 rt, u32 ra, s32 i7)
 	{
-		const int nRot = (0 - i7) % 64;
-		CPU.GPR[rt]._u32[0] = nRot < 32 ? CPU.GPR[ra]._u32[0] >> nRot : 0;
-		CPU.GPR[rt]._u32[1] = nRot < 32 ? CPU.GPR[ra]._u32[1] >> nRot : 0;
-		CPU.GPR[rt]._u32[2] = nRot < 32 ? CPU.GPR[ra]._u32[2] >> nRot : 0;
-		CPU.GPR[rt]._u32[3] = nRot < 32 ? CPU.GPR[ra]._u32[3] >> nRot : 0;
+		const int nRot = (0 - i7) & 0x3f; // shifts by 32 and more give 0
+		CPU.GPR[rt]._m128i = _mm_srl_epi32(CPU.GPR[ra]._m128i, _mm_cvtsi32_si128(nRot));
 	}
 	void ROTMAI(u32 rt, u32 ra, s32 i7)
 	{
-		const int nRot = (0 - i7) % 64;
-		CPU.GPR[rt]._i32[0] = nRot < 32 ? CPU.GPR[ra]._i32[0] >> nRot : CPU.GPR[ra]._i32[0] >> 31;
-		CPU.GPR[rt]._i32[1] = nRot < 32 ? CPU.GPR[ra]._i32[1] >> nRot : CPU.GPR[ra]._i32[1] >> 31;
-		CPU.GPR[rt]._i32[2] = nRot < 32 ? CPU.GPR[ra]._i32[2] >> nRot : CPU.GPR[ra]._i32[2] >> 31;
-		CPU.GPR[rt]._i32[3] = nRot < 32 ? CPU.GPR[ra]._i32[3] >> nRot : CPU.GPR[ra]._i32[3] >> 31;
+		const int nRot = (0 - i7) & 0x3f; // shifts by 32 and more fill with the sign bit
+		CPU.GPR[rt]._m128i = _mm_sra_epi32(CPU.GPR[ra]._m128i, _mm_cvtsi32_si128(nRot));
 	}
 	void SHLI(u32 rt, u32 ra, s32 i7)
 	{
-		const u32 s = i7 & 0x3f;
-
-		for (u32 j = 0; j < 4; ++j)
-			CPU.GPR[rt]._u32[j] = CPU.GPR[ra]._u32[j] << s;
+		const int s = i7 & 0x3f;
+		CPU.GPR[rt]._m128i = _mm_sll_epi32(CPU.GPR[ra]._m128i, _mm_cvtsi32_si128(s));
 	}
 	void ROTHI(u32 rt, u32 ra, s32 i7)
 	{
 		const int nRot = i7 & 0xf;
-
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._u16[h] = (CPU.GPR[ra]._u16[h] << nRot) | (CPU.GPR[ra]._u16[h] >> (16 - nRot));
+		const __m128i a = CPU.GPR[ra]._m128i;
+		CPU.GPR[rt]._m128i = _mm_or_si128(_mm_sll_epi16(a, _mm_cvtsi32_si128(nRot)), _mm_srl_epi16(a, _mm_cvtsi32_si128(16 - nRot)));
 	}
 	void ROTHMI(u32 rt, u32 ra, s32 i7)
 	{
-		const int nRot = (0 - i7) % 32;
-
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._u16[h] = nRot < 16 ? CPU.GPR[ra]._u16[h] >> nRot : 0;
+		const int nRot = (0 - i7) & 0x1f;
+		CPU.GPR[rt]._m128i = _mm_srl_epi16(CPU.GPR[ra]._m128i, _mm_cvtsi32_si128(nRot));
 	}
 	void ROTMAHI(u32 rt, u32 ra, s32 i7)
 	{
-		const int nRot = (0 - i7) % 32;
-
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._i16[h] = nRot < 16 ? CPU.GPR[ra]._i16[h] >> nRot : CPU.GPR[ra]._i16[h] >> 15;
+		const int nRot = (0 - i7) & 0x1f;
+		CPU.GPR[rt]._m128i = _mm_sra_epi16(CPU.GPR[ra]._m128i, _mm_cvtsi32_si128(nRot));
 	}
 	void SHLHI(u32 rt, u32 ra, s32 i7)
 	{
 		const int nRot = i7 & 0x1f;
-
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._u16[0] = nRot > 15 ? 0 : CPU.GPR[ra]._u16[0] << nRot;
+		CPU.GPR[rt]._m128i = _mm_sll_epi16(CPU.GPR[ra]._m128i, _mm_cvtsi32_si128(nRot));
 	}
 	void A(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u32[0] = CPU.GPR[ra]._u32[0] + CPU.GPR[rb]._u32[0];
-		CPU.GPR[rt]._u32[1] = CPU.GPR[ra]._u32[1] + CPU.GPR[rb]._u32[1];
-		CPU.GPR[rt]._u32[2] = CPU.GPR[ra]._u32[2] + CPU.GPR[rb]._u32[2];
-		CPU.GPR[rt]._u32[3] = CPU.GPR[ra]._u32[3] + CPU.GPR[rb]._u32[3];
+		CPU.GPR[rt]._m128i = _mm_add_epi32(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void AND(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u32[0] = CPU.GPR[ra]._u32[0] & CPU.GPR[rb]._u32[0];
-		CPU.GPR[rt]._u32[1] = CPU.GPR[ra]._u32[1] & CPU.GPR[rb]._u32[1];
-		CPU.GPR[rt]._u32[2] = CPU.GPR[ra]._u32[2] & CPU.GPR[rb]._u32[2];
-		CPU.GPR[rt]._u32[3] = CPU.GPR[ra]._u32[3] & CPU.GPR[rb]._u32[3];
+		CPU.GPR[rt]._m128i = _mm_and_si128(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void CG(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u32[0] = ((CPU.GPR[ra]._u32[0] + CPU.GPR[rb]._u32[0]) < CPU.GPR[ra]._u32[0]) ? 1 : 0;
-		CPU.GPR[rt]._u32[1] = ((CPU.GPR[ra]._u32[1] + CPU.GPR[rb]._u32[1]) < CPU.GPR[ra]._u32[1]) ? 1 : 0;
-		CPU.GPR[rt]._u32[2] = ((CPU.GPR[ra]._u32[2] + CPU.GPR[rb]._u32[2]) < CPU.GPR[ra]._u32[2]) ? 1 : 0;
-		CPU.GPR[rt]._u32[3] = ((CPU.GPR[ra]._u32[3] + CPU.GPR[rb]._u32[3]) < CPU.GPR[ra]._u32[3]) ? 1 : 0;
+		const __m128i a = CPU.GPR[ra]._m128i;
+		const __m128i sum = _mm_add_epi32(a, CPU.GPR[rb]._m128i);
+		CPU.GPR[rt]._m128i = _mm_srli_epi32(CmpGtU32(a, sum), 31);
 	}
 	void AH(u32 rt, u32 ra, u32 rb)
 	{
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._u16[h] = CPU.GPR[ra]._u16[h] + CPU.GPR[rb]._u16[h];
+		CPU.GPR[rt]._m128i = _mm_add_epi16(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void NAND(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u32[0] = ~(CPU.GPR[ra]._u32[0] & CPU.GPR[rb]._u32[0]);
-		CPU.GPR[rt]._u32[1] = ~(CPU.GPR[ra]._u32[1] & CPU.GPR[rb]._u32[1]);
-		CPU.GPR[rt]._u32[2] = ~(CPU.GPR[ra]._u32[2] & CPU.GPR[rb]._u32[2]);
-		CPU.GPR[rt]._u32[3] = ~(CPU.GPR[ra]._u32[3] & CPU.GPR[rb]._u32[3]);
+		CPU.GPR[rt]._m128i = _mm_xor_si128(_mm_and_si128(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i), _mm_set1_epi32(-1));
 	}
 	void AVGB(u32 rt, u32 ra, u32 rb)
 	{
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._u8[b] = (CPU.GPR[ra]._u8[b] + CPU.GPR[rb]._u8[b] + 1) >> 1;
+		CPU.GPR[rt]._m128i = _mm_avg_epu8(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void MTSPR(u32 rt, u32 sa)
 	{
@@ -428,61 +411,45 @@ private:
 	}
 	void GB(u32 rt, u32 ra)
 	{
-		CPU.GPR[rt]._u32[3] =	(CPU.GPR[ra]._u32[0] & 1) |
-										((CPU.GPR[ra]._u32[1] & 1) << 1) |
-										((CPU.GPR[ra]._u32[2] & 1) << 2) |
-										((CPU.GPR[ra]._u32[3] & 1) << 3);
-		CPU.GPR[rt]._u32[2] = 0;
-		CPU.GPR[rt]._u64[0] = 0;
+		const int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_slli_epi32(CPU.GPR[ra]._m128i, 31)));
+		CPU.GPR[rt]._m128i = _mm_set_epi32(mask, 0, 0, 0);
 	}
 	void GBH(u32 rt, u32 ra)
 	{
-		u32 temp = 0;
-		for (int h = 0; h < 8; h++)
-			temp |= (CPU.GPR[ra]._u16[h] & 1) << h;
-		CPU.GPR[rt]._u32[3] = temp;
-		CPU.GPR[rt]._u32[2] = 0;
-		CPU.GPR[rt]._u64[0] = 0;
+		const __m128i bits = _mm_slli_epi16(CPU.GPR[ra]._m128i, 15);
+		const int mask = _mm_movemask_epi8(_mm_packs_epi16(bits, bits)) & 0xff;
+		CPU.GPR[rt]._m128i = _mm_set_epi32(mask, 0, 0, 0);
 	}
 	void GBB(u32 rt, u32 ra)
 	{
-		u32 temp = 0;
-		for (int b = 0; b < 16; b++)
-			temp |= (CPU.GPR[ra]._u8[b] & 1) << b;
-		CPU.GPR[rt]._u32[3] = temp;
-		CPU.GPR[rt]._u32[2] = 0;
-		CPU.GPR[rt]._u64[0] = 0;
+		const int mask = _mm_movemask_epi8(_mm_slli_epi16(CPU.GPR[ra]._m128i, 7));
+		CPU.GPR[rt]._m128i = _mm_set_epi32(mask, 0, 0, 0);
 	}
 	void FSM(u32 rt, u32 ra)
 	{
-		const u32 pref = CPU.GPR[ra]._u32[3];
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] = (pref & (1 << w)) ? ~0 : 0;
+		const __m128i bits = _mm_set_epi32(8, 4, 2, 1);
+		const __m128i pref = _mm_and_si128(_mm_set1_epi32(CPU.GPR[ra]._u32[3]), bits);
+		CPU.GPR[rt]._m128i = _mm_cmpeq_epi32(pref, bits);
 	}
 	void FSMH(u32 rt, u32 ra)
 	{
-		const u32 pref = CPU.GPR[ra]._u32[3];
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._u16[h] = (pref & (1 << h)) ? ~0 : 0;
+		const __m128i bits = _mm_set_epi16(128, 64, 32, 16, 8, 4, 2, 1);
+		const __m128i pref = _mm_and_si128(_mm_set1_epi16(CPU.GPR[ra]._u32[3] & 0xff), bits);
+		CPU.GPR[rt]._m128i = _mm_cmpeq_epi16(pref, bits);
 	}
 	void FSMB(u32 rt, u32 ra)
 	{
-		const u32 pref = CPU.GPR[ra]._u32[3];
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._u8[b] = (pref & (1 << b)) ? ~0 : 0;
+		CPU.GPR[rt]._m128i = ExpandBits(CPU.GPR[ra]._u32[3]);
 	}
 	void FREST(u32 rt, u32 ra)
 	{
-		//CPU.GPR[rt]._m128 = _mm_rcp_ps(CPU.GPR[ra]._m128);
-		for (int i = 0; i < 4; i++)
-			CPU.GPR[rt]._f[i] = 1 / CPU.GPR[ra]._f[i];
+		// exact instead of rcpps: FI passes the estimate through unchanged
+		CPU.GPR[rt]._m128 = _mm_div_ps(_mm_set1_ps(1.0f), CPU.GPR[ra]._m128);
 	}
 	void FRSQEST(u32 rt, u32 ra)
 	{
-		//const __u32x4 FloatAbsMask = {0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff};
-		//CPU.GPR[rt]._m128 = _mm_rsqrt_ps(_mm_and_ps(CPU.GPR[ra]._m128, FloatAbsMask.m128));
-		for (int i = 0; i < 4; i++)
-			CPU.GPR[rt]._f[i] = 1 / sqrt(abs(CPU.GPR[ra]._f[i]));
+		const __m128 abs = _mm_and_ps(CPU.GPR[ra]._m128, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+		CPU.GPR[rt]._m128 = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(abs));
 	}
 	void LQX(u32 rt, u32 ra, u32 rb)
 	{
@@ -501,26 +468,15 @@ private:
 	}
 	void ROTQBYBI(u32 rt, u32 ra, u32 rb)
 	{
-		const int s = (CPU.GPR[rb]._u32[3] >> 3) & 0xf;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._u8[b] = temp._u8[(b - s) & 0xf];
+		CPU.GPR[rt]._m128i = RotateBytes(CPU.GPR[ra]._m128i, (CPU.GPR[rb]._u32[3] >> 3) & 0xf);
 	}
 	void ROTQMBYBI(u32 rt, u32 ra, u32 rb)
 	{
-		const int s = (0 - (CPU.GPR[rb]._u32[3] >> 3)) & 0x1f;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		CPU.GPR[rt].Reset();
-		for (int b = 0; b < 16 - s; b++)
-			CPU.GPR[rt]._u8[b] = temp._u8[b + s];
+		CPU.GPR[rt]._m128i = ShiftBytesRight(CPU.GPR[ra]._m128i, (0 - (CPU.GPR[rb]._u32[3] >> 3)) & 0x1f);
 	}
 	void SHLQBYBI(u32 rt, u32 ra, u32 rb)
 	{
-		const int s = (CPU.GPR[rb]._u32[3] >> 3) & 0x1f;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		CPU.GPR[rt].Reset();
-		for (int b = s; b < 16; b++)
-			CPU.GPR[rt]._u8[b] = temp._u8[b - s];
+		CPU.GPR[rt]._m128i = ShiftBytesLeft(CPU.GPR[ra]._m128i, (CPU.GPR[rb]._u32[3] >> 3) & 0x1f);
 	}
 	void CBX(u32 rt, u32 ra, u32 rb)
 	{
@@ -556,53 +512,27 @@ private:
 	}
 	void ROTQBI(u32 rt, u32 ra, u32 rb)
 	{
-		const int t = CPU.GPR[rb]._u32[3] & 0x7;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		CPU.GPR[rt]._u32[0] = (temp._u32[0] << t) | (temp._u32[3] >> (32 - t));
-		CPU.GPR[rt]._u32[1] = (temp._u32[1] << t) | (temp._u32[0] >> (32 - t));
-		CPU.GPR[rt]._u32[2] = (temp._u32[2] << t) | (temp._u32[1] >> (32 - t));
-		CPU.GPR[rt]._u32[3] = (temp._u32[3] << t) | (temp._u32[2] >> (32 - t));
+		CPU.GPR[rt]._m128i = RotateBits(CPU.GPR[ra]._m128i, CPU.GPR[rb]._u32[3] & 0x7);
 	}
 	void ROTQMBI(u32 rt, u32 ra, u32 rb)
 	{
-		const int t = (0 - CPU.GPR[rb]._u32[3]) & 0x7;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		CPU.GPR[rt]._u32[0] = (temp._u32[0] >> t) | (temp._u32[1] << (32 - t));
-		CPU.GPR[rt]._u32[1] = (temp._u32[1] >> t) | (temp._u32[2] << (32 - t));
-		CPU.GPR[rt]._u32[2] = (temp._u32[2] >> t) | (temp._u32[3] << (32 - t));
-		CPU.GPR[rt]._u32[3] = (temp._u32[3] >> t);
+		CPU.GPR[rt]._m128i = ShiftBitsRight(CPU.GPR[ra]._m128i, (0 - CPU.GPR[rb]._u32[3]) & 0x7);
 	}
 	void SHLQBI(u32 rt, u32 ra, u32 rb)
 	{
-		const int t = CPU.GPR[rb]._u32[3] & 0x7;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		CPU.GPR[rt]._u32[0] = (temp._u32[0] << t);
-		CPU.GPR[rt]._u32[1] = (temp._u32[1] << t) | (temp._u32[0] >> (32 - t));
-		CPU.GPR[rt]._u32[2] = (temp._u32[2] << t) | (temp._u32[1] >> (32 - t));
-		CPU.GPR[rt]._u32[3] = (temp._u32[3] << t) | (temp._u32[2] >> (32 - t));
+		CPU.GPR[rt]._m128i = ShiftBitsLeft(CPU.GPR[ra]._m128i, CPU.GPR[rb]._u32[3] & 0x7);
 	}
 	void ROTQBY(u32 rt, u32 ra, u32 rb)
 	{
-		const int s = CPU.GPR[rb]._u32[3] & 0xf;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		for (int b = 0; b < 16; ++b)
-			CPU.GPR[rt]._u8[b] = temp._u8[(b - s) & 0xf];
+		CPU.GPR[rt]._m128i = RotateBytes(CPU.GPR[ra]._m128i, CPU.GPR[rb]._u32[3] & 0xf);
 	}
 	void ROTQMBY(u32 rt, u32 ra, u32 rb)
 	{
-		const int s = (0 - CPU.GPR[rb]._u32[3]) & 0x1f;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		CPU.GPR[rt].Reset();
-		for (int b = 0; b < 16 - s; b++)
-			CPU.GPR[rt]._u8[b] = temp._u8[b + s];
+		CPU.GPR[rt]._m128i = ShiftBytesRight(CPU.GPR[ra]._m128i, (0 - CPU.GPR[rb]._u32[3]) & 0x1f);
 	}
 	void SHLQBY(u32 rt, u32 ra, u32 rb)
 	{
-		const int s = CPU.GPR[rb]._u32[3] & 0x1f;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		CPU.GPR[rt].Reset();
-		for (int b = s; b < 16; b++)
-			CPU.GPR[rt]._u8[b] = temp._u8[b - s];
+		CPU.GPR[rt]._m128i = ShiftBytesLeft(CPU.GPR[ra]._m128i, CPU.GPR[rb]._u32[3] & 0x1f);
 	}
 	void ORX(u32 rt, u32 ra)
 	{
@@ -644,81 +574,50 @@ private:
 	}
 	void ROTQBII(u32 rt, u32 ra, s32 i7)
 	{
-		const int s = i7 & 0x7;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		CPU.GPR[rt]._u32[0] = (temp._u32[0] << s) | (temp._u32[3] >> (32 - s));
-		CPU.GPR[rt]._u32[1] = (temp._u32[1] << s) | (temp._u32[0] >> (32 - s));
-		CPU.GPR[rt]._u32[2] = (temp._u32[2] << s) | (temp._u32[1] >> (32 - s));
-		CPU.GPR[rt]._u32[3] = (temp._u32[3] << s) | (temp._u32[2] >> (32 - s));
+		CPU.GPR[rt]._m128i = RotateBits(CPU.GPR[ra]._m128i, i7 & 0x7);
 	}
 	void ROTQMBII(u32 rt, u32 ra, s32 i7)
 	{
-		const int s = (0 - i7) & 0x7;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		CPU.GPR[rt]._u32[0] = (temp._u32[0] >> s) | (temp._u32[1] << (32 - s));
-		CPU.GPR[rt]._u32[1] = (temp._u32[1] >> s) | (temp._u32[2] << (32 - s));
-		CPU.GPR[rt]._u32[2] = (temp._u32[2] >> s) | (temp._u32[3] << (32 - s));
-		CPU.GPR[rt]._u32[3] = (temp._u32[3] >> s);
+		CPU.GPR[rt]._m128i = ShiftBitsRight(CPU.GPR[ra]._m128i, (0 - i7) & 0x7);
 	}
 	void SHLQBII(u32 rt, u32 ra, s32 i7)
 	{
-		const int s = i7 & 0x7;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		CPU.GPR[rt]._u32[0] = (temp._u32[0] << s);
-		CPU.GPR[rt]._u32[1] = (temp._u32[1] << s) | (temp._u32[0] >> (32 - s));
-		CPU.GPR[rt]._u32[2] = (temp._u32[2] << s) | (temp._u32[1] >> (32 - s));
-		CPU.GPR[rt]._u32[3] = (temp._u32[3] << s) | (temp._u32[2] >> (32 - s));
+		CPU.GPR[rt]._m128i = ShiftBitsLeft(CPU.GPR[ra]._m128i, i7 & 0x7);
 	}
 	void ROTQBYI(u32 rt, u32 ra, s32 i7)
 	{
-		const int s = i7 & 0xf;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._u8[b] = temp._u8[(b - s) & 0xf];
+		CPU.GPR[rt]._m128i = RotateBytes(CPU.GPR[ra]._m128i, i7 & 0xf);
 	}
 	void ROTQMBYI(u32 rt, u32 ra, s32 i7)
 	{
-		const int s = (0 - i7) & 0x1f;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		CPU.GPR[rt].Reset();
-		for (int b = 0; b < 16 - s; b++)
-			CPU.GPR[rt]._u8[b] = temp._u8[b + s];
+		CPU.GPR[rt]._m128i = ShiftBytesRight(CPU.GPR[ra]._m128i, (0 - i7) & 0x1f);
 	}
 	void SHLQBYI(u32 rt, u32 ra, s32 i7)
 	{
-		const int s = i7 & 0x1f;
-		const SPU_GPR_hdr temp = CPU.GPR[ra];
-		CPU.GPR[rt].Reset();
-		for (int b = s; b < 16; b++)
-			CPU.GPR[rt]._u8[b] = temp._u8[b - s];
+		CPU.GPR[rt]._m128i = ShiftBytesLeft(CPU.GPR[ra]._m128i, i7 & 0x1f);
 	}
 	void NOP(u32 rt)
 	{
 	}
 	void CGT(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] = CPU.GPR[ra]._i32[w] > CPU.GPR[rb]._i32[w] ? 0xffffffff : 0;
+		CPU.GPR[rt]._m128i = _mm_cmpgt_epi32(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void XOR(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] = CPU.GPR[ra]._u32[w] ^ CPU.GPR[rb]._u32[w];
+		CPU.GPR[rt]._m128i = _mm_xor_si128(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void CGTH(u32 rt, u32 ra, u32 rb)
 	{
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._u16[h] = CPU.GPR[ra]._i16[h] > CPU.GPR[rb]._i16[h] ? 0xffff : 0;
+		CPU.GPR[rt]._m128i = _mm_cmpgt_epi16(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void EQV(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] = CPU.GPR[ra]._u32[w] ^ (~CPU.GPR[rb]._u32[w]);
+		CPU.GPR[rt]._m128i = _mm_xor_si128(_mm_xor_si128(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i), _mm_set1_epi32(-1));
 	}
 	void CGTB(u32 rt, u32 ra, u32 rb)
 	{
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._u8[b] = CPU.GPR[ra]._i8[b] > CPU.GPR[rb]._i8[b] ? 0xff : 0;
+		CPU.GPR[rt]._m128i = _mm_cmpgt_epi8(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void SUMB(u32 rt, u32 ra, u32 rb)
 	{
@@ -755,8 +654,7 @@ private:
 	}
 	void XSHW(u32 rt, u32 ra)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._i32[w] = (s32)CPU.GPR[ra]._i16[w*2];
+		CPU.GPR[rt]._m128i = _mm_srai_epi32(_mm_slli_epi32(CPU.GPR[ra]._m128i, 16), 16);
 	}
 	void CNTB(u32 rt, u32 ra)
 	{
@@ -768,70 +666,48 @@ private:
 	}
 	void XSBH(u32 rt, u32 ra)
 	{
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._i16[h] = (s16)CPU.GPR[ra]._i8[h*2];
+		CPU.GPR[rt]._m128i = _mm_srai_epi16(_mm_slli_epi16(CPU.GPR[ra]._m128i, 8), 8);
 	}
 	void CLGT(u32 rt, u32 ra, u32 rb)
 	{
-		for(u32 i = 0; i < 4; ++i)
-		{
-			CPU.GPR[rt]._u32[i] = (CPU.GPR[ra]._u32[i] > CPU.GPR[rb]._u32[i]) ? 0xffffffff : 0x00000000;
-		}
+		CPU.GPR[rt]._m128i = CmpGtU32(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void ANDC(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] = CPU.GPR[ra]._u32[w] & (~CPU.GPR[rb]._u32[w]);
+		CPU.GPR[rt]._m128i = _mm_andnot_si128(CPU.GPR[rb]._m128i, CPU.GPR[ra]._m128i);
 	}
 	void FCGT(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u32[0] = CPU.GPR[ra]._f[0] > CPU.GPR[rb]._f[0] ? 0xffffffff : 0;
-		CPU.GPR[rt]._u32[1] = CPU.GPR[ra]._f[1] > CPU.GPR[rb]._f[1] ? 0xffffffff : 0;
-		CPU.GPR[rt]._u32[2] = CPU.GPR[ra]._f[2] > CPU.GPR[rb]._f[2] ? 0xffffffff : 0;
-		CPU.GPR[rt]._u32[3] = CPU.GPR[ra]._f[3] > CPU.GPR[rb]._f[3] ? 0xffffffff : 0;
+		CPU.GPR[rt]._m128 = _mm_cmpgt_ps(CPU.GPR[ra]._m128, CPU.GPR[rb]._m128);
 	}
 	void DFCGT(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u64[0] = CPU.GPR[ra]._d[0] > CPU.GPR[rb]._d[0] ? 0xffffffffffffffff : 0;
-		CPU.GPR[rt]._u64[1] = CPU.GPR[ra]._d[1] > CPU.GPR[rb]._d[1] ? 0xffffffffffffffff : 0;
+		CPU.GPR[rt]._m128d = _mm_cmpgt_pd(CPU.GPR[ra]._m128d, CPU.GPR[rb]._m128d);
 	}
 	void FA(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._f[0] = CPU.GPR[ra]._f[0] + CPU.GPR[rb]._f[0];
-		CPU.GPR[rt]._f[1] = CPU.GPR[ra]._f[1] + CPU.GPR[rb]._f[1];
-		CPU.GPR[rt]._f[2] = CPU.GPR[ra]._f[2] + CPU.GPR[rb]._f[2];
-		CPU.GPR[rt]._f[3] = CPU.GPR[ra]._f[3] + CPU.GPR[rb]._f[3];
+		CPU.GPR[rt]._m128 = FlushDenormals(_mm_add_ps(FlushDenormals(CPU.GPR[ra]._m128), FlushDenormals(CPU.GPR[rb]._m128)));
 	}
 	void FS(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._f[0] = CPU.GPR[ra]._f[0] - CPU.GPR[rb]._f[0];
-		CPU.GPR[rt]._f[1] = CPU.GPR[ra]._f[1] - CPU.GPR[rb]._f[1];
-		CPU.GPR[rt]._f[2] = CPU.GPR[ra]._f[2] - CPU.GPR[rb]._f[2];
-		CPU.GPR[rt]._f[3] = CPU.GPR[ra]._f[3] - CPU.GPR[rb]._f[3];
+		CPU.GPR[rt]._m128 = FlushDenormals(_mm_sub_ps(FlushDenormals(CPU.GPR[ra]._m128), FlushDenormals(CPU.GPR[rb]._m128)));
 	}
 	void FM(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._f[0] = CPU.GPR[ra]._f[0] * CPU.GPR[rb]._f[0];
-		CPU.GPR[rt]._f[1] = CPU.GPR[ra]._f[1] * CPU.GPR[rb]._f[1];
-		CPU.GPR[rt]._f[2] = CPU.GPR[ra]._f[2] * CPU.GPR[rb]._f[2];
-		CPU.GPR[rt]._f[3] = CPU.GPR[ra]._f[3] * CPU.GPR[rb]._f[3];
+		CPU.GPR[rt]._m128 = FlushDenormals(_mm_mul_ps(FlushDenormals(CPU.GPR[ra]._m128), FlushDenormals(CPU.GPR[rb]._m128)));
 	}
 	void CLGTH(u32 rt, u32 ra, u32 rb)
 	{
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._u16[h] = CPU.GPR[ra]._u16[h] > CPU.GPR[rb]._u16[h] ? 0xffff : 0;
+		CPU.GPR[rt]._m128i = CmpGtU16(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void ORC(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] = CPU.GPR[ra]._u32[w] | (~CPU.GPR[rb]._u32[w]);
+		CPU.GPR[rt]._m128i = _mm_or_si128(CPU.GPR[ra]._m128i, _mm_xor_si128(CPU.GPR[rb]._m128i, _mm_set1_epi32(-1)));
 	}
 	void FCMGT(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u32[0] = fabs(CPU.GPR[ra]._f[0]) > fabs(CPU.GPR[rb]._f[0]) ? 0xffffffff : 0;
-		CPU.GPR[rt]._u32[1] = fabs(CPU.GPR[ra]._f[1]) > fabs(CPU.GPR[rb]._f[1]) ? 0xffffffff : 0;
-		CPU.GPR[rt]._u32[2] = fabs(CPU.GPR[ra]._f[2]) > fabs(CPU.GPR[rb]._f[2]) ? 0xffffffff : 0;
-		CPU.GPR[rt]._u32[3] = fabs(CPU.GPR[ra]._f[3]) > fabs(CPU.GPR[rb]._f[3]) ? 0xffffffff : 0;
+		const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		CPU.GPR[rt]._m128 = _mm_cmpgt_ps(_mm_and_ps(CPU.GPR[ra]._m128, abs_mask), _mm_and_ps(CPU.GPR[rb]._m128, abs_mask));
 	}
 	void DFCMGT(u32 rt, u32 ra, u32 rb)
 	{
@@ -840,23 +716,19 @@ private:
 	}
 	void DFA(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._d[0] = CPU.GPR[ra]._d[0] + CPU.GPR[rb]._d[0];
-		CPU.GPR[rt]._d[1] = CPU.GPR[ra]._d[1] + CPU.GPR[rb]._d[1];
+		CPU.GPR[rt]._m128d = _mm_add_pd(CPU.GPR[ra]._m128d, CPU.GPR[rb]._m128d);
 	}
 	void DFS(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._d[0] = CPU.GPR[ra]._d[0] - CPU.GPR[rb]._d[0];
-		CPU.GPR[rt]._d[1] = CPU.GPR[ra]._d[1] - CPU.GPR[rb]._d[1];
+		CPU.GPR[rt]._m128d = _mm_sub_pd(CPU.GPR[ra]._m128d, CPU.GPR[rb]._m128d);
 	}
 	void DFM(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._d[0] = CPU.GPR[ra]._d[0] * CPU.GPR[rb]._d[0];
-		CPU.GPR[rt]._d[1] = CPU.GPR[ra]._d[1] * CPU.GPR[rb]._d[1];
+		CPU.GPR[rt]._m128d = _mm_mul_pd(CPU.GPR[ra]._m128d, CPU.GPR[rb]._m128d);
 	}
 	void CLGTB(u32 rt, u32 ra, u32 rb)
 	{
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._u8[b] = CPU.GPR[ra]._u8[b] > CPU.GPR[rb]._u8[b] ? 0xff : 0;
+		CPU.GPR[rt]._m128i = CmpGtU8(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void HLGT(u32 rt, u32 ra, u32 rb)
 	{
@@ -864,43 +736,38 @@ private:
 	}
 	void DFMA(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._d[0] += CPU.GPR[ra]._d[0] * CPU.GPR[rb]._d[0];
-		CPU.GPR[rt]._d[1] += CPU.GPR[ra]._d[1] * CPU.GPR[rb]._d[1];
+		CPU.GPR[rt]._m128d = _mm_add_pd(CPU.GPR[rt]._m128d, _mm_mul_pd(CPU.GPR[ra]._m128d, CPU.GPR[rb]._m128d));
 	}
 	void DFMS(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._d[0] = CPU.GPR[ra]._d[0] * CPU.GPR[rb]._d[0] - CPU.GPR[rt]._d[0];
-		CPU.GPR[rt]._d[1] = CPU.GPR[ra]._d[1] * CPU.GPR[rb]._d[1] - CPU.GPR[rt]._d[1];
+		CPU.GPR[rt]._m128d = _mm_sub_pd(_mm_mul_pd(CPU.GPR[ra]._m128d, CPU.GPR[rb]._m128d), CPU.GPR[rt]._m128d);
 	}
 	void DFNMS(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._d[0] -= CPU.GPR[ra]._d[0] * CPU.GPR[rb]._d[0];
-		CPU.GPR[rt]._d[1] -= CPU.GPR[ra]._d[1] * CPU.GPR[rb]._d[1];
+		CPU.GPR[rt]._m128d = _mm_sub_pd(CPU.GPR[rt]._m128d, _mm_mul_pd(CPU.GPR[ra]._m128d, CPU.GPR[rb]._m128d));
 	}
 	void DFNMA(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._d[0] = -(CPU.GPR[ra]._d[0] * CPU.GPR[rb]._d[0] + CPU.GPR[rt]._d[0]);
-		CPU.GPR[rt]._d[1] = -(CPU.GPR[ra]._d[1] * CPU.GPR[rb]._d[1] + CPU.GPR[rt]._d[1]);
+		const __m128d sign = _mm_castsi128_pd(_mm_set_epi32(0x80000000, 0, 0x80000000, 0));
+		CPU.GPR[rt]._m128d = _mm_xor_pd(_mm_add_pd(_mm_mul_pd(CPU.GPR[ra]._m128d, CPU.GPR[rb]._m128d), CPU.GPR[rt]._m128d), sign);
 	}
 	void CEQ(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] = CPU.GPR[ra]._i32[w] == CPU.GPR[rb]._i32[w] ? 0xffffffff : 0;
+		CPU.GPR[rt]._m128i = _mm_cmpeq_epi32(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void MPYHHU(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] = CPU.GPR[ra]._u16[w*2+1] * CPU.GPR[rb]._u16[w*2+1];
+		CPU.GPR[rt]._m128i = MulU16(_mm_srli_epi32(CPU.GPR[ra]._m128i, 16), _mm_srli_epi32(CPU.GPR[rb]._m128i, 16));
 	}
 	void ADDX(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] = CPU.GPR[ra]._u32[w] + CPU.GPR[rb]._u32[w] + (CPU.GPR[rt]._u32[w] & 1);
+		const __m128i carry = _mm_and_si128(CPU.GPR[rt]._m128i, _mm_set1_epi32(1));
+		CPU.GPR[rt]._m128i = _mm_add_epi32(_mm_add_epi32(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i), carry);
 	}
 	void SFX(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] = CPU.GPR[rb]._u32[w] - CPU.GPR[ra]._u32[w] - (1 - (CPU.GPR[rt]._u32[w] & 1));
+		const __m128i borrow = _mm_sub_epi32(_mm_and_si128(CPU.GPR[rt]._m128i, _mm_set1_epi32(1)), _mm_set1_epi32(1));
+		CPU.GPR[rt]._m128i = _mm_add_epi32(_mm_sub_epi32(CPU.GPR[rb]._m128i, CPU.GPR[ra]._m128i), borrow);
 	}
 	void CGX(u32 rt, u32 ra, u32 rb)
 	{
@@ -919,13 +786,11 @@ private:
 	}
 	void MPYHHA(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._i32[w] += CPU.GPR[ra]._i16[w*2+1] * CPU.GPR[rb]._i16[w*2+1];
+		CPU.GPR[rt]._m128i = _mm_add_epi32(CPU.GPR[rt]._m128i, _mm_madd_epi16(_mm_srli_epi32(CPU.GPR[ra]._m128i, 16), _mm_srli_epi32(CPU.GPR[rb]._m128i, 16)));
 	}
 	void MPYHHAU(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] += CPU.GPR[ra]._u16[w*2+1] * CPU.GPR[rb]._u16[w*2+1];
+		CPU.GPR[rt]._m128i = _mm_add_epi32(CPU.GPR[rt]._m128i, MulU16(_mm_srli_epi32(CPU.GPR[ra]._m128i, 16), _mm_srli_epi32(CPU.GPR[rb]._m128i, 16)));
 	}
 	//Forced bits to 0, hence the shift:
 	
@@ -1007,47 +872,36 @@ private:
 	}
 	void FCEQ(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u32[0] = CPU.GPR[ra]._f[0] == CPU.GPR[rb]._f[0] ? 0xffffffff : 0;
-		CPU.GPR[rt]._u32[1] = CPU.GPR[ra]._f[1] == CPU.GPR[rb]._f[1] ? 0xffffffff : 0;
-		CPU.GPR[rt]._u32[2] = CPU.GPR[ra]._f[2] == CPU.GPR[rb]._f[2] ? 0xffffffff : 0;
-		CPU.GPR[rt]._u32[3] = CPU.GPR[ra]._f[3] == CPU.GPR[rb]._f[3] ? 0xffffffff : 0;
+		CPU.GPR[rt]._m128 = _mm_cmpeq_ps(CPU.GPR[ra]._m128, CPU.GPR[rb]._m128);
 	}
 	void DFCEQ(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u64[0] = CPU.GPR[ra]._d[0] == CPU.GPR[rb]._d[0] ? 0xffffffffffffffff : 0;
-		CPU.GPR[rt]._u64[1] = CPU.GPR[ra]._d[1] == CPU.GPR[rb]._d[1] ? 0xffffffffffffffff : 0;
+		CPU.GPR[rt]._m128d = _mm_cmpeq_pd(CPU.GPR[ra]._m128d, CPU.GPR[rb]._m128d);
 	}
 	void MPY(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._i32[w] = CPU.GPR[ra]._i16[w*2] * CPU.GPR[rb]._i16[w*2];
+		CPU.GPR[rt]._m128i = _mm_madd_epi16(_mm_and_si128(CPU.GPR[ra]._m128i, _mm_set1_epi32(0xffff)), CPU.GPR[rb]._m128i);
 	}
 	void MPYH(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._i32[w] = (CPU.GPR[ra]._i16[w*2+1] * CPU.GPR[rb]._i16[w*2]) << 16;
+		CPU.GPR[rt]._m128i = _mm_slli_epi32(_mm_mullo_epi16(_mm_srli_epi32(CPU.GPR[ra]._m128i, 16), CPU.GPR[rb]._m128i), 16);
 	}
 	void MPYHH(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._i32[w] = CPU.GPR[ra]._i16[w*2+1] * CPU.GPR[rb]._i16[w*2+1];
+		CPU.GPR[rt]._m128i = _mm_madd_epi16(_mm_srli_epi32(CPU.GPR[ra]._m128i, 16), _mm_srli_epi32(CPU.GPR[rb]._m128i, 16));
 	}
 	void MPYS(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._i32[w] = (CPU.GPR[ra]._i16[w*2] * CPU.GPR[rb]._i16[w*2]) >> 16;
+		CPU.GPR[rt]._m128i = _mm_srai_epi32(_mm_slli_epi32(_mm_mulhi_epi16(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i), 16), 16);
 	}
 	void CEQH(u32 rt, u32 ra, u32 rb)
 	{
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._u16[h] = CPU.GPR[ra]._u16[h] == CPU.GPR[rb]._u16[h] ? 0xffff : 0;
+		CPU.GPR[rt]._m128i = _mm_cmpeq_epi16(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void FCMEQ(u32 rt, u32 ra, u32 rb)
 	{
-		CPU.GPR[rt]._u32[0] = fabs(CPU.GPR[ra]._f[0]) == fabs(CPU.GPR[rb]._f[0]) ? 0xffffffff : 0;
-		CPU.GPR[rt]._u32[1] = fabs(CPU.GPR[ra]._f[1]) == fabs(CPU.GPR[rb]._f[1]) ? 0xffffffff : 0;
-		CPU.GPR[rt]._u32[2] = fabs(CPU.GPR[ra]._f[2]) == fabs(CPU.GPR[rb]._f[2]) ? 0xffffffff : 0;
-		CPU.GPR[rt]._u32[3] = fabs(CPU.GPR[ra]._f[3]) == fabs(CPU.GPR[rb]._f[3]) ? 0xffffffff : 0;
+		const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		CPU.GPR[rt]._m128 = _mm_cmpeq_ps(_mm_and_ps(CPU.GPR[ra]._m128, abs_mask), _mm_and_ps(CPU.GPR[rb]._m128, abs_mask));
 	}
 	void DFCMEQ(u32 rt, u32 ra, u32 rb)
 	{
@@ -1056,13 +910,12 @@ private:
 	}
 	void MPYU(u32 rt, u32 ra, u32 rb)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] = CPU.GPR[ra]._u16[w*2] * CPU.GPR[rb]._u16[w*2];
+		const __m128i low = _mm_set1_epi32(0xffff);
+		CPU.GPR[rt]._m128i = MulU16(_mm_and_si128(CPU.GPR[ra]._m128i, low), _mm_and_si128(CPU.GPR[rb]._m128i, low));
 	}
 	void CEQB(u32 rt, u32 ra, u32 rb)
 	{
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._u8[b] = CPU.GPR[ra]._u8[b] == CPU.GPR[rb]._u8[b] ? 0xff : 0;
+		CPU.GPR[rt]._m128i = _mm_cmpeq_epi8(CPU.GPR[ra]._m128i, CPU.GPR[rb]._m128i);
 	}
 	void FI(u32 rt, u32 ra, u32 rb)
 	{
@@ -1078,72 +931,37 @@ private:
 	//0 - 9
 	void CFLTS(u32 rt, u32 ra, s32 i8)
 	{
-		const u32 scale = 173 - (i8 & 0xff); //unsigned immediate
-		for (int i = 0; i < 4; i++)
-		{
-			u32 exp = ((CPU.GPR[ra]._u32[i] >> 23) & 0xff) + scale;
-
-			if (exp > 255) 
-				exp = 255;
-
-			CPU.GPR[rt]._u32[i] = (CPU.GPR[ra]._u32[i] & 0x807fffff) | (exp << 23);
+		const __m128 scaled = ScaleExponent(CPU.GPR[ra]._m128, 173 - (i8 & 0xff)); //unsigned immediate
 
-			CPU.GPR[rt]._u32[i] = (u32)CPU.GPR[rt]._f[i]; //trunc
-		}
-		//CPU.GPR[rt]._m128i = _mm_cvttps_epi32(CPU.GPR[rt]._m128);
+		// cvttps2dq gives 0x80000000 for out of range values: saturate the positive ones
+		const __m128i over = _mm_castps_si128(_mm_cmpge_ps(scaled, _mm_set1_ps(2147483648.0f)));
+		CPU.GPR[rt]._m128i = _mm_xor_si128(_mm_cvttps_epi32(scaled), over);
 	}
 	void CFLTU(u32 rt, u32 ra, s32 i8)
 	{
-		const u32 scale = 173 - (i8 & 0xff); //unsigned immediate
-		for (int i = 0; i < 4; i++)
-		{
-			u32 exp = ((CPU.GPR[ra]._u32[i] >> 23) & 0xff) + scale;
+		const __m128 scaled = ScaleExponent(CPU.GPR[ra]._m128, 173 - (i8 & 0xff)); //unsigned immediate
+		const __m128 clamped = _mm_max_ps(scaled, _mm_setzero_ps()); // negative values give 0
 
-			if (exp > 255) 
-				exp = 255;
-
-			if (CPU.GPR[ra]._u32[i] & 0x80000000) //if negative, result = 0
-				CPU.GPR[rt]._u32[i] = 0;
-			else
-			{
-				CPU.GPR[rt]._u32[i] = (CPU.GPR[ra]._u32[i] & 0x807fffff) | (exp << 23);
-
-				if (CPU.GPR[rt]._f[i] > 0xffffffff) //if big, result = max
-					CPU.GPR[rt]._u32[i] = 0xffffffff;
-				else
-					CPU.GPR[rt]._u32[i] = floor(CPU.GPR[rt]._f[i]);
-			}
-		}
+		// values from 2^31 are converted from value - 2^31
+		const __m128 big = _mm_cmpge_ps(clamped, _mm_set1_ps(2147483648.0f));
+		const __m128i result = _mm_xor_si128(_mm_cvttps_epi32(_mm_sub_ps(clamped, _mm_and_ps(big, _mm_set1_ps(2147483648.0f)))),
+			_mm_and_si128(_mm_castps_si128(big), _mm_set1_epi32(0x80000000)));
+		const __m128i over = _mm_castps_si128(_mm_cmpge_ps(scaled, _mm_set1_ps(4294967296.0f)));
+		CPU.GPR[rt]._m128i = _mm_or_si128(result, over);
 	}
 	void CSFLT(u32 rt, u32 ra, s32 i8)
 	{
-		//CPU.GPR[rt]._m128 = _mm_cvtepi32_ps(CPU.GPR[ra]._m128i);
-		const u32 scale = 155 - (i8 & 0xff); //unsigned immediate
-		for (int i = 0; i < 4; i++)
-		{
-			CPU.GPR[rt]._f[i] = (s32)CPU.GPR[ra]._i32[i];
-
-			u32 exp = ((CPU.GPR[rt]._u32[i] >> 23) & 0xff) - scale;
-
-			if (exp > 255) //< 0
-				exp = 0;
-
-			CPU.GPR[rt]._u32[i] = (CPU.GPR[rt]._u32[i] & 0x807fffff) | (exp << 23);
-		}
+		const __m128 f = _mm_cvtepi32_ps(CPU.GPR[ra]._m128i);
+		CPU.GPR[rt]._m128 = ScaleExponent(f, -(s32)(155 - (i8 & 0xff))); //unsigned immediate
 	}
 	void CUFLT(u32 rt, u32 ra, s32 i8)
 	{
-		const u32 scale = 155 - (i8 & 0xff); //unsigned immediate
-		for (int i = 0; i < 4; i++)
-		{
-			CPU.GPR[rt]._f[i] = (float)CPU.GPR[ra]._u32[i];
-			u32 exp = ((CPU.GPR[rt]._u32[i] >> 23) & 0xff) - scale;
+		const __m128i a = CPU.GPR[ra]._m128i;
 
-			if (exp > 255) //< 0
-				exp = 0;
-
-			CPU.GPR[rt]._u32[i] = (CPU.GPR[rt]._u32[i] & 0x807fffff) | (exp << 23);
-		}
+		// both halves convert exactly, the sum is rounded once
+		const __m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(a, 16)), _mm_set1_ps(65536.0f));
+		const __m128 lo = _mm_cvtepi32_ps(_mm_and_si128(a, _mm_set1_epi32(0xffff)));
+		CPU.GPR[rt]._m128 = ScaleExponent(_mm_add_ps(hi, lo), -(s32)(155 - (i8 & 0xff))); //unsigned immediate
 	}
 
 	//0 - 8
@@ -1219,19 +1037,7 @@ private:
 	}
 	void FSMBI(u32 rt, s32 i16)
 	{
-		const u32 s = i16;
-
-		for(u32 j = 0; j < 16; ++j)
-		{
-			if((s >> j) & 0x1)
-			{
-				CPU.GPR[rt]._u8[j] = 0xFF;
-			}
-			else
-			{
-				CPU.GPR[rt]._u8[j] = 0x00;
-			}
-		}
+		CPU.GPR[rt]._m128i = ExpandBits(i16);
 	}
 	void BRSL(u32 rt, s32 i16)
 	{
@@ -1253,80 +1059,62 @@ private:
 	}
 	void IL(u32 rt, s32 i16)
 	{
-		CPU.GPR[rt]._i32[0] =
-			CPU.GPR[rt]._i32[1] =
-			CPU.GPR[rt]._i32[2] =
-			CPU.GPR[rt]._i32[3] = i16;
+		CPU.GPR[rt]._m128i = _mm_set1_epi32(i16);
 	}
 	void ILHU(u32 rt, s32 i16)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._i32[w] = i16 << 16;
+		CPU.GPR[rt]._m128i = _mm_set1_epi32(i16 << 16);
 	}
 	void ILH(u32 rt, s32 i16)
 	{
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._i16[h] = i16;
+		CPU.GPR[rt]._m128i = _mm_set1_epi16(i16);
 	}
 	void IOHL(u32 rt, s32 i16)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._i32[w] |= (i16 & 0xFFFF);
+		CPU.GPR[rt]._m128i = _mm_or_si128(CPU.GPR[rt]._m128i, _mm_set1_epi32(i16 & 0xffff));
 	}
 	
 
 	//0 - 7
 	void ORI(u32 rt, u32 ra, s32 i10)
 	{
-		for(u32 i = 0; i < 4; ++i)
-			CPU.GPR[rt]._i32[i] = CPU.GPR[ra]._i32[i] | i10;
+		CPU.GPR[rt]._m128i = _mm_or_si128(CPU.GPR[ra]._m128i, _mm_set1_epi32(i10));
 	}
 	void ORHI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._i16[h] = CPU.GPR[ra]._i16[h] | i10;
+		CPU.GPR[rt]._m128i = _mm_or_si128(CPU.GPR[ra]._m128i, _mm_set1_epi16(i10));
 	}
 	void ORBI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._i8[b] = CPU.GPR[ra]._i8[b] | i10;
+		CPU.GPR[rt]._m128i = _mm_or_si128(CPU.GPR[ra]._m128i, _mm_set1_epi8(i10));
 	}
 	void SFI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._i32[w] = i10 - CPU.GPR[ra]._i32[w];
+		CPU.GPR[rt]._m128i = _mm_sub_epi32(_mm_set1_epi32(i10), CPU.GPR[ra]._m128i);
 	}
 	void SFHI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._i16[h] = i10 - CPU.GPR[ra]._i16[h];
+		CPU.GPR[rt]._m128i = _mm_sub_epi16(_mm_set1_epi16(i10), CPU.GPR[ra]._m128i);
 	}
 	void ANDI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._i32[w] = CPU.GPR[ra]._i32[w] & i10;
+		CPU.GPR[rt]._m128i = _mm_and_si128(CPU.GPR[ra]._m128i, _mm_set1_epi32(i10));
 	}
 	void ANDHI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._i16[h] = CPU.GPR[ra]._i16[h] & i10;
+		CPU.GPR[rt]._m128i = _mm_and_si128(CPU.GPR[ra]._m128i, _mm_set1_epi16(i10));
 	}
 	void ANDBI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._i8[b] = CPU.GPR[ra]._i8[b] & i10;
+		CPU.GPR[rt]._m128i = _mm_and_si128(CPU.GPR[ra]._m128i, _mm_set1_epi8(i10));
 	}
 	void AI(u32 rt, u32 ra, s32 i10)
 	{
-		CPU.GPR[rt]._i32[0] = CPU.GPR[ra]._i32[0] + i10;
-		CPU.GPR[rt]._i32[1] = CPU.GPR[ra]._i32[1] + i10;
-		CPU.GPR[rt]._i32[2] = CPU.GPR[ra]._i32[2] + i10;
-		CPU.GPR[rt]._i32[3] = CPU.GPR[ra]._i32[3] + i10;
+		CPU.GPR[rt]._m128i = _mm_add_epi32(CPU.GPR[ra]._m128i, _mm_set1_epi32(i10));
 	}
 	void AHI(u32 rt, u32 ra, s32 i10)
 	{
-		for(u32 h = 0; h < 8; ++h)
-			CPU.GPR[rt]._i16[h] = CPU.GPR[ra]._i16[h] + i10;
+		CPU.GPR[rt]._m128i = _mm_add_epi16(CPU.GPR[ra]._m128i, _mm_set1_epi16(i10));
 	}
 	void STQD(u32 rt, s32 i10, u32 ra) //i10 is shifted left by 4 while decoding
 	{
@@ -1353,33 +1141,27 @@ private:
 	}
 	void XORI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._i32[w] = CPU.GPR[ra]._i32[w] ^ i10;
+		CPU.GPR[rt]._m128i = _mm_xor_si128(CPU.GPR[ra]._m128i, _mm_set1_epi32(i10));
 	}
 	void XORHI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._i16[h] = CPU.GPR[ra]._i16[h] ^ i10;
+		CPU.GPR[rt]._m128i = _mm_xor_si128(CPU.GPR[ra]._m128i, _mm_set1_epi16(i10));
 	}
 	void XORBI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._i8[b] = CPU.GPR[ra]._i8[b] ^ i10;
+		CPU.GPR[rt]._m128i = _mm_xor_si128(CPU.GPR[ra]._m128i, _mm_set1_epi8(i10));
 	}
 	void CGTI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] = CPU.GPR[ra]._i32[w] > i10 ? 0xffffffff : 0;
+		CPU.GPR[rt]._m128i = _mm_cmpgt_epi32(CPU.GPR[ra]._m128i, _mm_set1_epi32(i10));
 	}
 	void CGTHI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._u16[h] = CPU.GPR[ra]._i16[h] > i10 ? 0xffff : 0;
+		CPU.GPR[rt]._m128i = _mm_cmpgt_epi16(CPU.GPR[ra]._m128i, _mm_set1_epi16(i10));
 	}
 	void CGTBI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._u8[b] = CPU.GPR[ra]._i8[b] > (s8)(i10 & 0xff) ? 0xff : 0;
+		CPU.GPR[rt]._m128i = _mm_cmpgt_epi8(CPU.GPR[ra]._m128i, _mm_set1_epi8(i10));
 	}
 	void HGTI(u32 rt, u32 ra, s32 i10)
 	{
@@ -1387,22 +1169,15 @@ private:
 	}
 	void CLGTI(u32 rt, u32 ra, s32 i10)
 	{
-		for(u32 i = 0; i < 4; ++i)
-		{
-			CPU.GPR[rt]._u32[i] = (CPU.GPR[ra]._u32[i] > (u32)i10) ? 0xffffffff : 0x00000000;
-		}
+		CPU.GPR[rt]._m128i = CmpGtU32(CPU.GPR[ra]._m128i, _mm_set1_epi32(i10));
 	}
 	void CLGTHI(u32 rt, u32 ra, s32 i10)
 	{
-		for(u32 i = 0; i < 8; ++i)
-		{
-			CPU.GPR[rt]._u16[i] = (CPU.GPR[ra]._u16[i] > (u16)i10) ? 0xffff : 0x0000;
-		}
+		CPU.GPR[rt]._m128i = CmpGtU16(CPU.GPR[ra]._m128i, _mm_set1_epi16(i10));
 	}
 	void CLGTBI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._u8[b] = CPU.GPR[ra]._u8[b] > (u8)(i10 & 0xff) ? 0xff : 0;
+		CPU.GPR[rt]._m128i = CmpGtU8(CPU.GPR[ra]._m128i, _mm_set1_epi8(i10));
 	}
 	void HLGTI(u32 rt, u32 ra, s32 i10)
 	{
@@ -1410,28 +1185,23 @@ private:
 	}
 	void MPYI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._i32[w] = CPU.GPR[ra]._i16[w*2] * i10;
+		CPU.GPR[rt]._m128i = _mm_madd_epi16(_mm_and_si128(CPU.GPR[ra]._m128i, _mm_set1_epi32(0xffff)), _mm_set1_epi32(i10 & 0xffff));
 	}
 	void MPYUI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._u32[w] = CPU.GPR[ra]._u16[w*2] * (u16)(i10 & 0xffff);
+		CPU.GPR[rt]._m128i = MulU16(_mm_and_si128(CPU.GPR[ra]._m128i, _mm_set1_epi32(0xffff)), _mm_set1_epi32(i10 & 0xffff));
 	}
 	void CEQI(u32 rt, u32 ra, s32 i10)
 	{
-		for(u32 i = 0; i < 4; ++i)
-			CPU.GPR[rt]._u32[i] = (CPU.GPR[ra]._i32[i] == i10) ? 0xffffffff : 0x00000000;
+		CPU.GPR[rt]._m128i = _mm_cmpeq_epi32(CPU.GPR[ra]._m128i, _mm_set1_epi32(i10));
 	}
 	void CEQHI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int h = 0; h < 8; h++)
-			CPU.GPR[rt]._u16[h] = (CPU.GPR[ra]._i16[h] == (s16)i10) ? 0xffff : 0;
+		CPU.GPR[rt]._m128i = _mm_cmpeq_epi16(CPU.GPR[ra]._m128i, _mm_set1_epi16(i10));
 	}
 	void CEQBI(u32 rt, u32 ra, s32 i10)
 	{
-		for (int b = 0; b < 16; b++)
-			CPU.GPR[rt]._i8[b] = (CPU.GPR[ra]._i8[b] == (s8)(i10 & 0xff)) ? 0xff : 0;
+		CPU.GPR[rt]._m128i = _mm_cmpeq_epi8(CPU.GPR[ra]._m128i, _mm_set1_epi8(i10));
 	}
 	void HEQI(u32 rt, u32 ra, s32 i10)
 	{
@@ -1448,75 +1218,45 @@ private:
 	}
 	void ILA(u32 rt, u32 i18)
 	{
-		CPU.GPR[rt]._u32[0] = 
-			CPU.GPR[rt]._u32[1] = 
-			CPU.GPR[rt]._u32[2] = 
-			CPU.GPR[rt]._u32[3] = i18 & 0x3FFFF;
+		CPU.GPR[rt]._m128i = _mm_set1_epi32(i18 & 0x3ffff);
 	}
 
 	//0 - 3
 	void SELB(u32 rt, u32 ra, u32 rb, u32 rc)
 	{
-		for(u64 i = 0; i < 2; ++i)
-		{
-			CPU.GPR[rt]._u64[i] =
-				( CPU.GPR[rc]._u64[i] & CPU.GPR[rb]._u64[i]) |
-				(~CPU.GPR[rc]._u64[i] & CPU.GPR[ra]._u64[i]);
-		}
+		CPU.GPR[rt]._m128i = SelectBits(CPU.GPR[rc]._m128i, CPU.GPR[rb]._m128i, CPU.GPR[ra]._m128i);
 	}
 	void SHUFB(u32 rt, u32 ra, u32 rb, u32 rc)
 	{
-		const SPU_GPR_hdr _a = CPU.GPR[ra];
-		const SPU_GPR_hdr _b = CPU.GPR[rb];
-		for (int i = 0; i < 16; i++)
-		{
-			u8 b = CPU.GPR[rc]._u8[i];
-			if(b & 0x80)
-			{
-				if(b & 0x40)
-				{
-					if(b & 0x20)
-						CPU.GPR[rt]._u8[i] = 0x80;
-					else
-						CPU.GPR[rt]._u8[i] = 0xFF;
-				}
-				else
-					CPU.GPR[rt]._u8[i] = 0x00;
-			}
-			else
-			{
-				if(b & 0x10)
-					CPU.GPR[rt]._u8[i] = _b._u8[15 - (b & 0x0F)];
-				else
-					CPU.GPR[rt]._u8[i] = _a._u8[15 - (b & 0x0F)];
-			}
-		}
+		const __m128i c = CPU.GPR[rc]._m128i;
+
+		// 0x00-0x0f select a byte of ra, 0x10-0x1f a byte of rb (SPU byte n is _u8[15 - n])
+		const __m128i index = _mm_xor_si128(_mm_and_si128(c, _mm_set1_epi8(0x0f)), _mm_set1_epi8(0x0f));
+		const __m128i from_b = _mm_cmpeq_epi8(_mm_and_si128(c, _mm_set1_epi8(0x10)), _mm_set1_epi8(0x10));
+		const __m128i bytes = SelectBits(from_b, ShuffleBytes(CPU.GPR[rb]._m128i, index), ShuffleBytes(CPU.GPR[ra]._m128i, index));
+
+		// constants: 10xxxxxx -> 0x00, 110xxxxx -> 0xff, 111xxxxx -> 0x80
+		const __m128i c_e0 = _mm_and_si128(c, _mm_set1_epi8((s8)0xe0));
+		const __m128i consts = _mm_or_si128(_mm_cmpeq_epi8(c_e0, _mm_set1_epi8((s8)0xc0)),
+			_mm_and_si128(_mm_cmpeq_epi8(c_e0, _mm_set1_epi8((s8)0xe0)), _mm_set1_epi8((s8)0x80)));
+
+		CPU.GPR[rt]._m128i = SelectBits(_mm_cmplt_epi8(c, _mm_setzero_si128()), consts, bytes);
 	}
 	void MPYA(u32 rt, u32 ra, u32 rb, u32 rc)
 	{
-		for (int w = 0; w < 4; w++)
-			CPU.GPR[rt]._i32[w] = CPU.GPR[ra]._i16[w*2] * CPU.GPR[rb]._i16[w*2] + CPU.GPR[rc]._i32[w];
+		CPU.GPR[rt]._m128i = _mm_add_epi32(_mm_madd_epi16(_mm_and_si128(CPU.GPR[ra]._m128i, _mm_set1_epi32(0xffff)), CPU.GPR[rb]._m128i), CPU.GPR[rc]._m128i);
 	}
 	void FNMS(u32 rt, u32 ra, u32 rb, u32 rc)
 	{
-		CPU.GPR[rt]._f[0] = CPU.GPR[rc]._f[0] - CPU.GPR[ra]._f[0] * CPU.GPR[rb]._f[0];
-		CPU.GPR[rt]._f[1] = CPU.GPR[rc]._f[1] - CPU.GPR[ra]._f[1] * CPU.GPR[rb]._f[1];
-		CPU.GPR[rt]._f[2] = CPU.GPR[rc]._f[2] - CPU.GPR[ra]._f[2] * CPU.GPR[rb]._f[2];
-		CPU.GPR[rt]._f[3] = CPU.GPR[rc]._f[3] - CPU.GPR[ra]._f[3] * CPU.GPR[rb]._f[3];
+		CPU.GPR[rt]._m128 = FlushDenormals(_mm_sub_ps(FlushDenormals(CPU.GPR[rc]._m128), FlushDenormals(_mm_mul_ps(FlushDenormals(CPU.GPR[ra]._m128), FlushDenormals(CPU.GPR[rb]._m128)))));
 	}
 	void FMA(u32 rt, u32 ra, u32 rb, u32 rc)
 	{
-		CPU.GPR[rt]._f[0] = CPU.GPR[ra]._f[0] * CPU.GPR[rb]._f[0] + CPU.GPR[rc]._f[0];
-		CPU.GPR[rt]._f[1] = CPU.GPR[ra]._f[1] * CPU.GPR[rb]._f[1] + CPU.GPR[rc]._f[1];
-		CPU.GPR[rt]._f[2] = CPU.GPR[ra]._f[2] * CPU.GPR[rb]._f[2] + CPU.GPR[rc]._f[2];
-		CPU.GPR[rt]._f[3] = CPU.GPR[ra]._f[3] * CPU.GPR[rb]._f[3] + CPU.GPR[rc]._f[3];
+		CPU.GPR[rt]._m128 = FlushDenormals(_mm_add_ps(FlushDenormals(_mm_mul_ps(FlushDenormals(CPU.GPR[ra]._m128), FlushDenormals(CPU.GPR[rb]._m128))), FlushDenormals(CPU.GPR[rc]._m128)));
 	}
 	void FMS(u32 rt, u32 ra, u32 rb, u32 rc)
 	{
-		CPU.GPR[rt]._f[0] = CPU.GPR[ra]._f[0] * CPU.GPR[rb]._f[0] - CPU.GPR[rc]._f[0];
-		CPU.GPR[rt]._f[1] = CPU.GPR[ra]._f[1] * CPU.GPR[rb]._f[1] - CPU.GPR[rc]._f[1];
-		CPU.GPR[rt]._f[2] = CPU.GPR[ra]._f[2] * CPU.GPR[rb]._f[2] - CPU.GPR[rc]._f[2];
-		CPU.GPR[rt]._f[3] = CPU.GPR[ra]._f[3] * CPU.GPR[rb]._f[3] - CPU.GPR[rc]._f[3];
+		CPU.GPR[rt]._m128 = FlushDenormals(_mm_sub_ps(FlushDenormals(_mm_mul_ps(FlushDenormals(CPU.GPR[ra]._m128), FlushDenormals(CPU.GPR[rb]._m128))), FlushDenormals(CPU.GPR[rc]._m128)));
 	}
 
 	void UNK(u32 code, u32 opcode, u32 gcode)
@@ -1,12 +1,535 @@
 #include "stdafx.h"
 #include "SPURSManager.h"
+#include "Emu/System.h"
+#include "Emu/Memory/Memory.h"
+#include "Emu/Cell/SPUThread.h"
+#include "Emu/CPU/SpinWait.h"
 
-SPURSManager::SPURSManager(SPURSManagerAttribute *attr)
+SPURSManager::SPURSManager(const u32 addr, const SPURSManagerAttribute& attr)
+	: m_attr(attr)
+	, m_addr(addr)
+	, m_last_workload(0)
+	, m_ports(0)
+	, m_finalizing(false)
 {
-	this->attr = attr;
+	for(u32 i = 0; i < CELL_SPURS_MAX_SPU; i++)
+	{
+		m_current[i].wid = -1;
+		m_current[i].task = 0;
+	}
+}
+
+SPURSManager::~SPURSManager()
+{
+	// the kernel SPUs are removed by Finalize() or by the emulator before the ID is destroyed
+}
+
+void SPURSManager::Start()
+{
+	for(int i = 0; i < m_attr.nSpus; i++)
+	{
+		SPUThread& spu = (SPUThread&)Emu.GetCPU().AddThread(CPU_THREAD_SPU);
+		const u32 ls = Memory.MainMem.AllocAlign(256 * 1024);
+
+		// the kernel: a stop handled by HandleStop(), the SPU waits there for work
+		Memory.Write32(ls + SPURS_KERNEL_ENTRY, SPURS_STOP_DISPATCH);
+
+		spu.SetOffset(ls);
+		spu.SetEntry(SPURS_KERNEL_ENTRY);
+		spu.SetName(fmt::Format("%sSpursKernel%d", m_attr.namePrefix.c_str(), i));
+		spu.spurs = this;
+		spu.spurs_index = i;
+
+		m_spus.push_back(&spu);
+		m_ls.push_back(ls);
+		m_loaded_elf.push_back(0);
+	}
+
+	for(u32 i = 0; i < m_spus.size(); i++)
+	{
+		m_spus[i]->Run();
+		m_spus[i]->Exec();
+	}
 }
 
 void SPURSManager::Finalize()
 {
-	delete this->attr;
-}
\ No newline at end of file
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_finalizing = true;
+	}
+
+	NotifyChange();
+
+	for(u8 port = 0; port < 64; port++)
+	{
+		if(m_ports & (1ULL << port)) DetachQueue(port);
+	}
+
+	for(u32 i = 0; i < m_spus.size(); i++)
+	{
+		Emu.GetCPU().RemoveThread(m_spus[i]->GetId());
+		Memory.MainMem.Free(m_ls[i]);
+	}
+
+	m_spus.clear();
+	m_ls.clear();
+	m_loaded_elf.clear();
+}
+
+u32 SPURSManager::GetSpuThreadId(const u32 spu) const
+{
+	return spu < m_spus.size() ? m_spus[spu]->GetId() : 0;
+}
+
+void SPURSManager::NotifyChange()
+{
+	g_parking_lot.Notify(ParkingLot::ObjectKey(this));
+}
+
+SPURSWorkload* SPURSManager::FindTaskset(const u32 taskset)
+{
+	for(u32 i = 0; i < CELL_SPURS_MAX_WORKLOAD; i++)
+	{
+		SPURSWorkload* wl = m_workloads[i].get();
+		if(wl && wl->pm == SPURS_PM_TASKSET && wl->addr == taskset) return wl;
+	}
+
+	return nullptr;
+}
+
+SPURSError SPURSManager::AddTaskset(const u32 taskset, const u64 arg, const u8 priority[CELL_SPURS_MAX_SPU], const u32 max_contention, u32& wid)
+{
+	for(u32 i = 0; i < CELL_SPURS_MAX_SPU; i++)
+	{
+		if(priority[i] >= CELL_SPURS_MAX_PRIORITY) return SPURS_INVAL;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if(m_finalizing) return SPURS_STAT;
+	if(FindTaskset(taskset)) return SPURS_BUSY;
+
+	for(u32 i = 0; i < CELL_SPURS_MAX_WORKLOAD; i++)
+	{
+		if(m_workloads[i]) continue;
+
+		SPURSWorkload* wl = new SPURSWorkload;
+		wl->pm = SPURS_PM_TASKSET;
+		wl->addr = taskset;
+		wl->arg = arg;
+		memcpy(wl->priority, priority, sizeof(wl->priority));
+		wl->max_contention = max_contention;
+		wl->running = 0;
+		wl->ready = 0;
+		wl->next_task = 0;
+		wl->shutdown = false;
+
+		m_workloads[i].reset(wl);
+		wid = i;
+		return SPURS_OK;
+	}
+
+	return SPURS_AGAIN;
+}
+
+SPURSError SPURSManager::CreateTask(const u32 taskset, const u32 elf, const u32 context, const u32 context_size, const u32 args[4], u32& task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		SPURSWorkload* wl = FindTaskset(taskset);
+		if(!wl) return SPURS_SRCH;
+		if(wl->shutdown || m_finalizing) return SPURS_STAT;
+
+		u32 id = 0;
+		while(id < wl->tasks.size() && wl->tasks[id].state != SPURS_TASK_FREE) id++;
+
+		if(id >= CELL_SPURS_MAX_TASK) return SPURS_AGAIN;
+		if(id == wl->tasks.size()) wl->tasks.push_back(SPURSTask());
+
+		SPURSTask& t = wl->tasks[id];
+		t.state = SPURS_TASK_READY;
+		t.elf = elf;
+		t.context = context;
+		t.context_size = context_size;
+		memcpy(t.args, args, sizeof(t.args));
+		t.signal = false;
+
+		wl->ready++;
+		task = id;
+	}
+
+	NotifyChange();
+	return SPURS_OK;
+}
+
+SPURSError SPURSManager::SendSignal(const u32 taskset, const u32 task)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	SPURSWorkload* wl = FindTaskset(taskset);
+	if(!wl) return SPURS_SRCH;
+	if(task >= wl->tasks.size() || wl->tasks[task].state == SPURS_TASK_FREE) return SPURS_SRCH;
+
+	wl->tasks[task].signal = true;
+	return SPURS_OK;
+}
+
+SPURSError SPURSManager::ShutdownTaskset(const u32 taskset)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	SPURSWorkload* wl = FindTaskset(taskset);
+	if(!wl) return SPURS_SRCH;
+	if(wl->shutdown) return SPURS_STAT;
+
+	wl->shutdown = true;
+	return SPURS_OK;
+}
+
+SPURSError SPURSManager::JoinTaskset(const u32 taskset)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(!FindTaskset(taskset)) return SPURS_SRCH;
+	}
+
+	const bool done = g_parking_lot.WaitUntil(ParkingLot::ObjectKey(this), [&]()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		// the taskset is done once it is shut down and has no ready or running task
+		SPURSWorkload* wl = FindTaskset(taskset);
+		return m_finalizing || !wl || (wl->shutdown && !wl->ready && !wl->running);
+	});
+
+	if(!done) return SPURS_STAT;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for(u32 i = 0; i < CELL_SPURS_MAX_WORKLOAD; i++)
+	{
+		if(m_workloads[i] && m_workloads[i]->pm == SPURS_PM_TASKSET && m_workloads[i]->addr == taskset)
+		{
+			// a SPU running the taskset would have made it busy: none has it as current workload
+			m_workloads[i].reset();
+			return SPURS_OK;
+		}
+	}
+
+	return SPURS_SRCH;
+}
+
+SPURSError SPURSManager::GetTasksetId(const u32 taskset, u32& wid)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for(u32 i = 0; i < CELL_SPURS_MAX_WORKLOAD; i++)
+	{
+		if(m_workloads[i] && m_workloads[i]->pm == SPURS_PM_TASKSET && m_workloads[i]->addr == taskset)
+		{
+			wid = i;
+			return SPURS_OK;
+		}
+	}
+
+	return SPURS_SRCH;
+}
+
+SPURSError SPURSManager::SetMaxContention(const u32 wid, const u32 max_contention)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if(wid >= CELL_SPURS_MAX_WORKLOAD || !m_workloads[wid]) return SPURS_SRCH;
+		m_workloads[wid]->max_contention = max_contention;
+	}
+
+	NotifyChange();
+	return SPURS_OK;
+}
+
+SPURSError SPURSManager::SetPriorities(const u32 wid, const u8 priority[CELL_SPURS_MAX_SPU])
+{
+	for(u32 i = 0; i < CELL_SPURS_MAX_SPU; i++)
+	{
+		if(priority[i] >= CELL_SPURS_MAX_PRIORITY) return SPURS_INVAL;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if(wid >= CELL_SPURS_MAX_WORKLOAD || !m_workloads[wid]) return SPURS_SRCH;
+		memcpy(m_workloads[wid]->priority, priority, sizeof(m_workloads[wid]->priority));
+	}
+
+	NotifyChange();
+	return SPURS_OK;
+}
+
+SPURSError SPURSManager::AttachQueue(const u32 queue, u8& port, const bool dynamic)
+{
+	EventQueue* eq;
+	if(!Emu.GetIdManager().GetIDData(queue, eq)) return SPURS_INVAL;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if(dynamic)
+	{
+		port = CELL_SPURS_DYNAMIC_PORT_RANGE_TOP;
+		while(port <= CELL_SPURS_DYNAMIC_PORT_RANGE_BOTTOM && (m_ports & (1ULL << port))) port++;
+
+		if(port > CELL_SPURS_DYNAMIC_PORT_RANGE_BOTTOM) return SPURS_AGAIN;
+	}
+	else
+	{
+		if(port > CELL_SPURS_STATIC_PORT_RANGE_BOTTOM) return SPURS_INVAL;
+		if(m_ports & (1ULL << port)) return SPURS_BUSY;
+	}
+
+	for(u32 i = 0; i < m_spus.size(); i++)
+	{
+		EventPort& p = m_spus[i]->SPUPs[port];
+		SMutexLocker port_lock(p.mutex);
+
+		if(p.eq) p.eq->ports.remove(&p);
+		eq->ports.add(&p);
+		p.eq = eq;
+	}
+
+	m_ports |= 1ULL << port;
+	return SPURS_OK;
+}
+
+SPURSError SPURSManager::DetachQueue(const u8 port)
+{
+	if(port > CELL_SPURS_DYNAMIC_PORT_RANGE_BOTTOM) return SPURS_INVAL;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if(!(m_ports & (1ULL << port))) return SPURS_SRCH;
+
+	for(u32 i = 0; i < m_spus.size(); i++)
+	{
+		EventPort& p = m_spus[i]->SPUPs[port];
+		SMutexLocker port_lock(p.mutex);
+
+		if(p.eq)
+		{
+			p.eq->ports.remove(&p);
+			p.eq = nullptr;
+		}
+	}
+
+	m_ports &= ~(1ULL << port);
+	return SPURS_OK;
+}
+
+bool SPURSManager::Select(const u32 spu, u32& wid, u32& task)
+{
+	u32 best = CELL_SPURS_MAX_WORKLOAD;
+	u32 best_priority = CELL_SPURS_MAX_PRIORITY;
+
+	// the workloads after the last one chosen come first among the workloads of the same priority
+	for(u32 i = 1; i <= CELL_SPURS_MAX_WORKLOAD; i++)
+	{
+		const u32 w = (m_last_workload + i) % CELL_SPURS_MAX_WORKLOAD;
+		SPURSWorkload* wl = m_workloads[w].get();
+
+		if(!wl) continue;
+
+		const u32 priority = wl->priority[spu];
+		if(!priority || priority >= best_priority) continue;
+		if(wl->max_contention && wl->running >= wl->max_contention) continue;
+
+		switch(wl->pm)
+		{
+		case SPURS_PM_TASKSET:
+			if(!wl->ready) continue;
+			break;
+		}
+
+		best = w;
+		best_priority = priority;
+	}
+
+	if(best == CELL_SPURS_MAX_WORKLOAD) return false;
+
+	SPURSWorkload& wl = *m_workloads[best];
+
+	switch(wl.pm)
+	{
+	case SPURS_PM_TASKSET:
+		{
+			// taskset policy: the next ready task from the last one started
+			const u32 count = wl.tasks.size();
+			u32 id = wl.next_task;
+
+			for(u32 i = 0; i < count; i++, id = (id + 1) % count)
+			{
+				if(wl.tasks[id].state == SPURS_TASK_READY) break;
+			}
+
+			wl.tasks[id].state = SPURS_TASK_RUNNING;
+			wl.next_task = (id + 1) % count;
+			wl.ready--;
+			task = id;
+		}
+		break;
+	}
+
+	wl.running++;
+	m_last_workload = best;
+	wid = best;
+	return true;
+}
+
+void SPURSManager::Complete(const u32 spu)
+{
+	Current& cur = m_current[spu];
+	if(cur.wid < 0) return;
+
+	SPURSWorkload* wl = m_workloads[cur.wid].get();
+
+	if(wl)
+	{
+		switch(wl->pm)
+		{
+		case SPURS_PM_TASKSET:
+			wl->tasks[cur.task].state = SPURS_TASK_FREE;
+			break;
+		}
+
+		wl->running--;
+	}
+
+	cur.wid = -1;
+}
+
+u32 SPURSManager::LoadTask(const u32 spu, const u32 elf)
+{
+	const u32 ls = m_ls[spu];
+
+	if(!Memory.IsGoodAddr(elf, 0x34) || Memory.Read32(elf) != 0x7f454c46) return 0;
+
+	const u32 entry = Memory.Read32(elf + 0x18);
+	const u32 phoff = Memory.Read32(elf + 0x1c);
+	const u16 phentsize = Memory.Read16(elf + 0x2a);
+	const u16 phnum = Memory.Read16(elf + 0x2c);
+
+	// the text of the task doesn't change: only the writable segments are copied again if the
+	// SPU ran the same ELF before
+	const bool reload = m_loaded_elf[spu] == elf;
+	m_loaded_elf[spu] = 0;
+
+	for(u32 i = 0; i < phnum; i++)
+	{
+		const u32 ph = elf + phoff + i * phentsize;
+		if(!Memory.IsGoodAddr(ph, 0x20)) return 0;
+
+		const u32 type = Memory.Read32(ph);
+		const u32 offset = Memory.Read32(ph + 0x04);
+		const u32 vaddr = Memory.Read32(ph + 0x08);
+		const u32 filesz = Memory.Read32(ph + 0x10);
+		const u32 memsz = Memory.Read32(ph + 0x14);
+		const u32 flags = Memory.Read32(ph + 0x18);
+
+		if(type != 1) continue; // PT_LOAD
+
+		if(vaddr < CELL_SPURS_TASK_TOP || memsz > CELL_SPURS_TASK_BOTTOM - vaddr || filesz > memsz) return 0;
+		if(reload && !(flags & 2)) continue; // PF_W
+
+		if(filesz && !Memory.Copy(ls + vaddr, elf + offset, filesz)) return 0;
+		if(memsz > filesz) memset(Memory.GetMemFromAddr(ls + vaddr + filesz), 0, memsz - filesz);
+	}
+
+	m_loaded_elf[spu] = elf;
+	return entry;
+}
+
+bool SPURSManager::HandleStop(SPUThread& spu, const u32 code)
+{
+	if(code != SPURS_STOP_DISPATCH && code != 0x102) return false;
+
+	// not looked up in m_spus, which Finalize() clears
+	const u32 index = spu.spurs_index;
+
+	if(code == 0x102)
+	{
+		// sys_spu_thread_exit of a task: the task exits, the SPU goes back to the kernel
+		u32 status;
+		spu.SPU.Out_MBox.Pop(status);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Complete(index);
+	}
+
+	NotifyChange();
+
+	while(true)
+	{
+		bool selected = false;
+		u32 wid, task;
+
+		g_parking_lot.WaitUntil(ParkingLot::ObjectKey(this), [&]()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(m_finalizing) return true;
+
+			selected = Select(index, wid, task);
+			return selected;
+		});
+
+		if(!selected)
+		{
+			// finalized or emulator stopped
+			spu.Stop();
+			return true;
+		}
+
+		// Select() has marked the task as running: copy what the SPU needs
+		SPURSTask t;
+		u32 wl_addr;
+		u64 wl_arg;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			const SPURSWorkload& wl = *m_workloads[wid];
+			t = wl.tasks[task];
+			wl_addr = wl.addr;
+			wl_arg = wl.arg;
+
+			m_current[index].wid = wid;
+			m_current[index].task = task;
+		}
+
+		// the local storage and m_loaded_elf[index] are only used by this SPU: loaded without the lock
+		const u32 entry = LoadTask(index, t.elf);
+
+		if(!entry)
+		{
+			ConLog.Error("SPURS: invalid ELF of task %d of taskset 0x%x (elf=0x%x)", task, wl_addr, t.elf);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				Complete(index);
+			}
+
+			NotifyChange();
+			continue;
+		}
+
+		// r3: argument, r4: argument of the taskset, r1: stack, r0: return to the kernel
+		for(u32 i = 0; i < 4; i++) spu.GPR[3]._u32[3 - i] = t.args[i];
+		spu.GPR[4].Reset();
+		spu.GPR[4]._u64[1] = wl_arg;
+		spu.GPR[1].Reset();
+		spu.GPR[1]._u32[3] = SPURS_TASK_STACK;
+		spu.GPR[0].Reset();
+		spu.GPR[0]._u32[3] = SPURS_KERNEL_ENTRY;
+		spu.SetBranch(entry);
+		return true;
+	}
+}
@@ -44,49 +44,152 @@ enum TaskConstants
 	CELL_SPURS_MAX_TASK_NAME_LENGTH = 32,
 };
 
-// Internal class to shape a SPURS attribute.
-class SPURSManagerAttribute
+// Stop codes of the native kernel (reserved by the emulator, not used by the SDK).
+enum SPURSKernelStopCodes
 {
-public:
-	SPURSManagerAttribute(int nSpus, int spuPriority, int ppuPriority, bool exitIfNoWork)
-	{
-		this->nSpus = nSpus;
-		this->spuThreadGroupPriority = spuPriority;
-		this->ppuThreadPriority = ppuPriority;
-		this->exitIfNoWork = exitIfNoWork;
-		memset(this->namePrefix, 0, CELL_SPURS_NAME_MAX_LENGTH + 1);
-		this->threadGroupType = 0;
-	}
+	SPURS_STOP_DISPATCH = 0x3ff0, // the task returned to the kernel, r3: exit code
+};
 
-	int _setNamePrefix(const char *name, u32 size)
-	{
-		strncpy(this->namePrefix, name, size);
-		this->namePrefix[0] = 0;
-		return 0;
-	}
+// Local storage layout of the kernel SPUs below CELL_SPURS_TASK_TOP.
+enum SPURSKernelLayout
+{
+	SPURS_KERNEL_ENTRY = 0x100,  // "stop SPURS_STOP_DISPATCH", return address of the tasks
+	SPURS_TASK_STACK   = 0x3fff0, // initial stack pointer of the tasks
+};
 
-	int _setSpuThreadGroupType(int type)
+// Errors of the manager: the low byte of the CELL_SPURS_CORE_ERROR_* and CELL_SPURS_TASK_ERROR_* codes.
+enum SPURSError
+{
+	SPURS_OK     = 0,
+	SPURS_AGAIN  = 0x01,
+	SPURS_INVAL  = 0x02,
+	SPURS_SRCH   = 0x05,
+	SPURS_NOEXEC = 0x07,
+	SPURS_PERM   = 0x09,
+	SPURS_BUSY   = 0x0a,
+	SPURS_STAT   = 0x0f,
+};
+
+// Policy modules: how a workload chooses the work of a kernel SPU.
+enum SPURSPolicyModule
+{
+	SPURS_PM_TASKSET, // a ready task of the taskset, tasks run to completion
+};
+
+enum SPURSTaskState
+{
+	SPURS_TASK_FREE,    // the ID can be reused
+	SPURS_TASK_READY,
+	SPURS_TASK_RUNNING,
+};
+
+// Attribute of a SPURS instance (CellSpursAttribute or the arguments of cellSpursInitialize).
+struct SPURSManagerAttribute
+{
+	int nSpus;
+	int spuThreadGroupPriority;
+	int ppuThreadPriority;
+	bool exitIfNoWork;
+	std::string namePrefix;
+	int threadGroupType;
+
+	SPURSManagerAttribute(int nSpus, int spuPriority, int ppuPriority, bool exitIfNoWork)
+		: nSpus(nSpus)
+		, spuThreadGroupPriority(spuPriority)
+		, ppuThreadPriority(ppuPriority)
+		, exitIfNoWork(exitIfNoWork)
+		, threadGroupType(0)
 	{
-		this->threadGroupType = type;
-		return 0;
 	}
+};
 
-protected:
-	be_t<int> nSpus; 
-	be_t<int> spuThreadGroupPriority; 
-	be_t<int> ppuThreadPriority; 
-	bool exitIfNoWork;
-	char namePrefix[CELL_SPURS_NAME_MAX_LENGTH+1];
-	be_t<int> threadGroupType; 
+struct SPURSTask
+{
+	SPURSTaskState state;
+	u32 elf;          // address of the SPU ELF in guest memory
+	u32 context;      // context save area (unused: tasks aren't preempted)
+	u32 context_size;
+	u32 args[4];      // argument quadword, r3 of the task
+	bool signal;
+};
+
+struct SPURSWorkload
+{
+	SPURSPolicyModule pm;
+	u32 addr;           // guest object of the workload (CellSpursTaskset)
+	u64 arg;            // r4 of the tasks
+	u8 priority[CELL_SPURS_MAX_SPU]; // per kernel SPU: 0 not scheduled there, 1 highest .. 15 lowest
+	u32 max_contention; // kernel SPUs running the workload at the same time
+	u32 running;
+	u32 ready;          // tasks in SPURS_TASK_READY
+	u32 next_task;      // the search of a ready task starts there (round robin)
+	bool shutdown;      // no task can be created
+	std::vector<SPURSTask> tasks; // indexed by task ID
 };
 
-// Main SPURS manager class.
+class SPUThread;
+
+// Native SPURS instance.
+// The SPURS kernel isn't emulated: the kernel SPU threads run the tasks only, the scheduling is
+// done by the host threads of the SPUs when a task returns to the kernel stub (SPURS_KERNEL_ENTRY)
+// or exits. The SPU asks the policy module of the workload with the highest priority on it which
+// has work and is below its contention to choose a task, copies the task into its local storage
+// and branches to it; a SPU without work waits on the parking lot for the workloads to change.
+// The PPU calls (cellSpurs) and the kernel SPUs share the state under m_mutex.
 class SPURSManager
 {
+	std::mutex m_mutex;
+	SPURSManagerAttribute m_attr;
+	u32 m_addr;                      // CellSpurs
+	std::vector<SPUThread*> m_spus;  // kernel SPUs
+	std::vector<u32> m_ls;           // their local storage
+	std::vector<u32> m_loaded_elf;   // the ELF last copied into the local storage of the SPU
+	struct Current
+	{
+		s32 wid;  // -1 if idle
+		u32 task;
+	} m_current[CELL_SPURS_MAX_SPU];
+	std::unique_ptr<SPURSWorkload> m_workloads[CELL_SPURS_MAX_WORKLOAD];
+	u32 m_last_workload;             // workloads of the same priority are chosen in turn
+	u64 m_ports;                     // attached event queue ports
+	bool m_finalizing;
+
+	SPURSWorkload* FindTaskset(const u32 taskset);
+	// the workload chosen for the SPU and its work, false if none has work for it
+	bool Select(const u32 spu, u32& wid, u32& task);
+	void Complete(const u32 spu);
+	// copies the task into the local storage, returns its entry (0 if the ELF is invalid)
+	u32 LoadTask(const u32 spu, const u32 elf);
+	void NotifyChange();
+
 public:
-	SPURSManager(SPURSManagerAttribute *attr);
+	SPURSManager(const u32 addr, const SPURSManagerAttribute& attr);
+	~SPURSManager();
+
+	// creates and starts the kernel SPUs
+	void Start();
+	// stops and removes the kernel SPUs
 	void Finalize();
 
-protected:
-	SPURSManagerAttribute *attr;
-};
\ No newline at end of file
+	u32 GetAddr() const { return m_addr; }
+	const SPURSManagerAttribute& GetAttribute() const { return m_attr; }
+	u32 GetSpuCount() const { return m_spus.size(); }
+	u32 GetSpuThreadId(const u32 spu) const;
+
+	SPURSError AddTaskset(const u32 taskset, const u64 arg, const u8 priority[CELL_SPURS_MAX_SPU], const u32 max_contention, u32& wid);
+	SPURSError CreateTask(const u32 taskset, const u32 elf, const u32 context, const u32 context_size, const u32 args[4], u32& task);
+	SPURSError SendSignal(const u32 taskset, const u32 task);
+	SPURSError ShutdownTaskset(const u32 taskset);
+	// waits until the tasks of the taskset have exited and removes it
+	SPURSError JoinTaskset(const u32 taskset);
+	SPURSError GetTasksetId(const u32 taskset, u32& wid);
+	SPURSError SetMaxContention(const u32 wid, const u32 max_contention);
+	SPURSError SetPriorities(const u32 wid, const u8 priority[CELL_SPURS_MAX_SPU]);
+
+	// connects the event queue to a port of the kernel SPUs (a free dynamic port if dynamic)
+	SPURSError AttachQueue(const u32 queue, u8& port, const bool dynamic);
+	SPURSError DetachQueue(const u8 port);
+
+	// STOP of a kernel SPU: returns false if the code isn't handled by the kernel
+	bool HandleStop(SPUThread& spu, const u32 code);
+};
@@ -3,6 +3,7 @@
 #include "Emu/Cell/SPUDecoder.h"
 #include "Emu/Cell/SPUInterpreter.h"
 #include "Emu/Cell/SPUDisAsm.h"
+#include <bitset>
 
 SPUThread& GetCurrentSPUThread()
 {
@@ -21,6 +22,8 @@ SPUThread::SPUThread(CPUThreadType type) : PPCThread(type)
 	assert(type == CPU_THREAD_SPU || type == CPU_THREAD_RAW_SPU);
 
 	group = nullptr;
+	spurs = nullptr;
+	spurs_index = 0;
 
 	Reset();
 }
@@ -35,6 +38,9 @@ void SPUThread::DoReset()
 
 	//reset regs
 	memset(GPR, 0, sizeof(SPU_GPR_hdr) * 128);
+
+	m_last_mfc_cmd = 0;
+	m_last_getllar_ea = 0;
 }
 
 void SPUThread::InitRegs()
@@ -115,4 +121,227 @@ void SPUThread::DoClose()
 			port.eq = nullptr;
 		}
 	}
-}
\ No newline at end of file
+}
+// operands of an instruction of a polling loop
+struct SPUSpinOp
+{
+	static const u32 none = 128;
+
+	u32 rt; // register written
+	u32 ra, rb, rc; // registers read
+	bool load; // local storage address: (ra + rb + imm) & 0x3fff0, unused registers count as 0
+	s32 imm;
+	s32 count_ch; // rchcnt
+	s32 read_ch; // rdch
+	s32 write_ch; // wrch
+	bool branch;
+	bool indirect; // branch to a register
+	u64 target;
+};
+
+// decodes the instructions allowed in a polling loop: loads, channel counts, GETLLAR
+// parameters, integer operations and branches (see SPUDecoder for the opcode lengths)
+static bool DecodeSpinOp(const u32 code, const u64 pc, SPUSpinOp& op)
+{
+	using namespace SPU_opcodes;
+
+	const u32 rt = code & 0x7f;
+	const u32 ra = (code >> 7) & 0x7f;
+	const u32 rb = (code >> 14) & 0x7f;
+	const s32 si16 = (s16)(code >> 7);
+
+	op.rt = op.ra = op.rb = op.rc = SPUSpinOp::none;
+	op.load = op.branch = op.indirect = false;
+	op.imm = 0;
+	op.count_ch = op.read_ch = op.write_ch = -1;
+
+	switch(code >> 28)
+	{
+	case SELB:
+	case SHUFB: op.rt = (code >> 21) & 0x7f; op.ra = ra; op.rb = rb; op.rc = rt; return true;
+	case MPYA:
+	case FNMS:
+	case FMA:
+	case FMS: return false;
+	}
+
+	switch(code >> 25)
+	{
+	case HBRA:
+	case HBRR: return true;
+	case ILA: op.rt = rt; return true;
+	}
+
+	switch(code >> 24)
+	{
+	case LQD: op.rt = rt; op.ra = ra; op.load = true; op.imm = ((s32)(code << 8) >> 22) << 4; return true;
+
+	case ORI: case ORHI: case ORBI: case SFI: case SFHI: case ANDI: case ANDHI: case ANDBI:
+	case AI: case AHI: case XORI: case XORHI: case XORBI: case CGTI: case CGTHI: case CGTBI:
+	case CLGTI: case CLGTHI: case CLGTBI: case MPYI: case MPYUI: case CEQI: case CEQHI: case CEQBI:
+		op.rt = rt; op.ra = ra; return true;
+
+	case STQD: case HGTI: case HLGTI: case HEQI: return false;
+	}
+
+	switch(code >> 23)
+	{
+	case BRZ: case BRNZ: case BRHZ: case BRHNZ:
+		op.ra = rt; op.branch = true; op.target = SPUOpcodes::branchTarget(pc, si16); return true;
+	case BR: op.branch = true; op.target = SPUOpcodes::branchTarget(pc, si16); return true;
+	case BRA: op.branch = true; op.target = SPUOpcodes::branchTarget(0, si16); return true;
+	case LQA: op.rt = rt; op.load = true; op.imm = si16 << 2; return true;
+	case LQR: op.rt = rt; op.load = true; op.imm = SPUOpcodes::branchTarget(pc, si16); return true;
+	case FSMBI: case IL: case ILHU: case ILH: op.rt = rt; return true;
+	case IOHL: op.rt = rt; op.ra = rt; return true;
+	case STQA: case STQR: case BRASL: case BRSL: return false;
+	}
+
+	switch(code >> 22)
+	{
+	case CFLTS: case CFLTU: case CSFLT: case CUFLT: return false;
+	}
+
+	switch(code >> 21)
+	{
+	case LNOP: case NOP: case SYNC: case DSYNC: case HBR: return true;
+
+	case RCHCNT: op.rt = rt; op.count_ch = ra; return true;
+	case RDCH: op.rt = rt; op.read_ch = ra; return true;
+	case WRCH: op.ra = rt; op.write_ch = ra; return true;
+	case LQX: op.rt = rt; op.ra = ra; op.rb = rb; op.load = true; return true;
+
+	case SF: case OR: case NOR: case A: case AND: case NAND: case XOR: case EQV: case ANDC: case ORC:
+	case AH: case SFH: case CEQ: case CEQH: case CEQB: case CGT: case CGTH: case CGTB:
+	case CLGT: case CLGTH: case CLGTB: case ROT: case ROTM: case ROTMA: case SHL: case ROTH:
+	case ROTHM: case ROTMAH: case SHLH: case ROTQBY: case ROTQMBY: case SHLQBY: case ROTQBI:
+	case ROTQMBI: case SHLQBI: case ROTQBYBI: case ROTQMBYBI: case SHLQBYBI: case CBX: case CHX:
+	case CWX: case CDX:
+		op.rt = rt; op.ra = ra; op.rb = rb; return true;
+
+	case ROTI: case ROTMI: case ROTMAI: case SHLI: case ROTHI: case ROTHMI: case ROTMAHI: case SHLHI:
+	case ROTQBII: case ROTQMBII: case SHLQBII: case ROTQBYI: case ROTQMBYI: case SHLQBYI:
+	case CBD: case CHD: case CWD: case CDD: case ORX: case CLZ: case XSWD: case XSHW: case CNTB:
+	case XSBH: case GB: case GBH: case GBB: case FSM: case FSMH: case FSMB:
+		op.rt = rt; op.ra = ra; return true;
+
+	case BI: case BIZ: case BINZ: case BIHZ: case BIHNZ:
+		op.ra = ra; op.rb = (code >> 21) == BI ? SPUSpinOp::none : rt; op.branch = op.indirect = true; return true;
+	}
+
+	return false;
+}
+
+void* SPUThread::GetChannelObject(u32 ch)
+{
+	switch(ch)
+	{
+	case SPU_WrOutMbox: return &SPU.Out_MBox;
+	case SPU_RdInMbox: return &SPU.In_MBox;
+	case MFC_RdTagStat: return &Prxy.TagStatus;
+	case MFC_RdListStallStat: return &StallStat;
+	case SPU_RdSigNotify1: return &SPU.SNR[0];
+	case SPU_RdSigNotify2: return &SPU.SNR[1];
+	case MFC_RdAtomicStat: return &Prxy.AtomicStat;
+	}
+
+	return nullptr;
+}
+
+u64 SPUThread::GetSpinKey(const u64 start, const u64 end, SpinWaitKind& kind)
+{
+	// every register read must be loop-invariant or written earlier in the same iteration
+	std::bitset<SPUSpinOp::none + 1> written, defined;
+	void* channel = nullptr;
+	bool getllar = false, atomic_stat = false, has_line = false;
+	u64 line = 0;
+
+	for(u32 pass = 0; pass < 2; pass++)
+	{
+		// unused operands
+		written[SPUSpinOp::none] = false;
+
+		for(u64 pc = start; pc <= end; pc += 4)
+		{
+			SPUSpinOp op;
+			if(!DecodeSpinOp(Memory.Read32(m_offset + pc), pc, op))
+			{
+				return 0;
+			}
+
+			if(pass == 0)
+			{
+				// only the last instruction branches back, the others can only leave the loop
+				if(op.branch ? pc != end && !op.indirect && op.target >= start && op.target <= end : pc == end)
+				{
+					return 0;
+				}
+
+				written[op.rt] = true;
+				continue;
+			}
+
+			const u32 uses[3] = { op.ra, op.rb, op.rc };
+			for(u32 i = 0; i < 3; i++)
+			{
+				if(written[uses[i]] && !defined[uses[i]]) return 0;
+			}
+
+			if(op.count_ch >= 0)
+			{
+				void* ch = GetChannelObject(op.count_ch);
+				if(!ch || (channel && channel != ch)) return 0;
+				channel = ch;
+			}
+
+			// reading other channels consumes their data
+			if(op.read_ch >= 0)
+			{
+				if(op.read_ch != MFC_RdAtomicStat) return 0;
+				atomic_stat = true;
+			}
+
+			// MFC command parameters, the command is checked below
+			if(op.write_ch >= 0)
+			{
+				if(op.write_ch < MFC_LSA || op.write_ch > MFC_Cmd) return 0;
+				if(op.write_ch == MFC_Cmd) getllar = true;
+			}
+
+			if(op.load)
+			{
+				if(written[op.ra] || written[op.rb]) return 0;
+
+				const u32 lsa = ((op.ra != SPUSpinOp::none ? GPR[op.ra]._u32[3] : 0) + (op.rb != SPUSpinOp::none ? GPR[op.rb]._u32[3] : 0) + op.imm) & 0x3fff0;
+				const u64 l = ParkingLot::LineKey(m_offset + lsa);
+				if(has_line && line != l) return 0;
+				line = l;
+				has_line = true;
+			}
+
+			defined[op.rt] = true;
+		}
+	}
+
+	// GETLLAR loop: the loads read the reserved line copied to the local storage
+	if(getllar)
+	{
+		if(m_last_mfc_cmd != MFC_GETLLAR_CMD) return 0;
+		kind = SPIN_WAIT_RESERVATION;
+		return ParkingLot::LineKey(m_last_getllar_ea);
+	}
+
+	if(atomic_stat || (channel && has_line))
+	{
+		return 0;
+	}
+
+	if(channel)
+	{
+		kind = SPIN_WAIT_CHANNEL;
+		return ParkingLot::ObjectKey(channel);
+	}
+
+	kind = SPIN_WAIT_MEMORY;
+	return has_line ? line : 0;
+}
@@ -217,6 +217,7 @@ union SPU_GPR_hdr
 	s128 _i128;
 	__m128 _m128;
 	__m128i _m128i;
+	__m128d _m128d;
 	u64 _u64[2];
 	s64 _i64[2];
 	u32 _u32[4];
@@ -277,6 +278,8 @@ union SPU_SNRConfig_hdr
 	}
 };
 
+class SPURSManager;
+
 class SPUThread : public PPCThread
 {
 public:
@@ -288,6 +291,11 @@ public:
 	EventPort SPUPs[64]; // SPU Thread Event Ports
 	EventManager SPUQs; // SPU Queue Mapping
 	SpuGroupInfo* group; // associated SPU Thread Group (null for raw spu)
+	SPURSManager* spurs; // SPURS instance of a kernel SPU (null for other threads)
+	u32 spurs_index; // index of the kernel SPU in its SPURS instance
+
+	u32 m_last_mfc_cmd; // busy-wait detection: the last MFC command enqueued
+	u64 m_last_getllar_ea;
 
 	template<size_t _max_count>
 	class Channel
@@ -310,6 +318,12 @@ public:
 		};
 		std::mutex m_lock;
 
+		// wakes the threads waiting for a change of the channel count
+		__forceinline void Changed()
+		{
+			g_parking_lot.Notify(ParkingLot::ObjectKey(this));
+		}
+
 	public:
 
 		Channel()
@@ -338,6 +352,7 @@ public:
 				}
 				m_value[max_count-1] = 0;
 				m_index--;
+				Changed();
 				return true;
 			}
 			else
@@ -348,6 +363,7 @@ public:
 				{
 					res = (m_indval >> 32);
 					m_indval = 0;
+					Changed();
 					return true;
 				}				
 			}
@@ -363,6 +379,7 @@ public:
 					return false;
 				}
 				m_value[m_index++] = value;
+				Changed();
 				return true;
 			}
 			else
@@ -373,6 +390,7 @@ public:
 				{
 					const u64 new_value = ((u64)value << 32) | 1;
 					m_indval = new_value;
+					Changed();
 					return true;
 				}
 			}
@@ -393,6 +411,8 @@ public:
 				const u64 new_value = ((u64)value << 32) | 1;
 				m_indval = new_value;
 			}
+
+			Changed();
 		}
 
 		__forceinline void PushUncond_OR(u32 value)
@@ -413,6 +433,8 @@ public:
 				ConLog.Error("PushUncond_OR(): no code compiled");
 #endif
 			}
+
+			Changed();
 		}
 
 		__forceinline void PopUncond(u32& res)
@@ -438,6 +460,8 @@ public:
 					m_indval = 0;
 				}
 			}
+
+			Changed();
 		}
 
 		__forceinline u32 GetCount()
@@ -692,6 +716,9 @@ public:
 		u16 tag = (u16)size_tag;
 		u16 size = size_tag >> 16;
 
+		m_last_mfc_cmd = op & ~(MFC_BARRIER_MASK | MFC_FENCE_MASK);
+		if (m_last_mfc_cmd == MFC_GETLLAR_CMD) m_last_getllar_ea = ea;
+
 		switch(op & ~(MFC_BARRIER_MASK | MFC_FENCE_MASK))
 		{
 		case MFC_PUT_CMD:
@@ -786,6 +813,7 @@ public:
 								if (InterlockedCompareExchange64((volatile long long*)(Memory + (u32)ea + last * 16 + last_q * 8),
 									buf[last]._u64[last_q], reservation.data[last]._u64[last_q]) == reservation.data[last]._u64[last_q])
 								{
+									g_parking_lot.NotifyWrite(ea, 128);
 									Prxy.AtomicStat.PushUncond(MFC_PUTLLC_SUCCESS);
 								}
 								else
@@ -1018,7 +1046,7 @@ public:
 
 		case SPU_WrOutMbox:
 			//ConLog.Warning("%s: %s = 0x%x", __FUNCTION__, spu_ch_name[ch], v);
-			while (!SPU.Out_MBox.Push(v) && !Emu.IsStopped()) Sleep(1);
+			WaitPush(SPU.Out_MBox, v);
 		break;
 
 		case MFC_WrTagMask:
@@ -1082,6 +1110,43 @@ public:
 		if (Emu.IsStopped()) ConLog.Warning("%s(%s) aborted", __FUNCTION__, spu_ch_name[ch]);
 	}
 
+	// blocking channel accesses: the thread is parked until the channel count changes
+	template<size_t max_count>
+	void WaitPop(Channel<max_count>& ch, u32& v)
+	{
+		while (!ch.Pop(v) && !Emu.IsStopped())
+		{
+			const u64 key = ParkingLot::ObjectKey(&ch);
+			const u64 generation = g_parking_lot.Prepare(key);
+
+			if (ch.Pop(v))
+			{
+				g_parking_lot.Cancel(key);
+				return;
+			}
+
+			g_parking_lot.Wait(key, generation, SPIN_WAIT_CHANNEL);
+		}
+	}
+
+	template<size_t max_count>
+	void WaitPush(Channel<max_count>& ch, u32 v)
+	{
+		while (!ch.Push(v) && !Emu.IsStopped())
+		{
+			const u64 key = ParkingLot::ObjectKey(&ch);
+			const u64 generation = g_parking_lot.Prepare(key);
+
+			if (ch.Push(v))
+			{
+				g_parking_lot.Cancel(key);
+				return;
+			}
+
+			g_parking_lot.Wait(key, generation, SPIN_WAIT_CHANNEL);
+		}
+	}
+
 	void ReadChannel(SPU_GPR_hdr& r, u32 ch)
 	{
 		r.Reset();
@@ -1090,31 +1155,31 @@ public:
 		switch(ch)
 		{
 		case SPU_RdInMbox:
-			while (!SPU.In_MBox.Pop(v) && !Emu.IsStopped()) Sleep(1);
+			WaitPop(SPU.In_MBox, v);
 			//ConLog.Warning("%s: 0x%x = %s", __FUNCTION__, v, spu_ch_name[ch]);
 		break;
 
 		case MFC_RdTagStat:
-			while (!Prxy.TagStatus.Pop(v) && !Emu.IsStopped()) Sleep(1);
+			WaitPop(Prxy.TagStatus, v);
 			//ConLog.Warning("%s: 0x%x = %s", __FUNCTION__, v, spu_ch_name[ch]);
 		break;
 
 		case SPU_RdSigNotify1:
-			while (!SPU.SNR[0].Pop(v) && !Emu.IsStopped()) Sleep(1);
+			WaitPop(SPU.SNR[0], v);
 			//ConLog.Warning("%s: 0x%x = %s", __FUNCTION__, v, spu_ch_name[ch]);
 		break;
 
 		case SPU_RdSigNotify2:
-			while (!SPU.SNR[1].Pop(v) && !Emu.IsStopped()) Sleep(1);
+			WaitPop(SPU.SNR[1], v);
 			//ConLog.Warning("%s: 0x%x = %s", __FUNCTION__, v, spu_ch_name[ch]);
 		break;
 
 		case MFC_RdAtomicStat:
-			while (!Prxy.AtomicStat.Pop(v) && !Emu.IsStopped()) Sleep(1);
+			WaitPop(Prxy.AtomicStat, v);
 		break;
 
 		case MFC_RdListStallStat:
-			while (!StallStat.Pop(v) && !Emu.IsStopped()) Sleep(1);
+			WaitPop(StallStat, v);
 		break;
 
 		default:
@@ -1203,6 +1268,10 @@ protected:
 	virtual void DoResume();
 	virtual void DoStop();
 	virtual void DoClose();
+
+	// the channel object behind a channel count (nullptr if none)
+	void* GetChannelObject(u32 ch);
+	virtual u64 GetSpinKey(const u64 start, const u64 end, SpinWaitKind& kind) override;
 };
 
 SPUThread& GetCurrentSPUThread();
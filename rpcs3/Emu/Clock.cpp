@@ -0,0 +1,457 @@
+#include "stdafx.h"
+#include "Clock.h"
+#include "Emu/System.h"
+
+#ifndef _MSC_VER
+#include <cpuid.h>
+#endif
+
+HostClock g_host_clock;
+TimerWheel g_timer_wheel;
+
+static bool HostHasInvariantTSC()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0x80000000);
+	if((u32)info[0] < 0x80000007) return false;
+	__cpuid(info, 0x80000007);
+	return (info[3] & (1 << 8)) != 0;
+#else
+	unsigned int eax, ebx, ecx, edx;
+	if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+	return (edx & (1 << 8)) != 0;
+#endif
+}
+
+u64 HostClock::GetMonotonicTime()
+{
+#ifdef _WIN32
+	static const u64 freq = []() { LARGE_INTEGER freq; QueryPerformanceFrequency(&freq); return (u64)freq.QuadPart; }();
+	LARGE_INTEGER cycle;
+	QueryPerformanceCounter(&cycle);
+	return cycle.QuadPart / freq * 10000000 + cycle.QuadPart % freq * 10000000 / freq;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * (u64)10000000 + (u64)ts.tv_nsec / 100;
+#endif
+}
+
+HostClock::HostClock()
+	: m_has_tsc(HostHasInvariantTSC())
+	, m_use_tsc(false)
+	, m_calibrating(false)
+	, m_calibrate_time(0)
+	, m_attempts(0)
+	, m_start_time(0)
+	, m_start_tsc(0)
+	, m_tsc_base(0)
+	, m_time_base(0)
+	, m_tb_base(0)
+	, m_time_mul(0)
+	, m_tb_mul(0)
+	, m_tsc_freq(0)
+{
+	if(!m_has_tsc) return;
+
+	// the calibration counts the TSC ticks from here to the first read after calibration_time
+	m_start_time = GetMonotonicTime();
+	m_start_tsc = ReadTSC();
+	m_calibrate_time = m_start_time + calibration_time;
+}
+
+void HostClock::Calibrate(const u64 time)
+{
+	if(time < m_calibrate_time.load(std::memory_order_relaxed)) return;
+
+	// a single thread calibrates, the others keep reading the monotonic clock until it is done
+	if(m_calibrating.exchange(true, std::memory_order_acquire)) return;
+
+	// another thread may have restarted the calibration after this time was read
+	if(time < m_calibrate_time.load(std::memory_order_relaxed))
+	{
+		m_calibrating.store(false, std::memory_order_release);
+		return;
+	}
+
+	const u64 tsc = ReadTSC();
+	const u64 freq = tsc > m_start_tsc ? (tsc - m_start_tsc) * 10000000 / (time - m_start_time) : 0;
+
+	if(freq < 100000000)
+	{
+		if(++m_attempts >= calibration_attempts)
+		{
+			// m_calibrating stays set: no more attempt
+			ConLog.Warning("HostClock: TSC calibration failed (%lld Hz), using the monotonic clock", freq);
+			return;
+		}
+
+		ConLog.Warning("HostClock: TSC calibration failed (%lld Hz), retrying", freq);
+		m_start_time = time;
+		m_start_tsc = tsc;
+		m_calibrate_time.store(time + calibration_time, std::memory_order_relaxed);
+		m_calibrating.store(false, std::memory_order_release);
+		return;
+	}
+
+	m_tsc_freq = freq;
+
+	m_time_mul = (10000000ULL << 32) / m_tsc_freq;
+	m_tb_mul = (timebase_frequency << 32) / m_tsc_freq;
+	m_tsc_base = tsc;
+	m_time_base = time;
+	m_tb_base = TimeToTimebase(time);
+	m_use_tsc.store(true, std::memory_order_release);
+}
+
+TimerWheel::TimerWheel()
+	: ThreadBase("Timer Thread")
+	, m_current(g_host_clock.GetSystemTime() >> tick_shift)
+	, m_next_id(1)
+	, m_running(0)
+	, m_interrupts(0)
+{
+	memset(m_occupied, 0, sizeof(m_occupied));
+}
+
+TimerWheel::~TimerWheel()
+{
+	Close();
+}
+
+// the first occupied slot from the index, slot_count if none
+static u32 FindSlot(const u64* bits, const u32 from, const u32 count)
+{
+	for(u32 i = from; i < count; i = (i | 63) + 1)
+	{
+		const u64 word = bits[i / 64] >> (i % 64);
+		if(!word) continue;
+
+		u32 bit = 0;
+		while(!(word & (1ULL << bit))) bit++;
+		return i + bit;
+	}
+
+	return count;
+}
+
+void TimerWheel::Insert(const u64 id, const u64 deadline)
+{
+	SlotEntry entry;
+	entry.id = id;
+	entry.deadline = deadline;
+
+	const u64 tick = std::max(deadline >> tick_shift, m_current);
+
+	// the lowest level where the tick and the current tick are in the same slot of the level above
+	for(u32 level = 0; level < level_count; level++)
+	{
+		const u32 shift = slot_shift * (level + 1);
+		if((tick >> shift) != (m_current >> shift)) continue;
+
+		const u32 slot = (tick >> (slot_shift * level)) % slot_count;
+		m_slots[level][slot].push_back(entry);
+		m_occupied[level][slot / 64] |= 1ULL << (slot % 64);
+		return;
+	}
+
+	m_far.push_back(entry);
+}
+
+void TimerWheel::Cascade(const u32 level)
+{
+	const u32 slot = (m_current >> (slot_shift * level)) % slot_count;
+	std::vector<SlotEntry> entries;
+	entries.swap(m_slots[level][slot]);
+	m_occupied[level][slot / 64] &= ~(1ULL << (slot % 64));
+
+	for(u32 i = 0; i < entries.size(); i++)
+	{
+		if(m_timers.count(entries[i].id)) Insert(entries[i].id, entries[i].deadline);
+	}
+}
+
+void TimerWheel::Advance(const u64 now, std::vector<u64>& due)
+{
+	const u64 target = now >> tick_shift;
+
+	while(true)
+	{
+		const u32 slot = m_current % slot_count;
+
+		if(m_occupied[0][slot / 64] & (1ULL << (slot % 64)))
+		{
+			std::vector<SlotEntry>& entries = m_slots[0][slot];
+
+			// the entries of the current tick fire at their exact deadline
+			for(u32 i = 0; i < entries.size();)
+			{
+				if(m_current < target || entries[i].deadline <= now)
+				{
+					due.push_back(entries[i].id);
+					entries[i] = entries.back();
+					entries.pop_back();
+				}
+				else
+				{
+					i++;
+				}
+			}
+
+			if(entries.empty()) m_occupied[0][slot / 64] &= ~(1ULL << (slot % 64));
+		}
+
+		if(m_current >= target) break;
+
+		// skip to the next occupied slot of the block or to the next block
+		const u32 next = FindSlot(m_occupied[0], slot + 1, slot_count);
+		m_current = std::min(target, (m_current & ~(u64)(slot_count - 1)) + next);
+
+		if(m_current % slot_count) continue;
+
+		// new block: move down the slots of the higher levels reached
+		if((m_current >> (slot_shift * level_count)) << (slot_shift * level_count) == m_current)
+		{
+			std::vector<SlotEntry> far;
+			far.swap(m_far);
+
+			for(u32 i = 0; i < far.size(); i++)
+			{
+				if(m_timers.count(far[i].id)) Insert(far[i].id, far[i].deadline);
+			}
+		}
+
+		for(u32 level = level_count - 1; level > 0; level--)
+		{
+			if(m_current % (1ULL << (slot_shift * level)) == 0) Cascade(level);
+		}
+	}
+}
+
+u64 TimerWheel::GetNextEvent() const
+{
+	// level 0: the earliest deadline of the next occupied slot
+	const u32 slot = FindSlot(m_occupied[0], m_current % slot_count, slot_count);
+
+	if(slot < slot_count)
+	{
+		const std::vector<SlotEntry>& entries = m_slots[0][slot];
+		u64 deadline = ~0ULL;
+
+		for(u32 i = 0; i < entries.size(); i++)
+		{
+			deadline = std::min(deadline, entries[i].deadline);
+		}
+
+		return deadline;
+	}
+
+	// higher levels: the start of the next occupied slot
+	for(u32 level = 1; level < level_count; level++)
+	{
+		const u32 shift = slot_shift * level;
+		const u32 next = FindSlot(m_occupied[level], (m_current >> shift) % slot_count + 1, slot_count);
+
+		if(next < slot_count)
+		{
+			return ((m_current >> (shift + slot_shift) << (shift + slot_shift)) | ((u64)next << shift)) << tick_shift;
+		}
+	}
+
+	if(m_far.size())
+	{
+		const u32 shift = slot_shift * level_count;
+		return ((m_current >> shift) + 1) << shift << tick_shift;
+	}
+
+	return ~0ULL;
+}
+
+void TimerWheel::Task()
+{
+	std::vector<u64> due;
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while(!TestDestroy())
+	{
+		const u64 now = g_host_clock.GetSystemTime();
+		Advance(now, due);
+
+		if(due.size())
+		{
+			for(u32 i = 0; i < due.size() && !TestDestroy(); i++)
+			{
+				auto f = m_timers.find(due[i]);
+				if(f == m_timers.end()) continue;
+
+				Timer& t = f->second;
+				std::function<void()> func;
+
+				if(t.period)
+				{
+					// missed periods are skipped
+					t.deadline += t.period;
+					if(t.deadline <= now) t.deadline += ((now - t.deadline) / t.period + 1) * t.period;
+
+					Insert(due[i], t.deadline);
+					func = t.func;
+				}
+				else
+				{
+					func = std::move(t.func);
+					m_timers.erase(f);
+				}
+
+				m_running = due[i];
+				lock.unlock();
+				func();
+				lock.lock();
+				m_running = 0;
+				m_running_cond.notify_all();
+			}
+
+			due.clear();
+			continue;
+		}
+
+		const u64 next = GetNextEvent();
+
+		if(next == ~0ULL)
+		{
+			m_cond.wait(lock);
+		}
+		else if(next > now + spin_time)
+		{
+			m_cond.wait_for(lock, std::chrono::microseconds(next - now - spin_time));
+		}
+		else if(next > now)
+		{
+			lock.unlock();
+			std::this_thread::yield();
+			lock.lock();
+		}
+	}
+}
+
+u64 TimerWheel::Add(const u64 deadline, const u64 period, const std::function<void()>& func)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const u64 id = m_next_id++;
+	Timer& t = m_timers[id];
+	t.deadline = deadline;
+	t.period = period;
+	t.func = func;
+
+	Insert(id, deadline);
+
+	if(IsAlive())
+	{
+		m_cond.notify_one();
+	}
+	else
+	{
+		Start();
+	}
+
+	return id;
+}
+
+bool TimerWheel::Cancel(const u64 id)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// the slot entry is dropped when the wheel reaches it
+	const bool removed = m_timers.erase(id) != 0;
+
+	if(GetCurrentNamedThread() != this)
+	{
+		while(m_running == id) m_running_cond.wait(lock);
+	}
+
+	return removed;
+}
+
+bool TimerWheel::SleepUntil(const u64 deadline)
+{
+	Sleeper sleeper;
+	sleeper.fired = false;
+	sleeper.interrupted = false;
+
+	u64 interrupts;
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleep_mutex);
+		interrupts = m_interrupts;
+	}
+
+	if(Emu.IsStopped()) return false;
+	if(deadline <= g_host_clock.GetSystemTime()) return true;
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleep_mutex);
+
+		// Close() was called in the meantime
+		if(m_interrupts != interrupts) return false;
+		m_sleepers.push_back(&sleeper);
+	}
+
+	const u64 id = Add(deadline, 0, [this, &sleeper]()
+	{
+		std::lock_guard<std::mutex> lock(m_sleep_mutex);
+		sleeper.fired = true;
+		sleeper.cond.notify_one();
+	});
+
+	bool result;
+
+	{
+		std::unique_lock<std::mutex> lock(m_sleep_mutex);
+		sleeper.cond.wait(lock, [&]() { return sleeper.fired || sleeper.interrupted; });
+		result = sleeper.fired;
+
+		m_sleepers.erase(std::find(m_sleepers.begin(), m_sleepers.end(), &sleeper));
+	}
+
+	// waits for the function if the timer is firing right now: it uses the sleeper
+	if(!result) Cancel(id);
+	return result;
+}
+
+void TimerWheel::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_timers.clear();
+		m_far.clear();
+
+		for(u32 level = 0; level < level_count; level++)
+		{
+			for(u32 slot = 0; slot < slot_count; slot++)
+			{
+				m_slots[level][slot].clear();
+			}
+		}
+
+		memset(m_occupied, 0, sizeof(m_occupied));
+		m_current = g_host_clock.GetSystemTime() >> tick_shift;
+
+		m_destroy = true;
+		m_cond.notify_all();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleep_mutex);
+		m_interrupts++;
+
+		for(u32 i = 0; i < m_sleepers.size(); i++)
+		{
+			m_sleepers[i]->interrupted = true;
+			m_sleepers[i]->cond.notify_one();
+		}
+	}
+
+	ThreadBase::Stop();
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include "Utilities/Thread.h"
+#include <unordered_map>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+// Host clock of the emulator.
+// With an invariant TSC (constant rate, synchronized between cores) a read is rdtsc and a
+// multiplication by a factor calibrated against the monotonic clock of the OS, otherwise the
+// monotonic clock is read. The calibration is done by the first read at least
+// calibration_time after startup, the reads before it use the monotonic clock: nothing
+// sleeps during static initialization. A failed calibration starts over, the monotonic clock
+// is kept after calibration_attempts failures. Every thread may call the getters.
+class HostClock
+{
+	static const u64 calibration_time = 200000; // 100 ns units
+	static const u32 calibration_attempts = 3;
+
+	bool m_has_tsc;
+	std::atomic<bool> m_use_tsc;      // set once the fields below are written
+	std::atomic<bool> m_calibrating;  // held by the calibrating thread (for good after the last attempt)
+	std::atomic<u64> m_calibrate_time; // m_start_time + calibration_time
+	u32 m_attempts;
+	u64 m_start_time; // monotonic time (100 ns) at m_start_tsc
+	u64 m_start_tsc;
+	u64 m_tsc_base;
+	u64 m_time_base;  // monotonic time (100 ns) at m_tsc_base
+	u64 m_tb_base;    // timebase at m_tsc_base
+	u64 m_time_mul;   // 100 ns units per TSC tick (32.32 fixed point)
+	u64 m_tb_mul;     // timebase ticks per TSC tick (32.32 fixed point)
+	u64 m_tsc_freq;
+
+	static __forceinline u64 ReadTSC()
+	{
+		return __rdtsc();
+	}
+
+	// (a * b) >> 32 without overflow (the result is truncated to 64 bits)
+	static __forceinline u64 MulShift32(const u64 a, const u64 b)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		u64 hi;
+		const u64 lo = _umul128(a, b, &hi);
+		return (hi << 32) | (lo >> 32);
+#elif defined(__SIZEOF_INT128__)
+		return (u64)(((unsigned __int128)a * b) >> 32);
+#else
+		const u64 a_lo = (u32)a, a_hi = a >> 32;
+		const u64 b_lo = (u32)b, b_hi = b >> 32;
+		return ((a_hi * b_hi) << 32) + a_hi * b_lo + a_lo * b_hi + ((a_lo * b_lo) >> 32);
+#endif
+	}
+
+	static u64 TimeToTimebase(const u64 time)
+	{
+		return time / 10000000 * timebase_frequency + time % 10000000 * timebase_frequency / 10000000;
+	}
+
+	// switches to the TSC once calibration_time has passed since the start of the calibration
+	void Calibrate(const u64 time);
+
+public:
+	// frequency of the PPU timebase (mftb, sys_time_get_timebase_frequency)
+	static const u64 timebase_frequency = 79800000;
+
+	HostClock();
+
+	// monotonic clock of the OS (100 ns units)
+	static u64 GetMonotonicTime();
+
+	// 100 ns units
+	u64 GetTime()
+	{
+		if(m_use_tsc.load(std::memory_order_acquire)) return m_time_base + MulShift32(ReadTSC() - m_tsc_base, m_time_mul);
+
+		const u64 time = GetMonotonicTime();
+		if(m_has_tsc) Calibrate(time);
+		return time;
+	}
+
+	// microseconds
+	u64 GetSystemTime()
+	{
+		return GetTime() / 10;
+	}
+
+	// ticks of the 79.8 MHz timebase
+	u64 GetTimebase()
+	{
+		if(m_use_tsc.load(std::memory_order_acquire)) return m_tb_base + MulShift32(ReadTSC() - m_tsc_base, m_tb_mul);
+
+		const u64 time = GetMonotonicTime();
+		if(m_has_tsc) Calibrate(time);
+		return TimeToTimebase(time);
+	}
+
+	bool IsTSC() const { return m_use_tsc; }
+	u64 GetTSCFrequency() const { return m_tsc_freq; }
+};
+
+extern HostClock g_host_clock;
+
+// Timer service: a thread calling functions at absolute deadlines (GetSystemTime() microseconds).
+// Timers are sorted in a hierarchical wheel: level 0 has a slot per 64 us tick, each higher
+// level a slot per 256 ticks of the level below; a slot of a higher level is moved down when
+// the wheel reaches it, timers further than 2^32 ticks wait in a separate list. Adding or
+// cancelling a timer doesn't depend on the count of timers.
+// The thread sleeps until the earliest deadline and yields during its last part (spin_time),
+// so timers fire a few microseconds after their deadline instead of the scheduler quantum.
+// Every sleeper (SleepUntil) waits on its own condition variable, woken by its timer.
+// The functions are called from the timer thread without the lock: they may add or cancel
+// timers, they must not block.
+class TimerWheel : public ThreadBase
+{
+	static const u32 tick_shift = 6; // 64 us
+	static const u32 slot_shift = 8;
+	static const u32 slot_count = 1 << slot_shift;
+	static const u32 level_count = 4;
+	// the last part of a wait (us) is spent yielding instead of sleeping
+	static const u64 spin_time = 50;
+
+	struct Timer
+	{
+		u64 deadline;
+		u64 period;
+		std::function<void()> func;
+	};
+
+	struct SlotEntry
+	{
+		u64 id;
+		u64 deadline;
+	};
+
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::unordered_map<u64, Timer> m_timers; // slot entries without a timer were cancelled
+	std::vector<SlotEntry> m_slots[level_count][slot_count];
+	u64 m_occupied[level_count][slot_count / 64];
+	std::vector<SlotEntry> m_far;
+	u64 m_current;  // first tick not processed
+	u64 m_next_id;
+	u64 m_running;  // id of the timer whose function is called (0 if none)
+	std::condition_variable m_running_cond;
+
+	struct Sleeper
+	{
+		std::condition_variable cond;
+		bool fired;
+		bool interrupted;
+	};
+
+	// sleepers (SleepUntil) waiting for their timer, woken up all at once by Close()
+	std::mutex m_sleep_mutex;
+	std::vector<Sleeper*> m_sleepers;
+	u64 m_interrupts;
+
+	void Insert(const u64 id, const u64 deadline);
+	void Cascade(const u32 level);
+	// moves the wheel up to the time, collects the ids of the timers due
+	void Advance(const u64 now, std::vector<u64>& due);
+	// the time when Advance() has something to do
+	u64 GetNextEvent() const;
+
+	virtual void Task();
+
+public:
+	TimerWheel();
+	~TimerWheel();
+
+	// calls the function at the deadline and every period (us) after it if period isn't 0,
+	// returns the id of the timer (never 0)
+	u64 Add(const u64 deadline, const u64 period, const std::function<void()>& func);
+	// removes the timer, waits for its function if it is being called by another thread,
+	// returns false if the timer didn't exist or has fired (single shot)
+	bool Cancel(const u64 id);
+
+	// blocks the calling thread until the deadline (us), returns false if interrupted by Close()
+	bool SleepUntil(const u64 deadline);
+	bool SleepFor(const u64 time)
+	{
+		return SleepUntil(g_host_clock.GetSystemTime() + time);
+	}
+
+	// removes every timer, wakes the sleepers and stops the thread (emulator stopped)
+	void Close();
+};
+
+extern TimerWheel g_timer_wheel;
@@ -2,6 +2,7 @@
 #include "VFS.h"
 #include "Emu/HDD/HDD.h"
 #include "vfsDeviceLocalFile.h"
+#include "vfsDevicePKG.h"
 
 int sort_devices(const void* _a, const void* _b)
 {
@@ -14,9 +15,15 @@ int sort_devices(const void* _a, const void* _b)
 	return 0;
 }
 
+VFS::VFS()
+	: m_mount_tree(new vfsMountNode())
+{
+}
+
 VFS::~VFS()
 {
 	UnMountAll();
+	delete m_mount_tree;
 }
 
 void VFS::Mount(const std::string& ps3_path, const std::string& local_path, vfsDevice* device)
@@ -30,6 +37,8 @@ void VFS::Mount(const std::string& ps3_path, const std::string& local_path, vfsD
 	{
 		//std::qsort(m_devices.GetPtr(), m_devices.GetCount(), sizeof(vfsDevice*), sort_devices);
 	}
+
+	RebuildMountTree();
 }
 
 void VFS::UnMount(const std::string& ps3_path)
@@ -40,6 +49,7 @@ void VFS::UnMount(const std::string& ps3_path)
 		{
 			delete m_devices[i];
 			m_devices.erase(m_devices.begin() +i);
+			RebuildMountTree();
 
 			return;
 		}
@@ -54,16 +64,73 @@ void VFS::UnMountAll()
 	}
 
 	m_devices.clear();
+	RebuildMountTree();
+}
+
+void VFS::RebuildMountTree()
+{
+	std::lock_guard<std::mutex> lock(m_cache_mutex);
+
+	delete m_mount_tree;
+	m_mount_tree = new vfsMountNode();
+	m_path_cache.clear();
+	m_missing_cache.clear();
+
+	for(u32 i=0; i<m_devices.size(); ++i)
+	{
+		const std::string& ps3_path = m_devices[i]->GetPs3Path();
+		vfsMountNode* node = m_mount_tree;
+
+		for(u32 j=0; j<ps3_path.length(); ++j)
+		{
+			vfsMountNode*& child = node->children[ps3_path[j]];
+			if(!child) child = new vfsMountNode();
+			node = child;
+		}
+
+		node->device = m_devices[i];
+		node->order = i;
+	}
+}
+
+void VFS::InvalidateMissing() const
+{
+	std::lock_guard<std::mutex> lock(m_cache_mutex);
+	m_missing_cache.clear();
+}
+
+bool VFS::IsMissing(const std::string& ps3_path, u32 flag) const
+{
+	std::lock_guard<std::mutex> lock(m_cache_mutex);
+
+	auto found = m_missing_cache.find(ps3_path);
+	return found != m_missing_cache.end() && (found->second & flag);
+}
+
+void VFS::SetMissing(const std::string& ps3_path, u32 flag) const
+{
+	std::lock_guard<std::mutex> lock(m_cache_mutex);
+
+	if(m_missing_cache.size() >= max_cached_paths) m_missing_cache.clear();
+	m_missing_cache[ps3_path] |= flag;
 }
 
 vfsFileBase* VFS::OpenFile(const std::string& ps3_path, vfsOpenMode mode) const
 {
+	if(mode == vfsRead && IsMissing(ps3_path, vfsMissingFile)) return nullptr;
+
 	std::string path;
 	if(vfsDevice* dev = GetDevice(ps3_path, path))
 	{
 		if(vfsFileBase* res = dev->GetNewFileStream())
 		{
 			res->Open(path, mode);
+
+			if(mode & vfsWrite)
+				InvalidateMissing();
+			else if(!res->IsOpened())
+				SetMissing(ps3_path, vfsMissingFile);
+
 			return res;
 		}
 	}
@@ -73,13 +140,15 @@ vfsFileBase* VFS::OpenFile(const std::string& ps3_path, vfsOpenMode mode) const
 
 vfsDirBase* VFS::OpenDir(const std::string& ps3_path) const
 {
+	if(IsMissing(ps3_path, vfsMissingDir)) return nullptr;
+
 	std::string path;
 
 	if(vfsDevice* dev = GetDevice(ps3_path, path))
 	{
 		if(vfsDirBase* res = dev->GetNewDirStream())
 		{
-			res->Open(path);
+			if(!res->Open(path)) SetMissing(ps3_path, vfsMissingDir);
 			return res;
 		}
 	}
@@ -96,7 +165,9 @@ bool VFS::CreateFile(const std::string& ps3_path) const
 
 		if(res)
 		{
-			return res->Create(path);
+			const bool ret = res->Create(path);
+			InvalidateMissing();
+			return ret;
 		}
 	}
 
@@ -112,7 +183,9 @@ bool VFS::CreateDir(const std::string& ps3_path) const
 
 		if(res)
 		{
-			return res->Create(path);
+			const bool ret = res->Create(path);
+			InvalidateMissing();
+			return ret;
 		}
 	}
 
@@ -128,7 +201,9 @@ bool VFS::RemoveFile(const std::string& ps3_path) const
 
 		if(res)
 		{
-			return res->Remove(path);
+			const bool ret = res->Remove(path);
+			InvalidateMissing();
+			return ret;
 		}
 	}
 
@@ -144,7 +219,9 @@ bool VFS::RemoveDir(const std::string& ps3_path) const
 
 		if(res)
 		{
-			return res->Remove(path);
+			const bool ret = res->Remove(path);
+			InvalidateMissing();
+			return ret;
 		}
 	}
 
@@ -153,6 +230,8 @@ bool VFS::RemoveDir(const std::string& ps3_path) const
 
 bool VFS::ExistsFile(const std::string& ps3_path) const
 {
+	if(IsMissing(ps3_path, vfsMissingFile)) return false;
+
 	std::string path;
 	if(vfsDevice* dev = GetDevice(ps3_path, path))
 	{
@@ -160,6 +239,7 @@ bool VFS::ExistsFile(const std::string& ps3_path) const
 
 		if(res)
 		{
+			// not cached as missing: not every device implements Exists()
 			return res->Exists(path);
 		}
 	}
@@ -169,6 +249,8 @@ bool VFS::ExistsFile(const std::string& ps3_path) const
 
 bool VFS::ExistsDir(const std::string& ps3_path) const
 {
+	if(IsMissing(ps3_path, vfsMissingDir)) return false;
+
 	std::string path;
 	if(vfsDevice* dev = GetDevice(ps3_path, path))
 	{
@@ -176,7 +258,9 @@ bool VFS::ExistsDir(const std::string& ps3_path) const
 
 		if(res)
 		{
-			return res->IsExists(path);
+			if(res->IsExists(path)) return true;
+
+			SetMissing(ps3_path, vfsMissingDir);
 		}
 	}
 
@@ -185,14 +269,19 @@ bool VFS::ExistsDir(const std::string& ps3_path) const
 
 bool VFS::RenameFile(const std::string& ps3_path_from, const std::string& ps3_path_to) const
 {
-	std::string path;
+	std::string path, path_to;
 	if(vfsDevice* dev = GetDevice(ps3_path_from, path))
 	{
+		if(GetDevice(ps3_path_to, path_to) != dev)
+			return false;
+
 		std::shared_ptr<vfsFileBase> res(dev->GetNewFileStream());
 
 		if(res)
 		{
-			return res->Rename(path, ps3_path_to);
+			const bool ret = res->Rename(path, path_to);
+			InvalidateMissing();
+			return ret;
 		}
 	}
 
@@ -201,39 +290,97 @@ bool VFS::RenameFile(const std::string& ps3_path_from, const std::string& ps3_pa
 
 bool VFS::RenameDir(const std::string& ps3_path_from, const std::string& ps3_path_to) const
 {
-	std::string path;
+	std::string path, path_to;
 	if(vfsDevice* dev = GetDevice(ps3_path_from, path))
 	{
+		if(GetDevice(ps3_path_to, path_to) != dev)
+			return false;
+
 		std::shared_ptr<vfsDirBase> res(dev->GetNewDirStream());
 
 		if(res)
 		{
-			return res->Rename(path, ps3_path_to);
+			const bool ret = res->Rename(path, path_to);
+			InvalidateMissing();
+			return ret;
 		}
 	}
 
 	return false;
 }
 
-vfsDevice* VFS::GetDevice(const std::string& ps3_path, std::string& path) const
+vfsDevice* VFS::FindDevice(const std::string& ps3_path, u32& eq) const
 {
-	u32 max_eq;
-	s32 max_i=-1;
+	// deepest mount point that is a prefix of ps3_path
+	vfsMountNode* node = m_mount_tree;
+	vfsDevice* res = nullptr;
+	eq = 0;
 
-	for(u32 i=0; i<m_devices.size(); ++i)
+	u32 i = 0;
+	for(; i<ps3_path.length(); ++i)
 	{
-		const u32 eq = m_devices[i]->CmpPs3Path(ps3_path);
+		auto found = node->children.find(ps3_path[i]);
+		if(found == node->children.end()) break;
 
-		if(max_i < 0 || eq > max_eq)
+		node = found->second;
+
+		if(node->device)
 		{
-			max_eq = eq;
-			max_i = i;
+			res = node->device;
+			eq = i + 1;
 		}
 	}
 
-	if(max_i < 0) return nullptr;
-	path = vfsDevice::GetWinPath(m_devices[max_i]->GetLocalPath(), ps3_path.substr(max_eq, ps3_path.length() - max_eq));
-	return m_devices[max_i];
+	// ps3_path is itself a prefix of mount points (e.g. "/dev_hdd0" for "/dev_hdd0/"):
+	// take the earliest mounted one below, as the linear scan used to
+	if(i == ps3_path.length() && i && !node->children.empty())
+	{
+		vfsMountNode* best = node->device ? node : nullptr;
+		std::vector<vfsMountNode*> stack(1, node);
+
+		while(!stack.empty())
+		{
+			vfsMountNode* cur = stack.back();
+			stack.pop_back();
+
+			if(cur->device && (!best || cur->order < best->order)) best = cur;
+
+			for(auto& child : cur->children) stack.push_back(child.second);
+		}
+
+		if(best)
+		{
+			res = best->device;
+			eq = i;
+		}
+	}
+
+	if(!res && m_devices.size()) res = m_devices[0];
+
+	return res;
+}
+
+vfsDevice* VFS::GetDevice(const std::string& ps3_path, std::string& path) const
+{
+	std::lock_guard<std::mutex> lock(m_cache_mutex);
+
+	auto cached = m_path_cache.find(ps3_path);
+	if(cached != m_path_cache.end())
+	{
+		path = cached->second.second;
+		return cached->second.first;
+	}
+
+	u32 eq;
+	vfsDevice* dev = FindDevice(ps3_path, eq);
+	if(!dev) return nullptr;
+
+	path = vfsDevice::GetWinPath(dev->GetLocalPath(), ps3_path.substr(eq, ps3_path.length() - eq));
+
+	if(m_path_cache.size() >= max_cached_paths) m_path_cache.clear();
+	m_path_cache[ps3_path] = std::make_pair(dev, path);
+
+	return dev;
 }
 
 vfsDevice* VFS::GetDeviceLocal(const std::string& local_path, std::string& path) const
@@ -283,6 +430,10 @@ void VFS::Init(const std::string& path)
 			dev = new vfsDeviceHDD(entry.device_path);
 		break;
 
+		case vfsDevice_PKG:
+			dev = new vfsDevicePKG(entry.device_path);
+		break;
+
 		default:
 			continue;
 		}
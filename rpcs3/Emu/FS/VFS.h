@@ -1,17 +1,20 @@
 #pragma once
 
 #include "vfsDevice.h"
+#include <unordered_map>
 
 enum vfsDeviceType
 {
 	vfsDevice_LocalFile,
 	vfsDevice_HDD,
+	vfsDevice_PKG,
 };
 
 static const char* vfsDeviceTypeNames[] = 
 {
 	"Local",
 	"HDD",
+	"PKG",
 };
 
 struct VFSManagerEntry
@@ -39,8 +42,32 @@ struct VFSManagerEntry
 	}
 };
 
+// Prefix tree over the mount points, one node per path character.
+struct vfsMountNode
+{
+	std::unordered_map<char, vfsMountNode*> children;
+	vfsDevice* device;
+	u32 order; // mount sequence number, lower means earlier in m_devices
+
+	vfsMountNode() : device(nullptr), order(0)
+	{
+	}
+
+	~vfsMountNode()
+	{
+		for(auto& child : children) delete child.second;
+	}
+};
+
+enum vfsMissingFlags
+{
+	vfsMissingFile = 0x1,
+	vfsMissingDir = 0x2,
+};
+
 struct VFS
 {
+	VFS();
 	~VFS();
 
 	//TODO: find out where these are supposed to be deleted or just make it shared_ptr
@@ -67,6 +94,26 @@ struct VFS
 	vfsDevice* GetDevice(const std::string& ps3_path, std::string& path) const;
 	vfsDevice* GetDeviceLocal(const std::string& local_path, std::string& path) const;
 
+	// must be called after changing the guest file system without going through VFS or the
+	// vfsFile/vfsDir wrappers (host paths, streams of a device)
+	void InvalidateMissing() const;
+
 	void Init(const std::string& path);
 	void SaveLoadDevices(std::vector<VFSManagerEntry>& res, bool is_load);
+
+private:
+	static const u32 max_cached_paths = 4096;
+
+	mutable std::mutex m_cache_mutex;
+	vfsMountNode* m_mount_tree;
+
+	// ps3 path -> resolved device and local path
+	mutable std::unordered_map<std::string, std::pair<vfsDevice*, std::string>> m_path_cache;
+	// ps3 path -> vfsMissingFlags of failed lookups
+	mutable std::unordered_map<std::string, u32> m_missing_cache;
+
+	void RebuildMountTree();
+	vfsDevice* FindDevice(const std::string& ps3_path, u32& eq) const;
+	bool IsMissing(const std::string& ps3_path, u32 flag) const;
+	void SetMissing(const std::string& ps3_path, u32 flag) const;
 };
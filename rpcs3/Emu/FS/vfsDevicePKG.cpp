@@ -0,0 +1,215 @@
+#include "stdafx.h"
+#include "vfsDevicePKG.h"
+#include "Crypto/unpkg.h"
+
+vfsDevicePKG::vfsDevicePKG(const std::string& pkg_path) : m_pkg_path(pkg_path)
+{
+}
+
+std::shared_ptr<PKGReader> vfsDevicePKG::GetReader()
+{
+	std::lock_guard<std::mutex> lock(m_reader_mutex);
+
+	if(!m_reader)
+	{
+		std::shared_ptr<PKGReader> reader(new PKGReader());
+
+		if(!reader->Open(m_pkg_path))
+		{
+			ConLog.Error("vfsDevicePKG: failed to open '%s'", m_pkg_path.c_str());
+			return nullptr;
+		}
+
+		ConLog.Write("vfsDevicePKG: mounted '%s' (%d entries)", m_pkg_path.c_str(), reader->entries.size());
+		m_reader = reader;
+	}
+
+	return m_reader;
+}
+
+std::string vfsDevicePKG::GetEntryPath(const std::string& path) const
+{
+	const std::string root = GetWinPath(GetLocalPath());
+	std::string res = GetWinPath(path, false);
+
+	if(res.compare(0, root.length(), root) == 0)
+	{
+		res = res.substr(root.length());
+	}
+	else if(res + '/' == root)
+	{
+		res.clear();
+	}
+
+	while(!res.empty() && res.back() == '/')
+	{
+		res.pop_back();
+	}
+
+	return res;
+}
+
+vfsFileBase* vfsDevicePKG::GetNewFileStream()
+{
+	return new vfsPKGFile(this);
+}
+
+vfsDirBase* vfsDevicePKG::GetNewDirStream()
+{
+	return new vfsPKGDir(this);
+}
+
+vfsPKGFile::vfsPKGFile(vfsDevicePKG* device)
+	: vfsFileBase(device)
+	, m_offset(0)
+	, m_size(0)
+{
+}
+
+bool vfsPKGFile::Open(const std::string& path, vfsOpenMode mode)
+{
+	Close();
+
+	if(mode != vfsRead)
+	{
+		return false;
+	}
+
+	vfsDevicePKG* device = (vfsDevicePKG*)m_device;
+	std::shared_ptr<PKGReader> reader = device->GetReader();
+	if(!reader)
+	{
+		return false;
+	}
+
+	const PKGReader::Entry* entry = reader->Find(device->GetEntryPath(path));
+	if(!entry || (entry->type & 0xff) == PKG_FILE_ENTRY_FOLDER)
+	{
+		return false;
+	}
+
+	m_reader = reader;
+	m_offset = entry->offset;
+	m_size = entry->size;
+
+	return vfsFileBase::Open(path, mode);
+}
+
+bool vfsPKGFile::Exists(const std::string& path)
+{
+	vfsDevicePKG* device = (vfsDevicePKG*)m_device;
+	std::shared_ptr<PKGReader> reader = device->GetReader();
+	if(!reader)
+	{
+		return false;
+	}
+
+	const PKGReader::Entry* entry = reader->Find(device->GetEntryPath(path));
+	return entry && (entry->type & 0xff) != PKG_FILE_ENTRY_FOLDER;
+}
+
+bool vfsPKGFile::Close()
+{
+	m_reader = nullptr;
+	m_offset = 0;
+	m_size = 0;
+
+	return vfsFileBase::Close();
+}
+
+u64 vfsPKGFile::GetSize()
+{
+	return m_size;
+}
+
+u64 vfsPKGFile::Write(const void* src, u64 size)
+{
+	return 0;
+}
+
+u64 vfsPKGFile::Read(void* dst, u64 size)
+{
+	const u64 res = ReadAt(Tell(), dst, size);
+	return vfsFileBase::Read(dst, res);
+}
+
+u64 vfsPKGFile::ReadAt(u64 offset, void* dst, u64 size)
+{
+	if(!m_reader || offset >= m_size)
+	{
+		return 0;
+	}
+
+	return m_reader->Read(m_offset + offset, dst, min<u64>(size, m_size - offset));
+}
+
+bool vfsPKGFile::IsOpened() const
+{
+	return m_reader != nullptr;
+}
+
+vfsPKGDir::vfsPKGDir(vfsDevicePKG* device) : vfsDirBase(device)
+{
+}
+
+bool vfsPKGDir::Open(const std::string& path)
+{
+	if(!vfsDirBase::Open(path))
+		return false;
+
+	vfsDevicePKG* device = (vfsDevicePKG*)m_device;
+	std::shared_ptr<PKGReader> reader = device->GetReader();
+	if(!reader)
+		return false;
+
+	const std::string dir = device->GetEntryPath(path);
+	const std::string prefix = dir.empty() ? dir : dir + '/';
+
+	for(const PKGReader::Entry& entry : reader->entries)
+	{
+		if(entry.name.length() <= prefix.length() || entry.name.compare(0, prefix.length(), prefix) != 0)
+			continue;
+
+		const std::string name = entry.name.substr(prefix.length());
+		if(name.find('/') != std::string::npos)
+			continue;
+
+		m_entries.emplace_back();
+		DirEntryInfo& info = m_entries.back();
+		info.name = name;
+		info.flags |= (entry.type & 0xff) == PKG_FILE_ENTRY_FOLDER ? DirEntry_TypeDir : DirEntry_TypeFile;
+		info.flags |= DirEntry_PermReadable;
+	}
+
+	return true;
+}
+
+bool vfsPKGDir::IsExists(const std::string& path) const
+{
+	vfsDevicePKG* device = (vfsDevicePKG*)m_device;
+	std::shared_ptr<PKGReader> reader = device->GetReader();
+	if(!reader)
+		return false;
+
+	const std::string dir = device->GetEntryPath(path);
+	if(dir.empty())
+		return true;
+
+	const PKGReader::Entry* entry = reader->Find(dir);
+	return entry && (entry->type & 0xff) == PKG_FILE_ENTRY_FOLDER;
+}
+
+bool vfsPKGDir::Create(const std::string& path)
+{
+	return false;
+}
+
+bool vfsPKGDir::Rename(const std::string& from, const std::string& to)
+{
+	return false;
+}
+
+bool vfsPKGDir::Remove(const std::string& path)
+{
+	return false;
+}
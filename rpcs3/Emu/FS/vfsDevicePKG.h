@@ -0,0 +1,58 @@
+#pragma once
+#include "vfsDevice.h"
+
+class PKGReader;
+
+// Read-only view of a .pkg archive. Files are decrypted on demand, nothing is extracted.
+class vfsDevicePKG : public vfsDevice
+{
+	std::string m_pkg_path;
+	std::shared_ptr<PKGReader> m_reader;
+	std::mutex m_reader_mutex;
+
+public:
+	vfsDevicePKG(const std::string& pkg_path);
+
+	std::shared_ptr<PKGReader> GetReader();
+
+	// converts a host path produced by VFS into a path relative to the package root
+	std::string GetEntryPath(const std::string& path) const;
+
+	virtual vfsFileBase* GetNewFileStream() override;
+	virtual vfsDirBase* GetNewDirStream() override;
+};
+
+class vfsPKGFile : public vfsFileBase
+{
+	std::shared_ptr<PKGReader> m_reader;
+	u64 m_offset;
+	u64 m_size;
+
+public:
+	vfsPKGFile(vfsDevicePKG* device);
+
+	virtual bool Open(const std::string& path, vfsOpenMode mode = vfsRead) override;
+	virtual bool Exists(const std::string& path) override;
+	virtual bool Close() override;
+
+	virtual u64 GetSize() override;
+
+	virtual u64 Write(const void* src, u64 size) override;
+	virtual u64 Read(void* dst, u64 size) override;
+	virtual u64 ReadAt(u64 offset, void* dst, u64 size) override;
+
+	virtual bool IsOpened() const override;
+};
+
+class vfsPKGDir : public vfsDirBase
+{
+public:
+	vfsPKGDir(vfsDevicePKG* device);
+
+	virtual bool Open(const std::string& path) override;
+	virtual bool IsExists(const std::string& path) const override;
+
+	virtual bool Create(const std::string& path) override;
+	virtual bool Rename(const std::string& from, const std::string& to) override;
+	virtual bool Remove(const std::string& path) override;
+};
@@ -25,7 +25,9 @@ bool vfsDir::Open(const std::string& path)
 
 bool vfsDir::Create(const std::string& path)
 {
-	return m_stream->Create(path);
+	const bool res = m_stream->Create(path);
+	Emu.GetVFS().InvalidateMissing();
+	return res;
 }
 
 bool vfsDir::IsExists(const std::string& path) const
@@ -40,12 +42,16 @@ const std::vector<DirEntryInfo>& vfsDir::GetEntries() const
 
 bool vfsDir::Rename(const std::string& from, const std::string& to)
 {
-	return m_stream->Rename(from, to);
+	const bool res = m_stream->Rename(from, to);
+	Emu.GetVFS().InvalidateMissing();
+	return res;
 }
 
 bool vfsDir::Remove(const std::string& path)
 {
-	return m_stream->Remove(path);
+	const bool res = m_stream->Remove(path);
+	Emu.GetVFS().InvalidateMissing();
+	return res;
 }
 
 const DirEntryInfo* vfsDir::Read()
@@ -25,7 +25,9 @@ bool vfsFile::Open(const std::string& path, vfsOpenMode mode)
 
 bool vfsFile::Create(const std::string& path)
 {
-	return m_stream->Create(path);
+	const bool res = m_stream->Create(path);
+	Emu.GetVFS().InvalidateMissing();
+	return res;
 }
 
 bool vfsFile::Exists(const std::string& path)
@@ -35,12 +37,16 @@ bool vfsFile::Exists(const std::string& path)
 
 bool vfsFile::Rename(const std::string& from, const std::string& to)
 {
-	return m_stream->Rename(from, to);
+	const bool res = m_stream->Rename(from, to);
+	Emu.GetVFS().InvalidateMissing();
+	return res;
 }
 
 bool vfsFile::Remove(const std::string& path)
 {
-	return m_stream->Remove(path);
+	const bool res = m_stream->Remove(path);
+	Emu.GetVFS().InvalidateMissing();
+	return res;
 }
 
 bool vfsFile::Close()
@@ -64,6 +70,11 @@ u64 vfsFile::Read(void* dst, u64 size)
 	return m_stream->Read(dst, size);
 }
 
+u64 vfsFile::ReadAt(u64 offset, void* dst, u64 size)
+{
+	return m_stream->ReadAt(offset, dst, size);
+}
+
 u64 vfsFile::Seek(s64 offset, vfsSeekMode mode)
 {
 	return m_stream->Seek(offset, mode);
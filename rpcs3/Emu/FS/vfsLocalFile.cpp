@@ -1,6 +1,12 @@
 #include "stdafx.h"
 #include "vfsLocalFile.h"
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 static const wxFile::OpenMode vfs2wx_mode(vfsOpenMode mode)
 {
 	switch(mode)
@@ -28,6 +34,9 @@ static const wxSeekMode vfs2wx_seek(vfsSeekMode mode)
 }
 
 vfsLocalFile::vfsLocalFile(vfsDevice* device) : vfsFileBase(device)
+#ifdef _WIN32
+	, m_read_handle(INVALID_HANDLE_VALUE)
+#endif
 {
 }
 
@@ -46,7 +55,16 @@ bool vfsLocalFile::Open(const std::string& path, vfsOpenMode mode)
 	// {
 		if(!m_file.Access(fmt::FromUTF8(path), vfs2wx_mode(mode))) return false;
 
-		return m_file.Open(fmt::FromUTF8(path), vfs2wx_mode(mode)) && vfsFileBase::Open(path, mode);
+		if(!m_file.Open(fmt::FromUTF8(path), vfs2wx_mode(mode)) || !vfsFileBase::Open(path, mode)) return false;
+
+#ifdef _WIN32
+		if(mode & vfsRead)
+		{
+			m_read_handle = ReOpenFile((HANDLE)_get_osfhandle(m_file.fd()), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0);
+		}
+#endif
+
+		return true;
 	// }
 }
 
@@ -80,8 +98,21 @@ bool vfsLocalFile::Create(const std::string& path)
 	return true;
 }
 
+bool vfsLocalFile::Exists(const std::string& path)
+{
+	return wxFileExists(fmt::FromUTF8(path));
+}
+
 bool vfsLocalFile::Close()
 {
+#ifdef _WIN32
+	if(m_read_handle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_read_handle);
+		m_read_handle = INVALID_HANDLE_VALUE;
+	}
+#endif
+
 	return m_file.Close() && vfsFileBase::Close();
 }
 
@@ -100,6 +131,35 @@ u64 vfsLocalFile::Read(void* dst, u64 size)
 	return m_file.Read(dst, size);
 }
 
+u64 vfsLocalFile::ReadAt(u64 offset, void* dst, u64 size)
+{
+#ifdef _WIN32
+	// ReadFile() with an OVERLAPPED offset moves the file pointer of a synchronous handle: the
+	// reads use their own handle
+	if(m_read_handle == INVALID_HANDLE_VALUE) return 0;
+
+	u64 done = 0;
+
+	while(done < size)
+	{
+		OVERLAPPED ov = {};
+		ov.Offset = (DWORD)(offset + done);
+		ov.OffsetHigh = (DWORD)((offset + done) >> 32);
+
+		const DWORD count = (DWORD)std::min<u64>(size - done, 0x40000000);
+		DWORD read = 0;
+
+		if(!ReadFile(m_read_handle, (u8*)dst + done, count, &read, &ov) || !read) break;
+		done += read;
+	}
+
+	return done;
+#else
+	const ssize_t res = pread(m_file.fd(), dst, size, offset);
+	return res < 0 ? 0 : res;
+#endif
+}
+
 u64 vfsLocalFile::Seek(s64 offset, vfsSeekMode mode)
 {
 	return m_file.Seek(offset, vfs2wx_seek(mode));
@@ -5,18 +5,24 @@ class vfsLocalFile : public vfsFileBase
 {
 private:
 	wxFile m_file;
+#ifdef _WIN32
+	// handle with its own file pointer for ReadAt(), the position of m_file isn't changed
+	HANDLE m_read_handle;
+#endif
 
 public:
 	vfsLocalFile(vfsDevice* device);
 
 	virtual bool Open(const std::string& path, vfsOpenMode mode = vfsRead) override;
 	virtual bool Create(const std::string& path) override;
+	virtual bool Exists(const std::string& path) override;
 	virtual bool Close() override;
 
 	virtual u64 GetSize() override;
 
 	virtual u64 Write(const void* src, u64 size) override;
 	virtual u64 Read(void* dst, u64 size) override;
+	virtual u64 ReadAt(u64 offset, void* dst, u64 size) override;
 
 	virtual u64 Seek(s64 offset, vfsSeekMode mode = vfsSeekSet) override;
 	virtual u64 Tell() const override;
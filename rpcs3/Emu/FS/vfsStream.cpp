@@ -46,6 +46,20 @@ u64 vfsStream::Read(void* dst, u64 size)
 	return size;
 }
 
+u64 vfsStream::ReadAt(u64 offset, void* dst, u64 size)
+{
+	// generic fallback for streams without positional I/O: borrow the cursor and restore it
+	static std::mutex cursor_mutex;
+	std::lock_guard<std::mutex> lock(cursor_mutex);
+
+	const u64 old_pos = Tell();
+	Seek(offset, vfsSeekSet);
+	const u64 res = Read(dst, size);
+	Seek(old_pos, vfsSeekSet);
+
+	return res;
+}
+
 u64 vfsStream::Seek(s64 offset, vfsSeekMode mode)
 {
 	switch(mode)
@@ -24,6 +24,7 @@ public:
 
 	virtual u64 Write(const void* src, u64 size);
 	virtual u64 Read(void* dst, u64 size);
+	virtual u64 ReadAt(u64 offset, void* dst, u64 size);
 
 	virtual u64 Seek(s64 offset, vfsSeekMode mode = vfsSeekSet);
 	virtual u64 Tell() const;
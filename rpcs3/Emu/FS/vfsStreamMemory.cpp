@@ -50,3 +50,19 @@ u64 vfsStreamMemory::Read(void* dst, u64 size)
 
 	return vfsStream::Read(dst, size);
 }
+
+u64 vfsStreamMemory::ReadAt(u64 offset, void* dst, u64 size)
+{
+	if(offset >= GetSize()) return 0;
+
+	if(offset + size > GetSize())
+	{
+		size = GetSize() - offset;
+	}
+
+	if(!size || !Memory.IsGoodAddr(m_addr + offset, size)) return 0;
+
+	Memory.CopyToReal(dst, m_addr + offset, size);
+
+	return size;
+}
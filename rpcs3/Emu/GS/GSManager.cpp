@@ -18,6 +18,12 @@ void GSManager::Init()
 
 	m_info.Init();
 
+	if(Emu.IsHeadless())
+	{
+		m_render = new HeadlessGSRender();
+		return;
+	}
+
 	switch(Ini.GSRenderMode.GetValue())
 	{
 	default:
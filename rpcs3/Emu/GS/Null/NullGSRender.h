@@ -82,3 +82,37 @@ private:
 		if(m_frame->IsShown()) m_frame->Hide();
 	}
 };
+
+// windowless variant for headless runs: doesn't need a display
+class HeadlessGSRender : public GSRender
+{
+private:
+	virtual void OnInit()
+	{
+	}
+
+	virtual void OnInitThread()
+	{
+	}
+
+	virtual void OnExitThread()
+	{
+	}
+
+	virtual void OnReset()
+	{
+	}
+
+	virtual void ExecCMD()
+	{
+	}
+
+	virtual void Flip()
+	{
+	}
+
+	virtual void Close()
+	{
+		Stop();
+	}
+};
@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "RSXThread.h"
 #include "Emu/SysCalls/lv2/SC_Time.h"
+#include "Headless.h"
 
 #define ARGS(x) (x >= count ? OutOfArgsCount(x, cmd, count) : Memory.Read32(Memory.RSXIOMem.GetStartAddr() + m_ctrl->get + (4*(x+1))))
 
@@ -191,6 +192,7 @@ void RSXThread::DoCmd(const u32 fcmd, const u32 cmd, mem32_ptr_t& args, const u3
 		//if(cmd == 0xfeadffff)
 		{
 			Flip();
+			m_flip_count++;
 
 			m_gcm_current_buffer = ARGS(0);
 			m_read_buffer = true;
@@ -1520,18 +1522,85 @@ void RSXThread::End()
 	OnReset();
 }
 
+void RSXThread::ExecFIFOCommand(const u32 get)
+{
+	u8 inc = 1;
+
+	//ConLog.Write("addr = 0x%x", m_ioAddress + get);
+	const u32 cmd = Memory.Read32(Memory.RSXIOMem.GetStartAddr() + get);
+	const u32 count = (cmd >> 18) & 0x7ff;
+	//if(cmd == 0) continue;
+
+	if(cmd & CELL_GCM_METHOD_FLAG_JUMP)
+	{
+		u32 addr = cmd & ~(CELL_GCM_METHOD_FLAG_JUMP | CELL_GCM_METHOD_FLAG_NON_INCREMENT);
+		//ConLog.Warning("rsx jump(0x%x) #addr=0x%x, cmd=0x%x, get=0x%x, put=0x%x", addr, m_ioAddress + get, cmd, get, put);
+		m_ctrl->get = addr;
+		return;
+	}
+	if(cmd & CELL_GCM_METHOD_FLAG_CALL)
+	{
+		m_call_stack.push(get + 4);
+		u32 offs = cmd & ~CELL_GCM_METHOD_FLAG_CALL;
+		u32 addr = Memory.RSXIOMem.GetStartAddr() + offs;
+		//ConLog.Warning("rsx call(0x%x) #0x%x - 0x%x - 0x%x", offs, addr, cmd, get);
+		m_ctrl->get = offs;
+		return;
+	}
+	if(cmd == CELL_GCM_METHOD_FLAG_RETURN)
+	{
+		//ConLog.Warning("rsx return!");
+		u32 ret = m_call_stack.top();
+		m_call_stack.pop();
+		//ConLog.Warning("rsx return(0x%x)", ret);
+		m_ctrl->get = ret;
+		return;
+	}
+	if(cmd & CELL_GCM_METHOD_FLAG_NON_INCREMENT)
+	{
+		//ConLog.Warning("non increment cmd! 0x%x", cmd);
+		inc=0;
+	}
+
+	if(cmd == 0)
+	{
+		ConLog.Warning("null cmd: addr=0x%x, put=0x%x, get=0x%x", Memory.RSXIOMem.GetStartAddr() + get, m_ctrl->put, get);
+		Emu.Pause();
+		return;
+	}
+
+	for(u32 i=0; i<count; i++)
+	{
+		methodRegisters[(cmd & 0xffff) + (i*4*inc)] = ARGS(i);
+	}
+
+	mem32_ptr_t args(Memory.RSXIOMem.GetStartAddr() + get + 4);
+	DoCmd(cmd, cmd & 0x3ffff, args, count);
+
+	m_ctrl->get = get + (count + 1) * 4;
+	//memset(Memory.GetMemFromAddr(p.m_ioAddress + get), 0, (count + 1) * 4);
+}
+
 void RSXThread::Task()
 {
-	u8 inc;
 	ConLog.Write("RSX thread entry");
 
 	OnInitThread();
 
 	while(!TestDestroy())
 	{
-		wxCriticalSectionLocker lock(m_cs_main);
+		if(m_vblank_handled != m_vblank_count)
+		{
+			m_vblank_handled = m_vblank_count;
+
+			if(m_vblank_handler)
+			{
+				m_vblank_handler.Handle(1, 0, 0);
+				m_vblank_handler.Branch(false);
+			}
+		}
 
-		inc=1;
+		wxCriticalSectionLocker lock(m_cs_main);
 
 		u32 put, get;
 		se_t<u32>::func(put, std::atomic_load((volatile std::atomic<u32>*)((u8*)m_ctrl + offsetof(CellGcmControl, put))));
@@ -1551,62 +1620,12 @@ void RSXThread::Task()
 			continue;
 		}
 
-		//ConLog.Write("addr = 0x%x", m_ioAddress + get);
-		const u32 cmd = Memory.Read32(Memory.RSXIOMem.GetStartAddr() + get);
-		const u32 count = (cmd >> 18) & 0x7ff;
-		//if(cmd == 0) continue;
-
-		if(cmd & CELL_GCM_METHOD_FLAG_JUMP)
-		{
-			u32 addr = cmd & ~(CELL_GCM_METHOD_FLAG_JUMP | CELL_GCM_METHOD_FLAG_NON_INCREMENT);
-			//ConLog.Warning("rsx jump(0x%x) #addr=0x%x, cmd=0x%x, get=0x%x, put=0x%x", addr, m_ioAddress + get, cmd, get, put);
-			m_ctrl->get = addr;
-			continue;
-		}
-		if(cmd & CELL_GCM_METHOD_FLAG_CALL)
-		{
-			m_call_stack.push(get + 4);
-			u32 offs = cmd & ~CELL_GCM_METHOD_FLAG_CALL;
-			u32 addr = Memory.RSXIOMem.GetStartAddr() + offs;
-			//ConLog.Warning("rsx call(0x%x) #0x%x - 0x%x - 0x%x", offs, addr, cmd, get);
-			m_ctrl->get = offs;
-			continue;
-		}
-		if(cmd == CELL_GCM_METHOD_FLAG_RETURN)
-		{
-			//ConLog.Warning("rsx return!");
-			u32 get = m_call_stack.top();
-			m_call_stack.pop();
-			//ConLog.Warning("rsx return(0x%x)", get);
-			m_ctrl->get = get;
-			continue;
-		}
-		if(cmd & CELL_GCM_METHOD_FLAG_NON_INCREMENT)
-		{
-			//ConLog.Warning("non increment cmd! 0x%x", cmd);
-			inc=0;
-		}
-
-		if(cmd == 0)
-		{
-			ConLog.Warning("null cmd: addr=0x%x, put=0x%x, get=0x%x", Memory.RSXIOMem.GetStartAddr() + get, m_ctrl->put, get);
-			Emu.Pause();
-			continue;
-		}
-
-		for(u32 i=0; i<count; i++)
-		{
-			methodRegisters[(cmd & 0xffff) + (i*4*inc)] = ARGS(i);
-		}
-
-		mem32_ptr_t args(Memory.RSXIOMem.GetStartAddr() + get + 4);
-		DoCmd(cmd, cmd & 0x3ffff, args, count);
-
-		m_ctrl->get = get + (count + 1) * 4;
-		//memset(Memory.GetMemFromAddr(p.m_ioAddress + get), 0, (count + 1) * 4);
+		ExecFIFOCommand(get);
 	}
 
 	ConLog.Write("RSX thread exit...");
 
 	OnExitThread();
+
+	if (g_headless_report.IsEnabled()) g_headless_report.AddThread("RSXThread", "RSX", 0);
 }
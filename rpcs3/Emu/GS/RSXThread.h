@@ -4,6 +4,7 @@
 #include "RSXVertexProgram.h"
 #include "RSXFragmentProgram.h"
 #include "Emu/SysCalls/Callback.h"
+#include "Emu/Clock.h"
 
 #include <set> // For tracking a list of used gcm commands
 #include <stack>
@@ -119,6 +120,10 @@ public:
 	u32 m_ioAddress, m_ioSize, m_ctrlAddress;
 	int m_flip_status;
 	int m_flip_mode;
+	std::atomic<u64> m_flip_count; // flips executed so far (read by other threads)
+	std::atomic<u64> m_vblank_count; // vblanks so far (59.94 Hz, counted by the timer thread)
+	u64 m_vblank_handled; // last vblank passed to m_vblank_handler
+	u64 m_vblank_timer;
 	int m_debug_level;
 	int m_frequency_mode;
 
@@ -144,6 +149,7 @@ public:
 	wxSemaphore m_sem_flush;
 	wxSemaphore m_sem_flip;
 	Callback m_flip_handler;
+	Callback m_vblank_handler;
 
 public:
 	bool m_set_color_mask;
@@ -393,6 +399,10 @@ protected:
 		, m_ctrl(nullptr)
 		, m_flip_status(0)
 		, m_flip_mode(CELL_GCM_DISPLAY_VSYNC)
+		, m_flip_count(0)
+		, m_vblank_count(0)
+		, m_vblank_handled(0)
+		, m_vblank_timer(0)
 		, m_debug_level(CELL_GCM_DEBUG_LEVEL0)
 		, m_frequency_mode(CELL_GCM_DISPLAY_FREQUENCY_DISABLE)
 		, m_main_mem_addr(0)
@@ -442,7 +452,10 @@ protected:
 		Reset();
 	}
 
-	virtual ~RSXThread() {}
+	virtual ~RSXThread()
+	{
+		if(m_vblank_timer) g_timer_wheel.Cancel(m_vblank_timer);
+	}
 
 	void Reset()
 	{
@@ -508,6 +521,8 @@ protected:
 
 	u32 OutOfArgsCount(const uint x, const u32 cmd, const u32 count);
 	void DoCmd(const u32 fcmd, const u32 cmd, mem32_ptr_t& args, const u32 count);
+	// executes the FIFO entry at offset get, then advances m_ctrl->get (or follows a jump/call/return)
+	void ExecFIFOCommand(const u32 get);
 
 	virtual void OnInit() = 0;
 	virtual void OnInitThread() = 0;
@@ -545,5 +560,11 @@ public:
 
 		OnInit();
 		ThreadBase::Start();
+
+		// vertical blanking of a 59.94 Hz display
+		static const u64 vblank_period = 1001000 / 60;
+		m_vblank_count = 0;
+		m_vblank_handled = 0;
+		m_vblank_timer = g_timer_wheel.Add(g_host_clock.GetSystemTime() + vblank_period, vblank_period, [this]() { m_vblank_count++; });
 	}
 };
@@ -1,5 +1,356 @@
 #include "stdafx.h"
 #include "HDD.h"
+#include <algorithm>
+
+vfsHDDImage::vfsHDDImage(const std::string& path)
+	: m_path(path)
+	, m_file(nullptr)
+	, m_alloc_hint(1)
+	, m_map_dirty(false)
+{
+	memset(&m_hdr, 0, sizeof(vfsHDD_Hdr));
+
+	if(!m_file.Open(path, vfsReadWrite))
+	{
+		ConLog.Error("vfsHDDImage: failed to open '%s'", path.c_str());
+		m_hdr.block_size = 2048;
+		return;
+	}
+
+	m_file.Read(&m_hdr, sizeof(vfsHDD_Hdr));
+
+	if(m_hdr.version < 0x0002)
+	{
+		m_hdr.bitmap_block = 0;
+		m_hdr.bitmap_size = 0;
+	}
+
+	if(!m_hdr.block_size)
+	{
+		ConLog.Error("Bad block size!");
+		m_hdr.block_size = 2048;
+	}
+
+	LoadMap();
+}
+
+vfsHDDImage::~vfsHDDImage()
+{
+	Flush();
+	m_file.Close();
+}
+
+std::shared_ptr<vfsHDDImage> vfsHDDImage::Get(const std::string& path)
+{
+	static std::mutex registry_mutex;
+	static std::unordered_map<std::string, std::weak_ptr<vfsHDDImage>> registry;
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+
+	std::shared_ptr<vfsHDDImage> image = registry[path].lock();
+	if(!image)
+	{
+		image = std::make_shared<vfsHDDImage>(path);
+		registry[path] = image;
+	}
+
+	return image;
+}
+
+void vfsHDDImage::LoadMap()
+{
+	m_used_map.assign((m_hdr.block_count + 63) / 64, 0);
+
+	if(m_hdr.bitmap_block && m_hdr.bitmap_size)
+	{
+		const u64 bytes = min<u64>(m_hdr.bitmap_size * m_hdr.block_size, m_used_map.size() * sizeof(u64));
+		m_file.ReadAt(m_hdr.bitmap_block * m_hdr.block_size, &m_used_map[0], bytes);
+		return;
+	}
+
+	// version 1 images have no bitmap: scan the block headers once per mount
+	vfsHDD_Block block_info;
+	for(u64 i = 0; i < m_hdr.block_count; ++i)
+	{
+		if(m_file.ReadAt(i * m_hdr.block_size, &block_info, sizeof(vfsHDD_Block)) != sizeof(vfsHDD_Block))
+		{
+			break;
+		}
+
+		if(block_info.is_used)
+		{
+			SetUsed(i, true);
+		}
+	}
+
+	m_map_dirty = false;
+}
+
+void vfsHDDImage::SetUsed(u64 block, bool used)
+{
+	if(used)
+		m_used_map[block / 64] |= 1ULL << (block % 64);
+	else
+		m_used_map[block / 64] &= ~(1ULL << (block % 64));
+
+	m_map_dirty = true;
+}
+
+bool vfsHDDImage::IsUsed(u64 block) const
+{
+	return (m_used_map[block / 64] >> (block % 64)) & 1;
+}
+
+vfsHDDImage::CachedBlock& vfsHDDImage::GetCached(u64 block, bool fill)
+{
+	auto found = m_cache.find(block);
+	if(found != m_cache.end())
+	{
+		return found->second;
+	}
+
+	if(m_cache.size() >= max_cached_blocks)
+	{
+		FlushCache();
+		m_cache.clear();
+	}
+
+	CachedBlock& res = m_cache[block];
+	res.data.resize(m_hdr.block_size);
+	res.dirty = false;
+
+	if(fill)
+	{
+		m_file.ReadAt(block * m_hdr.block_size, &res.data[0], m_hdr.block_size);
+	}
+
+	return res;
+}
+
+void vfsHDDImage::FlushCache()
+{
+	std::vector<u64> dirty;
+	for(auto& it : m_cache)
+	{
+		if(it.second.dirty)
+		{
+			dirty.push_back(it.first);
+		}
+	}
+
+	if(dirty.empty())
+	{
+		return;
+	}
+
+	std::sort(dirty.begin(), dirty.end());
+
+	std::vector<u8> run;
+	for(size_t i = 0; i < dirty.size();)
+	{
+		size_t end = i + 1;
+		while(end < dirty.size() && dirty[end] == dirty[end - 1] + 1)
+		{
+			++end;
+		}
+
+		run.resize((end - i) * m_hdr.block_size);
+		for(size_t j = i; j < end; ++j)
+		{
+			CachedBlock& cached = m_cache[dirty[j]];
+			memcpy(&run[(j - i) * m_hdr.block_size], &cached.data[0], m_hdr.block_size);
+			cached.dirty = false;
+		}
+
+		m_file.Seek(dirty[i] * m_hdr.block_size);
+		m_file.Write(&run[0], run.size());
+		i = end;
+	}
+}
+
+void vfsHDDImage::Flush()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if(!m_file.IsOpened())
+	{
+		return;
+	}
+
+	FlushCache();
+
+	if(m_map_dirty && m_hdr.bitmap_block)
+	{
+		const u64 bytes = min<u64>(m_hdr.bitmap_size * m_hdr.block_size, m_used_map.size() * sizeof(u64));
+		m_file.Seek(m_hdr.bitmap_block * m_hdr.block_size);
+		m_file.Write(&m_used_map[0], bytes);
+	}
+
+	m_map_dirty = false;
+}
+
+void vfsHDDImage::Read(u64 block, u32 offset, void* dst, u32 size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if(block >= m_hdr.block_count || offset + size > m_hdr.block_size)
+	{
+		memset(dst, 0, size);
+		return;
+	}
+
+	memcpy(dst, &GetCached(block, true).data[offset], size);
+}
+
+void vfsHDDImage::Write(u64 block, u32 offset, const void* src, u32 size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if(block >= m_hdr.block_count || offset + size > m_hdr.block_size)
+	{
+		ConLog.Error("vfsHDDImage::Write: bad block 0x%llx (offset=0x%x, size=0x%x)", block, offset, size);
+		return;
+	}
+
+	CachedBlock& cached = GetCached(block, offset || size < m_hdr.block_size);
+	memcpy(&cached.data[offset], src, size);
+	cached.dirty = true;
+}
+
+u64 vfsHDDImage::ReadData(const u64* blocks, u64 count, u64 offset, void* dst, u64 size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const u32 data_size = m_hdr.block_size - sizeof(vfsHDD_Block);
+	u8* out = (u8*)dst;
+	u64 done = 0;
+	std::vector<u8> run;
+
+	for(u64 i = 0; i < count && done < size;)
+	{
+		auto found = m_cache.find(blocks[i]);
+		if(found != m_cache.end())
+		{
+			const u64 rsize = min<u64>(data_size - offset, size - done);
+			memcpy(out + done, &found->second.data[sizeof(vfsHDD_Block) + offset], rsize);
+			done += rsize;
+			offset = 0;
+			++i;
+			continue;
+		}
+
+		// physically consecutive blocks not in the cache are fetched with a single host read
+		u64 end = i + 1;
+		u64 need = data_size - offset;
+		while(end < count && need < size - done && blocks[end] == blocks[end - 1] + 1 && m_cache.find(blocks[end]) == m_cache.end())
+		{
+			need += data_size;
+			++end;
+		}
+
+		run.resize((end - i) * m_hdr.block_size);
+		const u64 got = m_file.ReadAt(blocks[i] * m_hdr.block_size, &run[0], run.size());
+
+		for(u64 j = 0; j < end - i && done < size; ++j)
+		{
+			const u64 pos = j * m_hdr.block_size + sizeof(vfsHDD_Block) + offset;
+			if(pos >= got)
+			{
+				return done;
+			}
+
+			const u64 rsize = min<u64>(min<u64>(data_size - offset, size - done), got - pos);
+			memcpy(out + done, &run[pos], rsize);
+			done += rsize;
+			offset = 0;
+		}
+
+		i = end;
+	}
+
+	return done;
+}
+
+u64 vfsHDDImage::WriteData(const u64* blocks, u64 count, u64 offset, const void* src, u64 size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const u32 data_size = m_hdr.block_size - sizeof(vfsHDD_Block);
+	const u8* in = (const u8*)src;
+	u64 done = 0;
+
+	for(u64 i = 0; i < count && done < size; ++i)
+	{
+		const u64 wsize = min<u64>(data_size - offset, size - done);
+		CachedBlock& cached = GetCached(blocks[i], true);
+		memcpy(&cached.data[sizeof(vfsHDD_Block) + offset], in + done, wsize);
+		cached.dirty = true;
+		done += wsize;
+		offset = 0;
+	}
+
+	return done;
+}
+
+u64 vfsHDDImage::AllocBlock()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for(u64 pass = 0; pass < 2; ++pass)
+	{
+		const u64 from = pass ? 0 : m_alloc_hint / 64;
+		const u64 to = pass ? m_alloc_hint / 64 + 1 : m_used_map.size();
+
+		for(u64 word = from; word < to && word < m_used_map.size(); ++word)
+		{
+			if(m_used_map[word] == ~0ULL)
+			{
+				continue;
+			}
+
+			for(u64 bit = 0; bit < 64; ++bit)
+			{
+				const u64 block = word * 64 + bit;
+				if(block >= m_hdr.block_count)
+				{
+					break;
+				}
+
+				if(!block || IsUsed(block))
+				{
+					continue;
+				}
+
+				SetUsed(block, true);
+				m_alloc_hint = block + 1;
+
+				CachedBlock& cached = GetCached(block, true);
+				memcpy(&cached.data[0], &g_used_block, sizeof(vfsHDD_Block));
+				cached.dirty = true;
+				return block;
+			}
+		}
+	}
+
+	return 0;
+}
+
+void vfsHDDImage::FreeBlock(u64 block)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if(!block || block >= m_hdr.block_count)
+	{
+		return;
+	}
+
+	SetUsed(block, false);
+	m_alloc_hint = min<u64>(m_alloc_hint, block);
+
+	CachedBlock& cached = GetCached(block, true);
+	memcpy(&cached.data[0], &g_null_block, sizeof(vfsHDD_Block));
+	cached.dirty = true;
+}
 
 vfsDeviceHDD::vfsDeviceHDD(const std::string& hdd_path) : m_hdd_path(hdd_path)
 {
@@ -1,8 +1,9 @@
 #pragma once
 #include "Emu/FS/vfsDevice.h"
+#include <unordered_map>
 
 static const u64 g_hdd_magic = *(u64*)"PS3eHDD\0";
-static const u16 g_hdd_version = 0x0001;
+static const u16 g_hdd_version = 0x0002;
 
 struct vfsHDD_Block
 {
@@ -19,6 +20,8 @@ struct vfsHDD_Hdr : public vfsHDD_Block
 	u16 version;
 	u64 block_count;
 	u32 block_size;
+	u64 bitmap_block; // (version 2) first block of the free-block bitmap, 0 if the image has none
+	u64 bitmap_size;  // (version 2) bitmap size in blocks
 };
 
 enum vfsHDD_EntryType : u8
@@ -66,12 +69,15 @@ public:
 		static const u64 cur_dir_block = 1;
 
 		vfsHDD_Hdr hdr;
+		memset(&hdr, 0, sizeof(vfsHDD_Hdr));
 		CreateBlock(hdr);
 		hdr.next_block = cur_dir_block;
 		hdr.magic = g_hdd_magic;
 		hdr.version = g_hdd_version;
 		hdr.block_count = (size + block_size) / block_size;
 		hdr.block_size = block_size;
+		hdr.bitmap_block = cur_dir_block + 1;
+		hdr.bitmap_size = ((hdr.block_count + 7) / 8 + block_size - 1) / block_size;
 		f.Write(&hdr, sizeof(vfsHDD_Hdr));
 
 		{
@@ -86,6 +92,18 @@ public:
 			f.Write(".");
 		}
 
+		{
+			// header, root directory and the bitmap itself are in use
+			std::vector<u8> bitmap(hdr.bitmap_size * hdr.block_size);
+			for(u64 i = 0; i < hdr.bitmap_block + hdr.bitmap_size; ++i)
+			{
+				bitmap[i / 8] |= 1 << (i % 8);
+			}
+
+			f.Seek(hdr.bitmap_block * hdr.block_size);
+			f.Write(&bitmap[0], bitmap.size());
+		}
+
 		u8 null = 0;
 		f.Seek(hdr.block_count * hdr.block_size - sizeof(null));
 		f.Write(&null, sizeof(null));
@@ -100,112 +118,127 @@ public:
 	}
 };
 
-
-class vfsHDDFile
+// Block-level access to an HDD image, shared by every vfsHDD opened on the same path.
+// Holds the free-block bitmap in memory (persisted in version 2 images, rebuilt by a single
+// scan otherwise) and a write-back cache of recently used blocks. Dirty blocks are written
+// back in block order, consecutive runs with a single write.
+class vfsHDDImage
 {
-	u64 m_info_block;
-	vfsHDD_Entry m_info;
-	const vfsHDD_Hdr& m_hdd_info;
-	vfsLocalFile& m_hdd;
-	u32 m_position;
-	u64 m_cur_block;
-
-	bool goto_block(u64 n)
+	struct CachedBlock
 	{
-		vfsHDD_Block block_info;
+		std::vector<u8> data;
+		bool dirty;
+	};
 
-		if(m_info.data_block >= m_hdd_info.block_count)
-		{
-			return false;
-		}
+	std::string m_path;
+	vfsLocalFile m_file;
+	vfsHDD_Hdr m_hdr;
+	std::vector<u64> m_used_map; // bit set = block in use
+	u64 m_alloc_hint;
+	bool m_map_dirty;
+	std::unordered_map<u64, CachedBlock> m_cache;
+	std::mutex m_mutex;
 
-		m_hdd.Seek(m_info.data_block * m_hdd_info.block_size);
-		block_info.next_block = m_info.data_block;
+	static const u32 max_cached_blocks = 512;
 
-		for(u64 i=0; i<n; ++i)
-		{
-			if(!block_info.next_block || !block_info.is_used || block_info.next_block >= m_hdd_info.block_count)
-			{
-				return false;
-			}
+	CachedBlock& GetCached(u64 block, bool fill);
+	void FlushCache();
+	void LoadMap();
+	void SetUsed(u64 block, bool used);
+	bool IsUsed(u64 block) const;
 
-			m_hdd.Seek(block_info.next_block * m_hdd_info.block_size);
-			m_hdd.Read(&block_info, sizeof(vfsHDD_Block));
-		}
+public:
+	vfsHDDImage(const std::string& path);
+	~vfsHDDImage();
 
-		return true;
-	}
+	static std::shared_ptr<vfsHDDImage> Get(const std::string& path);
 
-	void RemoveBlocks(u64 start_block)
-	{
-		vfsHDD_Block block_info;
-		block_info.next_block = start_block;
+	bool IsOpened() const { return m_file.IsOpened(); }
+	const vfsHDD_Hdr& GetHeader() const { return m_hdr; }
 
-		while(block_info.next_block && block_info.is_used)
-		{
-			u64 offset = block_info.next_block * m_hdd_info.block_size;
+	// access inside a single block (offset includes the vfsHDD_Block header)
+	void Read(u64 block, u32 offset, void* dst, u32 size);
+	void Write(u64 block, u32 offset, const void* src, u32 size);
 
-			ReadBlock(offset, block_info);
-			WriteBlock(offset, g_null_block);
-		}
-	}
+	// payload access over a list of blocks, starting at payload offset `offset` of blocks[0]
+	u64 ReadData(const u64* blocks, u64 count, u64 offset, void* dst, u64 size);
+	u64 WriteData(const u64* blocks, u64 count, u64 offset, const void* src, u64 size);
 
-	void WriteBlock(u64 block, const vfsHDD_Block& data)
-	{
-		m_hdd.Seek(block * m_hdd_info.block_size);
-		m_hdd.Write(&data, sizeof(vfsHDD_Block));
-	}
+	// returns 0 if the image is full (block 0 always holds the header)
+	u64 AllocBlock();
+	void FreeBlock(u64 block);
 
-	void ReadBlock(u64 block, vfsHDD_Block& data)
-	{
-		m_hdd.Seek(block * m_hdd_info.block_size);
-		m_hdd.Read(&data, sizeof(vfsHDD_Block));
-	}
+	void Flush();
+};
 
-	void WriteEntry(u64 block, const vfsHDD_Entry& data)
-	{
-		m_hdd.Seek(block * m_hdd_info.block_size);
-		m_hdd.Write(&data, sizeof(vfsHDD_Entry));
-	}
+class vfsHDDFile
+{
+	u64 m_info_block;
+	vfsHDD_Entry m_info;
+	vfsHDDImage& m_hdd;
+	const vfsHDD_Hdr& m_hdd_info;
+	u64 m_position;
+	std::vector<u64> m_blocks; // data blocks of the file in chain order
 
-	void ReadEntry(u64 block, vfsHDD_Entry& data)
+	__forceinline u32 GetDataSize() const
 	{
-		m_hdd.Seek(block * m_hdd_info.block_size);
-		m_hdd.Read(&data, sizeof(vfsHDD_Entry));
+		return m_hdd_info.block_size - sizeof(vfsHDD_Block);
 	}
 
-	void ReadEntry(u64 block, vfsHDD_Entry& data, std::string& name)
+	void LoadBlocks()
 	{
-		m_hdd.Seek(block * m_hdd_info.block_size);
-		m_hdd.Read(&data, sizeof(vfsHDD_Entry));
-		name.resize(GetMaxNameLen());
-		m_hdd.Read(&name.front(), GetMaxNameLen());
-	}
+		m_blocks.clear();
 
-	void ReadEntry(u64 block, std::string& name)
-	{
-		m_hdd.Seek(block * m_hdd_info.block_size + sizeof(vfsHDD_Entry));
-		name.resize(GetMaxNameLen());
-		m_hdd.Read(&name.front(), GetMaxNameLen());
-	}
+		vfsHDD_Block block_info;
+		u64 block = m_info.data_block;
 
-	void WriteEntry(u64 block, const vfsHDD_Entry& data, const std::string& name)
-	{
-		m_hdd.Seek(block * m_hdd_info.block_size);
-		m_hdd.Write(&data, sizeof(vfsHDD_Entry));
-		m_hdd.Write(name.c_str(), min<size_t>(GetMaxNameLen() - 1, name.length() + 1));
+		while(block && block < m_hdd_info.block_count)
+		{
+			m_blocks.push_back(block);
+			m_hdd.Read(block, 0, &block_info, sizeof(vfsHDD_Block));
+
+			if(!block_info.is_used) break;
+			block = block_info.next_block;
+		}
 	}
 
-	__forceinline u32 GetMaxNameLen() const
+	// grow the chain until it covers `size` bytes
+	bool Reserve(u64 size)
 	{
-		return m_hdd_info.block_size - sizeof(vfsHDD_Entry);
+		while((u64)m_blocks.size() * GetDataSize() < size)
+		{
+			u64 new_block = m_hdd.AllocBlock();
+
+			if(!new_block)
+			{
+				return false;
+			}
+
+			if(m_blocks.empty())
+			{
+				m_info.data_block = new_block;
+			}
+			else
+			{
+				vfsHDD_Block link = g_used_block;
+				link.next_block = new_block;
+				m_hdd.Write(m_blocks.back(), 0, &link, sizeof(vfsHDD_Block));
+			}
+
+			m_blocks.push_back(new_block);
+		}
+
+		return true;
 	}
 
 public:
-	vfsHDDFile(vfsLocalFile& hdd, const vfsHDD_Hdr& hdd_info)
-		: m_hdd(hdd)
-		, m_hdd_info(hdd_info)
+	vfsHDDFile(vfsHDDImage& hdd)
+		: m_info_block(0)
+		, m_hdd(hdd)
+		, m_hdd_info(hdd.GetHeader())
+		, m_position(0)
 	{
+		memset(&m_info, 0, sizeof(vfsHDD_Entry));
 	}
 
 	~vfsHDDFile()
@@ -215,26 +248,9 @@ public:
 	void Open(u64 info_block)
 	{
 		m_info_block = info_block;
-		ReadEntry(m_info_block, m_info);
+		m_hdd.Read(m_info_block, 0, &m_info, sizeof(vfsHDD_Entry));
 		m_position = 0;
-		m_cur_block = m_info.data_block;
-	}
-
-	u64 FindFreeBlock()
-	{
-		vfsHDD_Block block_info;
-
-		for(u64 i = 0; i<m_hdd_info.block_count; ++i)
-		{
-			ReadBlock(i, block_info);
-
-			if(!block_info.is_used)
-			{
-				return i;
-			}
-		}
-
-		return 0;
+		LoadBlocks();
 	}
 
 	u64 GetSize() const
@@ -244,67 +260,33 @@ public:
 
 	bool Seek(u64 pos)
 	{
-		if(!goto_block(pos / m_hdd_info.block_size))
-		{
+		if(pos > m_info.size)
 			return false;
-		}
 
-		m_position = pos % m_hdd_info.block_size;
+		m_position = pos;
 		return true;
 	}
 
 	void SaveInfo()
 	{
-		m_hdd.Seek(m_info_block * m_hdd_info.block_size);
-		m_hdd.Write(&m_info, sizeof(vfsHDD_Entry));
+		m_hdd.Write(m_info_block, 0, &m_info, sizeof(vfsHDD_Entry));
 	}
 
 	u64 Read(void* dst, u64 size)
 	{
-		if(!size)
+		if(m_position >= m_info.size)
 			return 0;
 
-		//vfsDeviceLocker lock(m_hdd);
-
-		const u32 block_size = m_hdd_info.block_size - sizeof(vfsHDD_Block);
-		u64 rsize = min<u64>(block_size - m_position, size);
-
-		vfsHDD_Block cur_block_info;
-		m_hdd.Seek(m_cur_block * m_hdd_info.block_size);
-		m_hdd.Read(&cur_block_info, sizeof(vfsHDD_Block));
-		m_hdd.Seek(m_cur_block * m_hdd_info.block_size + sizeof(vfsHDD_Block) + m_position);
-		m_hdd.Read(dst, rsize);
-		size -= rsize;
-		m_position += rsize;
-		if(!size)
-		{
-			return rsize;
-		}
-
-		u64 offset = rsize;
-
-		for(; size; size -= rsize, offset += rsize)
-		{
-			if(!cur_block_info.is_used || !cur_block_info.next_block || cur_block_info.next_block >= m_hdd_info.block_count)
-			{
-				return offset;
-			}
-
-			m_cur_block = cur_block_info.next_block;
-			rsize = min<u64>(block_size, size);
-
-			m_hdd.Seek(cur_block_info.next_block * m_hdd_info.block_size);
-			m_hdd.Read(&cur_block_info, sizeof(vfsHDD_Block));
+		size = min<u64>(size, m_info.size - m_position);
 
-			if(m_hdd.Read((u8*)dst + offset, rsize) != rsize)
-			{
-				return offset;
-			}
-		}
-
-		m_position = rsize;
+		const u32 data_size = GetDataSize();
+		const u64 first = m_position / data_size;
+		if(first >= m_blocks.size())
+			return 0;
 
-		return offset;
+		const u64 res = m_hdd.ReadData(&m_blocks[first], m_blocks.size() - first, m_position % data_size, dst, size);
+		m_position += res;
+		return res;
 	}
 
 	u64 Write(const void* src, u64 size)
@@ -312,102 +294,35 @@ public:
 		if(!size)
 			return 0;
 
-		//vfsDeviceLocker lock(m_hdd);
-
-		const u32 block_size = m_hdd_info.block_size - sizeof(vfsHDD_Block);
+		const u32 data_size = GetDataSize();
+		const u64 had_block = m_info.data_block;
 
-		if(!m_cur_block)
+		if(!Reserve(m_position + size))
 		{
-			if(!m_info.data_block)
-			{
-				u64 new_block = FindFreeBlock();
-
-				if(!new_block)
-				{
-					return 0;
-				}
-
-				WriteBlock(new_block, g_used_block);
-				m_info.data_block = new_block;
-				m_info.size = 0;
-				SaveInfo();
-			}
-
-			m_cur_block = m_info.data_block;
-			m_position = 0;
+			// image is full: write as much as fits
+			size = (u64)m_blocks.size() * data_size > m_position ? (u64)m_blocks.size() * data_size - m_position : 0;
 		}
 
-		u64 wsize = min<u64>(block_size - m_position, size);
-
-		vfsHDD_Block block_info;
-		ReadBlock(m_cur_block, block_info);
-
-		if(wsize)
+		u64 res = 0;
+		if(size)
 		{
-			m_hdd.Seek(m_cur_block * m_hdd_info.block_size + sizeof(vfsHDD_Block) + m_position);
-			m_hdd.Write(src, wsize);
-			size -= wsize;
-			m_info.size += wsize;
-			m_position += wsize;
-			SaveInfo();
-
-			if(!size)
-				return wsize;
+			const u64 first = m_position / data_size;
+			res = m_hdd.WriteData(&m_blocks[first], m_blocks.size() - first, m_position % data_size, src, size);
+			m_position += res;
 		}
 
-		u64 last_block = m_cur_block;
-		block_info.is_used = true;
-		u64 offset = wsize;
-
-		for(; size; size -= wsize, offset += wsize, m_info.size += wsize)
+		if(m_position > m_info.size || had_block != m_info.data_block)
 		{
-			u64 new_block = FindFreeBlock();
-
-			if(!new_block)
-			{
-				m_position = 0;
-				SaveInfo();
-				return offset;
-			}
-
-			m_cur_block = new_block;
-			wsize = min<u64>(block_size, size);
-
-			block_info.next_block = m_cur_block;
-			m_hdd.Seek(last_block * m_hdd_info.block_size);
-			if(m_hdd.Write(&block_info, sizeof(vfsHDD_Block)) != sizeof(vfsHDD_Block))
-			{
-				m_position = 0;
-				SaveInfo();
-				return offset;
-			}
-
-			block_info.next_block = 0;
-			m_hdd.Seek(m_cur_block * m_hdd_info.block_size);
-			if(m_hdd.Write(&block_info, sizeof(vfsHDD_Block)) != sizeof(vfsHDD_Block))
-			{
-				m_position = 0;
-				SaveInfo();
-				return offset;
-			}
-			if((m_position = m_hdd.Write((u8*)src + offset, wsize)) != wsize)
-			{
-				m_info.size += wsize;
-				SaveInfo();
-				return offset;
-			}
-
-			last_block = m_cur_block;
+			m_info.size = max<u64>(m_info.size, m_position);
+			SaveInfo();
 		}
 
-		SaveInfo();
-		m_position = wsize;
-		return offset;
+		return res;
 	}
 
 	bool Eof() const
 	{
-		return m_info.size <= (m_cur_block * m_hdd_info.block_size + m_position);
+		return m_position >= m_info.size;
 	}
 };
 
@@ -424,30 +339,28 @@ public:
 
 class vfsHDD : public vfsFileBase
 {
-	vfsHDD_Hdr m_hdd_info;
-	vfsLocalFile m_hdd_file;
-	const std::string& m_hdd_path;
+	std::shared_ptr<vfsHDDImage> m_image;
+	const vfsHDD_Hdr& m_hdd_info;
+	std::string m_hdd_path;
 	vfsHDD_Entry m_cur_dir;
 	u64 m_cur_dir_block;
 	vfsHDDFile m_file;
 
 public:
 	vfsHDD(vfsDevice* device, const std::string& hdd_path)
-		: m_hdd_file(device)
-		, m_file(m_hdd_file, m_hdd_info)
+		: vfsFileBase(device)
+		, m_image(vfsHDDImage::Get(hdd_path))
+		, m_hdd_info(m_image->GetHeader())
 		, m_hdd_path(hdd_path)
-		, vfsFileBase(device)
+		, m_file(*m_image)
 	{
-		m_hdd_file.Open(hdd_path, vfsReadWrite);
-		m_hdd_file.Read(&m_hdd_info, sizeof(vfsHDD_Hdr));
 		m_cur_dir_block = m_hdd_info.next_block;
-		if(!m_hdd_info.block_size)
-		{
-			ConLog.Error("Bad block size!");
-			m_hdd_info.block_size = 2048;
-		}
-		m_hdd_file.Seek(m_cur_dir_block * m_hdd_info.block_size);
-		m_hdd_file.Read(&m_cur_dir, sizeof(vfsHDD_Entry));
+		ReadEntry(m_cur_dir_block, m_cur_dir);
+	}
+
+	~vfsHDD()
+	{
+		m_image->Flush();
 	}
 
 	__forceinline u32 GetMaxNameLen() const
@@ -489,9 +402,8 @@ public:
 		if(!SearchEntry(name, entry_block))
 			return -1;
 
-		m_hdd_file.Seek(entry_block * m_hdd_info.block_size);
 		vfsHDD_Entry entry;
-		m_hdd_file.Read(&entry, sizeof(vfsHDD_Entry));
+		ReadEntry(entry_block, entry);
 		if(entry.type == vfsHDD_Entry_File)
 			return 1;
 
@@ -516,67 +428,42 @@ public:
 		return true;
 	}
 
-	u64 FindFreeBlock()
-	{
-		vfsHDD_Block block_info;
-
-		for(u64 i = 0; i<m_hdd_info.block_count; ++i)
-		{
-			ReadBlock(i, block_info);
-
-			if(!block_info.is_used)
-			{
-				return i;
-			}
-		}
-
-		return 0;
-	}
-
 	void WriteBlock(u64 block, const vfsHDD_Block& data)
 	{
-		m_hdd_file.Seek(block * m_hdd_info.block_size);
-		m_hdd_file.Write(&data, sizeof(vfsHDD_Block));
+		m_image->Write(block, 0, &data, sizeof(vfsHDD_Block));
 	}
 
 	void ReadBlock(u64 block, vfsHDD_Block& data)
 	{
-		m_hdd_file.Seek(block * m_hdd_info.block_size);
-		m_hdd_file.Read(&data, sizeof(vfsHDD_Block));
+		m_image->Read(block, 0, &data, sizeof(vfsHDD_Block));
 	}
 
 	void WriteEntry(u64 block, const vfsHDD_Entry& data)
 	{
-		m_hdd_file.Seek(block * m_hdd_info.block_size);
-		m_hdd_file.Write(&data, sizeof(vfsHDD_Entry));
+		m_image->Write(block, 0, &data, sizeof(vfsHDD_Entry));
 	}
 
 	void ReadEntry(u64 block, vfsHDD_Entry& data)
 	{
-		m_hdd_file.Seek(block * m_hdd_info.block_size);
-		m_hdd_file.Read(&data, sizeof(vfsHDD_Entry));
+		m_image->Read(block, 0, &data, sizeof(vfsHDD_Entry));
 	}
 
 	void ReadEntry(u64 block, vfsHDD_Entry& data, std::string& name)
 	{
-		m_hdd_file.Seek(block * m_hdd_info.block_size);
-		m_hdd_file.Read(&data, sizeof(vfsHDD_Entry));
-		name.resize(GetMaxNameLen());
-		m_hdd_file.Read(&name.front(), GetMaxNameLen());
+		ReadEntry(block, data);
+		ReadEntry(block, name);
 	}
 
 	void ReadEntry(u64 block, std::string& name)
 	{
-		m_hdd_file.Seek(block * m_hdd_info.block_size + sizeof(vfsHDD_Entry));
 		name.resize(GetMaxNameLen());
-		m_hdd_file.Read(&name.front(), GetMaxNameLen());
+		m_image->Read(block, sizeof(vfsHDD_Entry), &name.front(), GetMaxNameLen());
 	}
 
 	void WriteEntry(u64 block, const vfsHDD_Entry& data, const std::string& name)
 	{
-		m_hdd_file.Seek(block * m_hdd_info.block_size);
-		m_hdd_file.Write(&data, sizeof(vfsHDD_Entry));
-		m_hdd_file.Write(name.c_str(), min<size_t>(GetMaxNameLen() - 1, name.length() + 1));
+		WriteEntry(block, data);
+		m_image->Write(block, sizeof(vfsHDD_Entry), name.c_str(), min<size_t>(GetMaxNameLen() - 1, name.length() + 1));
 	}
 
 	bool Create(vfsHDD_EntryType type, const std::string& name)
@@ -586,14 +473,13 @@ public:
 			return false;
 		}
 
-		u64 new_block = FindFreeBlock();
+		u64 new_block = m_image->AllocBlock();
 		if(!new_block)
 		{
 			return false;
 		}
 
 		ConLog.Write("CREATING ENTRY AT 0x%llx", new_block);
-		WriteBlock(new_block, g_used_block);
 
 		{
 			vfsHDD_Entry new_entry;
@@ -603,24 +489,23 @@ public:
 
 			if(type == vfsHDD_Entry_Dir)
 			{
-				u64 block_cur = FindFreeBlock();
+				u64 block_cur = m_image->AllocBlock();
 
 				if(!block_cur)
 				{
+					m_image->FreeBlock(new_block);
 					return false;
 				}
 
-				WriteBlock(block_cur, g_used_block);
-
-				u64 block_last = FindFreeBlock();
+				u64 block_last = m_image->AllocBlock();
 
 				if(!block_last)
 				{
+					m_image->FreeBlock(block_cur);
+					m_image->FreeBlock(new_block);
 					return false;
 				}
 
-				WriteBlock(block_last, g_used_block);
-
 				vfsHDD_Entry entry_cur, entry_last;
 				vfsHDDManager::CreateEntry(entry_cur);
 				vfsHDDManager::CreateEntry(entry_last);
@@ -660,6 +545,7 @@ public:
 			WriteBlock(block, tmp);
 		}
 
+		m_image->Flush();
 		return true;
 	}
 
@@ -768,7 +654,7 @@ public:
 		while(block)
 		{
 			ReadEntry(block, entry, name);
-			WriteBlock(block, g_null_block);
+			m_image->FreeBlock(block);
 
 			if(entry.type == vfsHDD_Entry_Dir && name != "." && name != "..")
 			{
@@ -792,7 +678,7 @@ public:
 		while(block)
 		{
 			ReadBlock(block, block_data);
-			WriteBlock(block, g_null_block);
+			m_image->FreeBlock(block);
 
 			block = block_data.next_block;
 		}
@@ -824,7 +710,8 @@ public:
 			entry.next_block = next;
 			WriteEntry(parent_entry, entry);
 		}
-		WriteBlock(entry_block, g_null_block);
+		m_image->FreeBlock(entry_block);
+		m_image->Flush();
 		return true;
 	}
 
@@ -833,12 +720,18 @@ public:
 		return false;
 	}
 
-	virtual u32 Write(const void* src, u32 size)
+	virtual bool Close() override
+	{
+		m_image->Flush();
+		return vfsFileBase::Close();
+	}
+
+	virtual u64 Write(const void* src, u64 size) override
 	{
 		return vfsFileBase::Write(src, m_file.Write(src, size));
 	}
 
-	virtual u32 Read(void* dst, u32 size)
+	virtual u64 Read(void* dst, u64 size) override
 	{
 		return vfsFileBase::Read(dst, m_file.Read(dst, size));
 	}
@@ -437,27 +437,37 @@ bool NullMemoryBlock::Write128(const u64 addr, const u128 value)
 //MemoryBase
 void MemoryBase::Write8(u64 addr, const u8 data)
 {
+	Emu.GetBreakPoints().CheckWrite(addr, 1, data);
 	GetMemByAddr(addr).Write8(addr, data);
+	g_parking_lot.NotifyWrite(addr, 1);
 }
 
 void MemoryBase::Write16(u64 addr, const u16 data)
 {
+	Emu.GetBreakPoints().CheckWrite(addr, 2, data);
 	GetMemByAddr(addr).Write16(addr, data);
+	g_parking_lot.NotifyWrite(addr, 2);
 }
 
 void MemoryBase::Write32(u64 addr, const u32 data)
 {
+	Emu.GetBreakPoints().CheckWrite(addr, 4, data);
 	GetMemByAddr(addr).Write32(addr, data);
+	g_parking_lot.NotifyWrite(addr, 4);
 }
 
 void MemoryBase::Write64(u64 addr, const u64 data)
 {
+	Emu.GetBreakPoints().CheckWrite(addr, 8, data);
 	GetMemByAddr(addr).Write64(addr, data);
+	g_parking_lot.NotifyWrite(addr, 8);
 }
 
 void MemoryBase::Write128(u64 addr, const u128 data)
 {
+	Emu.GetBreakPoints().CheckWrite(addr, 16, data.lo);
 	GetMemByAddr(addr).Write128(addr, data);
+	g_parking_lot.NotifyWrite(addr, 16);
 }
 
 bool MemoryBase::Write8NN(u64 addr, const u8 data)
@@ -498,6 +508,7 @@ bool MemoryBase::Write128NN(u64 addr, const u128 data)
 u8 MemoryBase::Read8(u64 addr)
 {
 	u8 res;
+	Emu.GetBreakPoints().CheckRead(addr, 1);
 	GetMemByAddr(addr).Read8(addr, &res);
 	return res;
 }
@@ -505,6 +516,7 @@ u8 MemoryBase::Read8(u64 addr)
 u16 MemoryBase::Read16(u64 addr)
 {
 	u16 res;
+	Emu.GetBreakPoints().CheckRead(addr, 2);
 	GetMemByAddr(addr).Read16(addr, &res);
 	return res;
 }
@@ -512,6 +524,7 @@ u16 MemoryBase::Read16(u64 addr)
 u32 MemoryBase::Read32(u64 addr)
 {
 	u32 res;
+	Emu.GetBreakPoints().CheckRead(addr, 4);
 	GetMemByAddr(addr).Read32(addr, &res);
 	return res;
 }
@@ -519,6 +532,7 @@ u32 MemoryBase::Read32(u64 addr)
 u64 MemoryBase::Read64(u64 addr)
 {
 	u64 res;
+	Emu.GetBreakPoints().CheckRead(addr, 8);
 	GetMemByAddr(addr).Read64(addr, &res);
 	return res;
 }
@@ -526,6 +540,7 @@ u64 MemoryBase::Read64(u64 addr)
 u128 MemoryBase::Read128(u64 addr)
 {
 	u128 res;
+	Emu.GetBreakPoints().CheckRead(addr, 16);
 	GetMemByAddr(addr).Read128(addr, &res);
 	return res;
 }
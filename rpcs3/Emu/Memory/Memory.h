@@ -1,5 +1,6 @@
 #pragma once
 #include "MemoryBlock.h"
+#include "Emu/CPU/SpinWait.h"
 #include <vector>
 
 using std::nullptr_t;
@@ -280,6 +281,7 @@ public:
 		if (!count) return true;
 
 		u8* from = (u8*)real;
+		const u32 to0 = to, count0 = count;
 
 		if (u32 frag = to & 4095)
 		{
@@ -307,6 +309,7 @@ public:
 			memcpy(GetMemFromAddr(to), from, count);
 		}
 
+		g_parking_lot.NotifyWrite(to0, count0);
 		return true;
 
 	}
@@ -689,6 +692,7 @@ public:
 	mem_t& operator = (T right)
 	{
 		(be_t<T>&)Memory[this->m_addr] = right;
+		g_parking_lot.NotifyWrite(this->m_addr, sizeof(T));
 
 		return *this;
 	}
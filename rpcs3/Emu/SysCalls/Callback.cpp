@@ -2,6 +2,8 @@
 #include "Callback.h"
 
 #include "Emu/Cell/PPCThread.h"
+#include "Emu/Cell/PPUInstrTable.h"
+#include "Emu/SysCalls/SysCalls.h"
 
 Callback::Callback(u32 slot, u64 addr)
 	: m_addr(addr)
@@ -53,92 +55,248 @@ void Callback::Branch(bool wait)
 {
 	m_has_data = false;
 
-	static std::mutex cb_mutex;
+	Emu.GetCallbackExecutor().Call(m_addr, a1, a2, a3, a4, wait, m_name);
+}
 
-	CPUThread& thr = Emu.GetCallbackThread();
+void Callback::SetName(const std::string& name)
+{
+	m_name = name;
+}
 
-again:
+Callback::operator bool() const
+{
+	return GetAddr() != 0;
+}
 
-	while (thr.IsAlive())
-	{
-		if (Emu.IsStopped())
-		{
-			ConLog.Warning("Callback::Branch() aborted");
-			return;
-		}
-		Sleep(1);
-	}
+Callback2::Callback2(u32 slot, u64 addr, u64 userdata) : Callback(slot, addr)
+{
+	a2 = userdata;
+}
+
+void Callback2::Handle(u64 status)
+{
+	Callback::Handle(status, a2, 0);
+}
+
+Callback3::Callback3(u32 slot, u64 addr, u64 userdata) : Callback(slot, addr)
+{
+	a3 = userdata;
+}
 
-	std::lock_guard<std::mutex> lock(cb_mutex);
+void Callback3::Handle(u64 status, u64 param)
+{
+	Callback::Handle(status, param, a3);
+}
 
-	if (thr.IsAlive())
+CallbackExecutor::CallbackExecutor()
+	: m_busy(0)
+	, m_closed(true)
+	, m_loop(0)
+	, m_return(0)
+{
+	for(u32 i = 0; i < thread_count; i++)
 	{
-		goto again;
+		m_workers[i].thread = nullptr;
 	}
-	if (Emu.IsStopped())
+}
+
+void CallbackExecutor::Init()
+{
+	using namespace PPU_instr;
+
+	// function descriptor, loop of the threads, return address of FastCall
+	const u32 addr = Memory.MainMem.AllocAlign(4 * 8);
+
+	m_loop = addr;
+	Memory.Write32(m_loop, addr + 8);
+	Memory.Write32(m_loop + 4, 0);
+
+	mem32_ptr_t loop_data(addr + 8);
+	loop_data += ADDI(11, 0, 1022);
+	loop_data += SC(2);
+	loop_data += BCCTR(0x10 | 0x04, 0, 0, 0); // returns to the loop (LR)
+
+	// never executed: FastCall stops when the callback returns here
+	m_return = addr + 20;
+	mem32_ptr_t return_data(m_return);
+	return_data += ADDI(11, 0, 41);
+	return_data += SC(2);
+
+	// the threads are registered after Run(): it checks the status of the emulator, which
+	// ignores them
+	CPUThread* threads[thread_count];
+
+	for(u32 i = 0; i < thread_count; i++)
 	{
-		ConLog.Warning("Callback::Branch() aborted");
-		return;
+		CPUThread& thr = Emu.GetCPU().AddThread(CPU_THREAD_PPU);
+		thr.SetName(fmt::Format("Callback Thread %d", i));
+		thr.SetEntry(m_loop);
+		thr.SetPrio(1001);
+		thr.SetStackSize(0x10000);
+		thr.Run();
+
+		threads[i] = &thr;
 	}
 
-	thr.Stop();
-	thr.Reset();
+	std::lock_guard<std::mutex> lock(m_mutex);
 
-	thr.SetEntry(m_addr);
-	thr.SetPrio(1001);
-	thr.SetStackSize(0x10000);
-	thr.SetName(m_name);
+	for(u32 i = 0; i < thread_count; i++)
+	{
+		m_workers[i].thread = threads[i];
+	}
 
-	thr.SetArg(0, a1);
-	thr.SetArg(1, a2);
-	thr.SetArg(2, a3);
-	thr.SetArg(3, a4);
-	thr.Run();
+	m_closed = false;
+	m_busy = 0;
+}
 
-	thr.Exec();
+void CallbackExecutor::Close()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
 
-	if (!wait)
+	for(u32 i = 0; i < thread_count; i++)
 	{
-		return;
+		m_workers[i].thread = nullptr;
+		m_workers[i].queue.clear();
+		m_workers[i].current.reset();
 	}
 
-	while (thr.IsAlive())
+	m_busy = 0;
+	m_closed = true;
+	m_queue_cond.notify_all();
+	m_done_cond.notify_all();
+}
+
+CallbackExecutor::Worker* CallbackExecutor::FindWorker(const CPUThread& thread)
+{
+	for(u32 i = 0; i < thread_count; i++)
 	{
-		if (Emu.IsStopped())
-		{
-			ConLog.Warning("Callback::Branch(true) aborted (end)");
-			return;
-		}
-		Sleep(1);
+		if(m_workers[i].thread == &thread) return &m_workers[i];
 	}
+
+	return nullptr;
 }
 
-void Callback::SetName(const std::string& name)
+bool CallbackExecutor::IsExecutorThread(const CPUThread& thread)
 {
-	m_name = name;
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return FindWorker(thread) != nullptr;
 }
 
-Callback::operator bool() const
+void CallbackExecutor::Complete(CallData& call, const u64 result)
 {
-	return GetAddr() != 0;
+	call.result = result;
+	call.done = true;
+	m_busy--;
+	m_done_cond.notify_all();
 }
 
-Callback2::Callback2(u32 slot, u64 addr, u64 userdata) : Callback(slot, addr)
+u64 CallbackExecutor::Call(const u64 addr, const u64 a1, const u64 a2, const u64 a3, const u64 a4, const bool wait, const std::string& name)
 {
-	a2 = userdata;
+	if(Emu.IsStopped())
+	{
+		ConLog.Warning("%s aborted (emulator stopped)", name.c_str());
+		return 0;
+	}
+
+	CPUThread* thr = GetCurrentCPUThread();
+
+	if(wait && thr && thr->GetType() == CPU_THREAD_PPU)
+	{
+		PPUThread& ppu = *(PPUThread*)thr;
+
+		if(ppu.GPR[1] >= ppu.GetStackAddr() + fast_call_min_stack + fast_call_frame)
+		{
+			return ppu.FastCall(addr, a1, a2, a3, a4);
+		}
+	}
+
+	std::shared_ptr<CallData> call(new CallData);
+	call->addr = addr;
+	call->args[0] = a1;
+	call->args[1] = a2;
+	call->args[2] = a3;
+	call->args[3] = a4;
+	call->name = name;
+	call->done = false;
+	call->result = 0;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	Worker& worker = m_workers[(addr >> 2) % thread_count];
+
+	if(m_closed || !worker.thread)
+	{
+		ConLog.Error("%s(addr=0x%llx): no callback thread", name.c_str(), addr);
+		return 0;
+	}
+
+	worker.queue.push_back(call);
+	m_busy++;
+	m_queue_cond.notify_all();
+
+	if(!wait) return 0;
+
+	m_done_cond.wait(lock, [&]() { return call->done || m_closed; });
+
+	if(!call->done)
+	{
+		ConLog.Warning("%s aborted (emulator stopped)", name.c_str());
+		return 0;
+	}
+
+	return call->result;
 }
 
-void Callback2::Handle(u64 status)
+void CallbackExecutor::WaitIdle()
 {
-	Callback::Handle(status, a2, 0);
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// a callback waiting for the others doesn't wait for itself
+	CPUThread* thr = GetCurrentCPUThread();
+	const u32 self = thr && FindWorker(*thr) ? 1 : 0;
+
+	m_done_cond.wait(lock, [&]() { return m_busy <= self || m_closed; });
 }
 
-Callback3::Callback3(u32 slot, u64 addr, u64 userdata) : Callback(slot, addr)
+void CallbackExecutor::Next(PPUThread& CPU)
 {
-	a3 = userdata;
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	Worker* worker = FindWorker(CPU);
+
+	if(!worker)
+	{
+		ConLog.Error("CallbackExecutor::Next(): %s isn't a callback thread", CPU.GetFName().c_str());
+		return;
+	}
+
+	if(worker->current)
+	{
+		Complete(*worker->current, CPU.GPR[3]);
+		worker->current.reset();
+	}
+
+	m_queue_cond.wait(lock, [&]() { return worker->queue.size() || m_closed; });
+
+	// closed: the thread stops after the syscall
+	if(m_closed) return;
+
+	std::shared_ptr<CallData> call = worker->queue.front();
+	worker->queue.pop_front();
+	worker->current = call;
+
+	CPU.SetName(call->name);
+	CPU.GPR[2] = Memory.Read32(call->addr + 4);
+	CPU.GPR[3] = call->args[0];
+	CPU.GPR[4] = call->args[1];
+	CPU.GPR[5] = call->args[2];
+	CPU.GPR[6] = call->args[3];
+	CPU.CTR = Memory.Read32(call->addr);
+	CPU.LR = m_loop + 8;
 }
 
-void Callback3::Handle(u64 status, u64 param)
+void sys_callback_next()
 {
-	Callback::Handle(status, param, a3);
+	Emu.GetCallbackExecutor().Next(GetCurrentPPUThread());
 }
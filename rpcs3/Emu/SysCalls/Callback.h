@@ -1,4 +1,8 @@
 #pragma once
+#include <deque>
+
+class CPUThread;
+class PPUThread;
 
 class Callback
 {
@@ -30,6 +34,71 @@ public:
 	operator bool() const;
 };
 
+// Runs the guest callbacks (function descriptor addresses) called by the emulator.
+// A callback waited for by a PPU thread runs on that thread, inside the syscall which called it
+// (PPUThread::FastCall). The others are queued to a few PPU threads created at load: they wait in
+// a syscall for the next call (a loop of guest code: sc, bcctr), so a call doesn't reset or start
+// a thread. The calls of a function always go to the same thread, in order.
+class CallbackExecutor
+{
+public:
+	static const u32 thread_count = 4;
+	// the stack frame of a callback run by FastCall, below the stack of the interrupted code
+	static const u32 fast_call_frame = 0x300;
+	// a PPU thread with less free stack queues the callback
+	static const u32 fast_call_min_stack = 0x4000;
+
+	struct CallData
+	{
+		u64 addr;
+		u64 args[4];
+		std::string name;
+		bool done;
+		u64 result;
+	};
+
+private:
+	struct Worker
+	{
+		CPUThread* thread;
+		std::deque<std::shared_ptr<CallData>> queue;
+		std::shared_ptr<CallData> current;
+	};
+
+	std::mutex m_mutex;
+	std::condition_variable m_queue_cond; // a call was queued or the executor closed
+	std::condition_variable m_done_cond;  // a call was completed or the executor closed
+	Worker m_workers[thread_count];
+	u32 m_busy;   // calls queued or running
+	bool m_closed;
+	u32 m_loop;   // function descriptor of the guest loop of the threads
+	u32 m_return; // return address of the callbacks run by FastCall
+
+	Worker* FindWorker(const CPUThread& thread);
+	void Complete(CallData& call, const u64 result);
+
+public:
+	CallbackExecutor();
+
+	// creates the threads (PPU executables, Emulator::Load)
+	void Init();
+	// releases the threads and the waiters (Emulator::Stop)
+	void Close();
+
+	// runs the callback, waits for its result if wait is set (0 if not waited or aborted)
+	u64 Call(const u64 addr, const u64 a1, const u64 a2, const u64 a3, const u64 a4, const bool wait, const std::string& name);
+	// blocks until no callback is queued or running (but the one of the calling thread)
+	void WaitIdle();
+
+	// the threads of the executor wait for calls: they don't keep the emulator running
+	bool IsExecutorThread(const CPUThread& thread);
+
+	// syscall of the executor threads: completes the current call, waits for the next one
+	void Next(PPUThread& CPU);
+
+	u32 GetReturnAddr() const { return m_return; }
+};
+
 struct Callback2 : public Callback
 {
 	Callback2(u32 slot, u64 addr, u64 userdata);
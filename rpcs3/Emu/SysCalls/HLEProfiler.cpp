@@ -0,0 +1,269 @@
+#include "stdafx.h"
+#include "Emu/SysCalls/SysCalls.h"
+#include "HLEProfiler.h"
+#include <algorithm>
+#include <fstream>
+
+HLEProfiler g_hle_profiler;
+
+struct HLEThreadStats
+{
+	// the lock is only contended while the counters are collected
+	std::mutex m_mutex;
+	std::unordered_map<u64, HLECallStats> m_calls;
+};
+
+#ifdef _WIN32
+__declspec(thread)
+#else
+thread_local
+#endif
+HLEThreadStats* g_tls_hle_stats = nullptr;
+
+static u64 hleCallKey(HLECallKind kind, u32 id)
+{
+	return (u64)kind << 32 | id;
+}
+
+void HLECallStats::Add(u64 time)
+{
+	count++;
+	total += time;
+	if (time > max) max = time;
+
+	u32 bucket = 0;
+	while (bucket + 1 < hle_hist_buckets && (time >> (bucket + 1)))
+	{
+		bucket++;
+	}
+	hist[bucket]++;
+}
+
+void HLECallStats::Merge(const HLECallStats& other)
+{
+	count += other.count;
+	total += other.total;
+	if (other.max > max) max = other.max;
+
+	for (u32 i = 0; i < hle_hist_buckets; i++)
+	{
+		hist[i] += other.hist[i];
+	}
+}
+
+u64 HLECallStats::Percentile(double fraction) const
+{
+	const u64 target = (u64)(count * fraction);
+	u64 seen = 0;
+
+	for (u32 i = 0; i < hle_hist_buckets; i++)
+	{
+		seen += hist[i];
+		if (seen > target || seen == count)
+		{
+			return std::min<u64>(2ull << i, max);
+		}
+	}
+
+	return max;
+}
+
+HLEProfiler::HLEProfiler()
+	: m_enabled(false)
+{
+}
+
+HLEProfiler::~HLEProfiler()
+{
+	for (u32 i = 0; i < m_threads.size(); i++)
+	{
+		delete m_threads[i];
+	}
+}
+
+void HLEProfiler::Enable(bool enable)
+{
+	m_enabled = enable;
+}
+
+HLEThreadStats& HLEProfiler::GetThreadStats()
+{
+	if (!g_tls_hle_stats)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		g_tls_hle_stats = new HLEThreadStats;
+		m_threads.push_back(g_tls_hle_stats);
+	}
+
+	return *g_tls_hle_stats;
+}
+
+void HLEProfiler::Record(HLECallKind kind, u32 id, u64 time)
+{
+	HLEThreadStats& stats = GetThreadStats();
+
+	std::lock_guard<std::mutex> lock(stats.m_mutex);
+	stats.m_calls[hleCallKey(kind, id)].Add(time);
+}
+
+void HLEProfiler::ReleaseThread()
+{
+	HLEThreadStats* stats = g_tls_hle_stats;
+	if (!stats)
+	{
+		return;
+	}
+
+	g_tls_hle_stats = nullptr;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (auto& it : stats->m_calls)
+	{
+		m_retired[it.first].Merge(it.second);
+	}
+
+	m_threads.erase(std::find(m_threads.begin(), m_threads.end(), stats));
+	delete stats;
+}
+
+void HLEProfiler::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_retired.clear();
+	for (u32 i = 0; i < m_threads.size(); i++)
+	{
+		std::lock_guard<std::mutex> lock_thread(m_threads[i]->m_mutex);
+		m_threads[i]->m_calls.clear();
+	}
+}
+
+std::vector<HLECallEntry> HLEProfiler::Collect()
+{
+	std::unordered_map<u64, HLECallStats> merged;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		merged = m_retired;
+		for (u32 i = 0; i < m_threads.size(); i++)
+		{
+			std::lock_guard<std::mutex> lock_thread(m_threads[i]->m_mutex);
+
+			for (auto& it : m_threads[i]->m_calls)
+			{
+				merged[it.first].Merge(it.second);
+			}
+		}
+	}
+
+	std::vector<HLECallEntry> res;
+	res.reserve(merged.size());
+
+	for (auto& it : merged)
+	{
+		HLECallEntry entry;
+		entry.kind = (HLECallKind)(it.first >> 32);
+		entry.id = (u32)it.first;
+		entry.stats = it.second;
+
+		if (entry.kind == HLE_CALL_SYSCALL)
+		{
+			entry.name = fmt::Format("syscall %d", entry.id);
+		}
+		else
+		{
+			Module* module = GetModuleByFuncId(entry.id);
+			entry.name = fmt::Format("%s::0x%08x", module ? module->GetName().c_str() : "unknown", entry.id);
+		}
+
+		res.push_back(entry);
+	}
+
+	std::sort(res.begin(), res.end(), [](const HLECallEntry& a, const HLECallEntry& b)
+	{
+		return a.stats.total > b.stats.total;
+	});
+
+	return res;
+}
+
+// ticks of 100 ns to microseconds
+static double hleTicksToUs(u64 ticks)
+{
+	return ticks / 10.0;
+}
+
+bool HLEProfiler::ExportJSON(const std::string& path)
+{
+	std::ofstream out(path);
+	if (!out)
+	{
+		ConLog.Error("HLEProfiler: can't create '%s'", path.c_str());
+		return false;
+	}
+
+	const std::vector<HLECallEntry> entries = Collect();
+
+	out << "{\n\t\"unit\": \"us\",\n\t\"histogram_base_us\": 0.1,\n\t\"calls\": [\n";
+
+	for (u32 i = 0; i < entries.size(); i++)
+	{
+		const HLECallEntry& e = entries[i];
+		const HLECallStats& s = e.stats;
+
+		out << fmt::Format("\t\t{\"kind\": \"%s\", \"id\": %u, \"name\": \"%s\", \"count\": %llu, \"total\": %.1f, \"avg\": %.3f, \"max\": %.1f, \"p50\": %.1f, \"p99\": %.1f, \"histogram\": [",
+			e.kind == HLE_CALL_SYSCALL ? "syscall" : "func", e.id, e.name.c_str(), s.count,
+			hleTicksToUs(s.total), hleTicksToUs(s.total) / std::max<u64>(s.count, 1), hleTicksToUs(s.max),
+			hleTicksToUs(s.Percentile(0.5)), hleTicksToUs(s.Percentile(0.99)));
+
+		for (u32 j = 0; j < hle_hist_buckets; j++)
+		{
+			out << (j ? ", " : "") << s.hist[j];
+		}
+
+		out << (i + 1 < entries.size() ? "]},\n" : "]}\n");
+	}
+
+	out << "\t]\n}\n";
+	return true;
+}
+
+bool HLEProfiler::ExportCSV(const std::string& path)
+{
+	std::ofstream out(path);
+	if (!out)
+	{
+		ConLog.Error("HLEProfiler: can't create '%s'", path.c_str());
+		return false;
+	}
+
+	const std::vector<HLECallEntry> entries = Collect();
+
+	out << "kind,id,name,count,total_us,avg_us,max_us,p50_us,p99_us";
+	for (u32 j = 0; j < hle_hist_buckets; j++)
+	{
+		out << ",hist" << j;
+	}
+	out << "\n";
+
+	for (u32 i = 0; i < entries.size(); i++)
+	{
+		const HLECallEntry& e = entries[i];
+		const HLECallStats& s = e.stats;
+
+		out << fmt::Format("%s,0x%x,%s,%llu,%.1f,%.3f,%.1f,%.1f,%.1f",
+			e.kind == HLE_CALL_SYSCALL ? "syscall" : "func", e.id, e.name.c_str(), s.count,
+			hleTicksToUs(s.total), hleTicksToUs(s.total) / std::max<u64>(s.count, 1), hleTicksToUs(s.max),
+			hleTicksToUs(s.Percentile(0.5)), hleTicksToUs(s.Percentile(0.99)));
+
+		for (u32 j = 0; j < hle_hist_buckets; j++)
+		{
+			out << "," << s.hist[j];
+		}
+		out << "\n";
+	}
+
+	return true;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <unordered_map>
+
+extern u64 get_time();
+
+// Per-function timing of HLE calls: lv2 syscalls (by number) and module functions (by NID).
+// Always compiled in, disabled by default: while disabled, a call only tests one flag.
+// Every thread records into its own counters; they are merged when the results are read
+// (debugger panel, JSON/CSV export), so recording never contends with other threads.
+
+enum HLECallKind : u8
+{
+	HLE_CALL_SYSCALL,
+	HLE_CALL_FUNC,
+};
+
+// bucket i counts calls that took [2^i, 2^(i+1)) ticks of 100 ns, the last bucket is open-ended
+static const u32 hle_hist_buckets = 24;
+
+struct HLECallStats
+{
+	u64 count;
+	u64 total; // in 100 ns ticks (get_time())
+	u64 max;
+	u64 hist[hle_hist_buckets];
+
+	HLECallStats()
+	{
+		memset(this, 0, sizeof(*this));
+	}
+
+	void Add(u64 time);
+	void Merge(const HLECallStats& other);
+
+	// upper bound of the histogram bucket containing the given fraction of calls, in ticks
+	u64 Percentile(double fraction) const;
+};
+
+struct HLECallEntry
+{
+	HLECallKind kind;
+	u32 id;
+	std::string name;
+	HLECallStats stats;
+};
+
+struct HLEThreadStats;
+
+class HLEProfiler
+{
+	std::atomic<bool> m_enabled;
+	std::mutex m_mutex; // thread registry and m_retired
+	std::vector<HLEThreadStats*> m_threads;
+	std::unordered_map<u64, HLECallStats> m_retired; // counters of exited threads
+
+	HLEThreadStats& GetThreadStats();
+
+public:
+	HLEProfiler();
+	~HLEProfiler();
+
+	bool IsEnabled() const
+	{
+		return m_enabled.load(std::memory_order_relaxed);
+	}
+
+	void Enable(bool enable);
+	void Record(HLECallKind kind, u32 id, u64 time);
+
+	// called by exiting threads: their counters are folded into the totals
+	void ReleaseThread();
+	void Reset();
+
+	// merged counters of all threads, most expensive (total time) first
+	std::vector<HLECallEntry> Collect();
+
+	bool ExportJSON(const std::string& path);
+	bool ExportCSV(const std::string& path);
+};
+
+extern HLEProfiler g_hle_profiler;
+
+// times the enclosing scope if the profiler is enabled when it is entered
+class HLECallTimer
+{
+	const HLECallKind m_kind;
+	const u32 m_id;
+	const bool m_enabled;
+	u64 m_start;
+
+public:
+	HLECallTimer(HLECallKind kind, u32 id)
+		: m_kind(kind)
+		, m_id(id)
+		, m_enabled(g_hle_profiler.IsEnabled())
+	{
+		if (m_enabled)
+		{
+			m_start = get_time();
+		}
+	}
+
+	~HLECallTimer()
+	{
+		if (m_enabled)
+		{
+			g_hle_profiler.Record(m_kind, m_id, get_time() - m_start);
+		}
+	}
+};
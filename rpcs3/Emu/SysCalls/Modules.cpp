@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "SysCalls.h"
 #include "SC_FUNC.h"
+#include "HLEProfiler.h"
 #include <mutex>
 
 
@@ -186,6 +187,7 @@ bool CallFunc(u32 num)
 	}
 	if (func)
 	{
+		HLECallTimer timer(HLE_CALL_FUNC, num);
 		(*func)();
 		return true;
 	}
@@ -272,6 +274,28 @@ Module* GetModuleById(u16 id)
 	return nullptr;
 }
 
+Module* GetModuleByFuncId(u32 id)
+{
+	for(u32 i=0; i<3; ++i)
+	{
+		for(u32 j=0; j<g_max_module_id; ++j)
+		{
+			Module* module = g_modules[i][j];
+			if(!module) continue;
+
+			for(u32 k=0; k<module->m_funcs_list.size(); ++k)
+			{
+				if(module->m_funcs_list[k]->id == id)
+				{
+					return module;
+				}
+			}
+		}
+	}
+
+	return nullptr;
+}
+
 void SetModule(int id, Module* module, bool with_data)
 {
 	if(id != 0xffff)
@@ -322,6 +346,7 @@ void SetModule(int id, Module* module, bool with_data)
 Module::Module(u16 id, const char* name)
 	: m_is_loaded(false)
 	, m_name(name)
+	, m_id_type(IdManager::GetTypeTag(name))
 	, m_id(id)
 	, m_load_func(nullptr)
 	, m_unload_func(nullptr)
@@ -332,6 +357,7 @@ Module::Module(u16 id, const char* name)
 Module::Module(const char* name, void (*init)(), void (*load)(), void (*unload)())
 	: m_is_loaded(false)
 	, m_name(name)
+	, m_id_type(IdManager::GetTypeTag(name))
 	, m_id(-1)
 	, m_load_func(load)
 	, m_unload_func(unload)
@@ -342,6 +368,7 @@ Module::Module(const char* name, void (*init)(), void (*load)(), void (*unload)(
 
 Module::Module(u16 id, void (*init)(), void (*load)(), void (*unload)())
 	: m_is_loaded(false)
+	, m_id_type(IdManager::GetTypeTag(""))
 	, m_id(id)
 	, m_load_func(load)
 	, m_unload_func(unload)
@@ -433,7 +460,7 @@ u16 Module::GetID() const
 	return m_id;
 }
 
-std::string Module::GetName() const
+const std::string& Module::GetName() const
 {
 	return m_name;
 }
@@ -441,69 +468,11 @@ std::string Module::GetName() const
 void Module::SetName(const std::string& name)
 {
 	m_name = name;
-}
-
-void Module::Log(const u32 id, std::string fmt, ...)
-{
-	if(Ini.HLELogging.GetValue())
-	{
-		va_list list;
-		va_start(list, fmt);
-		ConLog.Write(GetName() + fmt::Format("[%d]: ", id) + fmt::FormatV(fmt, list));
-		va_end(list);
-	}
-}
-
-void Module::Log(std::string fmt, ...)
-{
-	if(Ini.HLELogging.GetValue())
-	{
-		va_list list;
-		va_start(list, fmt);
-		ConLog.Write(GetName() + ": " + fmt::FormatV(fmt, list));
-		va_end(list);
-	}
-}
-
-void Module::Warning(const u32 id, std::string fmt, ...)
-{
-	va_list list;
-	va_start(list, fmt);
-	ConLog.Warning(GetName() + fmt::Format("[%d] warning: ", id) + fmt::FormatV(fmt, list));
-	va_end(list);
-}
-
-void Module::Warning(std::string fmt, ...)
-{
-	va_list list;
-	va_start(list, fmt);
-	ConLog.Warning(GetName() + " warning: " + fmt::FormatV(fmt, list));
-	va_end(list);
-}
-
-void Module::Error(const u32 id, std::string fmt, ...)
-{
-	va_list list;
-	va_start(list, fmt);
-	ConLog.Error(GetName() + fmt::Format("[%d] error: ", id) + fmt::FormatV(fmt, list));
-	va_end(list);
-}
-
-void Module::Error(std::string fmt, ...)
-{
-	va_list list;
-	va_start(list, fmt);
-	ConLog.Error(GetName() + " error: " + fmt::FormatV(fmt, list));
-	va_end(list);
+	m_id_type = IdManager::GetTypeTag(name);
 }
 
 bool Module::CheckID(u32 id) const
 {
-	return Emu.GetIdManager().CheckID(id) && Emu.GetIdManager().GetID(id).m_name == GetName();
-}
-
-bool Module::CheckID(u32 id, ID*& _id) const
-{
-	return Emu.GetIdManager().CheckID(id) && (_id = &Emu.GetIdManager().GetID(id))->m_name == GetName();
+	return Emu.GetIdManager().CheckID(id, m_id_type);
 }
 
@@ -47,6 +47,7 @@ extern std::vector<SFunc *> g_static_funcs_list;
 class Module
 {
 	std::string m_name;
+	u32 m_id_type; // type tag of the IDs created by GetNewId
 	const u16 m_id;
 	bool m_is_loaded;
 	void (*m_load_func)();
@@ -70,44 +71,62 @@ public:
 	bool IsLoaded() const;
 
 	u16 GetID() const;
-	std::string GetName() const;
+	const std::string& GetName() const;
 	void SetName(const std::string& name);
 
 public:
-	//TODO: use variadic function templates here to be able to use string references and forward all arguments without copying
-	void Log(const u32 id, std::string fmt, ...);
-	void Log(std::string fmt, ...);
+	template<typename F, typename... Arg> void Log(const u32 id, F&& fmt, Arg&&... args)
+	{
+		if(2 >= CONLOG_MIN_LEVEL && Ini.HLELogging.GetValue())
+		{
+			ConLog.ModuleLog(2, GetName(), id, ": ", std::forward<F>(fmt), std::forward<Arg>(args)...);
+		}
+	}
 
-	void Warning(const u32 id, std::string fmt, ...);
-	void Warning(std::string fmt, ...);
+	template<typename F, typename... Arg> typename std::enable_if<LogFormatArg<F>::value>::type Log(F&& fmt, Arg&&... args)
+	{
+		if(2 >= CONLOG_MIN_LEVEL && Ini.HLELogging.GetValue())
+		{
+			ConLog.ModuleLog(2, GetName(), -1, ": ", std::forward<F>(fmt), std::forward<Arg>(args)...);
+		}
+	}
 
-	void Error(const u32 id, std::string fmt, ...);
-	void Error(std::string fmt, ...);
+	template<typename F, typename... Arg> void Warning(const u32 id, F&& fmt, Arg&&... args)
+	{
+		ConLog.ModuleLog(3, GetName(), id, " warning: ", std::forward<F>(fmt), std::forward<Arg>(args)...);
+	}
 
-	bool CheckID(u32 id) const;
-	template<typename T> bool CheckId(u32 id, T*& data)
+	template<typename F, typename... Arg> typename std::enable_if<LogFormatArg<F>::value>::type Warning(F&& fmt, Arg&&... args)
 	{
-		ID* id_data;
+		ConLog.ModuleLog(3, GetName(), -1, " warning: ", std::forward<F>(fmt), std::forward<Arg>(args)...);
+	}
 
-		if(!CheckID(id, id_data)) return false;
+	template<typename F, typename... Arg> void Error(const u32 id, F&& fmt, Arg&&... args)
+	{
+		ConLog.ModuleLog(4, GetName(), id, " error: ", std::forward<F>(fmt), std::forward<Arg>(args)...);
+	}
 
-		data = id_data->m_data->get<T>();
+	template<typename F, typename... Arg> typename std::enable_if<LogFormatArg<F>::value>::type Error(F&& fmt, Arg&&... args)
+	{
+		ConLog.ModuleLog(4, GetName(), -1, " error: ", std::forward<F>(fmt), std::forward<Arg>(args)...);
+	}
 
-		return true;
+	bool CheckID(u32 id) const;
+	template<typename T> bool CheckId(u32 id, T*& data)
+	{
+		return Emu.GetIdManager().GetIDData(id, data, m_id_type);
 	}
 
 	template<typename T> bool CheckId(u32 id, T*& data, u32& attr)
 	{
-		ID* id_data;
-
-		if(!CheckID(id, id_data)) return false;
-
-		data = id_data->m_data->get<T>();
-		attr = id_data->m_attr;
+		return Emu.GetIdManager().GetIDData(id, data, m_id_type) && Emu.GetIdManager().GetIDAttr(id, attr, m_id_type);
+	}
 
-		return true;
+	// keeps the object alive while the reference exists
+	template<typename T> IDRef<T> GetRef(u32 id)
+	{
+		return IDRef<T>(Emu.GetIdManager(), id, m_id_type);
 	}
-	bool CheckID(u32 id, ID*& _id) const;
 
 	template<typename T>
 	u32 GetNewId(T* data, u8 flags = 0)
@@ -161,4 +180,5 @@ void UnloadModules();
 u32 GetFuncNumById(u32 id);
 Module* GetModuleByName(const std::string& name);
 Module* GetModuleById(u16 id);
+Module* GetModuleByFuncId(u32 id);
 
@@ -0,0 +1,344 @@
+#include "stdafx.h"
+#include "Emu/SysCalls/SysCalls.h"
+#include "ImageDecoder.h"
+#include "stblib/stb_image.h"
+
+DecodedImage::~DecodedImage()
+{
+	if (pixels)
+	{
+		stbi_image_free(pixels);
+	}
+}
+
+std::shared_ptr<const DecodedImage> ImageDecodeJob::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (!WaitWhileRunning(m_cond, lock, [this]() { return m_done; }))
+	{
+		return nullptr;
+	}
+
+	return m_image;
+}
+
+class ImageDecoderPool
+{
+	static const u32 max_workers = 4;
+	static const u64 max_cached_bytes = 64 * 1024 * 1024; // decoded pixels + compressed streams
+
+	std::mutex m_mutex;
+	std::condition_variable m_cond_queue; // signaled when a job is queued or the pool stops
+	std::deque<std::shared_ptr<ImageDecodeJob>> m_queue;
+	std::vector<thread*> m_workers;
+	bool m_stop;
+
+	// most recently used first
+	std::list<std::shared_ptr<ImageDecodeJob>> m_cache;
+	std::unordered_map<u64, std::list<std::shared_ptr<ImageDecodeJob>>::iterator> m_cache_map;
+	u64 m_cached_bytes;
+
+public:
+	ImageDecoderPool()
+		: m_stop(false)
+		, m_cached_bytes(0)
+	{
+	}
+
+	~ImageDecoderPool()
+	{
+		Stop();
+	}
+
+	std::shared_ptr<ImageDecodeJob> Submit(std::vector<u8>& stream, u64 hash)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto found = m_cache_map.find(hash);
+		if (found != m_cache_map.end())
+		{
+			std::shared_ptr<ImageDecodeJob> job = *found->second;
+
+			// the hash only selects the candidate, the stream itself must match
+			if (job->m_stream.size() == stream.size() && !memcmp(&job->m_stream[0], &stream[0], stream.size()))
+			{
+				m_cache.splice(m_cache.begin(), m_cache, found->second);
+				return job;
+			}
+
+			Erase(found->second);
+		}
+
+		std::shared_ptr<ImageDecodeJob> job(new ImageDecodeJob(stream, hash));
+
+		m_cache.push_front(job);
+		m_cache_map[hash] = m_cache.begin();
+
+		StartWorkers();
+		m_queue.push_back(job);
+		m_cond_queue.notify_one();
+		return job;
+	}
+
+	// drop queued jobs (their waiters get nullptr), release the workers and clear the cache
+	void Stop()
+	{
+		std::vector<thread*> workers;
+		std::deque<std::shared_ptr<ImageDecodeJob>> queue;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			m_stop = true;
+			m_cond_queue.notify_all();
+			queue.swap(m_queue);
+			workers.swap(m_workers);
+
+			m_cache.clear();
+			m_cache_map.clear();
+			m_cached_bytes = 0;
+		}
+
+		for (u32 i = 0; i < queue.size(); i++)
+		{
+			Finish(*queue[i], nullptr);
+		}
+
+		for (u32 i = 0; i < workers.size(); i++)
+		{
+			workers[i]->join();
+			delete workers[i];
+		}
+	}
+
+private:
+	void StartWorkers()
+	{
+		if (m_workers.size()) return;
+
+		m_stop = false;
+		const u32 count = std::max<u32>(1, std::min<u32>(max_workers, std::thread::hardware_concurrency()));
+
+		for (u32 i = 0; i < count; i++)
+		{
+			m_workers.push_back(new thread(fmt::Format("Image Decoder[%d]", i), std::bind(&ImageDecoderPool::Task, this)));
+		}
+	}
+
+	void Erase(std::list<std::shared_ptr<ImageDecodeJob>>::iterator it)
+	{
+		m_cached_bytes -= (*it)->m_size;
+		m_cache_map.erase((*it)->m_hash);
+		m_cache.erase(it);
+	}
+
+	void Evict()
+	{
+		auto it = m_cache.end();
+		while (m_cached_bytes > max_cached_bytes && it != m_cache.begin())
+		{
+			--it;
+			if ((*it)->m_size) // pending jobs are not accounted yet
+			{
+				Erase(it++);
+			}
+		}
+	}
+
+	static void Finish(ImageDecodeJob& job, const std::shared_ptr<const DecodedImage>& image)
+	{
+		std::lock_guard<std::mutex> lock(job.m_mutex);
+		job.m_image = image;
+		job.m_done = true;
+		job.m_cond.notify_all();
+	}
+
+	void Task()
+	{
+		while (true)
+		{
+			std::shared_ptr<ImageDecodeJob> job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cond_queue.wait(lock, [this](){ return m_stop || !m_queue.empty(); });
+
+				if (m_stop) break;
+
+				job = m_queue.front();
+				m_queue.pop_front();
+			}
+
+			int width, height, actual_components;
+			std::shared_ptr<DecodedImage> image(new DecodedImage);
+			image->pixels = stbi_load_from_memory(&job->m_stream[0], job->m_stream.size(), &width, &height, &actual_components, 4);
+
+			if (image->pixels)
+			{
+				image->width = width;
+				image->height = height;
+			}
+			else
+			{
+				ConLog.Warning("Image Decoder: stbi_load_from_memory() failed (%s)", stbi_failure_reason());
+				image.reset();
+			}
+
+			Finish(*job, image);
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			auto found = m_cache_map.find(job->m_hash);
+			if (found != m_cache_map.end() && *found->second == job)
+			{
+				job->m_size = job->m_stream.size() + (image ? (u64)image->width * image->height * 4 : 0);
+				m_cached_bytes += job->m_size;
+				Evict();
+			}
+		}
+	}
+};
+
+ImageDecoderPool g_image_decoder;
+
+static u64 imageHash(const std::vector<u8>& stream)
+{
+	const u8* data = &stream[0];
+	const size_t size = stream.size();
+	u64 hash = 0xcbf29ce484222325ULL ^ size;
+	size_t i = 0;
+
+	for (; i + 8 <= size; i += 8)
+	{
+		hash = (hash ^ *(u64*)(data + i)) * 0x9e3779b97f4a7c15ULL;
+		hash ^= hash >> 32;
+	}
+
+	for (; i < size; i++)
+	{
+		hash = (hash ^ data[i]) * 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+bool imageReadFile(u32 fd, u64 size, std::vector<u8>& stream)
+{
+	vfsStream* file;
+	if (!Emu.GetIdManager().GetIDData(fd, file))
+	{
+		return false;
+	}
+
+	stream.resize(size);
+	return size && file->ReadAt(0, &stream[0], size) == size;
+}
+
+bool imageReadBuffer(u32 addr, u32 size, std::vector<u8>& stream)
+{
+	if (!size || !Memory.IsGoodAddr(addr, size))
+	{
+		return false;
+	}
+
+	stream.resize(size);
+	return Memory.CopyToReal(&stream[0], addr, size);
+}
+
+std::shared_ptr<ImageDecodeJob> imageDecodeAsync(std::vector<u8>& stream)
+{
+	if (stream.empty())
+	{
+		return nullptr;
+	}
+
+	return g_image_decoder.Submit(stream, imageHash(stream));
+}
+
+static void imageConvertLine(u8* dst, const u8* src, u32 width, ImageOutputOrder order)
+{
+	switch (order)
+	{
+	case IMAGE_OUTPUT_RGBA:
+		memcpy(dst, src, width * 4);
+	break;
+
+	case IMAGE_OUTPUT_ARGB:
+	{
+		// RGBA -> ARGB is a byte rotation of each pixel (as little-endian u32: rotate left by 8)
+		u32 i = 0;
+		for (; i + 4 <= width; i += 4)
+		{
+			const __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+			_mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_slli_epi32(v, 8), _mm_srli_epi32(v, 24)));
+		}
+
+		for (; i < width; i++)
+		{
+			dst[i*4+0] = src[i*4+3];
+			dst[i*4+1] = src[i*4+0];
+			dst[i*4+2] = src[i*4+1];
+			dst[i*4+3] = src[i*4+2];
+		}
+	}
+	break;
+
+	case IMAGE_OUTPUT_RGB:
+		for (u32 i = 0; i < width; i++)
+		{
+			dst[i*3+0] = src[i*4+0];
+			dst[i*3+1] = src[i*4+1];
+			dst[i*3+2] = src[i*4+2];
+		}
+	break;
+	}
+}
+
+u32 imageWriteToGuest(const DecodedImage& image, u32 addr, u32 pitch, ImageOutputOrder order)
+{
+	const u32 line = image.width * (order == IMAGE_OUTPUT_RGB ? 3 : 4);
+	if (!line)
+	{
+		return 0;
+	}
+
+	if (pitch < line)
+	{
+		pitch = line;
+	}
+
+	std::vector<u8> bounce;
+
+	for (u32 y = 0; y < image.height; y++)
+	{
+		const u32 line_addr = addr + y * pitch;
+		if (!Memory.IsGoodAddr(line_addr, line))
+		{
+			ConLog.Error("imageWriteToGuest: bad output address (0x%x)", line_addr);
+			return y;
+		}
+
+		// convert in place when the line is backed by one host allocation
+		u8* dst = Memory.GetMemFromAddr(line_addr);
+		const bool direct = Memory.GetMemFromAddr(line_addr + line - 1) == dst + line - 1;
+
+		if (!direct)
+		{
+			bounce.resize(line);
+			dst = &bounce[0];
+		}
+
+		imageConvertLine(dst, image.pixels + (u64)y * image.width * 4, image.width, order);
+
+		if (!direct)
+		{
+			Memory.CopyFromReal(line_addr, dst, line);
+		}
+	}
+
+	return image.height;
+}
+
+void imageDecoderStop()
+{
+	g_image_decoder.Stop();
+}
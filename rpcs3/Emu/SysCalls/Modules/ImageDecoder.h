@@ -0,0 +1,73 @@
+#pragma once
+#include <deque>
+#include <list>
+#include <unordered_map>
+
+// Shared backend of cellPngDec, cellJpgDec and cellGifDec.
+// Compressed streams are decoded by stb_image on a small worker pool, so the decoding of a
+// sub-handle starts when it is opened and overlaps with the guest's ReadHeader/SetParameter calls.
+// Finished images are kept in a cache keyed by the content of the compressed stream: UI-heavy
+// titles open the same textures again and again.
+
+// 8-bit RGBA image as returned by stb_image
+struct DecodedImage
+{
+	u8* pixels;
+	u32 width;
+	u32 height;
+
+	DecodedImage()
+		: pixels(nullptr)
+		, width(0)
+		, height(0)
+	{
+	}
+
+	~DecodedImage();
+};
+
+class ImageDecodeJob
+{
+	friend class ImageDecoderPool;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cond; // signaled when the job is finished
+	std::vector<u8> m_stream;
+	u64 m_hash;
+	u64 m_size; // bytes accounted in the cache (0 while pending)
+	std::shared_ptr<const DecodedImage> m_image; // nullptr if decoding failed
+	bool m_done;
+
+public:
+	ImageDecodeJob(std::vector<u8>& stream, u64 hash)
+		: m_hash(hash)
+		, m_size(0)
+		, m_done(false)
+	{
+		m_stream.swap(stream);
+	}
+
+	// blocks until the image is decoded; returns nullptr on failure or emulator stop
+	std::shared_ptr<const DecodedImage> Wait();
+};
+
+enum ImageOutputOrder
+{
+	IMAGE_OUTPUT_RGBA,
+	IMAGE_OUTPUT_ARGB,
+	IMAGE_OUTPUT_RGB,
+};
+
+// read a whole cellFs file (positional read, the file cursor is not moved)
+bool imageReadFile(u32 fd, u64 size, std::vector<u8>& stream);
+// read a stream from guest memory
+bool imageReadBuffer(u32 addr, u32 size, std::vector<u8>& stream);
+
+// queue the stream for decoding, or return the cached/in-flight job of an identical stream
+std::shared_ptr<ImageDecodeJob> imageDecodeAsync(std::vector<u8>& stream);
+
+// convert and write the image directly into guest memory, `pitch` bytes per line (0 = packed);
+// padding bytes at the end of each line are left untouched. Returns the number of lines written.
+u32 imageWriteToGuest(const DecodedImage& image, u32 addr, u32 pitch, ImageOutputOrder order);
+
+void imageDecoderStop();
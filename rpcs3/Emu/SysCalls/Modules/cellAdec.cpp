@@ -26,17 +26,15 @@ int adecRawRead(void* opaque, u8* buf, int buf_size)
 next:
 	if (adec.reader.size < (u32)buf_size /*&& !adec.just_started*/)
 	{
-		while (adec.job.IsEmpty())
+		const AdecJobType next_type = adec.job.Peek().type; // blocks until the next task arrives
+
+		if (Emu.IsStopped())
 		{
-			if (Emu.IsStopped())
-			{
-				ConLog.Warning("adecRawRead() aborted");
-				return 0;
-			}
-			Sleep(1);
+			ConLog.Warning("adecRawRead() aborted");
+			return 0;
 		}
 
-		switch (adec.job.Peek().type)
+		switch (next_type)
 		{
 		case adecEndSeq:
 			{
@@ -66,7 +64,7 @@ next:
 			}
 			break;
 		default:
-			ConLog.Error("adecRawRead(): sequence error (task %d)", adec.job.Peek().type);
+			ConLog.Error("adecRawRead(): sequence error (task %d)", next_type);
 			return -1;
 		}
 
@@ -178,6 +176,91 @@ int adecRead(void* opaque, u8* buf, int buf_size)
 	return res;
 }
 
+// planar float L/R -> interleaved big-endian float
+void adecInterleaveBE(u8* out, const float* left, const float* right, u32 count)
+{
+	u32 i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 l = _mm_loadu_ps(left + i);
+		const __m128 r = _mm_loadu_ps(right + i);
+		__m128i lo = _mm_castps_si128(_mm_unpacklo_ps(l, r)); // l0 r0 l1 r1
+		__m128i hi = _mm_castps_si128(_mm_unpackhi_ps(l, r)); // l2 r2 l3 r3
+
+		// byte swap 32-bit lanes: swap bytes in 16-bit words, then swap the words
+		lo = _mm_or_si128(_mm_slli_epi16(lo, 8), _mm_srli_epi16(lo, 8));
+		hi = _mm_or_si128(_mm_slli_epi16(hi, 8), _mm_srli_epi16(hi, 8));
+		lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xb1), 0xb1);
+		hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xb1), 0xb1);
+
+		_mm_storeu_si128((__m128i*)(out + i * 8), lo);
+		_mm_storeu_si128((__m128i*)(out + i * 8 + 16), hi);
+	}
+
+	be_t<float>* out_f = (be_t<float>*)out;
+	for (; i < count; i++)
+	{
+		out_f[i*2] = left[i];
+		out_f[i*2+1] = right[i];
+	}
+}
+
+bool adecConvert(AudioDecoder& adec, AdecFrame& frame, AVFrame* data)
+{
+	const float* in_f[2] = { (float*)data->extended_data[0], (float*)data->extended_data[1] };
+	u32 count = data->nb_samples;
+	u32 rate = data->sample_rate;
+
+	if (Ini.AudioResample48k.GetValue() && rate != 48000)
+	{
+		if (!adec.swr || adec.swr_in_rate != rate)
+		{
+			if (adec.swr) swr_free(&adec.swr);
+
+			adec.swr = swr_alloc_set_opts(NULL, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLTP, 48000,
+				AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLTP, rate, 0, NULL);
+
+			if (!adec.swr || swr_init(adec.swr) < 0)
+			{
+				ConLog.Error("adecConvert: swr_alloc_set_opts() failed (rate=%d)", rate);
+				Emu.Pause();
+				return false;
+			}
+			adec.swr_in_rate = rate;
+		}
+
+		const u32 max_count = (u32)av_rescale_rnd(swr_get_delay(adec.swr, rate) + count, 48000, rate, AV_ROUND_UP);
+		adec.swr_out[0].resize(max_count);
+		adec.swr_out[1].resize(max_count);
+
+		u8* out[2] = { (u8*)adec.swr_out[0].data(), (u8*)adec.swr_out[1].data() };
+		const int res = swr_convert(adec.swr, out, max_count, (const u8**)data->extended_data, count);
+		if (res < 0)
+		{
+			ConLog.Error("adecConvert: swr_convert() failed (%d)", res);
+			Emu.Pause();
+			return false;
+		}
+
+		in_f[0] = adec.swr_out[0].data();
+		in_f[1] = adec.swr_out[1].data();
+		count = res;
+		rate = 48000;
+	}
+
+	frame.sample_rate = rate;
+	frame.channels = data->channels;
+	frame.size = count * data->channels * sizeof(float);
+	frame.pcm = adec.AllocPcm(frame.size);
+
+	if (frame.size)
+	{
+		adecInterleaveBE(frame.pcm->data(), in_f[0], in_f[1], count);
+	}
+	return true;
+}
+
 u32 adecOpen(AudioDecoder* data)
 {
 	AudioDecoder& adec = *data;
@@ -203,18 +286,6 @@ u32 adecOpen(AudioDecoder* data)
 				break;
 			}
 
-			if (adec.job.IsEmpty() && adec.is_running)
-			{
-				Sleep(1);
-				continue;
-			}
-
-			/*if (adec.frames.GetCount() >= 50)
-			{
-				Sleep(1);
-				continue;
-			}*/
-
 			if (!adec.job.Pop(task))
 			{
 				break;
@@ -396,9 +467,12 @@ u32 adecOpen(AudioDecoder* data)
 
 						struct AdecFrameHolder : AdecFrame
 						{
+							AVFrame* data;
+
 							AdecFrameHolder()
 							{
 								data = av_frame_alloc();
+								pcm = nullptr;
 							}
 
 							~AdecFrameHolder()
@@ -450,7 +524,6 @@ u32 adecOpen(AudioDecoder* data)
 							frame.auAddr = task.au.addr;
 							frame.auSize = task.au.size;
 							frame.userdata = task.au.userdata;
-							frame.size = frame.data->nb_samples * frame.data->channels * sizeof(float);
 
 							if (frame.data->format != AV_SAMPLE_FMT_FLTP)
 							{
@@ -469,8 +542,18 @@ u32 adecOpen(AudioDecoder* data)
 								//frame.pts, frame.data->nb_samples, frame.data->channels, frame.data->sample_rate,
 								//av_get_bytes_per_sample((AVSampleFormat)frame.data->format));
 
-							adec.frames.Push(frame);
-							frame.data = nullptr; // to prevent destruction
+							// convert here, so that cellAdecGetPcm only has to copy the result
+							if (!adecConvert(adec, frame, frame.data))
+							{
+								break;
+							}
+
+							if (!adec.frames.Push(frame))
+							{
+								adec.ReleasePcm(frame.pcm);
+								ConLog.Warning("adecDecodeAu aborted");
+								return;
+							}
 
 							/*Callback cb;
 							cb.SetAddr(adec.cbFunc);
@@ -695,76 +778,20 @@ int cellAdecGetPcm(u32 handle, u32 outBuffer_addr)
 
 	AdecFrame af;
 	adec->frames.Pop(af);
-	AVFrame* frame = af.data;
 
 	int result = CELL_OK;
 
 	if (!Memory.IsGoodAddr(outBuffer_addr, af.size))
 	{
 		result = CELL_ADEC_ERROR_FATAL;
-		if (af.data)
-		{
-			av_frame_unref(af.data);
-			av_frame_free(&af.data);
-		}
-		return result;
-	}
-
-	if (!af.data) // fake: empty data
-	{
-		/*u8* buf = (u8*)malloc(4096);
-		memset(buf, 0, 4096);
-		Memory.CopyFromReal(outBuffer_addr, buf, 4096);
-		free(buf);*/
-		return result;
-	}
-	// copy data
-	SwrContext* swr = nullptr;
-
-	/*swr = swr_alloc_set_opts(NULL, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLT, 48000,
-		frame->channel_layout, (AVSampleFormat)frame->format, frame->sample_rate, 0, NULL);
-
-	if (!swr)
-	{
-		ConLog.Error("cellAdecGetPcm(%d): swr_alloc_set_opts() failed", handle);
-		Emu.Pause();
-		free(out);
-		if (af.data)
-		{
-			av_frame_unref(af.data);
-			av_frame_free(&af.data);
-		}
-		return result;
-	}*/
-	u8* out = (u8*)malloc(af.size);
-	// something is wrong
-	//swr_convert(swr, &out, frame->nb_samples, (const u8**)frame->extended_data, frame->nb_samples);
-
-	// reverse byte order, extract data:
-	float* in_f[2];
-	in_f[0] = (float*)frame->extended_data[0];
-	in_f[1] = (float*)frame->extended_data[1];
-	be_t<float>* out_f = (be_t<float>*)out;
-	for (u32 i = 0; i < af.size / 8; i++)
-	{
-		out_f[i*2] = in_f[0][i];
-		out_f[i*2+1] = in_f[1][i];
 	}
-
-	if (!Memory.CopyFromReal(outBuffer_addr, out, af.size))
+	else if (af.size && !Memory.CopyFromReal(outBuffer_addr, af.pcm->data(), af.size))
 	{
 		ConLog.Error("cellAdecGetPcm(%d): data copying failed (addr=0x%x)", handle, outBuffer_addr);
 		Emu.Pause();
 	}
 
-	free(out);
-	if (swr) swr_free(&swr);
-
-	if (af.data)
-	{
-		av_frame_unref(af.data);
-		av_frame_free(&af.data);
-	}
+	adec->ReleasePcm(af.pcm);
 	return result;
 }
 
@@ -790,8 +817,6 @@ int cellAdecGetPcmItem(u32 handle, mem32_t pcmItem_ptr)
 		return CELL_ADEC_ERROR_EMPTY;
 	}
 
-	AVFrame* frame = af.data;
-
 	mem_ptr_t<CellAdecPcmItem> pcm(adec->memAddr + adec->memBias);
 
 	adec->memBias += 512;
@@ -812,8 +837,8 @@ int cellAdecGetPcmItem(u32 handle, mem32_t pcmItem_ptr)
 	pcm->auInfo.userData = af.userdata;
 
 	mem_ptr_t<CellAdecAtracXInfo> atx(pcm.GetAddr() + sizeof(CellAdecPcmItem));
-	atx->samplingFreq = frame->sample_rate; // ???
-	atx->nbytes = frame->nb_samples * frame->channels * sizeof(float); // ???
+	atx->samplingFreq = af.sample_rate; // ???
+	atx->nbytes = af.size; // ???
 	atx->channelConfigIndex = CELL_ADEC_CH_STEREO; // ???
 
 	pcmItem_ptr = pcm.GetAddr();
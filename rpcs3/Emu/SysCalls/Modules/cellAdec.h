@@ -1024,12 +1024,14 @@ struct AdecTask
 
 struct AdecFrame
 {
-	AVFrame* data;
+	std::vector<u8>* pcm; // interleaved big-endian float samples, ready for cellAdecGetPcm (pooled)
 	u64 pts;
 	u64 userdata;
 	u32 auAddr;
 	u32 auSize;
 	u32 size;
+	u32 sample_rate;
+	u32 channels;
 };
 
 int adecRead(void* opaque, u8* buf, int buf_size);
@@ -1116,6 +1118,13 @@ public:
 
 	CPUThread* adecCb;
 
+	std::mutex pcm_pool_mutex;
+	std::vector<std::vector<u8>*> pcm_pool; // output buffers returned by cellAdecGetPcm
+
+	SwrContext* swr; // optional resampling to 48 kHz (Ini.AudioResample48k)
+	u32 swr_in_rate;
+	std::vector<float> swr_out[2];
+
 	AudioDecoder(AudioCodecType type, u32 addr, u32 size, u32 func, u32 arg)
 		: type(type)
 		, memAddr(addr)
@@ -1129,6 +1138,8 @@ public:
 		, just_started(false)
 		, ctx(nullptr)
 		, fmt(nullptr)
+		, swr(nullptr)
+		, swr_in_rate(0)
 	{
 		AVCodec* codec = avcodec_find_decoder(AV_CODEC_ID_ATRAC3P);
 		if (!codec)
@@ -1161,8 +1172,7 @@ public:
 			for (u32 i = frames.GetCount() - 1; ~i; i--)
 			{
 				AdecFrame& af = frames.Peek(i);
-				av_frame_unref(af.data);
-				av_frame_free(&af.data);
+				delete af.pcm;
 			}
 			avcodec_close(ctx);
 			avformat_close_input(&fmt);
@@ -1176,5 +1186,42 @@ public:
 			if (fmt->pb) av_free(fmt->pb);
 			avformat_free_context(fmt);
 		}
+		for (std::vector<u8>* buf : pcm_pool)
+		{
+			delete buf;
+		}
+		if (swr)
+		{
+			swr_free(&swr);
+		}
+	}
+
+	std::vector<u8>* AllocPcm(u32 size)
+	{
+		std::vector<u8>* buf = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(pcm_pool_mutex);
+			if (!pcm_pool.empty())
+			{
+				buf = pcm_pool.back();
+				pcm_pool.pop_back();
+			}
+		}
+
+		if (!buf)
+		{
+			buf = new std::vector<u8>();
+		}
+
+		buf->resize(size);
+		return buf;
+	}
+
+	void ReleasePcm(std::vector<u8>* buf)
+	{
+		if (!buf) return;
+
+		std::lock_guard<std::mutex> lock(pcm_pool_mutex);
+		pcm_pool.push_back(buf);
 	}
 };
@@ -5,6 +5,7 @@
 #include "Emu/Audio/cellAudio.h"
 #include "Emu/Audio/AudioManager.h"
 #include "Emu/Audio/AudioDumper.h"
+#include "Emu/Clock.h"
 
 void cellAudio_init();
 Module cellAudio(0x0011, cellAudio_init);
@@ -110,9 +111,10 @@ int cellAudioInit()
 				// TODO: send beforemix event (in ~2,6 ms before mixing)
 
 				// precise time of sleeping: 5,(3) ms (or 256/48000 sec)
-				if (m_config.counter * 256000000 / 48000 >= stamp0 - m_config.start_time)
+				const u64 block_time = m_config.start_time + m_config.counter * 256000000 / 48000;
+				if (block_time >= stamp0)
 				{
-					Sleep(1);
+					g_timer_wheel.SleepUntil(block_time + 1);
 					continue;
 				}
 
@@ -138,14 +138,10 @@ u32 dmuxOpen(Demuxer* data)
 						if (esATX[ch])
 						{
 							ElementaryStream& es = *esATX[ch];
-							while (es.isfull())
+							if (!es.wait_space())
 							{
-								if (Emu.IsStopped())
-								{
-									ConLog.Warning("esATX[%d] was full, waiting aborted", ch);
-									return;
-								}
-								Sleep(1);
+								ConLog.Warning("esATX[%d] was full, waiting aborted", ch);
+								return;
 							}
 
 							if (es.hasunseen()) // hack, probably useless
@@ -187,14 +183,10 @@ u32 dmuxOpen(Demuxer* data)
 						if (esAVC[ch])
 						{
 							ElementaryStream& es = *esAVC[ch];
-							while (es.isfull())
+							if (!es.wait_space())
 							{
-								if (Emu.IsStopped())
-								{
-									ConLog.Warning("esAVC[%d] was full, waiting aborted", ch);
-									return;
-								}
-								Sleep(1);
+								ConLog.Warning("esAVC[%d] was full, waiting aborted", ch);
+								return;
 							}
 
 							DemuxerStream backup = stream;
@@ -278,6 +270,7 @@ u32 dmuxOpen(Demuxer* data)
 					{
 						// search
 						stream.skip(1);
+						stream.find_start_code();
 					}
 					break;
 
@@ -636,6 +629,7 @@ int cellDmuxSetStream(u32 demuxerHandle, const u32 streamAddress, u32 streamSize
 	info.size = streamSize;
 	info.discontinuity = discontinuity;
 	info.userdata = userData;
+	info.page_ptr = nullptr;
 
 	dmux->job.Push(task);
 
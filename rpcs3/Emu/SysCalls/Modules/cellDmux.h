@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Utilities/SQueue.h"
+#include <atomic>
 
 // align size or address to 128
 #define a128(x) ((x + 127) & (~127))
@@ -311,12 +312,31 @@ struct DemuxerStream
 	u64 userdata;
 	bool discontinuity;
 
+	u32 page; // host translation of the last accessed 4K page (page_ptr must be reset when addr is set)
+	u8* page_ptr;
+
+	__forceinline u8* get_ptr(u32 a, u32 count)
+	{
+		if ((a & 4095) + count > 4096)
+		{
+			return (u8*)Memory.VirtualToRealAddr(a); // crosses a page boundary
+		}
+
+		if (!page_ptr || page != (a & ~4095))
+		{
+			page = a & ~4095;
+			page_ptr = (u8*)Memory.VirtualToRealAddr(page);
+		}
+
+		return page_ptr + (a & 4095);
+	}
+
 	template<typename T>
 	bool get(T& out)
 	{
 		if (sizeof(T) > size) return false;
 
-		out = *(T*)Memory.VirtualToRealAddr(addr);
+		out = *(T*)get_ptr(addr, sizeof(T));
 		addr += sizeof(T);
 		size -= sizeof(T);
 
@@ -328,10 +348,59 @@ struct DemuxerStream
 	{
 		if (sizeof(T) + shift > size) return false;
 
-		out = *(T*)Memory.VirtualToRealAddr(addr + shift);
+		out = *(T*)get_ptr(addr + shift, sizeof(T));
 		return true;
 	}
 
+	// advances to the next 00 00 01 prefix (or to the end of the stream)
+	void find_start_code()
+	{
+		while (size >= 4)
+		{
+			// host memory is only contiguous inside a page, so scan page by page
+			const u32 chunk = min<u32>(size, 4096 - (addr & 4095));
+			const u8* p = get_ptr(addr, 1);
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i one = _mm_set1_epi8(1);
+			u32 i = 0;
+
+			for (; i + 18 <= chunk; i += 16)
+			{
+				const __m128i m0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i)), zero);
+				const __m128i m1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i + 1)), zero);
+				const __m128i m2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i + 2)), one);
+
+				if (u32 mask = _mm_movemask_epi8(_mm_and_si128(_mm_and_si128(m0, m1), m2)))
+				{
+					while (!(mask & 1)) { mask >>= 1; i++; }
+					skip(i);
+					return;
+				}
+			}
+
+			// tail of the page (the prefix may cross into the next page)
+			for (; i < chunk; i++)
+			{
+				u8 v[3];
+				if (!peek(v[0], i) || !peek(v[1], i + 1) || !peek(v[2], i + 2))
+				{
+					skip(size);
+					return;
+				}
+
+				if (v[0] == 0 && v[1] == 0 && v[2] == 1)
+				{
+					skip(i);
+					return;
+				}
+			}
+
+			skip(chunk);
+		}
+
+		skip(size);
+	}
+
 	void skip(u32 count)
 	{
 		addr += count;
@@ -479,25 +548,40 @@ public:
 	}
 };
 
+// AU descriptor published by the demuxer thread
+struct EsAuDescriptor
+{
+	u32 addr; // CellDmuxAuInfoEx address (AU data follows after 128 bytes)
+};
+
 class ElementaryStream
 {
-	SMutex mutex;
+	// single-producer (demuxer thread) / single-consumer (GetAu, PeekAu, ReleaseAu) ring of AU descriptors
+	static const u32 max_au_count = 1024;
+	EsAuDescriptor entries[max_au_count];
+	std::atomic<u32> put_count; // number of AU written
+	std::atomic<u32> released; // number of AU released
+	std::atomic<u32> peek_count; // number of AU obtained by GetAu(Ex)
 
-	SQueue<u32> entries; // AU starting addresses
-	u32 put_count; // number of AU written
-	u32 released; // number of AU released
-	u32 peek_count; // number of AU obtained by GetAu(Ex)
+	// taken by the consumer (peek, release) and by reset(), and to sleep while the ES buffer is full
+	std::mutex space_mutex;
+	std::condition_variable space_cond;
 
-	u32 put; // AU that is being written now
+	u32 put; // AU that is being written now (demuxer thread only)
 	u32 size; // number of bytes written (after 128b header)
-	//u32 first; // AU that will be released
-	//u32 peek; // AU that will be obtained by GetAu(Ex)/PeekAu(Ex)
 
 	bool is_full()
 	{
-		if (released < put_count)
+		const u32 first_index = released.load(std::memory_order_acquire);
+
+		if (put_count.load(std::memory_order_relaxed) - first_index >= max_au_count)
+		{
+			return true;
+		}
+
+		if (first_index < put_count.load(std::memory_order_relaxed))
 		{
-			u32 first = entries.Peek();
+			const u32 first = entries[first_index % max_au_count].addr;
 			if (first >= put)
 			{
 				return (first - put) < GetMaxAU();
@@ -538,8 +622,6 @@ public:
 		, cbFunc(cbFunc)
 		, cbArg(cbArg)
 		, spec(spec)
-		//, first(0)
-		//, peek(0)
 		, put(memAddr)
 		, size(0)
 		, put_count(0)
@@ -566,63 +648,43 @@ public:
 
 	bool hasunseen()
 	{
-		SMutexLocker lock(mutex);
-		return peek_count < put_count;
+		return peek_count.load(std::memory_order_relaxed) < put_count.load(std::memory_order_relaxed);
 	}
 
 	bool hasdata()
 	{
-		SMutexLocker lock(mutex);
-		return size;
+		return size != 0;
 	}
 
 	bool isfull()
 	{
-		SMutexLocker lock(mutex);
 		return is_full();
 	}
 
-	void finish(DemuxerStream& stream) // not multithread-safe
+	// blocks the demuxer thread until the consumer releases enough AU (returns false if the emulator is stopped)
+	bool wait_space()
 	{
-		u32 addr;
-		{
-			SMutexLocker lock(mutex);
-			//if (fidMajor != 0xbd) ConLog.Write(">>> es::finish(): peek=0x%x, first=0x%x, put=0x%x, size=0x%x", peek, first, put, size);
+		std::unique_lock<std::mutex> lock(space_mutex);
 
-			addr = put;
-			/*if (!first)
-			{
-				first = put;
-			}
-			if (!peek)
-			{
-				peek = put;
-			}*/
+		return WaitWhileRunning(space_cond, lock, [this]() { return !is_full(); });
+	}
 
-			mem_ptr_t<CellDmuxAuInfo> info(put);
-			//if (fidMajor != 0xbd) ConLog.Warning("es::finish(): (%s) size = 0x%x, info_addr=0x%x, pts = 0x%x",
-				//wxString(fidMajor == 0xbd ? "ATRAC3P Audio" : "Video AVC").wx_str(),
-				//(u32)info->auSize, put, (u32)info->ptsLower);
+	void finish(DemuxerStream& stream) // not multithread-safe
+	{
+		EsAuDescriptor& desc = entries[put_count.load(std::memory_order_relaxed) % max_au_count];
+		desc.addr = put;
 
-			u32 new_addr = a128(put + 128 + size);
-			put = ((new_addr + GetMaxAU()) > (memAddr + memSize))
-			    ? memAddr : new_addr;
+		u32 new_addr = a128(put + 128 + size);
+		put = ((new_addr + GetMaxAU()) > (memAddr + memSize))
+		    ? memAddr : new_addr;
 
-			size = 0;
+		size = 0;
 
-			put_count++;
-			//if (fidMajor != 0xbd) ConLog.Write("<<< es::finish(): peek=0x%x, first=0x%x, put=0x%x, size=0x%x", peek, first, put, size);
-		}
-		if (!entries.Push(addr))
-		{
-			ConLog.Error("es::finish() aborted (no space)");
-		}
+		put_count.fetch_add(1, std::memory_order_release); // publish
 	}
 
 	void push(DemuxerStream& stream, u32 sz, PesHeader& pes)
 	{
-		SMutexLocker lock(mutex);
-
 		if (is_full())
 		{
 			ConLog.Error("es::push(): buffer is full");
@@ -673,108 +735,66 @@ public:
 
 	bool release()
 	{
-		SMutexLocker lock(mutex);
-		//if (fidMajor != 0xbd) ConLog.Write(">>> es::release(): peek=0x%x, first=0x%x, put=0x%x, size=0x%x", peek, first, put, size);
-		if (released >= put_count)
+		// under the lock: reset() can't run between the check and the update, nor wait_space() miss the notification
+		std::unique_lock<std::mutex> lock(space_mutex);
+
+		const u32 index = released.load(std::memory_order_relaxed);
+
+		if (index >= put_count.load(std::memory_order_acquire))
 		{
 			ConLog.Error("es::release(): buffer is empty");
 			return false;
 		}
 
-		u32 addr = entries.Peek();
-
-		mem_ptr_t<CellDmuxAuInfo> info(addr);
-		//if (fidMajor != 0xbd) ConLog.Warning("es::release(): (%s) size = 0x%x, info = 0x%x, pts = 0x%x",
-			//wxString(fidMajor == 0xbd ? "ATRAC3P Audio" : "Video AVC").wx_str(), (u32)info->auSize, first, (u32)info->ptsLower);
-
-		if (released >= peek_count)
+		if (index >= peek_count.load(std::memory_order_relaxed))
 		{
 			ConLog.Error("es::release(): buffer has not been seen yet");
 			return false;
 		}
 
-		/*u32 new_addr = a128(info.GetAddr() + 128 + info->auSize);
-
-		if (new_addr == put)
-		{
-			first = 0;
-		}
-		else if ((new_addr + GetMaxAU()) > (memAddr + memSize))
-		{
-			first = memAddr;
-		}
-		else
-		{
-			first = new_addr;
-		}*/
-
-		released++;
-		if (!entries.Pop(addr))
-		{
-			ConLog.Error("es::release(): entries.Pop() aborted (no entries found)");
-			return false;
-		}
-		//if (fidMajor != 0xbd) ConLog.Write("<<< es::release(): peek=0x%x, first=0x%x, put=0x%x, size=0x%x", peek, first, put, size);
+		released.store(index + 1, std::memory_order_release);
+		lock.unlock();
+		space_cond.notify_one();
 		return true;
 	}
 
 	bool peek(u32& out_data, bool no_ex, u32& out_spec, bool update_index)
 	{
-		SMutexLocker lock(mutex);
-		//if (fidMajor != 0xbd) ConLog.Write(">>> es::peek(%sAu%s): peek=0x%x, first=0x%x, put=0x%x, size=0x%x", wxString(update_index ? "Get" : "Peek").wx_str(), 
-			//wxString(no_ex ? "" : "Ex").wx_str(), peek, first, put, size);
-		if (peek_count >= put_count) return false;
+		std::lock_guard<std::mutex> lock(space_mutex);
+
+		const u32 index = peek_count.load(std::memory_order_relaxed);
+
+		if (index >= put_count.load(std::memory_order_acquire)) return false;
 
-		if (peek_count < released)
+		if (index < released.load(std::memory_order_relaxed))
 		{
-			ConLog.Error("es::peek(): sequence error: peek_count < released (peek_count=%d, released=%d)", peek_count, released);
+			ConLog.Error("es::peek(): sequence error: peek_count < released (peek_count=%d, released=%d)", index, released.load());
 			Emu.Pause();
 			return false;
 		}
 
-		u32 addr = entries.Peek(peek_count - released);
-		mem_ptr_t<CellDmuxAuInfo> info(addr);
-		//if (fidMajor != 0xbd) ConLog.Warning("es::peek(%sAu(Ex)): (%s) size = 0x%x, info = 0x%x, pts = 0x%x",
-			//wxString(update_index ? "Get" : "Peek").wx_str(),
-			//wxString(fidMajor == 0xbd ? "ATRAC3P Audio" : "Video AVC").wx_str(), (u32)info->auSize, peek, (u32)info->ptsLower);
-
-		out_data = addr;
+		out_data = entries[index % max_au_count].addr;
 		out_spec = out_data + sizeof(CellDmuxAuInfoEx);
 		if (no_ex) out_data += 64;
 
 		if (update_index)
 		{
-			/*u32 new_addr = a128(peek + 128 + info->auSize);
-			if (new_addr == put)
-			{
-				peek = 0;
-			}
-			else if ((new_addr + GetMaxAU()) > (memAddr + memSize))
-			{
-				peek = memAddr;
-			}
-			else
-			{
-				peek = new_addr;
-			}*/
-			peek_count++;
+			peek_count.store(index + 1, std::memory_order_relaxed);
 		}
 
-		//if (fidMajor != 0xbd) ConLog.Write("<<< es::peek(%sAu%s): peek=0x%x, first=0x%x, put=0x%x, size=0x%x", wxString(update_index ? "Get" : "Peek").wx_str(), 
-			//wxString(no_ex ? "" : "Ex").wx_str(), peek, first, put, size);
 		return true;
 	}
 
-	void reset()
+	void reset() // demuxer thread only
 	{
-		SMutexLocker lock(mutex);
-		//first = 0;
-		//peek = 0;
-		put = memAddr;
-		size = 0;
-		entries.Clear();
-		put_count = 0;
-		released = 0;
-		peek_count = 0;
+		{
+			std::lock_guard<std::mutex> lock(space_mutex);
+			put = memAddr;
+			size = 0;
+			put_count = 0;
+			released = 0;
+			peek_count = 0;
+		}
+		space_cond.notify_one();
 	}
 };
@@ -210,6 +210,289 @@ struct CellFontRenderSurface
 };
 
 // Internal Datatypes
+
+// Rasterized glyphs and vertical metrics, keyed by font data, pixel height, code and slant.
+// Glyphs are rendered once into an 8-bit atlas made of horizontal shelves; when the atlas is full,
+// the least recently used shelf is evicted with all of its glyphs.
+class CellFontGlyphCache
+{
+public:
+	struct Metrics
+	{
+		float scale;
+		int ascent, descent, lineGap;
+	};
+
+private:
+	static const u32 atlas_width = 1024;
+	static const u32 atlas_height = 1024;
+
+	struct Key
+	{
+		u32 font;  // font data address
+		u32 size;  // pixel height (float bits)
+		u32 code;
+		u32 slant; // (float bits)
+
+		bool operator == (const Key& right) const
+		{
+			return font == right.font && size == right.size && code == right.code && slant == right.slant;
+		}
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const
+		{
+			return (key.font * 0x9e3779b1) ^ (key.size * 0x85ebca6b) ^ (key.code * 0xc2b2ae35) ^ key.slant;
+		}
+	};
+
+	struct Glyph
+	{
+		u16 x, y;
+		u16 width, height;
+		s32 xoff, yoff;
+		u32 shelf;
+	};
+
+	struct Shelf
+	{
+		u32 y, height;
+		u32 next_x;
+		u64 last_use;
+		std::vector<Key> keys;
+	};
+
+	std::mutex m_mutex;
+	std::vector<u8> m_atlas;
+	std::vector<Shelf> m_shelves;
+	u32 m_shelves_bottom;
+	u64 m_tick;
+	std::unordered_map<Key, Glyph, KeyHash> m_glyphs;
+	std::unordered_map<u64, Metrics> m_metrics; // (font data address << 32) | pixel height bits
+
+	static u32 FloatBits(float value)
+	{
+		return (u32&)value;
+	}
+
+	const Metrics& GetMetricsLocked(const stbtt_fontinfo& info, u32 font, float size)
+	{
+		auto found = m_metrics.find((u64)font << 32 | FloatBits(size));
+		if (found != m_metrics.end())
+		{
+			return found->second;
+		}
+
+		Metrics& res = m_metrics[(u64)font << 32 | FloatBits(size)];
+		res.scale = stbtt_ScaleForPixelHeight(&info, size);
+		stbtt_GetFontVMetrics(&info, &res.ascent, &res.descent, &res.lineGap);
+		return res;
+	}
+
+	void EvictShelf(u32 index)
+	{
+		Shelf& shelf = m_shelves[index];
+
+		for (u32 i = 0; i < shelf.keys.size(); i++)
+		{
+			auto found = m_glyphs.find(shelf.keys[i]);
+			if (found != m_glyphs.end() && found->second.shelf == index)
+			{
+				m_glyphs.erase(found);
+			}
+		}
+
+		shelf.keys.clear();
+		shelf.next_x = 0;
+	}
+
+	// find room for a width x height glyph; returns the shelf index or -1 if it can't fit at all
+	int Allocate(u32 width, u32 height)
+	{
+		if (width > atlas_width || height > atlas_height)
+		{
+			return -1;
+		}
+
+		// best fitting shelf with enough free space, not wasting more than a quarter of its height
+		int best = -1;
+		for (u32 i = 0; i < m_shelves.size(); i++)
+		{
+			const Shelf& shelf = m_shelves[i];
+			if (shelf.height >= height && shelf.height <= height + height / 4 + 2 && shelf.next_x + width <= atlas_width)
+			{
+				if (best < 0 || shelf.height < m_shelves[best].height) best = i;
+			}
+		}
+
+		if (best >= 0)
+		{
+			return best;
+		}
+
+		const u32 shelf_height = std::min<u32>((height + 3) & ~3, atlas_height);
+		if (m_shelves_bottom + shelf_height <= atlas_height)
+		{
+			Shelf shelf;
+			shelf.y = m_shelves_bottom;
+			shelf.height = shelf_height;
+			shelf.next_x = 0;
+			shelf.last_use = m_tick;
+			m_shelves.push_back(shelf);
+			m_shelves_bottom += shelf_height;
+			return m_shelves.size() - 1;
+		}
+
+		// atlas is full: reuse the least recently used shelf that is tall enough
+		for (u32 i = 0; i < m_shelves.size(); i++)
+		{
+			if (m_shelves[i].height >= height && (best < 0 || m_shelves[i].last_use < m_shelves[best].last_use)) best = i;
+		}
+
+		if (best < 0)
+		{
+			// only shorter shelves exist: start over with an empty atlas
+			m_glyphs.clear();
+			m_shelves.clear();
+			m_shelves_bottom = 0;
+			return Allocate(width, height);
+		}
+
+		EvictShelf(best);
+		return best;
+	}
+
+	const Glyph* GetGlyphLocked(const stbtt_fontinfo& info, u32 font, float size, float slant, u32 code, float scale)
+	{
+		const Key key = { font, FloatBits(size), code, FloatBits(slant) };
+
+		auto found = m_glyphs.find(key);
+		if (found != m_glyphs.end())
+		{
+			m_shelves[found->second.shelf].last_use = m_tick;
+			return &found->second;
+		}
+
+		int x0, y0, x1, y1;
+		stbtt_GetCodepointBitmapBox(&info, code, scale, scale, &x0, &y0, &x1, &y1);
+
+		const int shelf_index = Allocate(x1 - x0, y1 - y0);
+		if (shelf_index < 0)
+		{
+			return nullptr;
+		}
+
+		Shelf& shelf = m_shelves[shelf_index];
+		Glyph& glyph = m_glyphs[key];
+		glyph.x = shelf.next_x;
+		glyph.y = shelf.y;
+		glyph.width = x1 - x0;
+		glyph.height = y1 - y0;
+		glyph.xoff = x0;
+		glyph.yoff = y0;
+		glyph.shelf = shelf_index;
+
+		if (glyph.width && glyph.height)
+		{
+			stbtt_MakeCodepointBitmap(&info, &m_atlas[glyph.y * atlas_width + glyph.x], glyph.width, glyph.height, atlas_width, scale, scale, code);
+		}
+
+		shelf.next_x += glyph.width;
+		shelf.last_use = m_tick;
+		shelf.keys.push_back(key);
+		return &glyph;
+	}
+
+public:
+	CellFontGlyphCache()
+		: m_atlas(atlas_width * atlas_height)
+		, m_shelves_bottom(0)
+		, m_tick(0)
+	{
+	}
+
+	Metrics GetMetrics(const stbtt_fontinfo& info, u32 font, float size)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		return GetMetricsLocked(info, font, size);
+	}
+
+	// draw a glyph into an 8-bit surface, the top of the line at (x, y)
+	void Draw(const stbtt_fontinfo& info, u32 font, float size, float slant, u32 code, u8* surface, u32 width, u32 height, int x, int y)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_tick++;
+		const Metrics& metrics = GetMetricsLocked(info, font, size);
+		const Glyph* glyph = GetGlyphLocked(info, font, size, slant, code, metrics.scale);
+
+		std::vector<u8> temp;
+		const u8* src;
+		u32 src_pitch;
+		int glyph_width, glyph_height, yoff;
+
+		if (glyph)
+		{
+			src = &m_atlas[glyph->y * atlas_width + glyph->x];
+			src_pitch = atlas_width;
+			glyph_width = glyph->width;
+			glyph_height = glyph->height;
+			yoff = glyph->yoff;
+		}
+		else
+		{
+			// too large for the atlas
+			int x0, y0, x1, y1;
+			stbtt_GetCodepointBitmapBox(&info, code, metrics.scale, metrics.scale, &x0, &y0, &x1, &y1);
+			glyph_width = x1 - x0;
+			glyph_height = y1 - y0;
+			yoff = y0;
+			temp.resize(glyph_width * glyph_height);
+			if (temp.empty()) return;
+			stbtt_MakeCodepointBitmap(&info, &temp[0], glyph_width, glyph_height, glyph_width, metrics.scale, metrics.scale, code);
+			src = &temp[0];
+			src_pitch = glyph_width;
+		}
+
+		// TODO: There are some oddities in the position of the character in the final buffer
+		const int top = y + yoff + (int)(metrics.ascent * metrics.scale);
+		const int row_begin = std::max<int>(0, -top);
+		const int row_end = std::min<int>(glyph_height, (int)height - top);
+		const int col_begin = std::max<int>(0, -x);
+		const int col_end = std::min<int>(glyph_width, (int)width - x);
+
+		for (int row = row_begin; row < row_end && col_begin < col_end; row++)
+		{
+			memcpy(surface + (top + row) * width + x + col_begin, src + row * src_pitch + col_begin, col_end - col_begin);
+		}
+	}
+
+	// forget everything rendered from this font data
+	void Invalidate(u32 font)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto it = m_glyphs.begin(); it != m_glyphs.end();)
+		{
+			if (it->first.font == font)
+				it = m_glyphs.erase(it);
+			else
+				++it;
+		}
+
+		for (auto it = m_metrics.begin(); it != m_metrics.end();)
+		{
+			if ((u32)(it->first >> 32) == font)
+				it = m_metrics.erase(it);
+			else
+				++it;
+		}
+	}
+};
+
 struct CCellFontInternal      //Module cellFont
 {
 	u32 m_buffer_addr, m_buffer_size;
@@ -218,6 +501,8 @@ struct CCellFontInternal      //Module cellFont
 	bool m_bInitialized;
 	bool m_bFontGcmInitialized;
 
+	CellFontGlyphCache m_glyphCache;
+
 	CCellFontInternal()
 		: m_buffer_addr(NULL)
 		, m_buffer_size(0)
@@ -498,13 +783,11 @@ int cellFontGetHorizontalLayout(mem_ptr_t<CellFont> font, mem_ptr_t<CellFontHori
 	if (!font.IsGood() || !layout.IsGood())
 		return CELL_FONT_ERROR_INVALID_PARAMETER;
 
-	int ascent, descent, lineGap;
-	float scale = stbtt_ScaleForPixelHeight(&(font->stbfont), font->scale_y);
-	stbtt_GetFontVMetrics(&(font->stbfont), &ascent, &descent, &lineGap);
+	const CellFontGlyphCache::Metrics m = s_fontInternalInstance->m_glyphCache.GetMetrics(font->stbfont, font->fontdata_addr, font->scale_y);
 
-	layout->baseLineY = ascent * scale;
-	layout->lineHeight = (ascent-descent+lineGap) * scale;
-	layout->effectHeight = lineGap * scale;
+	layout->baseLineY = m.ascent * m.scale;
+	layout->lineHeight = (m.ascent-m.descent+m.lineGap) * m.scale;
+	layout->effectHeight = m.lineGap * m.scale;
 	return CELL_FONT_OK;
 }
 
@@ -582,33 +865,10 @@ int cellFontRenderCharGlyphImage(mem_ptr_t<CellFont> font, u32 code, mem_ptr_t<C
 	if (!font->renderer_addr)
 		return CELL_FONT_ERROR_RENDERER_UNBIND;
 
-	// Render the character
-	int width, height, xoff, yoff;
-	float scale = stbtt_ScaleForPixelHeight(&(font->stbfont), font->scale_y);
-	unsigned char* box = stbtt_GetCodepointBitmap(&(font->stbfont), scale, scale, code, &width, &height, &xoff, &yoff);
-	if (!box) return CELL_OK;
-
-	// Get the baseLineY value
-	int baseLineY;
-	int ascent, descent, lineGap;
-	stbtt_GetFontVMetrics(&(font->stbfont), &ascent, &descent, &lineGap);
-	baseLineY = ascent * scale;
-
-	// Move the rendered character to the surface
+	// Move the character from the glyph cache to the surface (rendered on first use)
 	unsigned char* buffer = (unsigned char*)Memory.VirtualToRealAddr(surface->buffer_addr);
-	for (u32 ypos = 0; ypos < (u32)height; ypos++){
-		if ((u32)y + ypos + yoff + baseLineY >= surface->height)
-			break;
-
-		for (u32 xpos = 0; xpos < (u32)width; xpos++){
-			if ((u32)x + xpos >= surface->width)
-				break;
-
-			// TODO: There are some oddities in the position of the character in the final buffer
-			buffer[((int)y + ypos + yoff + baseLineY)*surface->width + (int)x+xpos] = box[ypos*width + xpos];
-		}
-	}
-	stbtt_FreeBitmap(box, 0);
+	s_fontInternalInstance->m_glyphCache.Draw(font->stbfont, font->fontdata_addr, font->scale_y, font->slant, code,
+		buffer, surface->width, surface->height, (int)x, (int)y);
 	return CELL_FONT_OK;
 }
 
@@ -660,6 +920,8 @@ int cellFontCloseFont(mem_ptr_t<CellFont> font)
 	if (!font.IsGood())
 		return CELL_FONT_ERROR_INVALID_PARAMETER;
 
+	s_fontInternalInstance->m_glyphCache.Invalidate(font->fontdata_addr);
+
 	if (font->origin == CELL_FONT_OPEN_FONTSET ||
 		font->origin == CELL_FONT_OPEN_FONT_FILE ||
 		font->origin == CELL_FONT_OPEN_MEMORY)
@@ -678,7 +940,7 @@ int cellFontGetCharGlyphMetrics(mem_ptr_t<CellFont> font, u32 code, mem_ptr_t<Ce
 
 	int x0, y0, x1, y1;
 	int advanceWidth, leftSideBearing;
-	float scale = stbtt_ScaleForPixelHeight(&(font->stbfont), font->scale_y);
+	float scale = s_fontInternalInstance->m_glyphCache.GetMetrics(font->stbfont, font->fontdata_addr, font->scale_y).scale;
 	stbtt_GetCodepointBox(&(font->stbfont), code, &x0, &y0, &x1, &y1);
 	stbtt_GetCodepointHMetrics(&(font->stbfont), code, &advanceWidth, &leftSideBearing);
 	
@@ -307,7 +307,14 @@ int cellGameContentErrorDialog(s32 type, s32 errNeedSizeKB, u32 dirName_addr)
 
 	std::string errorMsg = fmt::Format("%s\nSpace needed: %d KB\nDirectory name: %s",
 		errorName.c_str(), errNeedSizeKB, dirName);
-	wxMessageBox(fmt::FromUTF8(errorMsg), wxGetApp().GetAppName(), wxICON_ERROR | wxOK);
+	if (Emu.IsHeadless())
+	{
+		cellGame.Warning("cellGameContentErrorDialog: %s", errorMsg.c_str());
+	}
+	else
+	{
+		wxMessageBox(fmt::FromUTF8(errorMsg), wxGetApp().GetAppName(), wxICON_ERROR | wxOK);
+	}
 	return CELL_OK;
 }
 
@@ -427,12 +427,24 @@ u32 cellGcmSetUserHandler(u32 handler)
 	return handler;
 }
 
-int cellGcmSetVBlankHandler()
+int cellGcmSetVBlankHandler(u32 handler_addr)
 {
-	UNIMPLEMENTED_FUNC(cellGcmSys);
+	cellGcmSys.Warning("cellGcmSetVBlankHandler(handler_addr=0x%x)", handler_addr);
+	if (handler_addr != 0 && !Memory.IsGoodAddr(handler_addr))
+	{
+		return CELL_EFAULT;
+	}
+
+	Emu.GetGSManager().GetRender().m_vblank_handler.SetAddr(handler_addr);
 	return CELL_OK;
 }
 
+u32 cellGcmGetVBlankCount()
+{
+	cellGcmSys.Log("cellGcmGetVBlankCount()");
+	return Emu.GetGSManager().GetRender().m_vblank_count;
+}
+
 int cellGcmSetWaitFlip(mem_ptr_t<CellGcmContextData> ctxt)
 {
 	cellGcmSys.Log("cellGcmSetWaitFlip(ctx=0x%x)", ctxt.GetAddr());
@@ -887,7 +899,7 @@ void cellGcmSys_init()
 	//cellGcmSys.AddFunc(0x63387071, cellGcmgetLastFlipTime);
 	//cellGcmSys.AddFunc(0x23ae55a3, cellGcmGetLastSecondVTime);
 	cellGcmSys.AddFunc(0x055bd74d, cellGcmGetTiledPitchSize);
-	//cellGcmSys.AddFunc(0x723bbc7e, cellGcmGetVBlankCount);
+	cellGcmSys.AddFunc(0x723bbc7e, cellGcmGetVBlankCount);
 	cellGcmSys.AddFunc(0x15bae46b, cellGcmInit);
 	//cellGcmSys.AddFunc(0xfce9e764, cellGcmInitSystemMode);
 	cellGcmSys.AddFunc(0xb2e761d4, cellGcmResetFlipStatus);
@@ -2,12 +2,25 @@
 #include "Emu/SysCalls/SysCalls.h"
 #include "Emu/SysCalls/SC_FUNC.h"
 #include "cellGifDec.h"
+#include "ImageDecoder.h"
 
 #include "stblib/stb_image.h"
 #include "stblib/stb_image.c" // (TODO: Should we put this elsewhere?)
 
 void cellGifDec_init();
-Module cellGifDec(0xf010, cellGifDec_init);
+void cellGifDec_unload();
+Module cellGifDec(0xf010, cellGifDec_init, nullptr, cellGifDec_unload);
+
+// Read the whole file and queue it for decoding, so that it runs in the background until DecodeData
+void gifDecStart(CellGifDecSubHandle* subHandle_data)
+{
+	std::vector<u8> stream;
+
+	if (imageReadFile(subHandle_data->fd, subHandle_data->fileSize, stream))
+	{
+		subHandle_data->decode = imageDecodeAsync(stream);
+	}
+}
 
 int cellGifDecCreate(u32 mainHandle, u32 threadInParam, u32 threadOutParam)
 {
@@ -67,6 +80,8 @@ int cellGifDecOpen(u32 mainHandle, mem32_t subHandle, const mem_ptr_t<CellGifDec
 	if(ret != CELL_OK) return ret;
 	current_subHandle->fileSize = sb->st_size; // Get CellFsStat.st_size
 
+	gifDecStart(current_subHandle);
+
 	// From now, every u32 subHandle argument is a pointer to a CellPngDecSubHandle struct.
 	subHandle = cellGifDec.GetNewId(current_subHandle);
 
@@ -155,37 +170,29 @@ int cellGifDecDecodeData(u32 mainHandle, u32 subHandle, mem8_ptr_t data, const m
 	if(!cellGifDec.CheckId(subHandle, subHandle_data))
 		return CELL_GIFDEC_ERROR_FATAL;
 
-	const u32& fd = subHandle_data->fd;
-	const u64& fileSize = subHandle_data->fileSize;
 	const CellGifDecOutParam& current_outParam = subHandle_data->outParam; 
 
-	//Copy the GIF file to a buffer
-	MemoryAllocator<unsigned char> gif(fileSize);
-	MemoryAllocator<u64> pos, nread;
-	cellFsLseek(fd, 0, CELL_SEEK_SET, pos);
-	cellFsRead(fd, gif.GetAddr(), gif.GetSize(), nread);
-
-	//Decode GIF file. (TODO: Is there any faster alternative? Can we do it without external libraries?)
-	int width, height, actual_components;
-	std::shared_ptr<unsigned char> image(stbi_load_from_memory(gif, fileSize, &width, &height, &actual_components, 4));
-	if (!image)	return CELL_GIFDEC_ERROR_STREAM_FORMAT;
+	if (!subHandle_data->decode)
+	{
+		gifDecStart(subHandle_data);
+	}
 
-	uint image_size = width * height * 4;
+	std::shared_ptr<const DecodedImage> image;
+	if (subHandle_data->decode)
+	{
+		image = subHandle_data->decode->Wait();
+	}
+	if (!image) return CELL_GIFDEC_ERROR_STREAM_FORMAT;
 
+	// rows are converted straight into the guest buffer with the requested pitch
 	switch(current_outParam.outputColorSpace)
 	{
 	case CELL_GIFDEC_RGBA:
-		Memory.CopyFromReal(data.GetAddr(), image.get(), image_size);
+		imageWriteToGuest(*image, data.GetAddr(), dataCtrlParam->outputBytesPerLine, IMAGE_OUTPUT_RGBA);
 	break;
 
 	case CELL_GIFDEC_ARGB:
-		for(uint i = 0; i < image_size; i+=4)
-		{
-			data += image.get()[i+3];
-			data += image.get()[i+0];
-			data += image.get()[i+1];
-			data += image.get()[i+2];
-		}
+		imageWriteToGuest(*image, data.GetAddr(), dataCtrlParam->outputBytesPerLine, IMAGE_OUTPUT_ARGB);
 	break;
 
 	default:
@@ -232,3 +239,8 @@ void cellGifDec_init()
 	cellGifDec.AddFunc(0x95cae771, cellGifDecExtSetParameter);
 	cellGifDec.AddFunc(0x02e7e03e, cellGifDecExtDecodeData);*/
 }
+
+void cellGifDec_unload()
+{
+	imageDecoderStop();
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+class ImageDecodeJob;
+
 
 //Return Codes
 enum
@@ -111,4 +113,5 @@ struct CellGifDecSubHandle //Custom struct
 	u64 fileSize;
 	CellGifDecInfo info;
 	CellGifDecOutParam outParam;
+	std::shared_ptr<ImageDecodeJob> decode; // started by Open, see ImageDecoder.h
 };
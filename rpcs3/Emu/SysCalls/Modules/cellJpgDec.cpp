@@ -2,10 +2,22 @@
 #include "Emu/SysCalls/SysCalls.h"
 #include "Emu/SysCalls/SC_FUNC.h"
 #include "cellJpgDec.h"
-#include "stblib/stb_image.h"
+#include "ImageDecoder.h"
 
 void cellJpgDec_init();
-Module cellJpgDec(0x000f, cellJpgDec_init);
+void cellJpgDec_unload();
+Module cellJpgDec(0x000f, cellJpgDec_init, nullptr, cellJpgDec_unload);
+
+// Read the whole file and queue it for decoding, so that it runs in the background until DecodeData
+void jpgDecStart(CellJpgDecSubHandle* subHandle_data)
+{
+	std::vector<u8> stream;
+
+	if (imageReadFile(subHandle_data->fd, subHandle_data->fileSize, stream))
+	{
+		subHandle_data->decode = imageDecodeAsync(stream);
+	}
+}
 
 int cellJpgDecCreate(u32 mainHandle, u32 threadInParam, u32 threadOutParam)
 {
@@ -47,6 +59,8 @@ int cellJpgDecOpen(u32 mainHandle, mem32_t subHandle, mem_ptr_t<CellJpgDecSrc> s
 	if(ret != CELL_OK) return ret;
 	current_subHandle->fileSize = sb->st_size;	// Get CellFsStat.st_size
 
+	jpgDecStart(current_subHandle);
+
 	// From now, every u32 subHandle argument is a pointer to a CellPngDecSubHandle struct.
 	subHandle = cellJpgDec.GetNewId(current_subHandle);
 
@@ -136,41 +150,34 @@ int cellJpgDecDecodeData(u32 mainHandle, u32 subHandle, mem8_ptr_t data, const m
 	if(!cellJpgDec.CheckId(subHandle, subHandle_data))
 		return CELL_JPGDEC_ERROR_FATAL;
 
-	const u32& fd = subHandle_data->fd;
-	const u64& fileSize = subHandle_data->fileSize;
 	const CellJpgDecOutParam& current_outParam = subHandle_data->outParam; 
 
-	//Copy the JPG file to a buffer
-	MemoryAllocator<unsigned char> jpg(fileSize);
-	MemoryAllocator<u64> pos, nread;
-	cellFsLseek(fd, 0, CELL_SEEK_SET, pos);
-	cellFsRead(fd, jpg.GetAddr(), jpg.GetSize(), nread);
-
-	//Decode JPG file. (TODO: Is there any faster alternative? Can we do it without external libraries?)
-	int width, height, actual_components;
-	std::shared_ptr<unsigned char> image(stbi_load_from_memory(jpg, fileSize, &width, &height, &actual_components, 4));
+	if (!subHandle_data->decode)
+	{
+		jpgDecStart(subHandle_data);
+	}
 
+	std::shared_ptr<const DecodedImage> image;
+	if (subHandle_data->decode)
+	{
+		image = subHandle_data->decode->Wait();
+	}
 	if (!image) return CELL_JPGDEC_ERROR_STREAM_FORMAT;
 
-	uint image_size = width * height;
+	// rows are converted straight into the guest buffer with the requested pitch
+	u32 lines = 0;
 	switch(current_outParam.outputColorSpace)
 	{
 	case CELL_JPG_RGBA:
+		lines = imageWriteToGuest(*image, data.GetAddr(), dataCtrlParam->outputBytesPerLine, IMAGE_OUTPUT_RGBA);
+	break;
+
 	case CELL_JPG_RGB:
-		image_size *= current_outParam.outputColorSpace == CELL_JPG_RGBA ? 4 : 3;
-		Memory.CopyFromReal(data.GetAddr(), image.get(), image_size);
+		lines = imageWriteToGuest(*image, data.GetAddr(), dataCtrlParam->outputBytesPerLine, IMAGE_OUTPUT_RGB);
 	break;
 
 	case CELL_JPG_ARGB:
-		image_size *= 4;
-
-		for(u32 i = 0; i < image_size; i+=4)
-		{
-			data += image.get()[i+3];
-			data += image.get()[i+0];
-			data += image.get()[i+1];
-			data += image.get()[i+2];
-		}
+		lines = imageWriteToGuest(*image, data.GetAddr(), dataCtrlParam->outputBytesPerLine, IMAGE_OUTPUT_ARGB);
 	break;
 
 	case CELL_JPG_GRAYSCALE:
@@ -187,8 +194,7 @@ int cellJpgDecDecodeData(u32 mainHandle, u32 subHandle, mem8_ptr_t data, const m
 
 	dataOutInfo->status = CELL_JPGDEC_DEC_STATUS_FINISH;
 
-	if(dataCtrlParam->outputBytesPerLine)
-		dataOutInfo->outputLines = image_size / dataCtrlParam->outputBytesPerLine;
+	dataOutInfo->outputLines = lines;
 
 	return CELL_OK;
 }
@@ -253,3 +259,8 @@ void cellJpgDec_init()
 	cellJpgDec.AddFunc(0x65cbbb16, cellJpgDecExtSetParameter);
 	cellJpgDec.AddFunc(0x716f8792, cellJpgDecExtDecodeData);*/
 }
+
+void cellJpgDec_unload()
+{
+	imageDecoderStop();
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+class ImageDecodeJob;
+
 //Return Codes
 enum
 {
@@ -98,4 +100,5 @@ struct CellJpgDecSubHandle //Custom struct
 	u64 fileSize;
 	CellJpgDecInfo info;
 	CellJpgDecOutParam outParam;
+	std::shared_ptr<ImageDecodeJob> decode; // started by Open, see ImageDecoder.h
 };
\ No newline at end of file
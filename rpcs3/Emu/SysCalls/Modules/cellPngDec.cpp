@@ -2,10 +2,29 @@
 #include "Emu/SysCalls/SysCalls.h"
 #include "Emu/SysCalls/SC_FUNC.h"
 #include "cellPngDec.h"
-#include "stblib/stb_image.h"
+#include "ImageDecoder.h"
 
 void cellPngDec_init();
-Module cellPngDec(0x0018, cellPngDec_init);
+void cellPngDec_unload();
+Module cellPngDec(0x0018, cellPngDec_init, nullptr, cellPngDec_unload);
+
+// Read the whole stream and queue it for decoding, so that it runs in the background until DecodeData
+void pngDecStart(CellPngDecSubHandle* subHandle_data)
+{
+	std::vector<u8> stream;
+
+	switch(subHandle_data->src.srcSelect.ToLE())
+	{
+	case CELL_PNGDEC_BUFFER:
+		if (!imageReadBuffer(subHandle_data->src.streamPtr.ToLE(), subHandle_data->fileSize, stream)) return;
+		break;
+	case CELL_PNGDEC_FILE:
+		if (!imageReadFile(subHandle_data->fd, subHandle_data->fileSize, stream)) return;
+		break;
+	}
+
+	subHandle_data->decode = imageDecodeAsync(stream);
+}
 
 int cellPngDecCreate(u32 mainHandle, u32 threadInParam, u32 threadOutParam)
 {
@@ -53,6 +72,8 @@ int cellPngDecOpen(u32 mainHandle, mem32_t subHandle, mem_ptr_t<CellPngDecSrc> s
 		break;
 	}
 
+	pngDecStart(current_subHandle);
+
 	// From now, every u32 subHandle argument is a pointer to a CellPngDecSubHandle struct.
 	subHandle = cellPngDec.GetNewId(current_subHandle);
 
@@ -143,91 +164,33 @@ int cellPngDecDecodeData(u32 mainHandle, u32 subHandle, mem8_ptr_t data, const m
 	if(!cellPngDec.CheckId(subHandle, subHandle_data))
 		return CELL_PNGDEC_ERROR_FATAL;
 
-	const u32& fd = subHandle_data->fd;
-	const u64& fileSize = subHandle_data->fileSize;
 	const CellPngDecOutParam& current_outParam = subHandle_data->outParam;
 
-	//Copy the PNG file to a buffer
-	MemoryAllocator<unsigned char> png(fileSize);
-	MemoryAllocator<u64> pos, nread;
-
-	switch(subHandle_data->src.srcSelect.ToLE())
+	if (!subHandle_data->decode)
 	{
-	case CELL_PNGDEC_BUFFER:
-		Memory.Copy(png.GetAddr(), subHandle_data->src.streamPtr.ToLE(), png.GetSize());
-		break;
-	case CELL_PNGDEC_FILE:
-		cellFsLseek(fd, 0, CELL_SEEK_SET, pos.GetAddr());
-		cellFsRead(fd, png.GetAddr(), png.GetSize(), nread.GetAddr());
-		break;
+		pngDecStart(subHandle_data);
 	}
 
-	//Decode PNG file. (TODO: Is there any faster alternative? Can we do it without external libraries?)
-	int width, height, actual_components;
-	auto image = std::unique_ptr<unsigned char,decltype(&::free)>
-			(
-				stbi_load_from_memory(png.GetPtr(), fileSize, &width, &height, &actual_components, 4),
-				&::free
-			);
-	if (!image)	return CELL_PNGDEC_ERROR_STREAM_FORMAT;
+	std::shared_ptr<const DecodedImage> image;
+	if (subHandle_data->decode)
+	{
+		image = subHandle_data->decode->Wait();
+	}
+	if (!image) return CELL_PNGDEC_ERROR_STREAM_FORMAT;
 
-	uint image_size = width * height;
+	// rows are converted straight into the guest buffer with the requested pitch
 	switch(current_outParam.outputColorSpace)
 	{
 	case CELL_PNGDEC_RGB:
+		imageWriteToGuest(*image, data.GetAddr(), dataCtrlParam->outputBytesPerLine, IMAGE_OUTPUT_RGB);
+	break;
+
 	case CELL_PNGDEC_RGBA:
-	{
-		const char nComponents = (CELL_PNGDEC_RGBA ? 4 : 3);
-		image_size *= nComponents;
-		if (dataCtrlParam->outputBytesPerLine > width * nComponents) //check if we need padding
-		{
-			//TODO: find out if we can't do padding without an extra copy
-			char *output = (char *) malloc(dataCtrlParam->outputBytesPerLine*height);
-			for (int i = 0; i < height; i++)
-			{
-				memcpy(&output[i*dataCtrlParam->outputBytesPerLine], &image.get()[width*nComponents*i], width*nComponents);
-			}
-			Memory.CopyFromReal(data.GetAddr(), output, dataCtrlParam->outputBytesPerLine*height);
-			free(output);
-		}
-		else
-		{
-			Memory.CopyFromReal(data.GetAddr(), image.get(), image_size);
-		}
-	}
+		imageWriteToGuest(*image, data.GetAddr(), dataCtrlParam->outputBytesPerLine, IMAGE_OUTPUT_RGBA);
 	break;
 
 	case CELL_PNGDEC_ARGB:
-	{
-		const char nComponents = 4;
-		image_size *= nComponents;
-		if (dataCtrlParam->outputBytesPerLine > width * nComponents) //check if we need padding
-		{
-			//TODO: find out if we can't do padding without an extra copy
-			char *output = (char *) malloc(dataCtrlParam->outputBytesPerLine*height);
-			for (int i = 0; i < height; i++)
-			{
-				for (int j = 0; j < width * nComponents; j += nComponents){
-					output[i*dataCtrlParam->outputBytesPerLine + j	  ] = image.get()[i*width * nComponents + j + 3];
-					output[i*dataCtrlParam->outputBytesPerLine + j + 1] = image.get()[i*width * nComponents + j + 0];
-					output[i*dataCtrlParam->outputBytesPerLine + j + 2] = image.get()[i*width * nComponents + j + 1];
-					output[i*dataCtrlParam->outputBytesPerLine + j + 3] = image.get()[i*width * nComponents + j + 2];
-				}
-			}
-			Memory.CopyFromReal(data.GetAddr(), output, dataCtrlParam->outputBytesPerLine*height);
-			free(output);
-		}
-		else
-		{
-			for (uint i = 0; i < image_size; i += nComponents)
-			{
-				data += image.get()[i + 3];
-				data += image.get()[i + 0];
-				data += image.get()[i + 1];
-				data += image.get()[i + 2];
-			}
-		}
-	}
+		imageWriteToGuest(*image, data.GetAddr(), dataCtrlParam->outputBytesPerLine, IMAGE_OUTPUT_ARGB);
 	break;
 
 	case CELL_PNGDEC_GRAYSCALE:
@@ -319,3 +282,8 @@ void cellPngDec_init()
 	cellPngDec.AddFunc(0x609ec7d5, cellPngDecUnknownChunks);
 	cellPngDec.AddFunc(0xb40ca175, cellPngDecGetTextChunk);*/
 }
+
+void cellPngDec_unload()
+{
+	imageDecoderStop();
+}
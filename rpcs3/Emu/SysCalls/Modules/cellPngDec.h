@@ -1,5 +1,7 @@
 #pragma once
 
+class ImageDecodeJob;
+
 //Return Codes
 enum
 {
@@ -116,4 +118,5 @@ struct CellPngDecSubHandle
 	CellPngDecInfo info;
 	CellPngDecOutParam outParam;
 	CellPngDecSrc src;
+	std::shared_ptr<ImageDecodeJob> decode; // started by Open, see ImageDecoder.h
 };
\ No newline at end of file
@@ -2,10 +2,54 @@
 #include "cellSpurs.h"
 #include "Emu/SysCalls/SysCalls.h"
 #include "Emu/SysCalls/SC_FUNC.h"
+#include "Emu/CPU/SpinWait.h"
 
 void cellSpurs_init();
 Module cellSpurs(0x000a, cellSpurs_init);
 
+// the error codes of the manager errors
+static int CoreError(const SPURSError err)
+{
+	return err == SPURS_OK ? CELL_OK : (CELL_SPURS_CORE_ERROR_AGAIN & ~0xff) | err;
+}
+
+static int TaskError(const SPURSError err)
+{
+	return err == SPURS_OK ? CELL_OK : (CELL_SPURS_TASK_ERROR_AGAIN & ~0xff) | err;
+}
+
+static int SpursInitialize(const u32 spurs_addr, const SPURSManagerAttribute& attr)
+{
+	if(spurs_addr % CELL_SPURS_ALIGN)
+		return CELL_SPURS_CORE_ERROR_ALIGN;
+
+	if(attr.nSpus < 1 || attr.nSpus > CELL_SPURS_MAX_SPU)
+		return CELL_SPURS_CORE_ERROR_INVAL;
+
+	SPURSManager* manager = new SPURSManager(spurs_addr, attr);
+
+	const u32 id = cellSpurs.GetNewId(manager);
+
+	if(!id)
+	{
+		delete manager;
+		return CELL_SPURS_CORE_ERROR_NOMEM;
+	}
+
+	Memory.Write32(spurs_addr, id);
+	manager->Start();
+
+	return CELL_OK;
+}
+
+static SPURSManagerAttribute SpursAttribute(const CellSpursAttribute& attr)
+{
+	SPURSManagerAttribute result(attr.nSpus, attr.spuThreadGroupPriority, attr.ppuThreadPriority, attr.exitIfNoWork != 0);
+	result.namePrefix = std::string(attr.namePrefix, std::min<u32>(attr.namePrefixLength, CELL_SPURS_NAME_MAX_LENGTH));
+	result.threadGroupType = attr.threadGroupType;
+	return result;
+}
+
 int cellSpursInitialize(mem_ptr_t<CellSpurs> spurs, int nSpus, int spuPriority, 
 									int ppuPriority, bool exitIfNoWork)
 {
@@ -15,10 +59,7 @@ int cellSpursInitialize(mem_ptr_t<CellSpurs> spurs, int nSpus, int spuPriority,
 	if(!spurs.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
-	SPURSManagerAttribute *attr = new SPURSManagerAttribute(nSpus, spuPriority, ppuPriority, exitIfNoWork);
-	spurs->spurs = new SPURSManager(attr);
-
-	return CELL_OK;
+	return SpursInitialize(spurs.GetAddr(), SPURSManagerAttribute(nSpus, spuPriority, ppuPriority, exitIfNoWork));
 }
 
 int cellSpursFinalize(mem_ptr_t<CellSpurs> spurs)
@@ -28,7 +69,15 @@ int cellSpursFinalize(mem_ptr_t<CellSpurs> spurs)
 	if(!spurs.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
-	spurs->spurs->Finalize();
+	const u32 id = spurs->id;
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(id);
+
+	if(!manager)
+		return CELL_SPURS_CORE_ERROR_STAT;
+
+	manager->Finalize();
+	Emu.GetIdManager().RemoveID(id);
+	spurs->id = 0;
 
 	return CELL_OK;
 }
@@ -41,9 +90,7 @@ int cellSpursInitializeWithAttribute(mem_ptr_t<CellSpurs> spurs, const mem_ptr_t
 	if(!attr.IsGood() || !spurs.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
-	spurs->spurs = new SPURSManager(attr->attr);
-
-	return CELL_OK;
+	return SpursInitialize(spurs.GetAddr(), SpursAttribute(*attr));
 }
 
 int cellSpursInitializeWithAttribute2(mem_ptr_t<CellSpurs2> spurs, const mem_ptr_t<CellSpursAttribute> attr)
@@ -54,9 +101,7 @@ int cellSpursInitializeWithAttribute2(mem_ptr_t<CellSpurs2> spurs, const mem_ptr
 	if(!attr.IsGood() || !spurs.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
-	spurs->spurs = new SPURSManager(attr->attr);
-
-	return CELL_OK;
+	return SpursInitialize(spurs.GetAddr(), SpursAttribute(*attr));
 }
 
 int _cellSpursAttributeInitialize(mem_ptr_t<CellSpursAttribute> attr, int nSpus, int spuPriority, 
@@ -68,7 +113,11 @@ int _cellSpursAttributeInitialize(mem_ptr_t<CellSpursAttribute> attr, int nSpus,
 	if(!attr.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
-	attr->attr = new SPURSManagerAttribute(nSpus, spuPriority, ppuPriority, exitIfNoWork);
+	memset(Memory + attr.GetAddr(), 0, sizeof(CellSpursAttribute));
+	attr->nSpus = nSpus;
+	attr->spuThreadGroupPriority = spuPriority;
+	attr->ppuThreadPriority = ppuPriority;
+	attr->exitIfNoWork = exitIfNoWork;
 
 	return CELL_OK;
 }
@@ -95,7 +144,9 @@ int cellSpursAttributeSetNamePrefix(mem_ptr_t<CellSpursAttribute> attr, const me
 	if(size > 15)
 		return CELL_SPURS_CORE_ERROR_INVAL;
 
-	attr->attr->_setNamePrefix(Memory.ReadString(prefix.GetAddr(), size).c_str(), size);
+	memset(attr->namePrefix, 0, sizeof(attr->namePrefix));
+	memcpy(attr->namePrefix, Memory.ReadString(prefix.GetAddr(), size).c_str(), size);
+	attr->namePrefixLength = size;
 
 	return CELL_OK;
 }
@@ -117,7 +168,7 @@ int cellSpursAttributeSetSpuThreadGroupType(mem_ptr_t<CellSpursAttribute> attr,
 	if(!attr.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
-	attr->attr->_setSpuThreadGroupType(type);
+	attr->threadGroupType = type;
 
 	return CELL_OK;
 }
@@ -140,57 +191,99 @@ int cellSpursAttributeEnableSystemWorkload(mem_ptr_t<CellSpursAttribute> attr, c
 
 int cellSpursGetSpuThreadGroupId(mem_ptr_t<CellSpurs> spurs, mem32_t group)
 {
-	cellSpurs.Error("cellSpursGetSpuThreadGroupId(spurs_addr=0x%x, group_addr=0x%x)", 
+	cellSpurs.Warning("cellSpursGetSpuThreadGroupId(spurs_addr=0x%x, group_addr=0x%x)", 
 		spurs.GetAddr(), group.GetAddr());
 
-	if(!spurs.IsGood() || group.IsGood())
+	if(!spurs.IsGood() || !group.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(spurs->id);
+
+	if(!manager)
+		return CELL_SPURS_CORE_ERROR_STAT;
+
+	// the kernel SPUs are native threads without group
+	group = 0;
+
 	return CELL_OK;
 }
 
 int cellSpursGetNumSpuThread(mem_ptr_t<CellSpurs> spurs, mem32_t nThreads)
 {
-	cellSpurs.Error("cellSpursGetNumSpuThread(spurs_addr=0x%x, nThreads_addr=0x%x)", 
+	cellSpurs.Warning("cellSpursGetNumSpuThread(spurs_addr=0x%x, nThreads_addr=0x%x)", 
 		spurs.GetAddr(), nThreads.GetAddr());
 	
-	if(!spurs.IsGood() || nThreads.IsGood())
+	if(!spurs.IsGood() || !nThreads.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(spurs->id);
+
+	if(!manager)
+		return CELL_SPURS_CORE_ERROR_STAT;
+
+	nThreads = manager->GetSpuCount();
+
 	return CELL_OK;
 }
 
 int cellSpursGetSpuThreadId(mem_ptr_t<CellSpurs> spurs, mem32_t thread, mem32_t nThreads)
 {
-	cellSpurs.Error("cellSpursGetSpuThreadId(spurs_addr=0x%x, thread_addr=0x%x, nThreads_addr=0x%x)", 
+	cellSpurs.Warning("cellSpursGetSpuThreadId(spurs_addr=0x%x, thread_addr=0x%x, nThreads_addr=0x%x)", 
 		spurs.GetAddr(), thread.GetAddr(), nThreads.GetAddr());
 	
-	if(!spurs.IsGood() || !thread.IsGood() || nThreads.IsGood())
+	if(!spurs.IsGood() || !thread.IsGood() || !nThreads.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(spurs->id);
+
+	if(!manager)
+		return CELL_SPURS_CORE_ERROR_STAT;
+
+	const u32 count = std::min<u32>(nThreads, manager->GetSpuCount());
+
+	for(u32 i = 0; i < count; i++)
+	{
+		Memory.Write32(thread.GetAddr() + i * 4, manager->GetSpuThreadId(i));
+	}
+
+	nThreads = count;
+
 	return CELL_OK;
 }
 
 int cellSpursSetMaxContention(mem_ptr_t<CellSpurs> spurs, u32 workloadId, u32 maxContention)
 {
-	cellSpurs.Error("cellSpursSetMaxContention(spurs_addr=0x%x, workloadId=%u, maxContention=%u)", 
+	cellSpurs.Warning("cellSpursSetMaxContention(spurs_addr=0x%x, workloadId=%u, maxContention=%u)", 
 		spurs.GetAddr(), workloadId, maxContention);
 	
 	if(!spurs.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
-	return CELL_OK;
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(spurs->id);
+
+	if(!manager)
+		return CELL_SPURS_CORE_ERROR_STAT;
+
+	return CoreError(manager->SetMaxContention(workloadId, maxContention));
 }
 
-int cellSpursSetPriorities(mem_ptr_t<CellSpurs> spurs, u32 workloadId, const u8 priorities[CELL_SPURS_MAX_SPU])
+int cellSpursSetPriorities(mem_ptr_t<CellSpurs> spurs, u32 workloadId, mem8_t priorities)
 {
-	cellSpurs.Error("cellSpursSetPriorities(spurs_addr=0x%x, workloadId=%u, priorities[%u])", 
-		spurs.GetAddr(), workloadId, priorities);
+	cellSpurs.Warning("cellSpursSetPriorities(spurs_addr=0x%x, workloadId=%u, priorities_addr=0x%x)", 
+		spurs.GetAddr(), workloadId, priorities.GetAddr());
 	
-	if(!spurs.IsGood())
+	if(!spurs.IsGood() || !priorities.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
-	return CELL_OK;
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(spurs->id);
+
+	if(!manager)
+		return CELL_SPURS_CORE_ERROR_STAT;
+
+	u8 priority[CELL_SPURS_MAX_SPU];
+	for(u32 i = 0; i < CELL_SPURS_MAX_SPU; i++) priority[i] = Memory.Read8(priorities.GetAddr() + i);
+
+	return CoreError(manager->SetPriorities(workloadId, priority));
 }
 
 int cellSpursSetPriority(mem_ptr_t<CellSpurs> spurs, u32 workloadId, u32 spuId, u32 priority)
@@ -217,33 +310,117 @@ int cellSpursSetPreemptionVictimHints(mem_ptr_t<CellSpurs> spurs, const bool isP
 
 int cellSpursAttachLv2EventQueue(mem_ptr_t<CellSpurs> spurs, u32 queue, mem8_t port, int isDynamic)
 {
-	cellSpurs.Error("cellSpursAttachLv2EventQueue(spurs_addr=0x%x, queue=0x%x, port_addr=0x%x, isDynamic=%u)", 
+	cellSpurs.Warning("cellSpursAttachLv2EventQueue(spurs_addr=0x%x, queue=0x%x, port_addr=0x%x, isDynamic=%u)", 
 						spurs.GetAddr(), queue, port.GetAddr(), isDynamic);
 	
 	if(!spurs.IsGood() || !port.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(spurs->id);
+
+	if(!manager)
+		return CELL_SPURS_CORE_ERROR_STAT;
+
+	u8 spup = port;
+	const SPURSError err = manager->AttachQueue(queue, spup, isDynamic != 0);
+
+	if(err != SPURS_OK)
+		return CoreError(err);
+
+	port = spup;
+
 	return CELL_OK;
 }
 
 int cellSpursDetachLv2EventQueue(mem_ptr_t<CellSpurs> spurs, u8 port)
 {
-	cellSpurs.Error("cellSpursDetachLv2EventQueue(spurs_addr=0x%x, port=0x%x)", spurs.GetAddr(), port);
+	cellSpurs.Warning("cellSpursDetachLv2EventQueue(spurs_addr=0x%x, port=0x%x)", spurs.GetAddr(), port);
 	
 	if(!spurs.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
-	return CELL_OK;
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(spurs->id);
+
+	if(!manager)
+		return CELL_SPURS_CORE_ERROR_STAT;
+
+	return CoreError(manager->DetachQueue(port));
+}
+
+// the state word of CellSpursEventFlag
+struct SpursEventFlagState
+{
+	be_t<u16> events;
+	be_t<u16> waiters;
+};
+
+static_assert(sizeof(SpursEventFlagState) == 4, "SpursEventFlagState: wrong sizeof");
+
+// applies the update to the state of the flag atomically and wakes its waiters, returns false
+// (nothing written) if the update refuses the state
+template<typename F> static bool EventFlagUpdate(mem_ptr_t<CellSpursEventFlag> event_flag, F update)
+{
+	while(true)
+	{
+		const u32 old_data = event_flag->m_data();
+		SpursEventFlagState state;
+		memcpy(&state, &old_data, 4);
+
+		if(!update(state)) return false;
+
+		u32 new_data;
+		memcpy(&new_data, &state, 4);
+
+		if(InterlockedCompareExchange(&event_flag->m_data(), new_data, old_data) == old_data) break;
+	}
+
+	g_parking_lot.NotifyWrite(event_flag.GetAddr(), 4);
+	return true;
+}
+
+// the events satisfying the wait, 0 if it isn't satisfied
+static u16 EventFlagMatch(const u16 events, const u16 bits, const u32 mode)
+{
+	const u16 match = events & bits;
+	return (mode == CELL_SPURS_EVENT_FLAG_AND ? match == bits : match != 0) ? match : 0;
+}
+
+// takes the events of a satisfied wait (auto clear mode), returns the events of the flag
+static bool EventFlagTryTake(mem_ptr_t<CellSpursEventFlag> event_flag, const u16 bits, const u32 mode, const bool waiter, u16& result)
+{
+	const bool clear = event_flag->clearMode == CELL_SPURS_EVENT_FLAG_CLEAR_AUTO;
+
+	return EventFlagUpdate(event_flag, [&](SpursEventFlagState& state)
+	{
+		if(!EventFlagMatch(state.events, bits, mode)) return false;
+
+		result = state.events;
+		if(clear) state.events &= ~bits;
+		if(waiter) state.waiters--;
+		return true;
+	});
 }
 
 int _cellSpursEventFlagInitialize(mem_ptr_t<CellSpurs> spurs, mem_ptr_t<CellSpursTaskset> taskset,
 								  mem_ptr_t<CellSpursEventFlag> eventFlag, u32 flagClearMode, u32 flagDirection)
 {
-	cellSpurs.Error("_cellSpursEventFlagInitialize(spurs_addr=0x%x, taskset_addr=0x%x, eventFlag_addr=0x%x, flagClearMode=%u, flagDirection=%u)", 
+	cellSpurs.Warning("_cellSpursEventFlagInitialize(spurs_addr=0x%x, taskset_addr=0x%x, eventFlag_addr=0x%x, flagClearMode=%u, flagDirection=%u)", 
 		spurs.GetAddr(), taskset.GetAddr(), eventFlag.GetAddr(), flagClearMode, flagDirection);
 	
-	if(!spurs.IsGood() || !taskset.IsGood() || !eventFlag.IsGood())
-		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
+	if((!spurs.IsGood() && !taskset.IsGood()) || !eventFlag.IsGood())
+		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
+
+	if(eventFlag.GetAddr() % 128)
+		return CELL_SPURS_TASK_ERROR_ALIGN;
+
+	if(flagClearMode > CELL_SPURS_EVENT_FLAG_CLEAR_MANUAL || flagDirection > CELL_SPURS_EVENT_FLAG_ANY2ANY)
+		return CELL_SPURS_TASK_ERROR_INVAL;
+
+	memset(Memory + eventFlag.GetAddr(), 0, sizeof(CellSpursEventFlag));
+	eventFlag->direction = flagDirection;
+	eventFlag->clearMode = flagClearMode;
+	eventFlag->taskset_addr = taskset.GetAddr();
+	g_parking_lot.NotifyWrite(eventFlag.GetAddr(), 4);
 
 	return CELL_OK;
 }
@@ -270,11 +447,144 @@ int cellSpursEventFlagDetachLv2EventQueue(mem_ptr_t<CellSpursEventFlag> event_fl
 
 int cellSpursEventFlagWait(mem_ptr_t<CellSpursEventFlag> event_flag, mem16_t flag_bits, u32 wait_mode)
 {
-	cellSpurs.Error("cellSpursEventFlagWait(event_flag_addr=0x%x, flag_bits_addr=0x%x, wait_mode=%u)", 
+	cellSpurs.Log("cellSpursEventFlagWait(event_flag_addr=0x%x, flag_bits_addr=0x%x, wait_mode=%u)", 
 		event_flag.GetAddr(), flag_bits.GetAddr(), wait_mode);
 	
 	if(!event_flag.IsGood() || !flag_bits.IsGood())
-		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
+		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
+
+	if(event_flag.GetAddr() % 128)
+		return CELL_SPURS_TASK_ERROR_ALIGN;
+
+	const u16 bits = flag_bits;
+
+	if(wait_mode > CELL_SPURS_EVENT_FLAG_AND || !bits)
+		return CELL_SPURS_TASK_ERROR_INVAL;
+
+	if(event_flag->direction != CELL_SPURS_EVENT_FLAG_SPU2PPU && event_flag->direction != CELL_SPURS_EVENT_FLAG_ANY2ANY)
+		return CELL_SPURS_TASK_ERROR_PERM;
+
+	// a single PPU thread waits on the flag
+	const bool registered = EventFlagUpdate(event_flag, [](SpursEventFlagState& state)
+	{
+		if(state.waiters) return false;
+
+		state.waiters = 1;
+		return true;
+	});
+
+	if(!registered)
+		return CELL_SPURS_TASK_ERROR_BUSY;
+
+	u16 result = 0;
+
+	// woken by cellSpursEventFlagSet (notified) or the guest stores to the line of the flag
+	if(!g_parking_lot.WaitUntil(ParkingLot::LineKey(event_flag.GetAddr()), [&]() { return EventFlagTryTake(event_flag, bits, wait_mode, true, result); }))
+	{
+		ConLog.Warning("cellSpursEventFlagWait(event_flag_addr=0x%x) aborted", event_flag.GetAddr());
+		EventFlagUpdate(event_flag, [](SpursEventFlagState& state) { state.waiters = 0; return true; });
+		return CELL_SPURS_TASK_ERROR_SHUTDOWN;
+	}
+
+	flag_bits = result;
+
+	return CELL_OK;
+}
+
+int cellSpursEventFlagTryWait(mem_ptr_t<CellSpursEventFlag> event_flag, mem16_t flag_bits, u32 wait_mode)
+{
+	cellSpurs.Log("cellSpursEventFlagTryWait(event_flag_addr=0x%x, flag_bits_addr=0x%x, wait_mode=%u)", 
+		event_flag.GetAddr(), flag_bits.GetAddr(), wait_mode);
+	
+	if(!event_flag.IsGood() || !flag_bits.IsGood())
+		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
+
+	if(event_flag.GetAddr() % 128)
+		return CELL_SPURS_TASK_ERROR_ALIGN;
+
+	const u16 bits = flag_bits;
+
+	if(wait_mode > CELL_SPURS_EVENT_FLAG_AND || !bits)
+		return CELL_SPURS_TASK_ERROR_INVAL;
+
+	if(event_flag->direction != CELL_SPURS_EVENT_FLAG_SPU2PPU && event_flag->direction != CELL_SPURS_EVENT_FLAG_ANY2ANY)
+		return CELL_SPURS_TASK_ERROR_PERM;
+
+	u16 result;
+
+	if(!EventFlagTryTake(event_flag, bits, wait_mode, false, result))
+		return CELL_SPURS_TASK_ERROR_BUSY;
+
+	flag_bits = result;
+
+	return CELL_OK;
+}
+
+int cellSpursEventFlagSet(mem_ptr_t<CellSpursEventFlag> event_flag, u16 bits)
+{
+	cellSpurs.Log("cellSpursEventFlagSet(event_flag_addr=0x%x, bits=0x%x)", event_flag.GetAddr(), bits);
+	
+	if(!event_flag.IsGood())
+		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
+
+	if(event_flag.GetAddr() % 128)
+		return CELL_SPURS_TASK_ERROR_ALIGN;
+
+	if(event_flag->direction != CELL_SPURS_EVENT_FLAG_PPU2SPU && event_flag->direction != CELL_SPURS_EVENT_FLAG_ANY2ANY)
+		return CELL_SPURS_TASK_ERROR_PERM;
+
+	EventFlagUpdate(event_flag, [bits](SpursEventFlagState& state) { state.events |= bits; return true; });
+
+	return CELL_OK;
+}
+
+int cellSpursEventFlagClear(mem_ptr_t<CellSpursEventFlag> event_flag, u16 bits)
+{
+	cellSpurs.Log("cellSpursEventFlagClear(event_flag_addr=0x%x, bits=0x%x)", event_flag.GetAddr(), bits);
+	
+	if(!event_flag.IsGood())
+		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
+
+	if(event_flag.GetAddr() % 128)
+		return CELL_SPURS_TASK_ERROR_ALIGN;
+
+	EventFlagUpdate(event_flag, [bits](SpursEventFlagState& state) { state.events &= ~bits; return true; });
+
+	return CELL_OK;
+}
+
+int cellSpursEventFlagGetDirection(mem_ptr_t<CellSpursEventFlag> event_flag, mem32_t direction)
+{
+	cellSpurs.Warning("cellSpursEventFlagGetDirection(event_flag_addr=0x%x, direction_addr=0x%x)", event_flag.GetAddr(), direction.GetAddr());
+	
+	if(!event_flag.IsGood() || !direction.IsGood())
+		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
+
+	direction = event_flag->direction;
+
+	return CELL_OK;
+}
+
+int cellSpursEventFlagGetClearMode(mem_ptr_t<CellSpursEventFlag> event_flag, mem32_t clear_mode)
+{
+	cellSpurs.Warning("cellSpursEventFlagGetClearMode(event_flag_addr=0x%x, clear_mode_addr=0x%x)", event_flag.GetAddr(), clear_mode.GetAddr());
+	
+	if(!event_flag.IsGood() || !clear_mode.IsGood())
+		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
+
+	clear_mode = event_flag->clearMode;
+
+	return CELL_OK;
+}
+
+int cellSpursEventFlagGetTasksetAddress(mem_ptr_t<CellSpursEventFlag> event_flag, mem32_t taskset)
+{
+	cellSpurs.Warning("cellSpursEventFlagGetTasksetAddress(event_flag_addr=0x%x, taskset_addr=0x%x)", event_flag.GetAddr(), taskset.GetAddr());
+	
+	if(!event_flag.IsGood() || !taskset.IsGood())
+		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
+
+	taskset = event_flag->taskset_addr;
 
 	return CELL_OK;
 }
@@ -313,63 +623,149 @@ int cellSpursUnsetGlobalExceptionEventHandler(mem_ptr_t<CellSpurs> spurs)
 
 int cellSpursGetInfo(mem_ptr_t<CellSpurs> spurs, mem_ptr_t<CellSpursInfo> info)
 {
-	cellSpurs.Error("cellSpursGetInfo(spurs_addr=0x%x, info_addr=0x%x)", spurs.GetAddr(), info.GetAddr());
+	cellSpurs.Warning("cellSpursGetInfo(spurs_addr=0x%x, info_addr=0x%x)", spurs.GetAddr(), info.GetAddr());
 	
 	if(!spurs.IsGood() || !info.IsGood())
 		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
 
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(spurs->id);
+
+	if(!manager)
+		return CELL_SPURS_CORE_ERROR_STAT;
+
+	const SPURSManagerAttribute& attr = manager->GetAttribute();
+
+	memset(Memory + info.GetAddr(), 0, sizeof(CellSpursInfo));
+	info->nSpus = manager->GetSpuCount();
+	info->spuThreadGroupPriority = attr.spuThreadGroupPriority;
+	info->ppuThreadPriority = attr.ppuThreadPriority;
+	info->exitIfNoWork = attr.exitIfNoWork;
+
+	for(u32 i = 0; i < manager->GetSpuCount(); i++)
+	{
+		info->spuThreads[i] = manager->GetSpuThreadId(i);
+	}
+
+	memcpy(info->namePrefix, attr.namePrefix.c_str(), attr.namePrefix.size());
+	info->namePrefixLength = attr.namePrefix.size();
+
 	return CELL_OK;
 }
 
 int _cellSpursSendSignal(mem_ptr_t<CellSpursTaskset> taskset, u32 taskID)
 {
-	cellSpurs.Error("_cellSpursSendSignal(taskset_addr=0x%x, taskID=%u)", taskset.GetAddr(), taskID);
+	cellSpurs.Log("_cellSpursSendSignal(taskset_addr=0x%x, taskID=%u)", taskset.GetAddr(), taskID);
 	
 	if(!taskset.IsGood())
-		return CELL_SPURS_CORE_ERROR_NULL_POINTER;
+		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
 
-	return CELL_OK;
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(taskset->spurs);
+
+	if(!manager)
+		return CELL_SPURS_TASK_ERROR_SRCH;
+
+	return TaskError(manager->SendSignal(taskset.GetAddr(), taskID));
 }
 
 int cellSpursCreateTaskset(mem_ptr_t<CellSpurs> spurs, mem_ptr_t<CellSpursTaskset> taskset,
 						   u64 args, mem8_t priority, u32 maxContention)
 {
-	cellSpurs.Error("cellSpursCreateTaskset(spurs_addr=0x%x, taskset_addr=0x%x, args=0x%x, priority_addr=0x%x, maxContention=%u)",
+	cellSpurs.Warning("cellSpursCreateTaskset(spurs_addr=0x%x, taskset_addr=0x%x, args=0x%llx, priority_addr=0x%x, maxContention=%u)",
 		spurs.GetAddr(), taskset.GetAddr(), args, priority.GetAddr(), maxContention);
 	
-	if(!spurs.IsGood() || !taskset.IsGood())
+	if(!spurs.IsGood() || !taskset.IsGood() || !priority.IsGood())
 		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
 
+	if(taskset.GetAddr() % CELL_SPURS_ALIGN)
+		return CELL_SPURS_TASK_ERROR_ALIGN;
+
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(spurs->id);
+
+	if(!manager)
+		return CELL_SPURS_TASK_ERROR_STAT;
+
+	u8 priorities[CELL_SPURS_MAX_SPU];
+	for(u32 i = 0; i < CELL_SPURS_MAX_SPU; i++) priorities[i] = Memory.Read8(priority.GetAddr() + i);
+
+	u32 wid;
+	const SPURSError err = manager->AddTaskset(taskset.GetAddr(), args, priorities, maxContention, wid);
+
+	if(err != SPURS_OK)
+		return TaskError(err);
+
+	taskset->spurs = spurs->id;
+	taskset->idWorkload = wid;
+
 	return CELL_OK;
 }
 
 int cellSpursJoinTaskset(mem_ptr_t<CellSpursTaskset> taskset)
 {
-	cellSpurs.Error("cellSpursJoinTaskset(taskset_addr=0x%x)", taskset.GetAddr());
+	cellSpurs.Warning("cellSpursJoinTaskset(taskset_addr=0x%x)", taskset.GetAddr());
 	
 	if(!taskset.IsGood())
 		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
 
-	return CELL_OK;
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(taskset->spurs);
+
+	if(!manager)
+		return CELL_SPURS_TASK_ERROR_SRCH;
+
+	return TaskError(manager->JoinTaskset(taskset.GetAddr()));
 }
 
 int cellSpursGetTasksetId(mem_ptr_t<CellSpursTaskset> taskset, mem32_t workloadId)
 {
-	cellSpurs.Error("cellSpursGetTasksetId(taskset_addr=0x%x, workloadId_addr=0x%x)", taskset.GetAddr(), workloadId.GetAddr());
+	cellSpurs.Warning("cellSpursGetTasksetId(taskset_addr=0x%x, workloadId_addr=0x%x)", taskset.GetAddr(), workloadId.GetAddr());
 	
 	if(!taskset.IsGood() || !workloadId.IsGood())
 		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
 
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(taskset->spurs);
+
+	if(!manager)
+		return CELL_SPURS_TASK_ERROR_SRCH;
+
+	u32 wid;
+	const SPURSError err = manager->GetTasksetId(taskset.GetAddr(), wid);
+
+	if(err != SPURS_OK)
+		return TaskError(err);
+
+	workloadId = wid;
+
 	return CELL_OK;
 }
 
 int cellSpursShutdownTaskset(mem_ptr_t<CellSpursTaskset> taskset)
 {
-	cellSpurs.Error("cellSpursShutdownTaskset(taskset_addr=0x%x)", taskset.GetAddr());
+	cellSpurs.Warning("cellSpursShutdownTaskset(taskset_addr=0x%x)", taskset.GetAddr());
 	
 	if(!taskset.IsGood())
 		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
 
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(taskset->spurs);
+
+	if(!manager)
+		return CELL_SPURS_TASK_ERROR_SRCH;
+
+	return TaskError(manager->ShutdownTaskset(taskset.GetAddr()));
+}
+
+int cellSpursTasksetGetSpursAddress(mem_ptr_t<CellSpursTaskset> taskset, mem32_t spurs)
+{
+	cellSpurs.Warning("cellSpursTasksetGetSpursAddress(taskset_addr=0x%x, spurs_addr=0x%x)", taskset.GetAddr(), spurs.GetAddr());
+	
+	if(!taskset.IsGood() || !spurs.IsGood())
+		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
+
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(taskset->spurs);
+
+	if(!manager)
+		return CELL_SPURS_TASK_ERROR_SRCH;
+
+	spurs = manager->GetAddr();
+
 	return CELL_OK;
 }
 
@@ -377,12 +773,38 @@ int cellSpursCreateTask(mem_ptr_t<CellSpursTaskset> taskset, mem32_t taskID, mem
 						mem_ptr_t<void> context_addr, u32 context_size, mem_ptr_t<CellSpursTaskLsPattern> lsPattern,
 						mem_ptr_t<CellSpursTaskArgument> argument)
 {
-	cellSpurs.Error("cellSpursCreateTask(taskset_addr=0x%x, taskID_addr=0x%x, elf_addr_addr=0x%x, context_addr_addr=0x%x, context_size=%u, lsPattern_addr=0x%x, argument_addr=0x%x)",
+	cellSpurs.Log("cellSpursCreateTask(taskset_addr=0x%x, taskID_addr=0x%x, elf_addr_addr=0x%x, context_addr_addr=0x%x, context_size=%u, lsPattern_addr=0x%x, argument_addr=0x%x)",
 		taskset.GetAddr(), taskID.GetAddr(), elf_addr.GetAddr(), context_addr.GetAddr(), context_size, lsPattern.GetAddr(), argument.GetAddr());
 	
-	if(!taskset.IsGood())
+	if(!taskset.IsGood() || !taskID.IsGood() || !elf_addr.IsGood())
 		return CELL_SPURS_TASK_ERROR_NULL_POINTER;
 
+	if(elf_addr.GetAddr() % 16)
+		return CELL_SPURS_TASK_ERROR_ALIGN;
+
+	IDRef<SPURSManager> manager = cellSpurs.GetRef<SPURSManager>(taskset->spurs);
+
+	if(!manager)
+		return CELL_SPURS_TASK_ERROR_SRCH;
+
+	u32 args[4] = {};
+
+	if(argument.GetAddr())
+	{
+		if(!argument.IsGood())
+			return CELL_SPURS_TASK_ERROR_NULL_POINTER;
+
+		for(u32 i = 0; i < 4; i++) args[i] = argument->u32[i];
+	}
+
+	u32 id;
+	const SPURSError err = manager->CreateTask(taskset.GetAddr(), elf_addr.GetAddr(), context_addr.GetAddr(), context_size, args, id);
+
+	if(err != SPURS_OK)
+		return TaskError(err);
+
+	taskID = id;
+
 	return CELL_OK;
 }
 
@@ -411,10 +833,16 @@ void cellSpurs_init()
 	
 	cellSpurs.AddFunc(0xb9bc6207, cellSpursAttachLv2EventQueue);
 	cellSpurs.AddFunc(0x4e66d483, cellSpursDetachLv2EventQueue);
-	//cellSpurs.AddFunc(0x5ef96465, _cellSpursEventFlagInitialize);
+	cellSpurs.AddFunc(0x5ef96465, _cellSpursEventFlagInitialize);
 	cellSpurs.AddFunc(0x87630976, cellSpursEventFlagAttachLv2EventQueue);
 	cellSpurs.AddFunc(0x22aab31d, cellSpursEventFlagDetachLv2EventQueue);
 	cellSpurs.AddFunc(0x373523d4, cellSpursEventFlagWait);
+	cellSpurs.AddFunc(0x6d2d9339, cellSpursEventFlagTryWait);
+	cellSpurs.AddFunc(0xf5507729, cellSpursEventFlagSet);
+	cellSpurs.AddFunc(0x4ac7bae4, cellSpursEventFlagClear);
+	cellSpurs.AddFunc(0x890f9e5a, cellSpursEventFlagGetDirection);
+	cellSpurs.AddFunc(0x4d1e9373, cellSpursEventFlagGetClearMode);
+	cellSpurs.AddFunc(0x947efb0b, cellSpursEventFlagGetTasksetAddress);
 
 	cellSpurs.AddFunc(0x32b94add, cellSpursEnableExceptionEventHandler);
 	cellSpurs.AddFunc(0x7517724a, cellSpursSetGlobalExceptionEventHandler);
@@ -429,5 +857,6 @@ void cellSpurs_init()
 	cellSpurs.AddFunc(0x9f72add3, cellSpursJoinTaskset);
 	cellSpurs.AddFunc(0xe7dd87e1, cellSpursGetTasksetId);
 	cellSpurs.AddFunc(0xa789e631, cellSpursShutdownTaskset);
+	cellSpurs.AddFunc(0x58d58fcf, cellSpursTasksetGetSpursAddress);
 	cellSpurs.AddFunc(0xbeb600ac, cellSpursCreateTask);
 }
\ No newline at end of file
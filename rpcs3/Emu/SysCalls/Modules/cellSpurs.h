@@ -34,21 +34,34 @@ enum
 };
 
 // Core CellSpurs structures.
+// The opaque objects of the guest hold the IDs of the native objects.
 struct CellSpurs
 { 
-	SPURSManager *spurs;  
+	be_t<u32> id; // SPURSManager
 };
 
 struct CellSpurs2
 { 
-	SPURSManager *spurs;
+	be_t<u32> id;
 };
 
 struct CellSpursAttribute
 { 
-	SPURSManagerAttribute *attr;  
+	be_t<s32> nSpus;
+	be_t<s32> spuThreadGroupPriority;
+	be_t<s32> ppuThreadPriority;
+	u8 exitIfNoWork;
+	u8 spuPrintf;
+	u8 padding[2];
+	be_t<s32> threadGroupType;
+	be_t<u32> container;
+	be_t<u32> namePrefixLength;
+	char namePrefix[CELL_SPURS_NAME_MAX_LENGTH+1];
+	u8 skip[CELL_SPURS_ATTRIBUTE_SIZE - 44];
 };
 
+static_assert(sizeof(CellSpursAttribute) == CELL_SPURS_ATTRIBUTE_SIZE, "CellSpursAttribute: wrong sizeof");
+
 struct CellSpursInfo
 { 
 	be_t<s32> nSpus;
@@ -138,9 +151,13 @@ struct CellSpursTracePacket
 // cellSpurs taskset structures.
 struct CellSpursTaskset 
 {
-	u8 skip[6400];
+	be_t<u32> spurs; // ID of the SPURSManager
+	be_t<u32> idWorkload;
+	u8 skip[6392];
 };
 
+static_assert(sizeof(CellSpursTaskset) == 6400, "CellSpursTaskset: wrong sizeof");
+
 // Exception handlers.
 typedef void (*CellSpursGlobalExceptionEventHandler)(mem_ptr_t<CellSpurs> spurs, const mem_ptr_t<CellSpursExceptionInfo> info, 
 													 u32 id, mem_ptr_t<void> arg);
@@ -240,6 +257,34 @@ struct CellSpursTaskBinInfo
 };
 
 // cellSpurs event flag.
+enum
+{
+	CELL_SPURS_EVENT_FLAG_OR  = 0,
+	CELL_SPURS_EVENT_FLAG_AND = 1,
+
+	CELL_SPURS_EVENT_FLAG_CLEAR_AUTO   = 0,
+	CELL_SPURS_EVENT_FLAG_CLEAR_MANUAL = 1,
+
+	CELL_SPURS_EVENT_FLAG_SPU2SPU = 0,
+	CELL_SPURS_EVENT_FLAG_SPU2PPU = 1,
+	CELL_SPURS_EVENT_FLAG_PPU2SPU = 2,
+	CELL_SPURS_EVENT_FLAG_ANY2ANY = 3,
+};
+
+// The events and the waiters are one word updated atomically; a waiter is woken by the
+// notification of the line of the flag (parking lot).
 struct CellSpursEventFlag {
-	u8 skip[128];
-};
\ No newline at end of file
+	be_t<u16> events;
+	be_t<u16> waiters;   // PPU threads waiting
+	be_t<u32> direction;
+	be_t<u32> clearMode;
+	be_t<u32> taskset_addr;
+	u8 skip[112];
+
+	volatile u32& m_data()
+	{
+		return *reinterpret_cast<u32*>(this);
+	}
+};
+
+static_assert(sizeof(CellSpursEventFlag) == 128, "CellSpursEventFlag: wrong sizeof");
\ No newline at end of file
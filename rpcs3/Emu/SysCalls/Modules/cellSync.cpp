@@ -55,6 +55,7 @@ int cellSyncMutexInitialize(mem_ptr_t<CellSyncMutex> mutex)
 	}
 
 	mutex->m_data() = 0;
+	g_parking_lot.NotifyWrite(mutex.GetAddr(), 4);
 	return CELL_OK;
 }
 
@@ -83,14 +84,10 @@ int cellSyncMutexLock(mem_ptr_t<CellSyncMutex> mutex)
 		if (InterlockedCompareExchange(&mutex->m_data(), new_mutex.m_data(), old_data) == old_data) break;
 	}
 
-	while (old_order != mutex->m_freed) 
+	// woken by the unlocks: HLE (notified below) or guest stores to the line
+	if (!g_parking_lot.WaitUntil(ParkingLot::LineKey(mutex.GetAddr()), [&]() { return old_order == mutex->m_freed; }))
 	{
-		Sleep(1);
-		if (Emu.IsStopped())
-		{
-			ConLog.Warning("cellSyncMutexLock(mutex=0x%x) aborted", mutex.GetAddr());
-			break;
-		}
+		ConLog.Warning("cellSyncMutexLock(mutex=0x%x) aborted", mutex.GetAddr());
 	}
 	_mm_mfence();
 	return CELL_OK;
@@ -155,6 +152,7 @@ int cellSyncMutexUnlock(mem_ptr_t<CellSyncMutex> mutex)
 		if (InterlockedCompareExchange(&mutex->m_data(), new_mutex.m_data(), old_data) == old_data) break;
 	}
 
+	g_parking_lot.NotifyWrite(mutex.GetAddr(), 4);
 	return CELL_OK;
 }
 
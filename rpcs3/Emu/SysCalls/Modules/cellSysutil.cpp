@@ -337,18 +337,19 @@ int cellSysutilCheckCallback()
 
 	Emu.GetCallbackManager().m_exit_callback.Check();
 
-	CPUThread& thr = Emu.GetCallbackThread();
-
-	while (thr.IsAlive() || (g_FsAioReadCur < g_FsAioReadID))
+	// the callbacks of the finished reads are queued before they are counted
+	while (g_FsAioReadCur < g_FsAioReadID)
 	{
 		Sleep(1);
 		if (Emu.IsStopped())
 		{
 			ConLog.Warning("cellSysutilCheckCallback() aborted");
-			break;
+			return CELL_OK;
 		}
 	}
 
+	Emu.GetCallbackExecutor().WaitIdle();
+
 	return CELL_OK;
 }
 
@@ -358,7 +359,7 @@ int cellSysutilRegisterCallback(int slot, u64 func_addr, u64 userdata)
 
 	Emu.GetCallbackManager().m_exit_callback.Register(slot, func_addr, userdata);
 
-	wxGetApp().SendDbgCommand(DID_REGISTRED_CALLBACK);
+	SendDbgCommand(DID_REGISTRED_CALLBACK);
 
 	return CELL_OK;
 }
@@ -369,7 +370,7 @@ int cellSysutilUnregisterCallback(int slot)
 
 	Emu.GetCallbackManager().m_exit_callback.Unregister(slot);
 
-	wxGetApp().SendDbgCommand(DID_UNREGISTRED_CALLBACK);
+	SendDbgCommand(DID_UNREGISTRED_CALLBACK);
 
 	return CELL_OK;
 }
@@ -396,7 +397,16 @@ int cellMsgDialogOpen2(u32 type, char* msgString, mem_func_ptr_t<CellMsgDialogCa
 		style |= wxOK;
 	}
 
-	int res = wxMessageBox(wxString(msgString, wxConvUTF8), wxGetApp().GetAppName(), style);
+	int res;
+	if (Emu.IsHeadless())
+	{
+		cellSysutil.Warning("cellMsgDialogOpen2: '%s' (headless: answered yes/ok)", msgString);
+		res = (type & CELL_MSGDIALOG_BUTTON_TYPE_YESNO) ? wxYES : wxOK;
+	}
+	else
+	{
+		res = wxMessageBox(wxString(msgString, wxConvUTF8), wxGetApp().GetAppName(), style);
+	}
 
 	u64 status;
 
@@ -503,7 +513,16 @@ int cellMsgDialogOpenErrorCode(u32 errorCode, mem_func_ptr_t<CellMsgDialogCallba
 	errorMessage.append(")\n");
 
 	u64 status;
-	int res = wxMessageBox(errorMessage, wxGetApp().GetAppName(), wxICON_ERROR | wxOK);
+	int res;
+	if (Emu.IsHeadless())
+	{
+		cellSysutil.Warning("cellMsgDialogOpenErrorCode: %s", errorMessage.c_str());
+		res = wxOK;
+	}
+	else
+	{
+		res = wxMessageBox(errorMessage, wxGetApp().GetAppName(), wxICON_ERROR | wxOK);
+	}
 	switch(res)
 	{
 	case wxOK: status = CELL_MSGDIALOG_BUTTON_OK; break;
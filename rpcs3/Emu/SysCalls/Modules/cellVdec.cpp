@@ -10,8 +10,11 @@ extern "C"
 #include "libavcodec/avcodec.h"
 #include "libavformat/avformat.h"
 #include "libavutil/imgutils.h"
+#include "libswscale/swscale.h"
 }
 
+#include <thread>
+
 #include "cellVdec.h"
 
 void cellVdec_init();
@@ -26,17 +29,15 @@ int vdecRead(void* opaque, u8* buf, int buf_size)
 next:
 	if (vdec.reader.size < (u32)buf_size /*&& !vdec.just_started*/)
 	{
-		while (vdec.job.IsEmpty())
+		const VdecJobType next_type = vdec.job.Peek().type; // blocks until the next task arrives
+
+		if (Emu.IsStopped())
 		{
-			if (Emu.IsStopped())
-			{
-				ConLog.Warning("vdecRead() aborted");
-				return 0;
-			}
-			Sleep(1);
+			ConLog.Warning("vdecRead() aborted");
+			return 0;
 		}
 
-		switch (vdec.job.Peek().type)
+		switch (next_type)
 		{
 		case vdecEndSeq:
 			{
@@ -70,7 +71,7 @@ next:
 			}
 			break;
 		default:
-			ConLog.Error("vdecRead(): sequence error (task %d)", vdec.job.Peek().type);
+			ConLog.Error("vdecRead(): sequence error (task %d)", next_type);
 			return 0;
 		}
 		
@@ -117,6 +118,40 @@ u32 vdecQueryAttr(CellVdecCodecType type, u32 profile, u32 spec_addr /* may be 0
 	return CELL_OK;
 }
 
+// decoded picture that returns its AVFrame to the pool unless it was queued
+struct VdecFrameHolder : VdecFrame
+{
+	VideoDecoder& vdec;
+
+	VdecFrameHolder(VideoDecoder& vdec) : vdec(vdec)
+	{
+		data = vdec.AllocFrame();
+	}
+
+	~VdecFrameHolder()
+	{
+		vdec.ReleaseFrame(data);
+	}
+};
+
+void vdecSetTimestamps(VideoDecoder& vdec, VdecFrame& frame)
+{
+	u64 ts = av_frame_get_best_effort_timestamp(frame.data);
+	if (ts != AV_NOPTS_VALUE)
+	{
+		frame.pts = ts/* - vdec.first_pts*/; // ???
+		vdec.last_pts = frame.pts;
+	}
+	else
+	{
+		vdec.last_pts += vdec.ctx->time_base.num * 90000 / (vdec.ctx->time_base.den / vdec.ctx->ticks_per_frame);
+		frame.pts = vdec.last_pts;
+	}
+	//frame.pts = vdec.last_pts;
+	//vdec.last_pts += 3754;
+	frame.dts = (frame.pts - vdec.first_pts) + vdec.first_dts;
+}
+
 u32 vdecOpen(VideoDecoder* data)
 {
 	VideoDecoder& vdec = *data;
@@ -142,18 +177,6 @@ u32 vdecOpen(VideoDecoder* data)
 				break;
 			}
 
-			if (vdec.job.IsEmpty() && vdec.is_running)
-			{
-				Sleep(1);
-				continue;
-			}
-
-			if (vdec.frames.GetCount() >= 50)
-			{
-				Sleep(1);
-				continue;
-			}
-
 			if (!vdec.job.Pop(task))
 			{
 				break;
@@ -178,6 +201,41 @@ u32 vdecOpen(VideoDecoder* data)
 					// TODO: finalize
 					ConLog.Warning("vdecEndSeq:");
 
+					// frame threading delays the output: drain the decoder with empty packets
+					while (vdec.ctx && !vdec.just_started)
+					{
+						if (Emu.IsStopped())
+						{
+							ConLog.Warning("vdecEndSeq aborted");
+							return;
+						}
+
+						AVPacket flush;
+						av_init_packet(&flush);
+						flush.data = NULL;
+						flush.size = 0;
+
+						VdecFrameHolder frame(vdec);
+
+						int got_picture = 0;
+						if (!frame.data || avcodec_decode_video2(vdec.ctx, frame.data, &got_picture, &flush) < 0 || !got_picture)
+						{
+							break;
+						}
+
+						vdecSetTimestamps(vdec, frame);
+						frame.userdata = 0;
+
+						if (!vdec.frames.Push(frame))
+						{
+							ConLog.Warning("vdecEndSeq aborted");
+							return;
+						}
+						frame.data = nullptr; // to prevent destruction
+
+						vdec.vdecCb->ExecAsCallback(vdec.cbFunc, false, vdec.id, CELL_VDEC_MSG_TYPE_PICOUT, CELL_OK, vdec.cbArg);
+					}
+
 					vdec.vdecCb->ExecAsCallback(vdec.cbFunc, false, vdec.id, CELL_VDEC_MSG_TYPE_SEQDONE, CELL_OK, vdec.cbArg);
 					/*Callback cb;
 					cb.SetAddr(vdec.cbFunc);
@@ -276,6 +334,10 @@ u32 vdecOpen(VideoDecoder* data)
 						}
 						vdec.ctx = vdec.fmt->streams[0]->codec; // TODO: check data
 						
+						// decode on all host cores: frame threading for throughput, slice threading for latency
+						vdec.ctx->thread_count = std::max<int>(1, std::min<int>(std::thread::hardware_concurrency(), 16));
+						vdec.ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
 						AVDictionary* opts = nullptr;
 						av_dict_set(&opts, "refcounted_frames", "1", 0);
 						{
@@ -313,23 +375,7 @@ u32 vdecOpen(VideoDecoder* data)
 							au.size = 0;
 						}
 
-						struct VdecFrameHolder : VdecFrame
-						{
-							VdecFrameHolder()
-							{
-								data = av_frame_alloc();
-							}
-
-							~VdecFrameHolder()
-							{
-								if (data)
-								{
-									av_frame_unref(data);
-									av_frame_free(&data);
-								}
-							}
-
-						} frame;
+						VdecFrameHolder frame(vdec);
 
 						if (!frame.data)
 						{
@@ -353,25 +399,16 @@ u32 vdecOpen(VideoDecoder* data)
 
 						if (got_picture)
 						{
-							u64 ts = av_frame_get_best_effort_timestamp(frame.data);
-							if (ts != AV_NOPTS_VALUE)
-							{
-								frame.pts = ts/* - vdec.first_pts*/; // ???
-								vdec.last_pts = frame.pts;
-							}
-							else
-							{
-								vdec.last_pts += vdec.ctx->time_base.num * 90000 / (vdec.ctx->time_base.den / vdec.ctx->ticks_per_frame);
-								frame.pts = vdec.last_pts;
-							}
-							//frame.pts = vdec.last_pts;
-							//vdec.last_pts += 3754;
-							frame.dts = (frame.pts - vdec.first_pts) + vdec.first_dts;
+							vdecSetTimestamps(vdec, frame);
 							frame.userdata = task.userData;
 
 							//ConLog.Write("got picture (pts=0x%llx, dts=0x%llx)", frame.pts, frame.dts);	
 
-							vdec.frames.Push(frame); // !!!!!!!!
+							if (!vdec.frames.Push(frame)) // blocks while the guest is behind
+							{
+								ConLog.Warning("vdecDecodeAu aborted");
+								return;
+							}
 							frame.data = nullptr; // to prevent destruction
 
 							vdec.vdecCb->ExecAsCallback(vdec.cbFunc, false, vdec.id, CELL_VDEC_MSG_TYPE_PICOUT, CELL_OK, vdec.cbArg);
@@ -544,14 +581,10 @@ int cellVdecEndSeq(u32 handle)
 		return CELL_VDEC_ERROR_BUSY; // ???
 	}*/
 
-	while (!vdec->job.IsEmpty() || !vdec->frames.IsEmpty())
+	if (!vdec->job.WaitEmpty() || !vdec->frames.WaitEmpty())
 	{
-		if (Emu.IsStopped())
-		{
-			ConLog.Warning("cellVdecEndSeq(%d) aborted", handle);
-			return CELL_OK;
-		}
-		Sleep(1);
+		ConLog.Warning("cellVdecEndSeq(%d) aborted", handle);
+		return CELL_OK;
 	}
 
 	vdec->job.Push(VdecTask(vdecEndSeq));
@@ -604,17 +637,33 @@ int cellVdecGetPicture(u32 handle, const mem_ptr_t<CellVdecPicFormat> format, u3
 
 	if (out_addr)
 	{
-		u32 buf_size = a128(av_image_get_buffer_size(vdec->ctx->pix_fmt, vdec->ctx->width, vdec->ctx->height, 1));
+		const int w = vdec->ctx->width;
+		const int h = vdec->ctx->height;
+		u32 buf_size;
+		AVPixelFormat out_fmt;
 
-		if (!Memory.IsGoodAddr(out_addr, buf_size))
+		switch (format->formatType)
 		{
-			return CELL_VDEC_ERROR_FATAL;
+		case CELL_VDEC_PICFMT_YUV420_PLANAR:
+			out_fmt = vdec->ctx->pix_fmt;
+			buf_size = a128(av_image_get_buffer_size(out_fmt, w, h, 1));
+			break;
+		case CELL_VDEC_PICFMT_RGBA32_ILV:
+			out_fmt = AV_PIX_FMT_RGBA;
+			buf_size = w * h * 4;
+			break;
+		case CELL_VDEC_PICFMT_ARGB32_ILV:
+			out_fmt = AV_PIX_FMT_ARGB;
+			buf_size = w * h * 4;
+			break;
+		default:
+			cellVdec.Error("cellVdecGetPicture: TODO: unknown formatType(%d)", (u32)format->formatType);
+			return CELL_OK;
 		}
 
-		if (format->formatType != CELL_VDEC_PICFMT_YUV420_PLANAR)
+		if (!Memory.IsGoodAddr(out_addr, buf_size))
 		{
-			cellVdec.Error("cellVdecGetPicture: TODO: unknown formatType(%d)", (u32)format->formatType);
-			return CELL_OK;
+			return CELL_VDEC_ERROR_FATAL;
 		}
 
 		if (format->colorMatrixType != CELL_VDEC_COLOR_MATRIX_TYPE_BT709)
@@ -629,26 +678,61 @@ int cellVdecGetPicture(u32 handle, const mem_ptr_t<CellVdecPicFormat> format, u3
 
 		AVFrame& frame = *vf.data;
 
-		u8* buf = (u8*)malloc(buf_size);
-
-		// TODO: zero padding bytes
+		// write straight into guest memory when the output is host-contiguous
+		std::vector<u8> tmp;
+		u8* out = Memory.GetMemFromAddr(out_addr);
+		const bool direct = out && Memory.GetMemFromAddr(out_addr + buf_size - 1) == out + buf_size - 1;
+		if (!direct)
+		{
+			tmp.resize(buf_size);
+			out = &tmp[0];
+		}
 
-		int err = av_image_copy_to_buffer(buf, buf_size, frame.data, frame.linesize, vdec->ctx->pix_fmt, frame.width, frame.height, 1);
-		if (err < 0)
+		if (out_fmt == vdec->ctx->pix_fmt)
 		{
-			cellVdec.Error("cellVdecGetPicture: av_image_copy_to_buffer failed(%d)", err);
-			Emu.Pause();
+			int err = av_image_copy_to_buffer(out, buf_size, frame.data, frame.linesize, vdec->ctx->pix_fmt, frame.width, frame.height, 1);
+			if (err < 0)
+			{
+				cellVdec.Error("cellVdecGetPicture: av_image_copy_to_buffer failed(%d)", err);
+				Emu.Pause();
+			}
+			else
+			{
+				memset(out + err, 0, buf_size - err); // alignment padding
+			}
+		}
+		else
+		{
+			const VideoDecoder::SwsKey key = { frame.width, frame.height, frame.format, w, h, out_fmt };
+
+			// the colorspace setup reinitializes the converter: only do it when a new context is created
+			if (!vdec->sws || memcmp(&key, &vdec->sws_key, sizeof(key)))
+			{
+				vdec->sws = sws_getCachedContext(vdec->sws, frame.width, frame.height, (AVPixelFormat)frame.format, w, h, out_fmt, SWS_BILINEAR, NULL, NULL, NULL);
+
+				const int* coefs = sws_getCoefficients(SWS_CS_ITU709);
+				sws_setColorspaceDetails(vdec->sws, coefs, 0, coefs, 1, 0, 1 << 16, 1 << 16);
+				vdec->sws_key = key;
+			}
+
+			u8* out_data[4] = { out, NULL, NULL, NULL };
+			int out_line[4] = { w * 4, 0, 0, 0 };
+			sws_scale(vdec->sws, frame.data, frame.linesize, 0, frame.height, out_data, out_line);
+
+			if (format->alpha != 0xff)
+			{
+				u8* a = out + (out_fmt == AV_PIX_FMT_RGBA ? 3 : 0);
+				for (u32 i = 0; i < (u32)(w * h); i++, a += 4) *a = format->alpha;
+			}
 		}
 
-		if (!Memory.CopyFromReal(out_addr, buf, buf_size))
+		if (!direct && !Memory.CopyFromReal(out_addr, out, buf_size))
 		{
 			cellVdec.Error("cellVdecGetPicture: data copying failed");
 			Emu.Pause();
 		}
 
-		av_frame_unref(vf.data);
-		av_frame_free(&vf.data);
-		free(buf);
+		vdec->ReleaseFrame(vf.data);
 	}
 
 	return CELL_OK;
@@ -708,7 +708,18 @@ public:
 		u32 size;
 	} reader;
 
-	SQueue<VdecFrame> frames;
+	SQueue<VdecFrame, 50> frames; // decoded pictures, the decoder thread blocks when full
+
+	std::mutex frame_pool_mutex;
+	std::vector<AVFrame*> frame_pool; // unreferenced AVFrame shells, reused between pictures
+
+	SwsContext* sws; // cached converter for RGBA/ARGB output of cellVdecGetPicture
+
+	struct SwsKey
+	{
+		int src_w, src_h, src_fmt;
+		int dst_w, dst_h, dst_fmt;
+	} sws_key; // parameters `sws` was created with
 
 	const CellVdecCodecType type;
 	const u32 profile;
@@ -737,6 +748,7 @@ public:
 		, just_started(false)
 		, ctx(nullptr)
 		, vdecCb(nullptr)
+		, sws(nullptr)
 	{
 		AVCodec* codec = avcodec_find_decoder(AV_CODEC_ID_H264);
 		if (!codec)
@@ -784,5 +796,38 @@ public:
 			if (fmt->pb) av_free(fmt->pb);
 			avformat_free_context(fmt);
 		}
+		for (AVFrame* frame : frame_pool)
+		{
+			av_frame_free(&frame);
+		}
+		if (sws)
+		{
+			sws_freeContext(sws);
+		}
+	}
+
+	AVFrame* AllocFrame()
+	{
+		std::lock_guard<std::mutex> lock(frame_pool_mutex);
+
+		if (frame_pool.empty())
+		{
+			return av_frame_alloc();
+		}
+
+		AVFrame* frame = frame_pool.back();
+		frame_pool.pop_back();
+		return frame;
+	}
+
+	// drops the picture buffer reference (the buffer itself returns to FFmpeg's pool) and keeps the shell
+	void ReleaseFrame(AVFrame* frame)
+	{
+		if (!frame) return;
+
+		av_frame_unref(frame);
+
+		std::lock_guard<std::mutex> lock(frame_pool_mutex);
+		frame_pool.push_back(frame);
 	}
 };
\ No newline at end of file
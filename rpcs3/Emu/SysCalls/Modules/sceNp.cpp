@@ -70,6 +70,9 @@ int sceNpDrmIsAvailable(u32 k_licensee_addr, u32 drm_path_addr)
 	// Decrypt this EDAT using the supplied k_licensee and matching RAP file.
 	DecryptEDAT(fmt::ToUTF8(enc_drm_path), fmt::ToUTF8(dec_drm_path), 8, fmt::ToUTF8(rap_file_path), k_licensee, false);
 
+	// created through the host paths: the VFS must forget the lookups that missed them
+	Emu.GetVFS().InvalidateMissing();
+
 	return CELL_OK;
 }
 
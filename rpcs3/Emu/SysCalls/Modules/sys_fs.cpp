@@ -2,8 +2,11 @@
 #include "Emu/SysCalls/SysCalls.h"
 #include "Emu/SysCalls/SC_FUNC.h"
 
+#include <deque>
+
 void sys_fs_init();
-Module sys_fs(0x000e, sys_fs_init);
+void sys_fs_unload();
+Module sys_fs(0x000e, sys_fs_init, nullptr, sys_fs_unload);
 
 bool sdata_check(u32 version, u32 flags, u64 filesizeInput, u64 filesizeTmp)
 {
@@ -133,102 +136,194 @@ int cellFsSdataOpen(u32 path_addr, int flags, mem32_t fd, mem32_t arg, u64 size)
 	return CELL_OK;
 }
 
-std::atomic<u32> g_FsAioReadID( 0 );
-std::atomic<u32> g_FsAioReadCur( 0 );
+typedef mem_func_ptr_t<void (*)(mem_ptr_t<CellFsAio> xaio, int error, int xid, u64 size)> fsAioCallback;
+
+std::atomic<u32> g_FsAioReadID( 0 );  // number of issued requests (next xid)
+std::atomic<u32> g_FsAioReadCur( 0 ); // number of finished (completed or cancelled) requests
 bool aio_init = false;
 
-void fsAioRead(u32 fd, mem_ptr_t<CellFsAio> aio, int xid, mem_func_ptr_t<void (*)(mem_ptr_t<CellFsAio> xaio, int error, int xid, u64 size)> func)
+struct FsAioRequest
 {
-	while (g_FsAioReadCur != xid)
+	u32 fd;
+	u32 xid;
+	mem_ptr_t<CellFsAio> aio;
+	fsAioCallback func;
+
+	FsAioRequest(u32 fd, u32 xid, mem_ptr_t<CellFsAio> aio, fsAioCallback func)
+		: fd(fd)
+		, xid(xid)
+		, aio(aio)
+		, func(func)
 	{
-		Sleep(1);
-		if (Emu.IsStopped())
-		{
-			ConLog.Warning("fsAioRead() aborted");
-			return;
-		}
 	}
+};
 
-	vfsFileBase* orig_file;
-	if(!sys_fs.CheckId(fd, orig_file)) return;
-
-	std::string path = orig_file->GetPath();
-
-	u64 nbytes = aio->size;
-	u32 buf_addr = aio->buf_addr;
-
-	u32 res = 0;
-	u32 error = CELL_OK;
+// Fixed-size worker pool executing AIO reads out of order.
+// Reads are positional (vfsStream::ReadAt), so several requests may be in flight on one fd
+// without touching the cursor used by cellFsRead/cellFsLseek.
+class FsAioManager
+{
+	static const u32 max_workers = 4;
 
-	vfsStream& file = *(vfsStream*)orig_file;
-	const u64 old_pos = file.Tell();
-	file.Seek((u64)aio->offset);
+	std::mutex m_mutex;
+	std::condition_variable m_cond_queue; // signaled when a request is queued or the pool stops
+	std::deque<FsAioRequest> m_queue;
+	std::vector<thread*> m_workers;
+	bool m_stop;
 
-	u32 count = nbytes;
-	if (nbytes != (u64)count)
+public:
+	FsAioManager()
+		: m_stop(false)
 	{
-		error = CELL_ENOMEM;
-		goto fin;
 	}
 
-	if (!Memory.IsGoodAddr(buf_addr))
+	~FsAioManager()
 	{
-		error = CELL_EFAULT;
-		goto fin;
+		Stop();
 	}
 
-	if (count) if (u32 frag = buf_addr & 4095) // memory page fragment
+	void Start()
 	{
-		u32 req = min(count, 4096 - frag);
-		u32 read = file.Read(Memory + buf_addr, req);
-		buf_addr += req;
-		res += read;
-		count -= req;
-		if (read < req) goto fin;
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_workers.size()) return;
+
+		m_stop = false;
+		const u32 count = std::max<u32>(1, std::min<u32>(max_workers, std::thread::hardware_concurrency()));
+
+		for (u32 i = 0; i < count; i++)
+		{
+			m_workers.push_back(new thread(fmt::Format("fsAioRead[%d]", i), std::bind(&FsAioManager::Task, this)));
+		}
 	}
 
-	for (u32 pages = count / 4096; pages > 0; pages--) // full pages
+	// cancel all queued requests, wait for the ones already being read and release the workers
+	void Stop()
 	{
-		if (!Memory.IsGoodAddr(buf_addr)) goto fin; // ??? (probably EFAULT)
-		u32 read = file.Read(Memory + buf_addr, 4096);
-		buf_addr += 4096;
-		res += read;
-		count -= 4096;
-		if (read < 4096) goto fin;
+		std::vector<thread*> workers;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			g_FsAioReadCur += m_queue.size();
+			m_queue.clear();
+			m_stop = true;
+			m_cond_queue.notify_all();
+
+			workers.swap(m_workers);
+		}
+
+		for (u32 i = 0; i < workers.size(); i++)
+		{
+			workers[i]->join();
+			delete workers[i];
+		}
 	}
 
-	if (count) // last fragment
+	void Push(const FsAioRequest& req)
 	{
-		if (!Memory.IsGoodAddr(buf_addr)) goto fin;
-		res += file.Read(Memory + buf_addr, count);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(req);
+		m_cond_queue.notify_one();
 	}
 
-fin:
-	file.Seek(old_pos);
+	// remove a queued request; returns false if it has already been started or finished
+	bool Cancel(u32 xid)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto it = m_queue.begin(); it != m_queue.end(); ++it)
+		{
+			if (it->xid == xid)
+			{
+				m_queue.erase(it);
+				g_FsAioReadCur++;
+				return true;
+			}
+		}
 
-	ConLog.Warning("*** fsAioRead(fd=%d, offset=0x%llx, buf_addr=0x%x, size=0x%x, error=0x%x, res=0x%x, xid=0x%x [%s])",
-		fd, (u64)aio->offset, buf_addr, (u64)aio->size, error, res, xid, path.c_str());
+		return false;
+	}
 
-	if (func) // start callback thread
+private:
+	void Task()
 	{
-		func.async(aio, error, xid, res);
+		while (true)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond_queue.wait(lock, [this](){ return m_stop || !m_queue.empty(); });
+
+			if (m_stop) break;
+
+			FsAioRequest req = m_queue.front();
+			m_queue.pop_front();
+			lock.unlock();
+
+			Execute(req);
+			g_FsAioReadCur++;
+		}
 	}
 
-	/*CPUThread& thr = Emu.GetCallbackThread();
-	while (thr.IsAlive())
+	void Execute(FsAioRequest& req)
 	{
-		Sleep(1);
-		if (Emu.IsStopped())
+		vfsFileBase* orig_file;
+		if (!sys_fs.CheckId(req.fd, orig_file)) return;
+
+		std::string path = orig_file->GetPath();
+
+		u64 offset = req.aio->offset;
+		u64 nbytes = req.aio->size;
+		u32 buf_addr = req.aio->buf_addr;
+
+		u32 res = 0;
+		u32 error = CELL_OK;
+
+		u32 count = nbytes;
+		if (nbytes != (u64)count)
 		{
-			ConLog.Warning("fsAioRead() aborted");
-			break;
+			error = CELL_ENOMEM;
+			goto fin;
 		}
-	}*/
 
-	g_FsAioReadCur++;
-}
+		if (!Memory.IsGoodAddr(buf_addr))
+		{
+			error = CELL_EFAULT;
+			goto fin;
+		}
+
+		// read directly into guest memory, one page at a time so a hole in the buffer ends the transfer
+		while (count)
+		{
+			if (Emu.IsStopped())
+			{
+				ConLog.Warning("fsAioRead() aborted");
+				return;
+			}
+
+			const u32 req_size = std::min<u32>(count, 4096 - (buf_addr & 4095));
+			if (!Memory.IsGoodAddr(buf_addr, req_size)) break; // ??? (probably EFAULT)
+
+			const u32 read = orig_file->ReadAt(offset, Memory + buf_addr, req_size);
+			buf_addr += read;
+			offset += read;
+			res += read;
+			count -= req_size;
+			if (read < req_size) break;
+		}
+
+	fin:
+		sys_fs.Log("*** fsAioRead(fd=%d, offset=0x%llx, buf_addr=0x%x, size=0x%llx, error=0x%x, res=0x%x, xid=0x%x [%s])",
+			req.fd, (u64)req.aio->offset, (u32)req.aio->buf_addr, (u64)req.aio->size, error, res, req.xid, path.c_str());
+
+		if (req.func) // start callback thread
+		{
+			req.func.async(req.aio, error, req.xid, res);
+		}
+	}
+};
+
+FsAioManager g_FsAio;
 
-int cellFsAioRead(mem_ptr_t<CellFsAio> aio, mem32_t aio_id, mem_func_ptr_t<void (*)(mem_ptr_t<CellFsAio> xaio, int error, int xid, u64 size)> func)
+int cellFsAioRead(mem_ptr_t<CellFsAio> aio, mem32_t aio_id, fsAioCallback func)
 {
 	sys_fs.Warning("cellFsAioRead(aio_addr=0x%x, id_addr=0x%x, func_addr=0x%x)", aio.GetAddr(), aio_id.GetAddr(), func.GetAddr());
 
@@ -250,9 +345,23 @@ int cellFsAioRead(mem_ptr_t<CellFsAio> aio, mem32_t aio_id, mem_func_ptr_t<void
 	const u32 xid = g_FsAioReadID++;
 	aio_id = xid;
 
+	g_FsAio.Push(FsAioRequest(fd, xid, aio, func));
+
+	return CELL_OK;
+}
+
+int cellFsAioCancel(u32 id)
+{
+	sys_fs.Warning("cellFsAioCancel(id=%d)", id);
+
+	if (!aio_init)
+	{
+		return CELL_ENXIO;
+	}
+
+	if (!g_FsAio.Cancel(id))
 	{
-		thread t("fsAioRead", std::bind(fsAioRead, fd, aio, xid, func));
-		t.detach();
+		return CELL_EINVAL;
 	}
 
 	return CELL_OK;
@@ -262,6 +371,7 @@ int cellFsAioInit(mem8_ptr_t mount_point)
 {
 	std::string mp = Memory.ReadString(mount_point.GetAddr());
 	sys_fs.Warning("cellFsAioInit(mount_point_addr=0x%x (%s))", mount_point.GetAddr(), mp.c_str());
+	g_FsAio.Start();
 	aio_init = true;
 	return CELL_OK;
 }
@@ -271,6 +381,7 @@ int cellFsAioFinish(mem8_ptr_t mount_point)
 	std::string mp = Memory.ReadString(mount_point.GetAddr());
 	sys_fs.Warning("cellFsAioFinish(mount_point_addr=0x%x (%s))", mount_point.GetAddr(), mp.c_str());
 	aio_init = false;
+	g_FsAio.Stop();
 	return CELL_OK;
 }
 
@@ -316,6 +427,7 @@ void sys_fs_init()
 	sys_fs.AddFunc(0xc1c507e7, cellFsAioRead);
 	sys_fs.AddFunc(0xdb869f20, cellFsAioInit);
 	sys_fs.AddFunc(0x9f951810, cellFsAioFinish);
+	sys_fs.AddFunc(0x7f13fc8c, cellFsAioCancel);
 	sys_fs.AddFunc(0x1a108ab7, cellFsGetBlockSize);
 	sys_fs.AddFunc(0xaa3b4bcd, cellFsGetFreeSize);
 	sys_fs.AddFunc(0x0d5b4a14, cellFsReadWithOffset);
@@ -335,3 +447,10 @@ void sys_fs_init()
 
 	aio_init = false;
 }
+
+void sys_fs_unload()
+{
+	aio_init = false;
+	g_FsAio.Stop();
+	fsStReadFinishAll();
+}
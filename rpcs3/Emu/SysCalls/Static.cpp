@@ -2,6 +2,7 @@
 #include "Modules.h"
 #include "Emu/SysCalls/SysCalls.h"
 #include "Emu/SysCalls/SC_FUNC.h"
+#include "Emu/CPU/GuestProfiler.h"
 
 extern std::vector<SFunc*> g_static_funcs_list;
 
@@ -85,6 +86,7 @@ void StaticAnalyse(void* ptr, u32 size, u32 base)
 				{
 					ConLog.Write("Function '%s' hooked (addr=0x%x)", g_static_funcs_list[j]->name, i * 4 + base);
 					g_static_funcs_list[j]->found++;
+					g_guest_profiler.AddFunction(i * 4 + base, 12, g_static_funcs_list[j]->name);
 					data[i+0] = re32(0x39600000 | j); // li r11, j
 					data[i+1] = se32(0x44000003); // sc 3
 					data[i+2] = se32(0x4e800020); // blr
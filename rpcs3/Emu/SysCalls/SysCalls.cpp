@@ -2,13 +2,7 @@
 #include "SysCalls.h"
 #include "Modules.h"
 #include "SC_FUNC.h"
-
-namespace detail{
-	template<> bool CheckId(u32 id, ID*& _id,const std::string &name)
-	{
-		return Emu.GetIdManager().CheckID(id) && (_id = &Emu.GetIdManager().GetID(id))->m_name == name;
-	}
-}
+#include "HLEProfiler.h"
 
 void default_syscall();
 static func_caller *null_func = bind_func(default_syscall);
@@ -501,7 +495,7 @@ static func_caller* sc_table[kSyscallTableLength] =
 	null_func, null_func, null_func, null_func, null_func, //1009
 	null_func, null_func, null_func, null_func, null_func, //1014
 	null_func, null_func, null_func, null_func, null_func, //1019
-	null_func, null_func, null_func, bind_func(cellGcmCallback), //1024
+	null_func, null_func, bind_func(sys_callback_next), bind_func(cellGcmCallback), //1024
 };
 
 /** HACK: Used to delete func_caller objects that get allocated and stored in sc_table (above).
@@ -569,6 +563,7 @@ void SysCalls::DoSyscall(u32 code)
 {
 	if(code < 1024)
 	{
+		HLECallTimer timer(HLE_CALL_SYSCALL, code);
 		(*sc_table[code])();
 		return;
 	}
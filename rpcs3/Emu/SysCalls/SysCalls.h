@@ -15,101 +15,73 @@
 
 #define declCPU PPUThread& CPU = GetCurrentPPUThread
 
-class SysCallBase;
-
-namespace detail{
-	template<typename T> bool CheckId(u32 id, T*& data,const std::string &name)
-	{
-		ID* id_data;
-		if(!CheckId(id, id_data,name)) return false;
-		data = id_data->m_data->get<T>();
-		return true;
-	}
-
-	template<> bool CheckId<ID>(u32 id, ID*& _id,const std::string &name);
-}
-
 class SysCallBase //Module
 {
 private:
 	std::string m_module_name;
+	u32 m_id_type; // type tag of the IDs created by GetNewId
 	//u32 m_id;
 
 public:
 	SysCallBase(const std::string& name/*, u32 id*/)
 		: m_module_name(name)
+		, m_id_type(IdManager::GetTypeTag(name))
 		//, m_id(id)
 	{
 	}
 
 	const std::string& GetName() const { return m_module_name; }
 
-	void Log(const u32 id, std::string fmt, ...)
+	template<typename F, typename... Arg> void Log(const u32 id, F&& fmt, Arg&&... args)
 	{
-		if(Ini.HLELogging.GetValue())
+		if(2 >= CONLOG_MIN_LEVEL && Ini.HLELogging.GetValue())
 		{
-		va_list list;
-		va_start(list, fmt);
-		ConLog.Write(GetName() + fmt::Format("[%d]: ", id) + fmt::FormatV(fmt, list));
-		va_end(list);
+			ConLog.ModuleLog(2, GetName(), id, ": ", std::forward<F>(fmt), std::forward<Arg>(args)...);
 		}
 	}
 
-	void Log(std::string fmt, ...)
+	template<typename F, typename... Arg> typename std::enable_if<LogFormatArg<F>::value>::type Log(F&& fmt, Arg&&... args)
 	{
-		if(Ini.HLELogging.GetValue())
+		if(2 >= CONLOG_MIN_LEVEL && Ini.HLELogging.GetValue())
 		{
-		va_list list;
-		va_start(list, fmt);
-		ConLog.Write(GetName() + ": " + fmt::FormatV(fmt, list));
-		va_end(list);
+			ConLog.ModuleLog(2, GetName(), -1, ": ", std::forward<F>(fmt), std::forward<Arg>(args)...);
 		}
 	}
 
-	void Warning(const u32 id, std::string fmt, ...)
+	template<typename F, typename... Arg> void Warning(const u32 id, F&& fmt, Arg&&... args)
 	{
-//#ifdef SYSCALLS_DEBUG
-		va_list list;
-		va_start(list, fmt);
-		ConLog.Warning(GetName() + fmt::Format("[%d] warning: ", id) + fmt::FormatV(fmt, list));
-		va_end(list);
-//#endif
+		ConLog.ModuleLog(3, GetName(), id, " warning: ", std::forward<F>(fmt), std::forward<Arg>(args)...);
 	}
 
-	void Warning(std::string fmt, ...)
+	template<typename F, typename... Arg> typename std::enable_if<LogFormatArg<F>::value>::type Warning(F&& fmt, Arg&&... args)
 	{
-//#ifdef SYSCALLS_DEBUG
-		va_list list;
-		va_start(list, fmt);
-		ConLog.Warning(GetName() + " warning: " + fmt::FormatV(fmt, list));
-		va_end(list);
-//#endif
+		ConLog.ModuleLog(3, GetName(), -1, " warning: ", std::forward<F>(fmt), std::forward<Arg>(args)...);
 	}
 
-	void Error(const u32 id, std::string fmt, ...)
+	template<typename F, typename... Arg> void Error(const u32 id, F&& fmt, Arg&&... args)
 	{
-		va_list list;
-		va_start(list, fmt);
-		ConLog.Error(GetName() + fmt::Format("[%d] error: ", id) + fmt::FormatV(fmt, list));
-		va_end(list);
+		ConLog.ModuleLog(4, GetName(), id, " error: ", std::forward<F>(fmt), std::forward<Arg>(args)...);
 	}
 
-	void Error(std::string fmt, ...)
+	template<typename F, typename... Arg> typename std::enable_if<LogFormatArg<F>::value>::type Error(F&& fmt, Arg&&... args)
 	{
-		va_list list;
-		va_start(list, fmt);
-		ConLog.Error(GetName() + " error: " + fmt::FormatV(fmt, list));
-		va_end(list);
+		ConLog.ModuleLog(4, GetName(), -1, " error: ", std::forward<F>(fmt), std::forward<Arg>(args)...);
 	}
 
 	bool CheckId(u32 id) const
 	{
-		return Emu.GetIdManager().CheckID(id) && Emu.GetIdManager().GetID(id).m_name == GetName();
+		return Emu.GetIdManager().CheckID(id, m_id_type);
 	}
 
 	template<typename T> bool CheckId(u32 id, T*& data)
 	{
-		return detail::CheckId(id,data,GetName());
+		return Emu.GetIdManager().GetIDData(id, data, m_id_type);
+	}
+
+	// keeps the object alive while the reference exists
+	template<typename T> IDRef<T> GetRef(u32 id)
+	{
+		return IDRef<T>(Emu.GetIdManager(), id, m_id_type);
 	}
 
 	template<typename T>
@@ -291,6 +263,7 @@ extern int cellFsStReadGetCurrentAddr(u32 fd, mem32_t addr_addr, mem64_t size);
 extern int cellFsStReadPutCurrentAddr(u32 fd, u32 addr_addr, u64 size);
 extern int cellFsStReadWait(u32 fd, u64 size);
 extern int cellFsStReadWaitCallback(u32 fd, u64 size, mem_func_ptr_t<void (*)(int xfd, u64 xsize)> func);
+extern void fsStReadFinishAll();
 
 //cellVideo
 extern int cellVideoOutGetState(u32 videoOut, u32 deviceIndex, u32 state_addr);
@@ -342,6 +315,9 @@ extern int cellMouseGetRawData(u32 port_no, mem_class_t data);
 //cellGcm
 extern int cellGcmCallback(u32 context_addr, u32 count);
 
+//callback executor
+extern void sys_callback_next();
+
 //sys_tty
 extern int sys_tty_read(u32 ch, u64 buf_addr, u32 len, u64 preadlen_addr);
 extern int sys_tty_write(u32 ch, u64 buf_addr, u32 len, u64 pwritelen_addr);
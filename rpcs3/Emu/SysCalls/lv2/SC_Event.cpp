@@ -161,8 +161,9 @@ int sys_event_queue_receive(u32 equeue_id, mem_ptr_t<sys_event_data> event, u64
 		return CELL_EFAULT;
 	}
 
-	EventQueue* eq;
-	if (!Emu.GetIdManager().GetIDData(equeue_id, eq))
+	// the queue may be destroyed (and the receiver cancelled) while waiting
+	IDRef<EventQueue> eq(Emu.GetIdManager(), equeue_id);
+	if (!eq)
 	{
 		return CELL_ESRCH;
 	}
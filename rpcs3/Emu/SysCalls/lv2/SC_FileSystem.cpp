@@ -2,6 +2,9 @@
 #include "SC_FileSystem.h"
 #include "Emu/SysCalls/SysCalls.h"
 
+#include <unordered_map>
+#include <chrono>
+
 extern Module sys_fs;
 
 enum
@@ -18,30 +21,295 @@ struct FsRingBuffer
 	u32 m_copy;
 };
 
-struct FsRingBufferConfig
+// Streaming reader attached to an fd by cellFsStReadInit.
+// A background thread fills the guest ring buffer from the file (paced by transfer_rate),
+// the guest drains it with cellFsStRead or in place with Get/PutCurrentAddr.
+// Ring positions are kept as running byte totals: fill level = m_produced - m_consumed.
+class FsStReader
 {
+	u32 m_fd;
+	vfsStream* m_file;
+	thread* m_thread;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cond; // fill level, free space or state changed
+
+	u64 m_read_pos; // next file offset to transfer
+	u64 m_read_end;
+	u64 m_produced;
+	u64 m_consumed;
+	bool m_eof;
+	bool m_stop;
+
+	u32 m_cb_addr; // cellFsStReadWaitCallback
+	u64 m_cb_size;
+
+public:
 	FsRingBuffer m_ring_buffer;
 	u32 m_buffer;
+	u32 m_alloc_mem_size;
 	u64 m_fs_status;
 	u64 m_regid;
-	u32 m_alloc_mem_size;
-	u32 m_current_addr;
 
-	FsRingBufferConfig()
-		: m_fs_status(CELL_FS_ST_NOT_INITIALIZED)
+	FsStReader(u32 fd, vfsStream* file, const FsRingBuffer& ring_buffer)
+		: m_fd(fd)
+		, m_file(file)
+		, m_thread(nullptr)
+		, m_read_pos(0)
+		, m_read_end(0)
+		, m_produced(0)
+		, m_consumed(0)
+		, m_eof(false)
+		, m_stop(false)
+		, m_cb_addr(0)
+		, m_cb_size(0)
+		, m_ring_buffer(ring_buffer)
+		, m_fs_status(CELL_FS_ST_INITIALIZED)
 		, m_regid(0)
-		, m_alloc_mem_size(0)
-		, m_current_addr(0)
 	{
-		memset(&m_ring_buffer, 0, sizeof(FsRingBuffer));
+		if (!m_ring_buffer.m_block_size) m_ring_buffer.m_block_size = 64 * 1024;
+
+		if(m_ring_buffer.m_ringbuf_size < 1024 * 1024) // If the size is less than 1MB
+			m_alloc_mem_size = ((m_ring_buffer.m_ringbuf_size + 64 * 1024 - 1) / (64 * 1024)) * (64 * 1024);
+		else
+			m_alloc_mem_size = ((m_ring_buffer.m_ringbuf_size + 1024 * 1024 - 1) / (1024 * 1024)) * (1024 * 1024);
+
+		m_buffer = Memory.Alloc(m_alloc_mem_size, 1024);
+		if (m_buffer) memset(Memory + m_buffer, 0, m_alloc_mem_size);
+	}
+
+	~FsStReader()
+	{
+		Stop();
+		if (m_buffer) Memory.Free(m_buffer);
+	}
+
+	void Start(u64 offset, u64 size)
+	{
+		Stop();
+
+		const u64 file_size = m_file->GetSize();
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_read_pos = std::min(offset, file_size);
+		m_read_end = (size && size < file_size - m_read_pos) ? m_read_pos + size : file_size;
+		m_produced = 0;
+		m_consumed = 0;
+		m_eof = false;
+		m_stop = false;
+		m_fs_status = CELL_FS_ST_PROGRESS;
+
+		m_thread = new thread(fmt::Format("fsStRead[fd=%d]", m_fd), std::bind(&FsStReader::Task, this));
+	}
+
+	void Stop()
+	{
+		thread* t;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+			m_cb_addr = 0;
+			if (m_fs_status == CELL_FS_ST_PROGRESS) m_fs_status = CELL_FS_ST_STOP;
+			m_cond.notify_all();
+
+			t = m_thread;
+			m_thread = nullptr;
+		}
+
+		if (t)
+		{
+			t->join();
+			delete t;
+		}
+	}
+
+	// copy up to size buffered bytes to guest memory, returns bytes consumed
+	u64 Read(u32 buf_addr, u64 size)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		u64 done = 0;
+		size = std::min(size, m_produced - m_consumed);
+
+		while (done < size)
+		{
+			const u32 pos = m_consumed % m_ring_buffer.m_ringbuf_size;
+			const u32 count = std::min<u64>(size - done, m_ring_buffer.m_ringbuf_size - pos);
+
+			Memory.Copy(buf_addr + done, m_buffer + pos, count);
+			m_consumed += count;
+			done += count;
+		}
+
+		m_cond.notify_all();
+		return done;
+	}
+
+	// contiguous readable region at the consumer position (copyless access)
+	void GetCurrent(u32& addr, u64& size)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		const u32 pos = m_consumed % m_ring_buffer.m_ringbuf_size;
+		addr = m_buffer + pos;
+		size = std::min<u64>(m_produced - m_consumed, m_ring_buffer.m_ringbuf_size - pos);
+	}
+
+	bool PutCurrent(u32 addr, u64 size)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (addr != m_buffer + m_consumed % m_ring_buffer.m_ringbuf_size) return false;
+
+		m_consumed += std::min(size, m_produced - m_consumed);
+		m_cond.notify_all();
+		return true;
+	}
+
+	// block until size bytes are buffered or the stream cannot provide more
+	bool Wait(u64 size)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		size = std::min(size, m_ring_buffer.m_ringbuf_size);
+
+		if (!WaitWhileRunning(m_cond, lock, [&]() { return m_produced - m_consumed >= size || m_eof || m_stop; }))
+		{
+			ConLog.Warning("cellFsStReadWait(fd=%d) aborted", m_fd);
+			return false;
+		}
+
+		return true;
+	}
+
+	void SetCallback(u32 addr, u64 size)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cb_size = std::min(size, m_ring_buffer.m_ringbuf_size);
+		m_cb_addr = addr;
+		CheckCallback(lock);
+	}
+
+private:
+	// must be called with m_mutex held, fires the pending wait callback once its level is reached
+	void CheckCallback(std::unique_lock<std::mutex>& lock)
+	{
+		const u64 available = m_produced - m_consumed;
+		if (!m_cb_addr || (available < m_cb_size && !m_eof)) return;
+
+		Callback cb;
+		cb.SetAddr(m_cb_addr);
+		cb.Handle(m_fd, available);
+		m_cb_addr = 0;
+
+		lock.unlock();
+		cb.Branch(false);
+		lock.lock();
+	}
+
+	void Task()
+	{
+		const u64 ring_size = m_ring_buffer.m_ringbuf_size;
+		const u64 block_size = std::min(m_ring_buffer.m_block_size, ring_size);
+		const u64 rate = m_ring_buffer.m_transfer_rate; // bytes per second, 0 = unpaced
+		const auto start = std::chrono::steady_clock::now();
+		u64 transferred = 0;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		while (!m_stop)
+		{
+			if (Emu.IsStopped())
+			{
+				ConLog.Warning("fsStRead(fd=%d) aborted", m_fd);
+				break;
+			}
+
+			if (m_read_pos >= m_read_end)
+			{
+				m_eof = true;
+				m_cond.notify_all();
+				CheckCallback(lock);
+				m_cond.wait(lock);
+				continue;
+			}
+
+			// wait for the consumer to free a whole block (or the tail of the stream)
+			const u64 want = std::min(block_size, m_read_end - m_read_pos);
+			if (ring_size - (m_produced - m_consumed) < want)
+			{
+				m_cond.wait(lock);
+				continue;
+			}
+
+			if (rate)
+			{
+				const auto due = start + std::chrono::microseconds(transferred * 1000000 / rate);
+				if (std::chrono::steady_clock::now() < due)
+				{
+					m_cond.wait_until(lock, due);
+					continue;
+				}
+			}
+
+			const u64 pos = m_produced % ring_size;
+			const u64 count = std::min(want, ring_size - pos);
+			const u64 file_pos = m_read_pos;
+
+			lock.unlock();
+			const u64 read = m_file->ReadAt(file_pos, Memory + m_buffer + pos, count);
+			lock.lock();
+
+			transferred += read;
+			m_read_pos += read;
+			m_produced += read;
+			if (read < count) m_read_end = m_read_pos; // unexpected end of file
+
+			m_cond.notify_all();
+			CheckCallback(lock);
+		}
+	}
+};
+
+std::mutex g_fs_st_mutex;
+std::unordered_map<u32, std::shared_ptr<FsStReader>> g_fs_st_readers;
+
+std::shared_ptr<FsStReader> GetStReader(u32 fd)
+{
+	std::lock_guard<std::mutex> lock(g_fs_st_mutex);
+
+	auto found = g_fs_st_readers.find(fd);
+	return found == g_fs_st_readers.end() ? nullptr : found->second;
+}
+
+void RemoveStReader(u32 fd)
+{
+	std::shared_ptr<FsStReader> reader;
+	{
+		std::lock_guard<std::mutex> lock(g_fs_st_mutex);
+
+		auto found = g_fs_st_readers.find(fd);
+		if (found == g_fs_st_readers.end()) return;
+
+		reader = found->second;
+		g_fs_st_readers.erase(found);
 	}
 
-	~FsRingBufferConfig()
+	reader->Stop();
+}
+
+void fsStReadFinishAll()
+{
+	std::unordered_map<u32, std::shared_ptr<FsStReader>> readers;
 	{
-		memset(&m_ring_buffer, 0, sizeof(FsRingBuffer));
+		std::lock_guard<std::mutex> lock(g_fs_st_mutex);
+		readers.swap(g_fs_st_readers);
 	}
-} m_fs_config;
 
+	for (auto& reader : readers)
+	{
+		reader.second->Stop();
+	}
+}
 
 int cellFsOpen(u32 path_addr, int flags, mem32_t fd, mem32_t arg, u64 size)
 {
@@ -195,6 +463,8 @@ int cellFsClose(u32 fd)
 {
 	sys_fs.Warning("cellFsClose(fd=%d)", fd);
 
+	RemoveStReader(fd);
+
 	if(!Emu.GetIdManager().RemoveID(fd))
 		return CELL_ESRCH;
 
@@ -344,27 +614,22 @@ int cellFsRename(u32 from_addr, u32 to_addr)
 {
 	const std::string& ps3_from = Memory.ReadString(from_addr);
 	const std::string& ps3_to = Memory.ReadString(to_addr);
+	sys_fs.Log("cellFsRename(from=\"%s\", to=\"%s\")", ps3_from.c_str(), ps3_to.c_str());
 
+	if(Emu.GetVFS().ExistsDir(ps3_from))
 	{
-		vfsDir dir;
-		if(dir.IsExists(ps3_from))
-		{
-			if(!dir.Rename(ps3_from, ps3_to))
-				return CELL_EBUSY;
+		if(!Emu.GetVFS().RenameDir(ps3_from, ps3_to))
+			return CELL_EBUSY;
 
-			return CELL_OK;
-		}
+		return CELL_OK;
 	}
 
+	if(Emu.GetVFS().ExistsFile(ps3_from))
 	{
-		vfsFile f;
-		if(f.Exists(ps3_from))
-		{
-			if(!f.Rename(ps3_from, ps3_to))
-				return CELL_EBUSY;
+		if(!Emu.GetVFS().RenameFile(ps3_from, ps3_to))
+			return CELL_EBUSY;
 
-			return CELL_OK;
-		}
+		return CELL_OK;
 	}
 
 	return CELL_ENOENT;
@@ -375,11 +640,10 @@ int cellFsRmdir(u32 path_addr)
 	const std::string& ps3_path = Memory.ReadString(path_addr);
 	sys_fs.Log("cellFsRmdir(path=\"%s\")", ps3_path.c_str());
 
-	vfsDir d;
-	if(!d.IsExists(ps3_path))
+	if(!Emu.GetVFS().ExistsDir(ps3_path))
 		return CELL_ENOENT;
 
-	if(!d.Remove(ps3_path))
+	if(!Emu.GetVFS().RemoveDir(ps3_path))
 		return CELL_EBUSY;
 
 	return CELL_OK;
@@ -573,22 +837,25 @@ int cellFsStReadInit(u32 fd, mem_ptr_t<CellFsRingBuffer> ringbuf)
 	if(!ringbuf.IsGood())
 		return CELL_EFAULT;
 
-	FsRingBuffer& buffer = m_fs_config.m_ring_buffer;
+	FsRingBuffer buffer;
 
 	buffer.m_block_size = ringbuf->block_size;
 	buffer.m_copy = ringbuf->copy;
 	buffer.m_ringbuf_size = ringbuf->ringbuf_size;
 	buffer.m_transfer_rate = ringbuf->transfer_rate;
 
-	if(buffer.m_ringbuf_size < 0x40000000) // If the size is less than 1MB
-		m_fs_config.m_alloc_mem_size = ((ringbuf->ringbuf_size + 64 * 1024 - 1) / (64 * 1024)) * (64 * 1024);
-	m_fs_config.m_alloc_mem_size = ((ringbuf->ringbuf_size + 1024 * 1024 - 1) / (1024 * 1024)) * (1024 * 1024);
+	if(!buffer.m_ringbuf_size || buffer.m_ringbuf_size > 0x10000000)
+		return CELL_EINVAL;
+
+	if(GetStReader(fd))
+		return CELL_EBUSY;
 
-	// alloc memory
-	m_fs_config.m_buffer = Memory.Alloc(m_fs_config.m_alloc_mem_size, 1024);
-	memset(Memory + m_fs_config.m_buffer, 0, m_fs_config.m_alloc_mem_size);
+	std::shared_ptr<FsStReader> reader(new FsStReader(fd, file, buffer));
+	if(!reader->m_buffer)
+		return CELL_ENOMEM;
 
-	m_fs_config.m_fs_status = CELL_FS_ST_INITIALIZED;
+	std::lock_guard<std::mutex> lock(g_fs_st_mutex);
+	g_fs_st_readers[fd] = reader;
 
 	return CELL_OK;
 }
@@ -600,8 +867,10 @@ int cellFsStReadFinish(u32 fd)
 	vfsStream* file;
 	if(!sys_fs.CheckId(fd, file)) return CELL_ESRCH;
 
-	Memory.Free(m_fs_config.m_buffer);
-	m_fs_config.m_fs_status = CELL_FS_ST_NOT_INITIALIZED;
+	if(!GetStReader(fd))
+		return CELL_ENXIO;
+
+	RemoveStReader(fd);
 
 	return CELL_OK;
 }
@@ -616,7 +885,11 @@ int cellFsStReadGetRingBuf(u32 fd, mem_ptr_t<CellFsRingBuffer> ringbuf)
 	if(!ringbuf.IsGood())
 		return CELL_EFAULT;
 
-	FsRingBuffer& buffer = m_fs_config.m_ring_buffer;
+	auto reader = GetStReader(fd);
+	if(!reader)
+		return CELL_ENXIO;
+
+	FsRingBuffer& buffer = reader->m_ring_buffer;
 
 	ringbuf->block_size = buffer.m_block_size;
 	ringbuf->copy = buffer.m_copy;
@@ -630,37 +903,45 @@ int cellFsStReadGetRingBuf(u32 fd, mem_ptr_t<CellFsRingBuffer> ringbuf)
 
 int cellFsStReadGetStatus(u32 fd, mem64_t status)
 {
-	sys_fs.Warning("cellFsStReadGetRingBuf(fd=%d, status_addr=0x%x)", fd, status.GetAddr());
+	sys_fs.Warning("cellFsStReadGetStatus(fd=%d, status_addr=0x%x)", fd, status.GetAddr());
 
 	vfsStream* file;
 	if(!sys_fs.CheckId(fd, file)) return CELL_ESRCH;
 
-	status = m_fs_config.m_fs_status;
+	auto reader = GetStReader(fd);
+	status = reader ? reader->m_fs_status : (u64)CELL_FS_ST_NOT_INITIALIZED;
 
 	return CELL_OK;
 }
 
 int cellFsStReadGetRegid(u32 fd, mem64_t regid)
 {
-	sys_fs.Warning("cellFsStReadGetRingBuf(fd=%d, regid_addr=0x%x)", fd, regid.GetAddr());
+	sys_fs.Warning("cellFsStReadGetRegid(fd=%d, regid_addr=0x%x)", fd, regid.GetAddr());
 
 	vfsStream* file;
 	if(!sys_fs.CheckId(fd, file)) return CELL_ESRCH;
 
-	regid = m_fs_config.m_regid;
+	auto reader = GetStReader(fd);
+	if(!reader)
+		return CELL_ENXIO;
+
+	regid = reader->m_regid;
 
 	return CELL_OK;
 }
 
 int cellFsStReadStart(u32 fd, u64 offset, u64 size)
 {
-	sys_fs.Warning("TODO: cellFsStReadStart(fd=%d, offset=0x%llx, size=0x%llx)", fd, offset, size);
+	sys_fs.Warning("cellFsStReadStart(fd=%d, offset=0x%llx, size=0x%llx)", fd, offset, size);
 
 	vfsStream* file;
 	if(!sys_fs.CheckId(fd, file)) return CELL_ESRCH;
 
-	m_fs_config.m_current_addr = m_fs_config.m_buffer + (u32)offset;
-	m_fs_config.m_fs_status = CELL_FS_ST_PROGRESS;
+	auto reader = GetStReader(fd);
+	if(!reader)
+		return CELL_ENXIO;
+
+	reader->Start(offset, size);
 
 	return CELL_OK;
 }
@@ -672,69 +953,109 @@ int cellFsStReadStop(u32 fd)
 	vfsStream* file;
 	if(!sys_fs.CheckId(fd, file)) return CELL_ESRCH;
 
-	m_fs_config.m_fs_status = CELL_FS_ST_STOP;
+	auto reader = GetStReader(fd);
+	if(!reader)
+		return CELL_ENXIO;
+
+	reader->Stop();
 
 	return CELL_OK;
 }
 
 int cellFsStRead(u32 fd, u32 buf_addr, u64 size, mem64_t rsize)
 {
-	sys_fs.Warning("TODO: cellFsStRead(fd=%d, buf_addr=0x%x, size=0x%llx, rsize_addr = 0x%x)", fd, buf_addr, size, rsize.GetAddr());
+	sys_fs.Log("cellFsStRead(fd=%d, buf_addr=0x%x, size=0x%llx, rsize_addr = 0x%x)", fd, buf_addr, size, rsize.GetAddr());
 	
 	vfsStream* file;
 	if(!sys_fs.CheckId(fd, file)) return CELL_ESRCH;
 
 	if (rsize.GetAddr() && !rsize.IsGood()) return CELL_EFAULT;
 
-	m_fs_config.m_regid += size;
-	rsize = m_fs_config.m_regid;
+	auto reader = GetStReader(fd);
+	if(!reader)
+		return CELL_ENXIO;
+
+	if (size && !Memory.IsGoodAddr(buf_addr, size)) return CELL_EFAULT;
+
+	const u64 res = reader->Read(buf_addr, size);
+	if (rsize.GetAddr()) rsize = res;
 
 	return CELL_OK;
 }
 
 int cellFsStReadGetCurrentAddr(u32 fd, mem32_t addr_addr, mem64_t size)
 {
-	sys_fs.Warning("TODO: cellFsStReadGetCurrentAddr(fd=%d, addr_addr=0x%x, size_addr = 0x%x)", fd, addr_addr.GetAddr(), size.GetAddr());
+	sys_fs.Log("cellFsStReadGetCurrentAddr(fd=%d, addr_addr=0x%x, size_addr = 0x%x)", fd, addr_addr.GetAddr(), size.GetAddr());
 
 	vfsStream* file;
 	if(!sys_fs.CheckId(fd, file)) return CELL_ESRCH;
 
-	if (!addr_addr.IsGood() && !size.IsGood()) return CELL_EFAULT;
-	
+	if (!addr_addr.IsGood() || !size.IsGood()) return CELL_EFAULT;
+
+	auto reader = GetStReader(fd);
+	if(!reader)
+		return CELL_ENXIO;
+
+	u32 addr;
+	u64 count;
+	reader->GetCurrent(addr, count);
+
+	addr_addr = addr;
+	size = count;
+
 	return CELL_OK;
 }
 
 int cellFsStReadPutCurrentAddr(u32 fd, u32 addr_addr, u64 size)
 {
-	sys_fs.Warning("TODO: cellFsStReadPutCurrentAddr(fd=%d, addr_addr=0x%x, size = 0x%llx)", fd, addr_addr, size);
+	sys_fs.Log("cellFsStReadPutCurrentAddr(fd=%d, addr_addr=0x%x, size = 0x%llx)", fd, addr_addr, size);
 	
 	vfsStream* file;
 	if(!sys_fs.CheckId(fd, file)) return CELL_ESRCH;
 
 	if (!Memory.IsGoodAddr(addr_addr)) return CELL_EFAULT;
 
+	auto reader = GetStReader(fd);
+	if(!reader)
+		return CELL_ENXIO;
+
+	if(!reader->PutCurrent(addr_addr, size))
+		return CELL_EINVAL;
+
 	return CELL_OK;
 }
 
 int cellFsStReadWait(u32 fd, u64 size)
 {
-	sys_fs.Warning("TODO: cellFsStReadWait(fd=%d, size = 0x%llx)", fd, size);
+	sys_fs.Log("cellFsStReadWait(fd=%d, size = 0x%llx)", fd, size);
 	
 	vfsStream* file;
 	if(!sys_fs.CheckId(fd, file)) return CELL_ESRCH;
-	
+
+	auto reader = GetStReader(fd);
+	if(!reader)
+		return CELL_ENXIO;
+
+	reader->Wait(size);
+
 	return CELL_OK;
 }
 
 int cellFsStReadWaitCallback(u32 fd, u64 size, mem_func_ptr_t<void (*)(int xfd, u64 xsize)> func)
 {
-	sys_fs.Warning("TODO: cellFsStReadWaitCallback(fd=%d, size = 0x%llx, func_addr = 0x%x)", fd, size, func.GetAddr());
+	sys_fs.Log("cellFsStReadWaitCallback(fd=%d, size = 0x%llx, func_addr = 0x%x)", fd, size, func.GetAddr());
 
 	if (!func.IsGood())
 		return CELL_EFAULT;
 
 	vfsStream* file;
 	if(!sys_fs.CheckId(fd, file)) return CELL_ESRCH;
-	
+
+	auto reader = GetStReader(fd);
+	if(!reader)
+		return CELL_ENXIO;
+
+	reader->SetCallback(func.GetAddr(), size);
+
 	return CELL_OK;
-}
\ No newline at end of file
+}
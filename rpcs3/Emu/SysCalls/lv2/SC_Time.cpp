@@ -8,32 +8,22 @@
 #include "stdafx.h"
 #include "Emu/SysCalls/SysCalls.h"
 #include "SC_Time.h"
+#include "Emu/Clock.h"
 
 SysCallBase sys_time("sys_time");
 
-//static const u64 timebase_frequency = 79800000;
 extern int cellSysutilGetSystemParamInt(int id, mem32_t value);
 
 // Auxiliary functions
 u64 get_time()
 {
-#ifdef _WIN32
-	LARGE_INTEGER cycle;
-	LARGE_INTEGER freq;
-	QueryPerformanceCounter(&cycle);
-	QueryPerformanceFrequency(&freq);
-	return cycle.QuadPart * 10000000 / freq.QuadPart;
-#else
-	struct timespec ts;
-	if (!clock_gettime(CLOCK_MONOTONIC, &ts))
-		return ts.tv_sec * (s64)10000000 + (s64)ts.tv_nsec / (s64)100;
-#endif
+	return g_host_clock.GetTime();
 }
 
 // Returns some relative time in microseconds, don't change this fact
 u64 get_system_time()
 {
-	return get_time() / 10;
+	return g_host_clock.GetSystemTime();
 }
 
 
@@ -69,5 +59,5 @@ s64 sys_time_get_system_time()
 u64 sys_time_get_timebase_frequency()
 {
 	sys_time.Log("sys_time_get_timebase_frequency()");
-	return 10000000;
+	return HostClock::timebase_frequency;
 }
@@ -2,9 +2,65 @@
 #include "SC_Timer.h"
 #include "Emu/SysCalls/SysCalls.h"
 #include "Emu/event.h"
+#include "Emu/Clock.h"
 
 SysCallBase sys_timer("sys_timer");
 
+// called by the timer thread at the expiration: sends the event to the connected queue
+static void sys_timer_fire(u32 timer_id)
+{
+	timer* timer_data = nullptr;
+	if(!Emu.GetIdManager().GetIDData(timer_id, timer_data)) return;
+
+	std::lock_guard<std::mutex> lock(timer_data->mutex);
+
+	sys_timer_information_t& info = timer_data->timer_information_t;
+	if(info.timer_state != SYS_TIMER_STATE_RUN) return;
+
+	const u64 expiration = info.next_expiration_time;
+
+	if(info.period)
+	{
+		// the timer thread skips missed periods the same way
+		const u64 now = get_system_time();
+		info.next_expiration_time += info.period;
+		if((u64)info.next_expiration_time <= now) info.next_expiration_time += ((now - info.next_expiration_time) / info.period + 1) * info.period;
+	}
+	else
+	{
+		info.timer_state = SYS_TIMER_STATE_STOP;
+		timer_data->wheel_id = 0;
+	}
+
+	IDRef<EventQueue> equeue(Emu.GetIdManager(), timer_data->queue_id);
+	if(!equeue) return;
+
+	if(!equeue->events.push(timer_data->name, timer_data->data1, timer_data->data2, expiration))
+	{
+		sys_timer.Warning("sys_timer %d: event queue %d is full", timer_id, timer_data->queue_id);
+	}
+}
+
+// stops the timer, returns false if it wasn't running
+static bool sys_timer_cancel(timer* timer_data)
+{
+	u64 wheel_id;
+
+	{
+		std::lock_guard<std::mutex> lock(timer_data->mutex);
+
+		if(timer_data->timer_information_t.timer_state != SYS_TIMER_STATE_RUN) return false;
+
+		timer_data->timer_information_t.timer_state = SYS_TIMER_STATE_STOP;
+		wheel_id = timer_data->wheel_id;
+		timer_data->wheel_id = 0;
+	}
+
+	// waits for sys_timer_fire if it is being called
+	if(wheel_id) g_timer_wheel.Cancel(wheel_id);
+	return true;
+}
+
 int sys_timer_create(mem32_t timer_id)
 {
 	sys_timer.Warning("sys_timer_create(timer_id_addr=0x%x)", timer_id.GetAddr());
@@ -17,9 +73,12 @@ int sys_timer_create(mem32_t timer_id)
 
 int sys_timer_destroy(u32 timer_id)
 {
-	sys_timer.Warning("TODO: sys_timer_destroy(timer_id=%d)", timer_id);
+	sys_timer.Warning("sys_timer_destroy(timer_id=%d)", timer_id);
 
-	if(!sys_timer.CheckId(timer_id)) return CELL_ESRCH;
+	timer* timer_data = nullptr;
+	if(!sys_timer.CheckId(timer_id, timer_data)) return CELL_ESRCH;
+
+	sys_timer_cancel(timer_data);
 
 	Emu.GetIdManager().RemoveID(timer_id);
 	return CELL_OK;
@@ -32,6 +91,7 @@ int sys_timer_get_information(u32 timer_id, mem_ptr_t<sys_timer_information_t> i
 	timer* timer_data = nullptr;
 	if(!sys_timer.CheckId(timer_id, timer_data)) return CELL_ESRCH;
 
+	std::lock_guard<std::mutex> lock(timer_data->mutex);
 	*info = timer_data->timer_information_t;
 	return CELL_OK;
 }
@@ -43,27 +103,31 @@ int sys_timer_start(u32 timer_id, s64 base_time, u64 period)
 	timer* timer_data = nullptr;
 	if(!sys_timer.CheckId(timer_id, timer_data)) return CELL_ESRCH;
 
+	// period 0: single expiration at base_time
+	if(period ? period < 100 : base_time <= 0) return CELL_EINVAL;
+
+	std::lock_guard<std::mutex> lock(timer_data->mutex);
+
 	if(timer_data->timer_information_t.timer_state != SYS_TIMER_STATE_STOP) return CELL_EBUSY;
-	if(period < 100) return CELL_EINVAL;
-	//TODO: if (timer is not connected to an event queue) return CELL_ENOTCONN;
-	
-	timer_data->timer_information_t.next_expiration_time = base_time;
+	if(!timer_data->queue_id) return CELL_ENOTCONN;
+
+	const u64 expiration = base_time > 0 ? base_time : get_system_time() + period;
+
+	timer_data->timer_information_t.next_expiration_time = expiration;
 	timer_data->timer_information_t.period = period;
 	timer_data->timer_information_t.timer_state = SYS_TIMER_STATE_RUN;
-	//TODO: ?
-	timer_data->tmr.Start();
+	timer_data->wheel_id = g_timer_wheel.Add(expiration, period, [timer_id]() { sys_timer_fire(timer_id); });
 	return CELL_OK;
 }
 
 int sys_timer_stop(u32 timer_id)
 {
-	sys_timer.Warning("TODO: sys_timer_stop()");
+	sys_timer.Warning("sys_timer_stop(timer_id=%d)", timer_id);
 
 	timer* timer_data = nullptr;
 	if(!sys_timer.CheckId(timer_id, timer_data)) return CELL_ESRCH;
 
-	timer_data->timer_information_t.timer_state = SYS_TIMER_STATE_STOP;
-	timer_data->tmr.Stop();
+	sys_timer_cancel(timer_data);
 	return CELL_OK;
 }
 
@@ -77,27 +141,38 @@ int sys_timer_connect_event_queue(u32 timer_id, u32 queue_id, u64 name, u64 data
 	if(!sys_timer.CheckId(timer_id, timer_data)) return CELL_ESRCH;
 	if(!sys_timer.CheckId(queue_id, equeue)) return CELL_ESRCH;
 
-	//TODO: ?
+	std::lock_guard<std::mutex> lock(timer_data->mutex);
+
+	if(timer_data->queue_id) return CELL_EISCONN;
 
+	timer_data->queue_id = queue_id;
+	timer_data->name = name;
+	timer_data->data1 = data1;
+	timer_data->data2 = data2;
 	return CELL_OK;
 }
 
 int sys_timer_disconnect_event_queue(u32 timer_id)
 {
-	sys_timer.Warning("TODO: sys_timer_disconnect_event_queue(timer_id=%d)", timer_id);
+	sys_timer.Warning("sys_timer_disconnect_event_queue(timer_id=%d)", timer_id);
 
 	timer* timer_data = nullptr;
 	if(!sys_timer.CheckId(timer_id, timer_data)) return CELL_ESRCH;
 
-	//TODO: ?
+	sys_timer_cancel(timer_data);
+
+	std::lock_guard<std::mutex> lock(timer_data->mutex);
 
+	if(!timer_data->queue_id) return CELL_ENOTCONN;
+
+	timer_data->queue_id = 0;
 	return CELL_OK;
 }
 
 int sys_timer_sleep(u32 sleep_time)
 {
 	sys_timer.Warning("sys_timer_sleep(sleep_time=%d)", sleep_time);
-	wxSleep(sleep_time);
+	g_timer_wheel.SleepFor(sleep_time * 1000000ULL);
 	return CELL_OK;
 }
 
@@ -105,6 +180,6 @@ int sys_timer_usleep(u64 sleep_time)
 {
 	sys_timer.Log("sys_timer_usleep(sleep_time=%lld)", sleep_time);
 	if (sleep_time > 0xFFFFFFFFFFFF) sleep_time = 0xFFFFFFFFFFFF; //2^48-1
-	wxMicroSleep(sleep_time); //TODO: If (sleep_time >= 2^32) shit may happen
+	g_timer_wheel.SleepFor(sleep_time);
 	return CELL_OK;
-}
\ No newline at end of file
+}
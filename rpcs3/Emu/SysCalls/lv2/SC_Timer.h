@@ -16,8 +16,23 @@ struct sys_timer_information_t
 
 struct timer
 {
-	wxTimer tmr;
+	std::mutex mutex; // everything below, not held while cancelling wheel_id
 	sys_timer_information_t timer_information_t;
+	u64 wheel_id; // TimerWheel timer while running (0 if stopped)
+	u32 queue_id; // connected event queue (0 if none)
+	u64 name;
+	u64 data1;
+	u64 data2;
+
+	timer()
+		: wheel_id(0)
+		, queue_id(0)
+		, name(0)
+		, data1(0)
+		, data2(0)
+	{
+		memset(&timer_information_t, 0, sizeof(timer_information_t));
+	}
 };
 
 #pragma pack()
\ No newline at end of file
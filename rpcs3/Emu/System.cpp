@@ -6,6 +6,8 @@
 #include "Emu/Cell/PPUThread.h"
 #include "Emu/Cell/SPUThread.h"
 #include "Emu/Cell/PPUInstrTable.h"
+#include "Emu/CPU/GuestProfiler.h"
+#include "Emu/Clock.h"
 
 #include "../Crypto/unself.h"
 #include <cstdlib>
@@ -13,7 +15,7 @@
 using namespace PPU_instr;
 
 static const std::string& BreakPointsDBName = "BreakPoints.dat";
-static const u16 bpdb_version = 0x1000;
+static const u16 bpdb_version = 0x1001;
 
 ModuleInitializer::ModuleInitializer()
 {
@@ -23,9 +25,9 @@ ModuleInitializer::ModuleInitializer()
 Emulator::Emulator()
 	: m_status(Stopped)
 	, m_mode(DisAsm)
+	, m_headless(false)
 	, m_dbg_console(nullptr)
 	, m_rsx_callback(0)
-	, m_ppu_callback_thr(0)
 	, m_event_manager(new EventManager())
 {
 }
@@ -78,7 +80,9 @@ void Emulator::CheckStatus()
 	bool IsAllStoped = true;
 	for(u32 i=0; i<threads.size(); ++i)
 	{
-		if(threads[i]->IsStopped()) continue;
+		// the callback executor and the SPURS kernel SPUs wait for work until they are removed
+		if(threads[i]->IsStopped() || m_callback_executor.IsExecutorThread(*threads[i])) continue;
+		if(threads[i]->GetType() == CPU_THREAD_SPU && ((SPUThread*)threads[i])->spurs) continue;
 		IsAllStoped = false;
 		break;
 	}
@@ -143,6 +147,7 @@ void Emulator::Load()
 
 	ConLog.Write("Loading '%s'...", m_path.c_str());
 	GetInfo().Reset();
+	g_guest_profiler.ClearSymbols();
 	m_vfs.Init(m_path);
 
 	ConLog.SkipLn();
@@ -244,8 +249,6 @@ void Emulator::Load()
 
 	case MACHINE_PPC64:
 	{
-		m_ppu_callback_thr = &GetCPU().AddThread(CPU_THREAD_PPU);
-
 		thread.SetEntry(l.GetEntry());
 		Memory.StackMem.AllocAlign(0x1000);
 		thread.InitStack();
@@ -268,6 +271,8 @@ void Emulator::Load()
 		ppu_thr_exit_data += SC(2);
 		ppu_thr_exit_data += BCLR(0x10 | 0x04, 0, 0, 0);
 
+		GetCallbackExecutor().Init();
+
 		Memory.Write64(Memory.PRXMem.AllocAlign(0x10000), 0xDEADBEEFABADCAFE);
 	}
 	break;
@@ -277,14 +282,17 @@ void Emulator::Load()
 	break;
 	}
 
-	if(!m_dbg_console)
+	if(!IsHeadless()) // headless: TTY output goes to stdout
 	{
-		m_dbg_console = new DbgConsole();
-	}
-	else
-	{
-		GetDbgCon().Close();
-		GetDbgCon().Clear();
+		if(!m_dbg_console)
+		{
+			m_dbg_console = new DbgConsole();
+		}
+		else
+		{
+			GetDbgCon().Close();
+			GetDbgCon().Clear();
+		}
 	}
 
 	GetGSManager().Init();
@@ -296,7 +304,7 @@ void Emulator::Load()
 
 	m_status = Ready;
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_READY_EMU);
+	SendDbgCommand(DID_READY_EMU);
 #endif
 }
 
@@ -315,7 +323,7 @@ void Emulator::Run()
 		return;
 	}
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_START_EMU);
+	SendDbgCommand(DID_START_EMU);
 #endif
 
 	//ConLog.Write("run...");
@@ -329,7 +337,7 @@ void Emulator::Run()
 
 	GetCPU().Exec();
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_STARTED_EMU);
+	SendDbgCommand(DID_STARTED_EMU);
 #endif
 }
 
@@ -338,12 +346,12 @@ void Emulator::Pause()
 	if(!IsRunning()) return;
 	//ConLog.Write("pause...");
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_PAUSE_EMU);
+	SendDbgCommand(DID_PAUSE_EMU);
 #endif
 
 	m_status = Paused;
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_PAUSED_EMU);
+	SendDbgCommand(DID_PAUSED_EMU);
 #endif
 }
 
@@ -352,7 +360,7 @@ void Emulator::Resume()
 	if(!IsPaused()) return;
 	//ConLog.Write("resume...");
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_RESUME_EMU);
+	SendDbgCommand(DID_RESUME_EMU);
 #endif
 
 	m_status = Running;
@@ -360,7 +368,7 @@ void Emulator::Resume()
 	CheckStatus();
 	//if(IsRunning() && Ini.CPUDecoderMode.GetValue() != 1) GetCPU().Exec();
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_RESUMED_EMU);
+	SendDbgCommand(DID_RESUMED_EMU);
 #endif
 }
 
@@ -370,14 +378,17 @@ void Emulator::Stop()
 	//ConLog.Write("shutdown...");
 
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_STOP_EMU);
+	SendDbgCommand(DID_STOP_EMU);
 #endif
 	m_status = Stopped;
+	g_parking_lot.NotifyAll();
+	g_timer_wheel.Close();
+	GetCallbackExecutor().Close();
 
 	m_rsx_callback = 0;
 
 	SavePoints(BreakPointsDBName);
-	m_break_points.clear();
+	m_break_points.Clear();
 	m_marked_points.clear();
 
 	m_vfs.UnMountAll();
@@ -386,6 +397,8 @@ void Emulator::Stop()
 	GetAudioManager().Close();
 	GetEventManager().Clear();
 	GetCPU().Close();
+	g_parking_lot.ReportStats(m_title_id.empty() ? m_path : m_title_id);
+	g_parking_lot.ResetStats();
 	//SysCallsManager.Close();
 	GetIdManager().Clear();
 	GetPadManager().Close();
@@ -399,56 +412,70 @@ void Emulator::Stop()
 
 	//if(m_memory_viewer && m_memory_viewer->IsShown()) m_memory_viewer->Hide();
 #ifndef QT_UI
-	wxGetApp().SendDbgCommand(DID_STOPPED_EMU);
+	SendDbgCommand(DID_STOPPED_EMU);
 #endif
 }
 
 void Emulator::SavePoints(const std::string& path)
 {
+	const std::vector<u64> break_points = m_break_points.GetBreakPoints();
+	const std::vector<WatchPoint> watch_points = m_break_points.GetWatchPoints();
+
 	std::ofstream f(path, std::ios::binary | std::ios::trunc);
 
-	u32 break_count = m_break_points.size();
-	u32 marked_count = m_marked_points.size();
+	const u16 version = bpdb_version;
+	const u32 break_count = break_points.size();
+	const u32 marked_count = m_marked_points.size();
+	const u32 watch_count = watch_points.size();
+
+	f.write(reinterpret_cast<const char*>(&version), sizeof(version));
+	f.write(reinterpret_cast<const char*>(&break_count), sizeof(break_count));
+	f.write(reinterpret_cast<const char*>(&marked_count), sizeof(marked_count));
+	f.write(reinterpret_cast<const char*>(&watch_count), sizeof(watch_count));
 
-	f << bpdb_version << break_count << marked_count;
-	
 	if(break_count)
 	{
-		f.write(reinterpret_cast<char*>(&m_break_points[0]), sizeof(u64) * break_count);
+		f.write(reinterpret_cast<const char*>(&break_points[0]), sizeof(u64) * break_count);
 	}
 
 	if(marked_count)
 	{
-		f.write(reinterpret_cast<char*>(&m_marked_points[0]), sizeof(u64) * marked_count);
+		f.write(reinterpret_cast<const char*>(&m_marked_points[0]), sizeof(u64) * marked_count);
+	}
+
+	if(watch_count)
+	{
+		f.write(reinterpret_cast<const char*>(&watch_points[0]), sizeof(WatchPoint) * watch_count);
 	}
 }
 
 void Emulator::LoadPoints(const std::string& path)
 {
-	struct stat buf;
-	if (!stat(path.c_str(), &buf))
-		return;
 	std::ifstream f(path, std::ios::binary);
 	if (!f.is_open())
 		return;
 	f.seekg(0, std::ios::end);
-	int length = f.tellg();
+	const u64 length = f.tellg();
 	f.seekg(0, std::ios::beg);
-	u32 break_count, marked_count;
-	u16 version;
-	f >> version >> break_count >> marked_count;
-
-	if(version != bpdb_version ||
-		(sizeof(u16) + break_count * sizeof(u64) + sizeof(u32) + marked_count * sizeof(u64) + sizeof(u32)) != length)
+	u32 break_count = 0, marked_count = 0, watch_count = 0;
+	u16 version = 0;
+	f.read(reinterpret_cast<char*>(&version), sizeof(version));
+	f.read(reinterpret_cast<char*>(&break_count), sizeof(break_count));
+	f.read(reinterpret_cast<char*>(&marked_count), sizeof(marked_count));
+	f.read(reinterpret_cast<char*>(&watch_count), sizeof(watch_count));
+
+	if(!f || version != bpdb_version ||
+		(sizeof(u16) + 3 * sizeof(u32) + (u64)break_count * sizeof(u64) + (u64)marked_count * sizeof(u64) + (u64)watch_count * sizeof(WatchPoint)) != length)
 	{
 		ConLog.Error("'%s' is broken", path.c_str());
 		return;
 	}
 
-	if(break_count > 0)
+	for(u32 i = 0; i < break_count; i++)
 	{
-		m_break_points.resize(break_count);
-		f.read(reinterpret_cast<char*>(&m_break_points[0]), sizeof(u64) * break_count);
+		u64 addr;
+		f.read(reinterpret_cast<char*>(&addr), sizeof(addr));
+		m_break_points.AddBreakPoint(addr);
 	}
 
 	if(marked_count > 0)
@@ -456,6 +483,13 @@ void Emulator::LoadPoints(const std::string& path)
 		m_marked_points.resize(marked_count);
 		f.read(reinterpret_cast<char*>(&m_marked_points[0]), sizeof(u64) * marked_count);
 	}
+
+	for(u32 i = 0; i < watch_count; i++)
+	{
+		WatchPoint w;
+		f.read(reinterpret_cast<char*>(&w), sizeof(w));
+		m_break_points.AddWatchPoint(w.addr, w.size, w.type);
+	}
 }
 
 Emulator Emu;
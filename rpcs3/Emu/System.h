@@ -1,8 +1,11 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include "Gui/MemoryViewer.h"
 #include "Emu/CPU/CPUThreadManager.h"
+#include "Emu/CPU/BreakPoints.h"
 #include "Emu/Io/Pad.h"
 #include "Emu/Io/Keyboard.h"
 #include "Emu/Io/Mouse.h"
@@ -71,6 +74,7 @@ class Emulator
 		
 	volatile uint m_status;
 	uint m_mode;
+	bool m_headless;
 
 	u32 m_rsx_callback;
 	u32 m_ppu_thr_exit;
@@ -78,7 +82,7 @@ class Emulator
 	//ArrayF<CPUThread> m_cpu_threads;
 	std::vector<std::unique_ptr<ModuleInitializer>> m_modules_init;
 
-	std::vector<u64> m_break_points;
+	BreakPointManager m_break_points;
 	std::vector<u64> m_marked_points;
 
 	CPUThreadManager m_thread_manager;
@@ -90,7 +94,7 @@ class Emulator
 	GSManager m_gs_manager;
 	AudioManager m_audio_manager;
 	CallbackManager m_callback_manager;
-	CPUThread* m_ppu_callback_thr;
+	CallbackExecutor m_callback_executor;
 	std::unique_ptr<EventManager> m_event_manager;
 
 	VFS m_vfs;
@@ -118,9 +122,9 @@ public:
 	AudioManager&     GetAudioManager()    { return m_audio_manager; }
 	CallbackManager&  GetCallbackManager() { return m_callback_manager; }
 	VFS&              GetVFS()             { return m_vfs; }
-	std::vector<u64>& GetBreakPoints()     { return m_break_points; }
+	BreakPointManager& GetBreakPoints()    { return m_break_points; }
 	std::vector<u64>& GetMarkedPoints()    { return m_marked_points; }
-	CPUThread&        GetCallbackThread()  { return *m_ppu_callback_thr; }
+	CallbackExecutor& GetCallbackExecutor() { return m_callback_executor; }
 	EventManager&     GetEventManager()    { return *m_event_manager; }
 	
 	void AddModuleInit(std::unique_ptr<ModuleInitializer> m)
@@ -156,6 +160,13 @@ public:
 	void SavePoints(const std::string& path);
 	void LoadPoints(const std::string& path);
 
+	// for tools driving the core without an executable (rpcs3_bench): SMutex and SQueue abort while stopped
+	void SetStatus(Status status) { m_status = status; }
+
+	// no GUI: no debugger notifications, console or message boxes, windowless renderer
+	void SetHeadless(bool headless) { m_headless = headless; }
+	bool IsHeadless() const { return m_headless; }
+
 	__forceinline bool IsRunning() const { return m_status == Running; }
 	__forceinline bool IsPaused()  const { return m_status == Paused; }
 	__forceinline bool IsStopped() const { return m_status == Stopped; }
@@ -163,3 +174,18 @@ public:
 };
 
 extern Emulator Emu;
+
+// blocks on cond until pred() is true; returns false if the emulator is stopped first
+// (the wait times out every millisecond to notice the stop)
+template<typename F> bool WaitWhileRunning(std::condition_variable& cond, std::unique_lock<std::mutex>& lock, F pred)
+{
+	while (!pred())
+	{
+		if (Emu.IsStopped())
+		{
+			return false;
+		}
+		cond.wait_for(lock, std::chrono::milliseconds(1));
+	}
+	return true;
+}
@@ -9,7 +9,7 @@
 LogWriter ConLog;
 LogFrame* ConLogFrame;
 
-std::mutex g_cs_conlog;
+std::mutex g_cs_conlog; // log outputs (log thread and WriteNow)
 
 static const uint max_item_count = 500;
 static const uint buffer_size = 1024 * 64;
@@ -19,6 +19,36 @@ static const std::string g_log_colors[] =
 	"Black", "Green", "White", "Yellow", "Red",
 };
 
+static const char* const g_log_prefix[] =
+{
+	"", "S", "!", "W", "E",
+};
+
+#ifdef _WIN32
+__declspec(thread)
+#else
+thread_local
+#endif
+LogRing* g_tls_log_ring = nullptr;
+
+// Binary log (_PRGNAME_ ".blog", enabled by Ini.HLEBinaryLog).
+// Header: "RPCS3BLG", u32 version. Entries: u8 type, u8 level, u16 reserved, u32 payload size, payload:
+//   BLOG_FORMAT  : u32 id, characters (format strings and module separators, interned by content and
+//                  written before first use)
+//   BLOG_THREAD  : u32 ring id, thread name (following messages of the ring come from this thread)
+//   BLOG_MESSAGE : u64 seq, u32 ring id, u32 format id, u32 separator id, u8 flags, u8 argc, then the
+//                  arguments as stored in the ring (LogArgType, then u64 value or u32 length + characters)
+//                  without the format. Format id 0 means that the message was formatted by its thread:
+//                  the text is the string argument following the module name/id.
+enum BinaryLogEntry : u8
+{
+	BLOG_FORMAT = 1,
+	BLOG_THREAD = 2,
+	BLOG_MESSAGE = 3,
+};
+
+static const u32 g_blog_version = 2;
+
 struct LogPacket
 {
 	const std::string m_prefix;
@@ -30,7 +60,7 @@ struct LogPacket
 		, m_text(text)
 		, m_colour(colour)
 	{
-		
+
 	}
 };
 
@@ -98,7 +128,227 @@ struct _LogBuffer : public MTPacketBuffer<LogPacket>
 	}
 } LogBuffer;
 
+// reads back the arguments written by LogArg
+class LogArgReader
+{
+	const u8* m_pos;
+	u32 m_left;
+
+	void Skip()
+	{
+		if (*m_pos++ == LOG_ARG_STRING)
+		{
+			u32 len;
+			memcpy(&len, m_pos, sizeof(u32));
+			m_pos += sizeof(u32) + len;
+		}
+		else
+		{
+			m_pos += sizeof(u64);
+		}
+		m_left--;
+	}
+
+public:
+	LogArgReader(const u8* pos, u32 count)
+		: m_pos(pos)
+		, m_left(count)
+	{
+	}
+
+	const u8* GetPos() const
+	{
+		return m_pos;
+	}
+
+	LogArgType Type() const
+	{
+		return m_left ? (LogArgType)*m_pos : LOG_ARG_UINT;
+	}
+
+	// missing arguments read as 0 / empty strings
+	u64 Value()
+	{
+		if (!m_left || *m_pos == LOG_ARG_STRING)
+		{
+			if (m_left) Skip();
+			return 0;
+		}
+
+		u64 value;
+		memcpy(&value, m_pos + 1, sizeof(u64));
+		Skip();
+		return value;
+	}
+
+	double Double()
+	{
+		const LogArgType type = Type();
+		const u64 value = Value();
+
+		if (type == LOG_ARG_DOUBLE)
+		{
+			double res;
+			memcpy(&res, &value, sizeof(double));
+			return res;
+		}
+
+		return type == LOG_ARG_SINT ? (double)(s64)value : (double)value;
+	}
+
+	std::string String()
+	{
+		if (!m_left || *m_pos != LOG_ARG_STRING)
+		{
+			if (m_left) Skip();
+			return "(?)";
+		}
+
+		u32 len;
+		memcpy(&len, m_pos + 1, sizeof(u32));
+		std::string res((const char*)m_pos + 1 + sizeof(u32), len);
+		Skip();
+		return res;
+	}
+};
+
+// printf-compatible formatting of stored arguments: every conversion is re-issued to snprintf
+// with the stored value cast to what the original argument would have been
+static std::string LogFormat(const char* fmt, LogArgReader& args)
+{
+	std::string res;
+
+	for (const char* p = fmt; *p;)
+	{
+		if (*p != '%')
+		{
+			const char* next = strchr(p, '%');
+			const size_t len = next ? next - p : strlen(p);
+			res.append(p, len);
+			p += len;
+			continue;
+		}
+
+		if (p[1] == '%')
+		{
+			res += '%';
+			p += 2;
+			continue;
+		}
+
+		const char* start = p++;
+		std::string spec = "%";
+
+		while (*p && strchr("-+ #0", *p)) spec += *p++;
+
+		if (*p == '*')
+		{
+			spec += fmt::Format("%d", (s32)args.Value());
+			p++;
+		}
+		while (*p >= '0' && *p <= '9') spec += *p++;
+
+		if (*p == '.')
+		{
+			spec += *p++;
+			if (*p == '*')
+			{
+				spec += fmt::Format("%d", (s32)args.Value());
+				p++;
+			}
+			while (*p >= '0' && *p <= '9') spec += *p++;
+		}
+
+		// size of the original integer argument
+		size_t size = sizeof(int);
+		if (p[0] == 'h' && p[1] == 'h') { size = 1; p += 2; }
+		else if (p[0] == 'h') { size = 2; p++; }
+		else if (p[0] == 'l' && p[1] == 'l') { size = 8; p += 2; }
+		else if (p[0] == 'l') { size = sizeof(long); p++; }
+		else if (p[0] == 'I' && p[1] == '6' && p[2] == '4') { size = 8; p += 3; }
+		else if (p[0] == 'I' && p[1] == '3' && p[2] == '2') { size = 4; p += 3; }
+		else if (p[0] == 'j' || p[0] == 'q') { size = 8; p++; }
+		else if (p[0] == 'z' || p[0] == 't' || p[0] == 'I') { size = sizeof(size_t); p++; }
+		else if (p[0] == 'L') { p++; }
+
+		const char conv = *p;
+		if (!conv)
+		{
+			res += start;
+			break;
+		}
+		p++;
+
+		switch (conv)
+		{
+		case 'd':
+		case 'i':
+		{
+			s64 value = args.Value();
+			if (size == 1) value = (s8)value;
+			else if (size == 2) value = (s16)value;
+			else if (size == 4) value = (s32)value;
+			res += fmt::Format(spec + "lld", (long long)value);
+		}
+		break;
+
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+		{
+			u64 value = args.Value();
+			if (size == 1) value = (u8)value;
+			else if (size == 2) value = (u16)value;
+			else if (size == 4) value = (u32)value;
+			res += fmt::Format(spec + "ll" + conv, (unsigned long long)value);
+		}
+		break;
+
+		case 'c':
+			res += fmt::Format(spec + 'c', (int)(char)args.Value());
+		break;
+
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			res += fmt::Format(spec + conv, args.Double());
+		break;
+
+		case 's':
+			if (spec.length() == 1)
+				res += args.String();
+			else
+				res += fmt::Format(spec + 's', args.String().c_str());
+		break;
+
+		case 'p':
+			res += fmt::Format(spec + 'p', (void*)(size_t)args.Value());
+		break;
+
+		case 'n':
+			args.Value();
+		break;
+
+		default:
+			res.append(start, p - start);
+		break;
+		}
+	}
+
+	return res;
+}
+
 LogWriter::LogWriter()
+	: m_seq(0)
+	, m_stop(false)
+	, m_done(false)
+	, m_started(false)
 {
 	if(!m_logfile.Open(_PRGNAME_ ".log", wxFile::write))
 	{
@@ -108,59 +358,394 @@ LogWriter::LogWriter()
 	}
 }
 
-void LogWriter::WriteToLog(const std::string& prefix, const std::string& value, u8 lvl/*, wxColour bgcolour*/)
+LogWriter::~LogWriter()
+{
+	m_stop = true;
+
+	if (m_started)
+	{
+		// the log thread is detached: give it some time to drain the rings
+		m_cond.notify_all();
+		for (u32 i = 0; i < 1000 && !m_done; i++)
+		{
+			Sleep(1);
+		}
+	}
+}
+
+LogRing* LogWriter::GetRing()
 {
-	std::string new_prefix = prefix;
-	if(!prefix.empty())
+	LogRing* ring = g_tls_log_ring;
+
+	if (!ring)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_free_rings.size())
+		{
+			ring = m_free_rings.back();
+			m_free_rings.pop_back();
+			ring->m_released = false;
+			ring->m_thread = nullptr;
+		}
+		else
+		{
+			ring = new LogRing(m_rings.size() + m_free_rings.size() + 1);
+		}
+
+		m_rings.push_back(ring);
+		g_tls_log_ring = ring;
+
+		if (!m_started)
+		{
+			m_started = true;
+			std::thread(&LogWriter::Task, this).detach();
+		}
+	}
+
+	// tell the log thread which thread the following messages come from
+	NamedThreadBase* thr = GetCurrentNamedThread();
+	if (ring->m_thread != thr)
 	{
-		if(NamedThreadBase* thr = GetCurrentNamedThread())
+		ring->m_thread = thr;
+		const std::string name = thr ? thr->GetThreadName() : "";
+		const u32 size = (sizeof(LogRecord) + LogArg::Size(name) + 7) & ~7;
+
+		if (LogRecord* rec = (LogRecord*)Reserve(*ring, size))
 		{
-			new_prefix += " : " + thr->GetThreadName();
+			rec->size = size;
+			rec->type = LOG_RECORD_THREAD;
+			rec->level = 0;
+			rec->flags = 0;
+			rec->argc = 1;
+			rec->seq = 0;
+			rec->sep = nullptr;
+
+			u8* out = (u8*)(rec + 1);
+			LogArg::Put(out, name);
+			Commit(*ring, size);
 		}
 	}
 
-	if(m_logfile.IsOpened() && !new_prefix.empty())
-		m_logfile.Write(fmt::FromUTF8("[" + new_prefix + "]: " + value + "\n"));
+	return ring;
+}
+
+u8* LogWriter::Reserve(LogRing& ring, u32 size)
+{
+	const u32 put = ring.m_put.load(std::memory_order_relaxed);
+	const u32 offset = put % LogRing::capacity;
+	const u32 pad = LogRing::capacity - offset < size ? LogRing::capacity - offset : 0;
 
-	if(!ConLogFrame || Ini.HLELogLvl.GetValue() == 4 || (lvl != 0 && lvl <= Ini.HLELogLvl.GetValue()))
+	// the ring is full: wait for the log thread
+	if (LogRing::capacity - (put - ring.m_get.load(std::memory_order_acquire)) < size + pad)
+	{
+		std::unique_lock<std::mutex> lock(m_space_mutex);
+
+		while (LogRing::capacity - (put - ring.m_get.load(std::memory_order_acquire)) < size + pad)
+		{
+			if (m_done)
+			{
+				return nullptr;
+			}
+
+			m_cond.notify_one();
+			m_space_cond.wait(lock);
+		}
+	}
+
+	// records are never split: skip the end of the ring
+	if (pad)
+	{
+		LogRecord& skip = *(LogRecord*)&ring.m_data[offset];
+		skip.size = pad;
+		skip.type = LOG_RECORD_SKIP;
+		ring.m_put.store(put + pad, std::memory_order_release);
+	}
+
+	return &ring.m_data[(put + pad) % LogRing::capacity];
+}
+
+void LogWriter::Commit(LogRing& ring, u32 size)
+{
+	const u32 put = ring.m_put.load(std::memory_order_relaxed);
+	const bool was_empty = put == ring.m_get.load(std::memory_order_acquire);
+
+	ring.m_put.store(put + size, std::memory_order_release);
+
+	if (was_empty)
+	{
+		m_cond.notify_one();
+	}
+}
+
+void LogWriter::ReleaseThreadBuffer()
+{
+	if (LogRing* ring = g_tls_log_ring)
+	{
+		g_tls_log_ring = nullptr;
+		ring->m_released = true;
+	}
+}
+
+void LogWriter::Process(std::string& thread_name, u32 ring_id, const LogRecord& rec, std::string& text_out)
+{
+	LogArgReader args((const u8*)(&rec + 1), rec.argc + !!(rec.flags & LOG_FLAG_MODULE) + !!(rec.flags & LOG_FLAG_MODULE_ID) + !!(rec.flags & LOG_FLAG_FMT_INLINE));
+
+	if (rec.type == LOG_RECORD_THREAD)
+	{
+		thread_name = args.String();
+
+		if (m_binfile.IsOpened())
+		{
+			WriteBinary(BLOG_THREAD, 0, ring_id, thread_name.c_str(), thread_name.length());
+		}
 		return;
+	}
 
-	std::lock_guard<std::mutex> lock(g_cs_conlog);
+	const u8* args_begin = args.GetPos();
 
-#ifdef QT_UI
-	// TODO: Use ThreadBase instead, track main thread id
-	if(QThread::currentThread() == qApp->thread())
-#else
-	if(wxThread::IsMain())
-#endif
+	std::string value;
+	if (rec.flags & LOG_FLAG_MODULE)
 	{
-		while(LogBuffer.IsBusy())
+		value = args.String();
+		if (rec.flags & LOG_FLAG_MODULE_ID)
 		{
-			// need extra break condition?
-			wxYieldIfNeeded();
+			value += fmt::Format("[%d]", (int)args.Value());
 		}
+		value += rec.sep;
+	}
+
+	const u8* fmt_begin = args.GetPos();
+	const u8* fmt_end = fmt_begin;
+	std::string fmt;
+
+	if (rec.flags & LOG_FLAG_FORMATTED)
+	{
+		value += args.String();
 	}
 	else
 	{
-		while (LogBuffer.IsBusy())
+		fmt = args.String();
+		fmt_end = args.GetPos();
+		value += LogFormat(fmt.c_str(), args);
+	}
+
+	if (Ini.HLEBinaryLog.GetValue())
+	{
+		if (!m_binfile.IsOpened() && m_binfile.Open(_PRGNAME_ ".blog", wxFile::write))
+		{
+			m_binfile.Write("RPCS3BLG", 8);
+			m_binfile.Write(&g_blog_version, sizeof(u32));
+			m_format_ids.clear();
+		}
+
+		if (m_binfile.IsOpened())
 		{
-			if (Emu.IsStopped())
+			std::vector<u8> payload(sizeof(u64) + sizeof(u32) * 4 + 2);
+			u8* out = &payload[0];
+			memcpy(out, &rec.seq, sizeof(u64));
+			memcpy(out + 8, &ring_id, sizeof(u32));
+			// the format is written once in the table instead of in every message
+			const u32 fmt_id = fmt_end != fmt_begin ? GetFormatId(fmt.c_str()) : 0;
+			memcpy(out + 12, &fmt_id, sizeof(u32));
+			const u32 sep_id = GetFormatId(rec.sep);
+			memcpy(out + 16, &sep_id, sizeof(u32));
+			out[20] = fmt_id ? rec.flags & ~LOG_FLAG_FMT_INLINE : rec.flags;
+			out[21] = rec.argc;
+			payload.insert(payload.end(), args_begin, fmt_begin);
+			payload.insert(payload.end(), fmt_end, args.GetPos());
+			WriteBinary(BLOG_MESSAGE, rec.level, 0, &payload[0], payload.size());
+		}
+	}
+
+	std::string new_prefix = g_log_prefix[rec.level];
+	if(!new_prefix.empty() && !thread_name.empty())
+	{
+		new_prefix += " : " + thread_name;
+	}
+
+	if(!new_prefix.empty())
+		text_out += "[" + new_prefix + "]: " + value + "\n";
+
+	if(!ConLogFrame || Ini.HLELogLvl.GetValue() == 4 || (rec.level != 0 && rec.level <= Ini.HLELogLvl.GetValue()))
+		return;
+
+	while (LogBuffer.IsBusy())
+	{
+		if (Emu.IsStopped())
+		{
+			break;
+		}
+		Sleep(1);
+	}
+
+	LogBuffer.Push(LogPacket(new_prefix, value, g_log_colors[rec.level]));
+}
+
+u32 LogWriter::GetFormatId(const char* str)
+{
+	if (!str)
+	{
+		return 0;
+	}
+
+	auto found = m_format_ids.find(str);
+	if (found != m_format_ids.end())
+	{
+		return found->second;
+	}
+
+	const u32 id = m_format_ids.size() + 1;
+	m_format_ids[str] = id;
+	WriteBinary(BLOG_FORMAT, 0, id, str, strlen(str));
+	return id;
+}
+
+void LogWriter::WriteBinary(u8 type, u8 level, u32 id, const void* data, u32 size)
+{
+	const bool has_id = type != BLOG_MESSAGE;
+	u8 header[8] = { type, level, 0, 0 };
+	const u32 payload_size = size + (has_id ? sizeof(u32) : 0);
+	memcpy(header + 4, &payload_size, sizeof(u32));
+
+	m_binfile.Write(header, sizeof(header));
+	if (has_id) m_binfile.Write(&id, sizeof(u32));
+	m_binfile.Write(data, size);
+}
+
+void LogWriter::WriteNow(const LogRecord& rec)
+{
+	std::lock_guard<std::mutex> lock(g_cs_conlog);
+
+	NamedThreadBase* thr = GetCurrentNamedThread();
+	std::string name = thr ? thr->GetThreadName() : "";
+	std::string text;
+
+	Process(name, 0, rec, text);
+
+	if (m_logfile.IsOpened() && text.length())
+	{
+		m_logfile.Write(text.c_str(), text.length());
+	}
+}
+
+void LogWriter::Task()
+{
+	std::vector<LogRing*> rings;
+	std::string text;
+
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			// rings of exited threads are reused once drained
+			for (u32 i = 0; i < m_rings.size();)
+			{
+				LogRing* ring = m_rings[i];
+				if (ring->m_released && ring->m_get == ring->m_put)
+				{
+					ring->m_name.clear();
+					m_free_rings.push_back(ring);
+					m_rings.erase(m_rings.begin() + i);
+					continue;
+				}
+				i++;
+			}
+
+			rings = m_rings;
+		}
+
+		u32 count = 0;
+		{
+			std::lock_guard<std::mutex> lock(g_cs_conlog);
+
+			// merge the rings in message order
+			while (true)
+			{
+				LogRing* best = nullptr;
+				const LogRecord* best_rec = nullptr;
+
+				for (u32 i = 0; i < rings.size(); i++)
+				{
+					LogRing& ring = *rings[i];
+
+					while (true)
+					{
+						const u32 get = ring.m_get.load(std::memory_order_relaxed);
+						if (get == ring.m_put.load(std::memory_order_acquire))
+						{
+							break;
+						}
+
+						const LogRecord& rec = *(LogRecord*)&ring.m_data[get % LogRing::capacity];
+						if (rec.type == LOG_RECORD_MESSAGE)
+						{
+							if (!best_rec || rec.seq < best_rec->seq)
+							{
+								best = &ring;
+								best_rec = &rec;
+							}
+							break;
+						}
+
+						if (rec.type == LOG_RECORD_THREAD)
+						{
+							Process(ring.m_name, ring.m_id, rec, text);
+						}
+						ring.m_get.store(get + rec.size, std::memory_order_release);
+					}
+				}
+
+				if (!best)
+				{
+					break;
+				}
+
+				Process(best->m_name, best->m_id, *best_rec, text);
+				best->m_get.store(best->m_get.load(std::memory_order_relaxed) + best_rec->size, std::memory_order_release);
+				count++;
+
+				if (text.length() >= 64 * 1024)
+				{
+					m_logfile.Write(text.c_str(), text.length());
+					text.clear();
+				}
+			}
+
+			if (m_logfile.IsOpened() && text.length())
+			{
+				m_logfile.Write(text.c_str(), text.length());
+			}
+			text.clear();
+		}
+
+		{
+			// wake up the producers waiting for space (m_get is updated before taking the lock)
+			std::lock_guard<std::mutex> lock(m_space_mutex);
+			m_space_cond.notify_all();
+		}
+
+		if (!count)
+		{
+			if (m_stop)
 			{
 				break;
 			}
-			Sleep(1);
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait_for(lock, std::chrono::milliseconds(10));
 		}
 	}
 
-	//if(LogBuffer.put == LogBuffer.get) LogBuffer.Flush();
-
-	LogBuffer.Push(LogPacket(new_prefix, value, g_log_colors[lvl]));
+	std::lock_guard<std::mutex> lock(m_space_mutex);
+	m_done = true;
+	m_space_cond.notify_all();
 }
 
-
 void LogWriter::SkipLn()
 {
-	WriteToLog("", "", 0);
+	Post(0, 0, nullptr, -1, nullptr, "");
 }
 
 BEGIN_EVENT_TABLE(LogFrame, wxPanel)
@@ -180,7 +765,7 @@ LogFrame::LogFrame(wxWindow* parent)
 	s_main.Add(&m_log, 1, wxEXPAND);
 	SetSizer(&s_main);
 	Layout();
-	
+
 	Show();
 	ThreadBase::Start();
 }
@@ -2,52 +2,373 @@
 #include <wx/listctrl.h>
 #include "Ini.h"
 #include "Gui/FrameBase.h"
+#include <atomic>
+#include <type_traits>
+#include <unordered_map>
+
+// Log sites below this level are compiled out (1 = success, 2 = notice and HLE logging, 3 = warning, 4 = error)
+#ifndef CONLOG_MIN_LEVEL
+#define CONLOG_MIN_LEVEL 0
+#endif
+
+// Messages are not formatted by the calling thread: the format string and the raw arguments are
+// stored as a binary record in a ring owned by the thread, and the log thread formats them for the
+// log window and the log files. Literal format strings are referenced by address, other strings are
+// copied into the record. Arguments that can't be stored (anything but numbers, enums, pointers and
+// strings) make the message fall back to formatting on the calling thread.
+
+enum LogArgType : u8
+{
+	LOG_ARG_SINT,
+	LOG_ARG_UINT,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_PTR,
+	LOG_ARG_STRING, // u32 length followed by the characters
+};
+
+enum LogRecordType : u8
+{
+	LOG_RECORD_SKIP,    // padding up to the end of the ring
+	LOG_RECORD_THREAD,  // following messages come from the thread named by the string argument
+	LOG_RECORD_MESSAGE,
+};
+
+enum LogRecordFlags : u8
+{
+	LOG_FLAG_MODULE     = 0x1, // module name string is the first argument, `sep` follows it
+	LOG_FLAG_MODULE_ID  = 0x2, // module id (uint) follows the module name and is printed as "[id]"
+	LOG_FLAG_FMT_INLINE = 0x4, // format string is stored as the next string argument
+	LOG_FLAG_FORMATTED  = 0x8, // the inline "format" is the final text
+};
+
+struct LogRecord
+{
+	u32 size; // whole record, multiple of 8
+	LogRecordType type;
+	u8 level;
+	u8 flags;
+	u8 argc;
+	u64 seq;  // message order across threads
+	const char* sep;
+};
+
+static const u32 log_max_string = 16 * 1024;
+
+// single producer (the owner thread), single consumer (the log thread)
+class LogRing
+{
+public:
+	static const u32 capacity = 512 * 1024;
+
+	std::unique_ptr<u8[]> m_data;
+	std::atomic<u32> m_put;
+	std::atomic<u32> m_get;
+	std::atomic<bool> m_released; // the owner thread has exited
+	NamedThreadBase* m_thread;    // producer side: thread announced by the last LOG_RECORD_THREAD
+	std::string m_name;           // consumer side
+	u32 m_id;
+
+	LogRing(u32 id)
+		: m_data(new u8[capacity])
+		, m_put(0)
+		, m_get(0)
+		, m_released(false)
+		, m_thread(nullptr)
+		, m_id(id)
+	{
+	}
+};
+
+template<typename... T> struct LogDeferrable
+{
+	static const bool value = true;
+};
+
+template<typename T, typename... R> struct LogDeferrable<T, R...>
+{
+	typedef typename std::decay<T>::type type;
+
+	static const bool value = (std::is_arithmetic<type>::value || std::is_enum<type>::value ||
+		std::is_pointer<type>::value || std::is_same<type, std::string>::value) && LogDeferrable<R...>::value;
+};
+
+// first argument of Module/SysCallBase logging functions that isn't an id
+template<typename F> struct LogFormatArg
+{
+	typedef typename std::decay<F>::type type;
+
+	static const bool value = !std::is_arithmetic<type>::value && !std::is_enum<type>::value;
+};
+
+struct LogArg
+{
+	static u32 StrLen(const char* str)
+	{
+		return str ? (u32)std::min<size_t>(strlen(str), log_max_string) : 6;
+	}
+
+	template<typename T> static typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value, u32>::type Size(T)
+	{
+		return 9;
+	}
+
+	template<typename T> static u32 Size(T*)
+	{
+		return 9;
+	}
+
+	static u32 Size(const char* str)
+	{
+		return 5 + StrLen(str);
+	}
+
+	static u32 Size(char* str)
+	{
+		return 5 + StrLen(str);
+	}
+
+	static u32 Size(const std::string& str)
+	{
+		return 5 + (u32)std::min<size_t>(str.length(), log_max_string);
+	}
+
+	static void PutValue(u8*& out, LogArgType type, u64 value)
+	{
+		*out++ = type;
+		memcpy(out, &value, sizeof(u64));
+		out += sizeof(u64);
+	}
+
+	static void PutString(u8*& out, const char* str, u32 len)
+	{
+		*out++ = LOG_ARG_STRING;
+		memcpy(out, &len, sizeof(u32));
+		memcpy(out + sizeof(u32), str, len);
+		out += sizeof(u32) + len;
+	}
+
+	template<typename T> static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type Put(u8*& out, T value)
+	{
+		if (std::is_signed<T>::value)
+			PutValue(out, LOG_ARG_SINT, (u64)(s64)value);
+		else
+			PutValue(out, LOG_ARG_UINT, (u64)value);
+	}
+
+	template<typename T> static typename std::enable_if<std::is_floating_point<T>::value>::type Put(u8*& out, T value)
+	{
+		const double d = value;
+		u64 bits;
+		memcpy(&bits, &d, sizeof(u64));
+		PutValue(out, LOG_ARG_DOUBLE, bits);
+	}
+
+	template<typename T> static void Put(u8*& out, T* ptr)
+	{
+		PutValue(out, LOG_ARG_PTR, (u64)ptr);
+	}
+
+	static void Put(u8*& out, const char* str)
+	{
+		if (str)
+			PutString(out, str, StrLen(str));
+		else
+			PutString(out, "(null)", 6);
+	}
+
+	static void Put(u8*& out, char* str)
+	{
+		Put(out, (const char*)str);
+	}
+
+	static void Put(u8*& out, const std::string& str)
+	{
+		PutString(out, str.c_str(), (u32)std::min<size_t>(str.length(), log_max_string));
+	}
+
+	static u32 SizeAll()
+	{
+		return 0;
+	}
+
+	template<typename T, typename... R> static u32 SizeAll(const T& arg, const R&... rest)
+	{
+		return Size(arg) + SizeAll(rest...);
+	}
+
+	static void PutAll(u8*&)
+	{
+	}
+
+	template<typename T, typename... R> static void PutAll(u8*& out, const T& arg, const R&... rest)
+	{
+		Put(out, arg);
+		PutAll(out, rest...);
+	}
+};
 
 class LogWriter
 {
 	wxFile m_logfile;
+	wxFile m_binfile;
 	wxColour m_txtcolour;
 
-	//wxString m_prefix;
-	//wxString m_value;
+	std::mutex m_mutex; // ring registry
+	std::condition_variable m_cond; // wakes the log thread up
+	std::vector<LogRing*> m_rings;
+	std::vector<LogRing*> m_free_rings;
+	std::atomic<u64> m_seq;
+	std::atomic<bool> m_stop;
+	std::atomic<bool> m_done;
+	bool m_started;
+
+	std::mutex m_space_mutex;
+	std::condition_variable m_space_cond; // signalled by the log thread after draining the rings
+
+	LogRing* GetRing();
+	u8* Reserve(LogRing& ring, u32 size);
+	void Commit(LogRing& ring, u32 size);
+	void Task();
+	void Process(std::string& thread_name, u32 ring_id, const LogRecord& rec, std::string& text_out);
 
-	void WriteToLog(const std::string& prefix, const std::string& value, u8 lvl);
+	// binary log (log thread or WriteNow, under the output lock)
+	std::unordered_map<std::string, u32> m_format_ids; // by content: the formats are copied
+	u32 GetFormatId(const char* str);
+	void WriteBinary(u8 type, u8 level, u32 id, const void* data, u32 size);
+
+	// format and output a record on the calling thread (logging after the log thread has stopped)
+	void WriteNow(const LogRecord& rec);
+
+	template<typename... Arg>
+	void Post(u8 lvl, u8 flags, const std::string* module, s64 id, const char* sep, const char* fmt, const Arg&... args)
+	{
+		u32 size = sizeof(LogRecord) + LogArg::SizeAll(args...);
+		if (module)
+		{
+			flags |= LOG_FLAG_MODULE;
+			size += LogArg::Size(*module);
+			if (id >= 0)
+			{
+				flags |= LOG_FLAG_MODULE_ID;
+				size += LogArg::Size((u64)id);
+			}
+		}
+		flags |= LOG_FLAG_FMT_INLINE;
+		size += LogArg::Size(fmt);
+		size = (size + 7) & ~7;
+
+		LogRing* ring = m_stop ? nullptr : GetRing();
+		std::vector<u64> local;
+		LogRecord* rec;
+
+		if (ring && size <= LogRing::capacity / 4)
+		{
+			rec = (LogRecord*)Reserve(*ring, size);
+		}
+		else
+		{
+			ring = nullptr;
+			local.resize(size / sizeof(u64));
+			rec = (LogRecord*)&local[0];
+		}
+
+		rec->size = size;
+		rec->type = LOG_RECORD_MESSAGE;
+		rec->level = lvl;
+		rec->flags = flags;
+		rec->argc = sizeof...(args);
+		rec->seq = m_seq++;
+		rec->sep = sep;
+
+		u8* out = (u8*)(rec + 1);
+		if (module)
+		{
+			LogArg::Put(out, *module);
+			if (id >= 0) LogArg::Put(out, (u64)id);
+		}
+		LogArg::Put(out, fmt);
+		LogArg::PutAll(out, args...);
+
+		if (ring)
+			Commit(*ring, size);
+		else
+			WriteNow(*rec);
+	}
+
+	// the format is copied into the record: a const char array isn't necessarily a literal that outlives the call
+	template<size_t N, typename... Arg>
+	typename std::enable_if<LogDeferrable<Arg...>::value>::type Dispatch(u8 lvl, const std::string* module, s64 id, const char* sep, const char (&fmt)[N], Arg&&... args)
+	{
+		Post(lvl, 0, module, id, sep, fmt, args...);
+	}
+
+	template<typename... Arg>
+	typename std::enable_if<LogDeferrable<Arg...>::value>::type Dispatch(u8 lvl, const std::string* module, s64 id, const char* sep, const std::string& fmt, Arg&&... args)
+	{
+		Post(lvl, 0, module, id, sep, fmt.c_str(), args...);
+	}
+
+	template<size_t N, typename... Arg>
+	typename std::enable_if<LogDeferrable<Arg...>::value>::type Dispatch(u8 lvl, const std::string* module, s64 id, const char* sep, char (&fmt)[N], Arg&&... args)
+	{
+		Post(lvl, 0, module, id, sep, fmt, args...);
+	}
+
+	// arguments that can't be stored are formatted on the calling thread
+	template<typename F, typename... Arg>
+	typename std::enable_if<!LogDeferrable<Arg...>::value>::type Dispatch(u8 lvl, const std::string* module, s64 id, const char* sep, const F& fmt, Arg&&... args)
+	{
+		const std::string text = fmt::Format(fmt, std::forward<Arg>(args)...);
+		Post(lvl, LOG_FLAG_FORMATTED, module, id, sep, text.c_str());
+	}
 
 public:
 	LogWriter();
+	~LogWriter();
 
-	template <typename ...Arg>
-	void Write(const std::string &fmt, Arg&&... args)
+	template <typename F, typename ...Arg>
+	void Write(F&& fmt, Arg&&... args)
 	{
-		std::string frmt = fmt::Format(fmt, std::forward<Arg>(args)...);
-		WriteToLog("!", frmt, 2);
+		if (2 < CONLOG_MIN_LEVEL) return;
+		Dispatch(2, nullptr, -1, nullptr, std::forward<F>(fmt), std::forward<Arg>(args)...);
 	}
-	
-	template <typename ...Arg>
-	void Error(const std::string &fmt, Arg&&... args)
+
+	template <typename F, typename ...Arg>
+	void Error(F&& fmt, Arg&&... args)
 	{
-		std::string frmt = fmt::Format(fmt, std::forward<Arg>(args)...);
-		WriteToLog("E", frmt, 4);
+		if (4 < CONLOG_MIN_LEVEL) return;
+		Dispatch(4, nullptr, -1, nullptr, std::forward<F>(fmt), std::forward<Arg>(args)...);
 	}
-	
-	template <typename ...Arg>
-	void Warning(const std::string &fmt, Arg&&... args)
+
+	template <typename F, typename ...Arg>
+	void Warning(F&& fmt, Arg&&... args)
 	{
-		std::string frmt = fmt::Format(fmt, std::forward<Arg>(args)...);
-		WriteToLog("W", frmt, 3);
+		if (3 < CONLOG_MIN_LEVEL) return;
+		Dispatch(3, nullptr, -1, nullptr, std::forward<F>(fmt), std::forward<Arg>(args)...);
 	}
-	
-	template <typename ...Arg>
-	void Success(const std::string &fmt, Arg&&... args)
+
+	template <typename F, typename ...Arg>
+	void Success(F&& fmt, Arg&&... args)
+	{
+		if (1 < CONLOG_MIN_LEVEL) return;
+		Dispatch(1, nullptr, -1, nullptr, std::forward<F>(fmt), std::forward<Arg>(args)...);
+	}
+
+	// "<module>[<id>]<sep><message>" (id < 0: no id), used by Module and SysCallBase
+	template <typename F, typename ...Arg>
+	void ModuleLog(u8 lvl, const std::string& module, s64 id, const char* sep, F&& fmt, Arg&&... args)
 	{
-		std::string frmt = fmt::Format(fmt, std::forward<Arg>(args)...);
-		WriteToLog("S", frmt, 1);
+		if (lvl < CONLOG_MIN_LEVEL) return;
+		Dispatch(lvl, &module, id, sep, std::forward<F>(fmt), std::forward<Arg>(args)...);
 	}
-	
-	virtual void SkipLn();	
+
+	virtual void SkipLn();
+
+	// called by exiting threads: the ring is reused once the log thread has drained it
+	void ReleaseThreadBuffer();
 };
 
-class LogFrame 
+class LogFrame
 	: public wxPanel
 	, public ThreadBase
 {
@@ -63,7 +384,7 @@ private:
 	virtual void Task();
 
 	void OnQuit(wxCloseEvent& event);
-	
+
 	DECLARE_EVENT_TABLE();
 };
 
@@ -4,6 +4,8 @@
 #include "Debugger.h"
 #include "Emu/Memory/Memory.h"
 #include "InterpreterDisAsm.h"
+#include "Emu/SysCalls/HLEProfiler.h"
+#include "Emu/CPU/GuestProfiler.h"
 
 class DbgEmuPanel : public wxPanel
 {
@@ -100,12 +102,332 @@ public:
 	}
 };
 
+// per-function HLE call timing (see HLEProfiler.h)
+class DbgHLEProfilerPanel : public wxPanel
+{
+	wxCheckBox* m_chbox_enable;
+	wxListView* m_list;
+
+public:
+	DbgHLEProfilerPanel(wxWindow* parent) : wxPanel(parent)
+	{
+		m_chbox_enable = new wxCheckBox(this, wxID_ANY, "Profile HLE calls");
+		wxButton* b_refresh = new wxButton(this, wxID_ANY, "Refresh");
+		wxButton* b_reset   = new wxButton(this, wxID_ANY, "Reset");
+		wxButton* b_export  = new wxButton(this, wxID_ANY, "Export...");
+		m_list = new wxListView(this, wxID_ANY, wxDefaultPosition, wxSize(400, 200));
+
+		m_list->InsertColumn(0, "Function", 0, 200);
+		m_list->InsertColumn(1, "Calls", 0, 70);
+		m_list->InsertColumn(2, "Total (us)", 0, 80);
+		m_list->InsertColumn(3, "Avg (us)", 0, 70);
+		m_list->InsertColumn(4, "Max (us)", 0, 70);
+		m_list->InsertColumn(5, "p99 (us)", 0, 70);
+
+		wxBoxSizer& s_b_buttons = *new wxBoxSizer(wxHORIZONTAL);
+		s_b_buttons.Add(m_chbox_enable, wxSizerFlags().Border(wxALL, 5).Center());
+		s_b_buttons.Add(b_refresh,      wxSizerFlags().Border(wxALL, 5));
+		s_b_buttons.Add(b_reset,        wxSizerFlags().Border(wxALL, 5));
+		s_b_buttons.Add(b_export,       wxSizerFlags().Border(wxALL, 5));
+
+		wxBoxSizer& s_b_main = *new wxBoxSizer(wxVERTICAL);
+		s_b_main.Add(&s_b_buttons);
+		s_b_main.Add(m_list, 1, wxEXPAND);
+
+		SetSizerAndFit(&s_b_main);
+		Layout();
+
+		m_chbox_enable->SetValue(g_hle_profiler.IsEnabled());
+
+		Connect(m_chbox_enable->GetId(), wxEVT_COMMAND_CHECKBOX_CLICKED, wxCommandEventHandler(DbgHLEProfilerPanel::OnEnable));
+		Connect(b_refresh->GetId(),      wxEVT_COMMAND_BUTTON_CLICKED,   wxCommandEventHandler(DbgHLEProfilerPanel::OnRefresh));
+		Connect(b_reset->GetId(),        wxEVT_COMMAND_BUTTON_CLICKED,   wxCommandEventHandler(DbgHLEProfilerPanel::OnReset));
+		Connect(b_export->GetId(),       wxEVT_COMMAND_BUTTON_CLICKED,   wxCommandEventHandler(DbgHLEProfilerPanel::OnExport));
+	}
+
+	void UpdateList()
+	{
+		const std::vector<HLECallEntry> entries = g_hle_profiler.Collect();
+
+		m_list->Freeze();
+		m_list->DeleteAllItems();
+
+		for (u32 i = 0; i < entries.size(); i++)
+		{
+			const HLECallStats& s = entries[i].stats;
+
+			m_list->InsertItem(i, fmt::FromUTF8(entries[i].name));
+			m_list->SetItem(i, 1, wxString::Format("%llu", s.count));
+			m_list->SetItem(i, 2, wxString::Format("%.1f", s.total / 10.0));
+			m_list->SetItem(i, 3, wxString::Format("%.2f", s.total / 10.0 / std::max<u64>(s.count, 1)));
+			m_list->SetItem(i, 4, wxString::Format("%.1f", s.max / 10.0));
+			m_list->SetItem(i, 5, wxString::Format("%.1f", s.Percentile(0.99) / 10.0));
+		}
+
+		m_list->Thaw();
+	}
+
+	void OnEnable(wxCommandEvent& event)
+	{
+		g_hle_profiler.Enable(m_chbox_enable->GetValue());
+	}
+
+	void OnRefresh(wxCommandEvent& event)
+	{
+		UpdateList();
+	}
+
+	void OnReset(wxCommandEvent& event)
+	{
+		g_hle_profiler.Reset();
+		UpdateList();
+	}
+
+	void OnExport(wxCommandEvent& event)
+	{
+		wxFileDialog ctrl(this, L"Export HLE profile", wxEmptyString, "hle_profile.json",
+			"JSON (*.json)|*.json|"
+			"CSV (*.csv)|*.csv",
+			wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+
+		if(ctrl.ShowModal() == wxID_CANCEL) return;
+
+		const std::string path = fmt::ToUTF8(ctrl.GetPath());
+		if(ctrl.GetFilterIndex() == 1)
+			g_hle_profiler.ExportCSV(path);
+		else
+			g_hle_profiler.ExportJSON(path);
+	}
+};
+
+// guest code sampling (see GuestProfiler.h)
+class DbgGuestProfilerPanel : public wxPanel
+{
+	wxCheckBox* m_chbox_sample;
+	wxCheckBox* m_chbox_opcodes;
+	wxListView* m_list;
+
+public:
+	DbgGuestProfilerPanel(wxWindow* parent) : wxPanel(parent)
+	{
+		m_chbox_sample  = new wxCheckBox(this, wxID_ANY, "Sample guest threads");
+		m_chbox_opcodes = new wxCheckBox(this, wxID_ANY, "Count opcodes");
+		wxButton* b_refresh = new wxButton(this, wxID_ANY, "Refresh");
+		wxButton* b_reset   = new wxButton(this, wxID_ANY, "Reset");
+		wxButton* b_export  = new wxButton(this, wxID_ANY, "Export...");
+		m_list = new wxListView(this, wxID_ANY, wxDefaultPosition, wxSize(400, 200));
+
+		m_list->InsertColumn(0, "Block", 0, 90);
+		m_list->InsertColumn(1, "Symbol", 0, 200);
+		m_list->InsertColumn(2, "Samples", 0, 70);
+		m_list->InsertColumn(3, "%", 0, 50);
+		m_list->InsertColumn(4, "Thread", 0, 150);
+
+		wxBoxSizer& s_b_buttons = *new wxBoxSizer(wxHORIZONTAL);
+		s_b_buttons.Add(m_chbox_sample,  wxSizerFlags().Border(wxALL, 5).Center());
+		s_b_buttons.Add(m_chbox_opcodes, wxSizerFlags().Border(wxALL, 5).Center());
+		s_b_buttons.Add(b_refresh,       wxSizerFlags().Border(wxALL, 5));
+		s_b_buttons.Add(b_reset,         wxSizerFlags().Border(wxALL, 5));
+		s_b_buttons.Add(b_export,        wxSizerFlags().Border(wxALL, 5));
+
+		wxBoxSizer& s_b_main = *new wxBoxSizer(wxVERTICAL);
+		s_b_main.Add(&s_b_buttons);
+		s_b_main.Add(m_list, 1, wxEXPAND);
+
+		SetSizerAndFit(&s_b_main);
+		Layout();
+
+		m_chbox_sample->SetValue(g_guest_profiler.IsSampling());
+		m_chbox_opcodes->SetValue(g_guest_profiler.IsCountingOpcodes());
+
+		Connect(m_chbox_sample->GetId(),  wxEVT_COMMAND_CHECKBOX_CLICKED, wxCommandEventHandler(DbgGuestProfilerPanel::OnEnable));
+		Connect(m_chbox_opcodes->GetId(), wxEVT_COMMAND_CHECKBOX_CLICKED, wxCommandEventHandler(DbgGuestProfilerPanel::OnEnable));
+		Connect(b_refresh->GetId(),       wxEVT_COMMAND_BUTTON_CLICKED,   wxCommandEventHandler(DbgGuestProfilerPanel::OnRefresh));
+		Connect(b_reset->GetId(),         wxEVT_COMMAND_BUTTON_CLICKED,   wxCommandEventHandler(DbgGuestProfilerPanel::OnReset));
+		Connect(b_export->GetId(),        wxEVT_COMMAND_BUTTON_CLICKED,   wxCommandEventHandler(DbgGuestProfilerPanel::OnExport));
+	}
+
+	void UpdateList()
+	{
+		const std::vector<GuestBlockStats> blocks = g_guest_profiler.GetHotBlocks(100);
+		const u64 total = std::max<u64>(g_guest_profiler.GetTotalSamples(), 1);
+
+		m_list->Freeze();
+		m_list->DeleteAllItems();
+
+		for (u32 i = 0; i < blocks.size(); i++)
+		{
+			m_list->InsertItem(i, wxString::Format("0x%llx", blocks[i].block));
+			m_list->SetItem(i, 1, fmt::FromUTF8(g_guest_profiler.Symbolize(blocks[i].block)));
+			m_list->SetItem(i, 2, wxString::Format("%llu", blocks[i].samples));
+			m_list->SetItem(i, 3, wxString::Format("%.2f", blocks[i].samples * 100.0 / total));
+			m_list->SetItem(i, 4, fmt::FromUTF8(blocks[i].thread));
+		}
+
+		m_list->Thaw();
+	}
+
+	void OnEnable(wxCommandEvent& event)
+	{
+		g_guest_profiler.EnableSampling(m_chbox_sample->GetValue());
+		g_guest_profiler.EnableOpcodeCounts(m_chbox_opcodes->GetValue());
+	}
+
+	void OnRefresh(wxCommandEvent& event)
+	{
+		UpdateList();
+	}
+
+	void OnReset(wxCommandEvent& event)
+	{
+		g_guest_profiler.Reset();
+		UpdateList();
+	}
+
+	void OnExport(wxCommandEvent& event)
+	{
+		wxFileDialog ctrl(this, L"Export guest profile", wxEmptyString, "guest_profile.folded",
+			"Folded stacks (*.folded)|*.folded|"
+			"Hot block report (*.txt)|*.txt",
+			wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+
+		if(ctrl.ShowModal() == wxID_CANCEL) return;
+
+		const std::string path = fmt::ToUTF8(ctrl.GetPath());
+		if(ctrl.GetFilterIndex() == 1)
+			g_guest_profiler.ExportReport(path);
+		else
+			g_guest_profiler.ExportFolded(path);
+	}
+};
+
+// data watchpoints (see BreakPoints.h)
+class DbgWatchPointsPanel : public wxPanel
+{
+	AppConnector m_app_connector;
+
+	wxTextCtrl* m_text_addr;
+	wxTextCtrl* m_text_size;
+	wxChoice* m_choice_type;
+	wxStaticText* m_last_hit;
+	wxListView* m_list;
+
+public:
+	DbgWatchPointsPanel(wxWindow* parent) : wxPanel(parent)
+	{
+		m_text_addr = new wxTextCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxSize(90, -1));
+		m_text_size = new wxTextCtrl(this, wxID_ANY, "4", wxDefaultPosition, wxSize(50, -1));
+		m_choice_type = new wxChoice(this, wxID_ANY);
+		wxButton* b_add    = new wxButton(this, wxID_ANY, "Add");
+		wxButton* b_remove = new wxButton(this, wxID_ANY, "Remove");
+		m_last_hit = new wxStaticText(this, wxID_ANY, wxEmptyString);
+		m_list = new wxListView(this, wxID_ANY, wxDefaultPosition, wxSize(400, 150));
+
+		m_choice_type->Append("Write");
+		m_choice_type->Append("Read");
+		m_choice_type->Append("Read/Write");
+		m_choice_type->SetSelection(0);
+
+		m_list->InsertColumn(0, "Address", 0, 90);
+		m_list->InsertColumn(1, "Size", 0, 60);
+		m_list->InsertColumn(2, "Type", 0, 80);
+
+		wxBoxSizer& s_b_buttons = *new wxBoxSizer(wxHORIZONTAL);
+		s_b_buttons.Add(new wxStaticText(this, wxID_ANY, "Address:"), wxSizerFlags().Border(wxALL, 5).Center());
+		s_b_buttons.Add(m_text_addr,   wxSizerFlags().Border(wxALL, 5));
+		s_b_buttons.Add(new wxStaticText(this, wxID_ANY, "Size:"), wxSizerFlags().Border(wxALL, 5).Center());
+		s_b_buttons.Add(m_text_size,   wxSizerFlags().Border(wxALL, 5));
+		s_b_buttons.Add(m_choice_type, wxSizerFlags().Border(wxALL, 5));
+		s_b_buttons.Add(b_add,         wxSizerFlags().Border(wxALL, 5));
+		s_b_buttons.Add(b_remove,      wxSizerFlags().Border(wxALL, 5));
+
+		wxBoxSizer& s_b_main = *new wxBoxSizer(wxVERTICAL);
+		s_b_main.Add(&s_b_buttons);
+		s_b_main.Add(m_last_hit, wxSizerFlags().Border(wxALL, 5).Expand());
+		s_b_main.Add(m_list, 1, wxEXPAND);
+
+		SetSizerAndFit(&s_b_main);
+		Layout();
+
+		UpdateList();
+
+		Connect(b_add->GetId(),    wxEVT_COMMAND_BUTTON_CLICKED, wxCommandEventHandler(DbgWatchPointsPanel::OnAdd));
+		Connect(b_remove->GetId(), wxEVT_COMMAND_BUTTON_CLICKED, wxCommandEventHandler(DbgWatchPointsPanel::OnRemove));
+
+		m_app_connector.Connect(wxEVT_DBG_COMMAND, wxCommandEventHandler(DbgWatchPointsPanel::HandleCommand), (wxObject*)0, this);
+	}
+
+	void UpdateList()
+	{
+		static const char* types[] = { "", "Read", "Write", "Read/Write" };
+		const std::vector<WatchPoint> points = Emu.GetBreakPoints().GetWatchPoints();
+
+		m_list->Freeze();
+		m_list->DeleteAllItems();
+
+		for (u32 i = 0; i < points.size(); i++)
+		{
+			m_list->InsertItem(i, wxString::Format("0x%08x", points[i].addr));
+			m_list->SetItem(i, 1, wxString::Format("%d", points[i].size));
+			m_list->SetItem(i, 2, types[points[i].type & WATCH_ACCESS]);
+		}
+
+		m_list->Thaw();
+
+		m_last_hit->SetLabel(fmt::FromUTF8(Emu.GetBreakPoints().GetLastHit()));
+	}
+
+	void OnAdd(wxCommandEvent& event)
+	{
+		static const u32 types[] = { WATCH_WRITE, WATCH_READ, WATCH_ACCESS };
+
+		unsigned long addr, size;
+		if (!m_text_addr->GetValue().ToULong(&addr, 16) || !m_text_size->GetValue().ToULong(&size) || !size)
+		{
+			wxMessageBox("Invalid address or size", "Watchpoints");
+			return;
+		}
+
+		Emu.GetBreakPoints().AddWatchPoint(addr, size, types[m_choice_type->GetSelection()]);
+		UpdateList();
+	}
+
+	void OnRemove(wxCommandEvent& event)
+	{
+		const std::vector<WatchPoint> points = Emu.GetBreakPoints().GetWatchPoints();
+
+		for (long i = m_list->GetFirstSelected(); i >= 0; i = m_list->GetNextSelected(i))
+		{
+			if (i < (long)points.size()) Emu.GetBreakPoints().RemoveWatchPoint(points[i].addr);
+		}
+
+		UpdateList();
+	}
+
+	void HandleCommand(wxCommandEvent& event)
+	{
+		event.Skip();
+
+		switch(event.GetId())
+		{
+		case DID_PAUSED_EMU:
+		case DID_STOPPED_EMU:
+		case DID_STARTED_EMU:
+			UpdateList();
+		break;
+		}
+	}
+};
+
 DebuggerPanel::DebuggerPanel(wxWindow* parent) : wxPanel(parent, wxID_ANY, wxDefaultPosition, wxSize(400, 600), wxTAB_TRAVERSAL)
 {
 	m_aui_mgr.SetManagedWindow(this);
 
 	m_aui_mgr.AddPane(new DbgEmuPanel(this), wxAuiPaneInfo().Top());
 	m_aui_mgr.AddPane(new InterpreterDisAsmFrame(this), wxAuiPaneInfo().Center().CaptionVisible(false).CloseButton().MaximizeButton());
+	m_aui_mgr.AddPane(new DbgHLEProfilerPanel(this), wxAuiPaneInfo().Bottom().Caption("HLE Profiler").CloseButton().MaximizeButton());
+	m_aui_mgr.AddPane(new DbgGuestProfilerPanel(this), wxAuiPaneInfo().Bottom().Caption("Guest Profiler").CloseButton().MaximizeButton());
+	m_aui_mgr.AddPane(new DbgWatchPointsPanel(this), wxAuiPaneInfo().Bottom().Caption("Watchpoints").CloseButton().MaximizeButton());
 	m_aui_mgr.Update();
 }
 
@@ -552,32 +552,15 @@ void InterpreterDisAsmFrame::MouseWheel(wxMouseEvent& event)
 
 bool InterpreterDisAsmFrame::IsBreakPoint(u64 pc)
 {
-	for(u32 i=0; i<Emu.GetBreakPoints().size(); ++i)
-	{
-		if(Emu.GetBreakPoints()[i] == pc) return true;
-	}
-
-	return false;
+	return Emu.GetBreakPoints().HasBreakPoint(pc);
 }
 
 void InterpreterDisAsmFrame::AddBreakPoint(u64 pc)
 {
-	for(u32 i=0; i<Emu.GetBreakPoints().size(); ++i)
-	{
-		if(Emu.GetBreakPoints()[i] == pc) return;
-	}
-
-	Emu.GetBreakPoints().push_back(pc);
+	Emu.GetBreakPoints().AddBreakPoint(pc);
 }
 
 bool InterpreterDisAsmFrame::RemoveBreakPoint(u64 pc)
 {
-	for(u32 i=0; i<Emu.GetBreakPoints().size(); ++i)
-	{
-		if(Emu.GetBreakPoints()[i] != pc) continue;
-		Emu.GetBreakPoints().erase(Emu.GetBreakPoints().begin() + i);
-		return true;
-	}
-
-	return false;
+	return Emu.GetBreakPoints().RemoveBreakPoint(pc);
 }
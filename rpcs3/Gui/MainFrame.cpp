@@ -367,12 +367,16 @@ void MainFrame::Config(wxCommandEvent& WXUNUSED(event))
 	wxComboBox* cbox_sys_lang = new wxComboBox(p_system, wxID_ANY);
 
 	wxCheckBox* chbox_cpu_ignore_rwerrors = new wxCheckBox(p_cpu, wxID_ANY, "Ignore Read/Write errors");
+	wxCheckBox* chbox_cpu_strict_flags = new wxCheckBox(p_cpu, wxID_ANY, "Strict CR/FPSCR flags (debug)");
+	wxCheckBox* chbox_cpu_thread_parking = new wxCheckBox(p_cpu, wxID_ANY, "Park busy-waiting threads");
 	wxCheckBox* chbox_gs_log_prog   = new wxCheckBox(p_graphics, wxID_ANY, "Log vertex/fragment programs");
 	wxCheckBox* chbox_gs_dump_depth = new wxCheckBox(p_graphics, wxID_ANY, "Write Depth Buffer");
 	wxCheckBox* chbox_gs_dump_color = new wxCheckBox(p_graphics, wxID_ANY, "Write Color Buffers");
 	wxCheckBox* chbox_gs_vsync = new wxCheckBox(p_graphics, wxID_ANY, "VSync");
 	wxCheckBox* chbox_audio_dump = new wxCheckBox(p_audio, wxID_ANY, "Dump to file");
+	wxCheckBox* chbox_audio_resample = new wxCheckBox(p_audio, wxID_ANY, "Resample decoded audio to 48 kHz");
 	wxCheckBox* chbox_hle_logging = new wxCheckBox(p_hle, wxID_ANY, "Log all SysCalls");
+	wxCheckBox* chbox_hle_binary_log = new wxCheckBox(p_hle, wxID_ANY, "Binary log");
 	wxCheckBox* chbox_hle_hook_stfunc = new wxCheckBox(p_hle, wxID_ANY, "Hook static functions");
 	wxCheckBox* chbox_hle_savetty = new wxCheckBox(p_hle, wxID_ANY, "Save TTY output to file");
 	wxCheckBox* chbox_hle_exitonstop = new wxCheckBox(p_hle, wxID_ANY, "Exit RPCS3 when process finishes");
@@ -436,12 +440,16 @@ void MainFrame::Config(wxCommandEvent& WXUNUSED(event))
 
 	// Get values from .ini
 	chbox_cpu_ignore_rwerrors->SetValue(Ini.CPUIgnoreRWErrors.GetValue());
+	chbox_cpu_strict_flags->SetValue(Ini.CPUStrictFlags.GetValue());
+	chbox_cpu_thread_parking->SetValue(Ini.CPUThreadParking.GetValue());
 	chbox_gs_log_prog->SetValue(Ini.GSLogPrograms.GetValue());
 	chbox_gs_dump_depth->SetValue(Ini.GSDumpDepthBuffer.GetValue());
 	chbox_gs_dump_color->SetValue(Ini.GSDumpColorBuffers.GetValue());
 	chbox_gs_vsync->SetValue(Ini.GSVSyncEnable.GetValue());
 	chbox_audio_dump->SetValue(Ini.AudioDumpToFile.GetValue());
+	chbox_audio_resample->SetValue(Ini.AudioResample48k.GetValue());
 	chbox_hle_logging->SetValue(Ini.HLELogging.GetValue());
+	chbox_hle_binary_log->SetValue(Ini.HLEBinaryLog.GetValue());
 	chbox_hle_hook_stfunc->SetValue(Ini.HLEHookStFunc.GetValue());
 	chbox_hle_savetty->SetValue(Ini.HLESaveTTY.GetValue());
 	chbox_hle_exitonstop->SetValue(Ini.HLEExitOnStop.GetValue());
@@ -460,7 +468,9 @@ void MainFrame::Config(wxCommandEvent& WXUNUSED(event))
 
 	// Enable / Disable parameters
 	chbox_audio_dump->Enable(Emu.IsStopped());
+	chbox_audio_resample->Enable(Emu.IsStopped());
 	chbox_hle_logging->Enable(Emu.IsStopped());
+	chbox_hle_binary_log->Enable(Emu.IsStopped());
 	chbox_hle_hook_stfunc->Enable(Emu.IsStopped());
 
 
@@ -483,6 +493,8 @@ void MainFrame::Config(wxCommandEvent& WXUNUSED(event))
 	// Core
 	s_subpanel_cpu->Add(s_round_cpu_decoder, wxSizerFlags().Border(wxALL, 5).Expand());
 	s_subpanel_cpu->Add(chbox_cpu_ignore_rwerrors, wxSizerFlags().Border(wxALL, 5).Expand());
+	s_subpanel_cpu->Add(chbox_cpu_strict_flags, wxSizerFlags().Border(wxALL, 5).Expand());
+	s_subpanel_cpu->Add(chbox_cpu_thread_parking, wxSizerFlags().Border(wxALL, 5).Expand());
 
 	// Graphics
 	s_subpanel_graphics->Add(s_round_gs_render, wxSizerFlags().Border(wxALL, 5).Expand());
@@ -501,10 +513,12 @@ void MainFrame::Config(wxCommandEvent& WXUNUSED(event))
 	// Audio
 	s_subpanel_audio->Add(s_round_audio_out, wxSizerFlags().Border(wxALL, 5).Expand());
 	s_subpanel_audio->Add(chbox_audio_dump, wxSizerFlags().Border(wxALL, 5).Expand());
+	s_subpanel_audio->Add(chbox_audio_resample, wxSizerFlags().Border(wxALL, 5).Expand());
 
 	// HLE / Misc.
 	s_subpanel_hle->Add(s_round_hle_log_lvl, wxSizerFlags().Border(wxALL, 5).Expand());
 	s_subpanel_hle->Add(chbox_hle_logging, wxSizerFlags().Border(wxALL, 5).Expand());
+	s_subpanel_hle->Add(chbox_hle_binary_log, wxSizerFlags().Border(wxALL, 5).Expand());
 	s_subpanel_hle->Add(chbox_hle_hook_stfunc, wxSizerFlags().Border(wxALL, 5).Expand());
 	s_subpanel_hle->Add(chbox_hle_savetty, wxSizerFlags().Border(wxALL, 5).Expand());
 	s_subpanel_hle->Add(chbox_hle_exitonstop, wxSizerFlags().Border(wxALL, 5).Expand());
@@ -532,6 +546,8 @@ void MainFrame::Config(wxCommandEvent& WXUNUSED(event))
 	{
 		Ini.CPUDecoderMode.SetValue(cbox_cpu_decoder->GetSelection() + 1);
 		Ini.CPUIgnoreRWErrors.SetValue(chbox_cpu_ignore_rwerrors->GetValue());
+		Ini.CPUStrictFlags.SetValue(chbox_cpu_strict_flags->GetValue());
+		Ini.CPUThreadParking.SetValue(chbox_cpu_thread_parking->GetValue());
 		Ini.GSRenderMode.SetValue(cbox_gs_render->GetSelection());
 		Ini.GSResolution.SetValue(ResolutionNumToId(cbox_gs_resolution->GetSelection() + 1));
 		Ini.GSAspectRatio.SetValue(cbox_gs_aspect->GetSelection() + 1);
@@ -544,7 +560,9 @@ void MainFrame::Config(wxCommandEvent& WXUNUSED(event))
 		Ini.MouseHandlerMode.SetValue(cbox_mouse_handler->GetSelection());
 		Ini.AudioOutMode.SetValue(cbox_audio_out->GetSelection());
 		Ini.AudioDumpToFile.SetValue(chbox_audio_dump->GetValue());
+		Ini.AudioResample48k.SetValue(chbox_audio_resample->GetValue());
 		Ini.HLELogging.SetValue(chbox_hle_logging->GetValue());
+		Ini.HLEBinaryLog.SetValue(chbox_hle_binary_log->GetValue());
 		Ini.HLEHookStFunc.SetValue(chbox_hle_hook_stfunc->GetValue());
 		Ini.HLESaveTTY.SetValue(chbox_hle_savetty->GetValue());
 		Ini.HLEExitOnStop.SetValue(chbox_hle_exitonstop->GetValue());
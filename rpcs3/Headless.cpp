@@ -0,0 +1,354 @@
+#include "stdafx.h"
+#include "Headless.h"
+#include "Emu/GS/GSRender.h"
+#include "Emu/SysCalls/HLEProfiler.h"
+#include <wx/init.h>
+#include <fstream>
+
+#ifdef _WIN32
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+HeadlessReport g_headless_report;
+
+// CPU time used by the calling thread, in seconds
+static double GetThreadCPUTime()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+	{
+		return 0.0;
+	}
+
+	const u64 ticks = ((u64)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime) + ((u64)user.dwHighDateTime << 32 | user.dwLowDateTime);
+	return ticks / 10000000.0;
+#else
+	timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+	{
+		return 0.0;
+	}
+
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+// CPU time used by all threads of the process (user + kernel), in seconds
+static double GetProcessCPUTime()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+	{
+		return 0.0;
+	}
+
+	const u64 ticks = ((u64)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime) + ((u64)user.dwHighDateTime << 32 | user.dwLowDateTime);
+	return ticks / 10000000.0;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage))
+	{
+		return 0.0;
+	}
+
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+#endif
+}
+
+// peak resident memory of the process, in bytes
+static u64 GetPeakMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return 0;
+	}
+
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage))
+	{
+		return 0;
+	}
+
+	return (u64)usage.ru_maxrss * 1024; // in kilobytes on Linux
+#endif
+}
+
+static std::string JSONString(const std::string& str)
+{
+	std::string res = "\"";
+
+	for (u32 i = 0; i < str.length(); i++)
+	{
+		const char c = str[i];
+
+		switch (c)
+		{
+		case '"': res += "\\\""; break;
+		case '\\': res += "\\\\"; break;
+		case '\n': res += "\\n"; break;
+		case '\t': res += "\\t"; break;
+		default:
+			if ((u8)c < 0x20)
+			{
+				res += fmt::Format("\\u%04x", (u8)c);
+			}
+			else
+			{
+				res += c;
+			}
+		}
+	}
+
+	return res + "\"";
+}
+
+HeadlessReport::HeadlessReport()
+	: m_enabled(false)
+{
+	memset(&m_spin_wait, 0, sizeof(m_spin_wait));
+}
+
+void HeadlessReport::AddThread(const std::string& name, const std::string& type, u64 instructions)
+{
+	HeadlessThreadStats stats;
+	stats.name = name;
+	stats.type = type;
+	stats.instructions = instructions;
+	stats.cpu_time = GetThreadCPUTime();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_threads.push_back(stats);
+}
+
+std::vector<HeadlessThreadStats> HeadlessReport::GetThreads()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_threads;
+}
+
+void HeadlessReport::SetSpinWait(const SpinWaitStats& stats)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_spin_wait = stats;
+}
+
+SpinWaitStats HeadlessReport::GetSpinWait()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_spin_wait;
+}
+
+struct HeadlessRunInfo
+{
+	std::string path;
+	std::string exit_reason;
+	double seconds;
+	u64 frames;
+};
+
+static bool WriteReport(const std::string& path, const HeadlessRunInfo& info)
+{
+	std::ofstream out(path);
+	if (!out)
+	{
+		ConLog.Error("Headless: can't create '%s'", path.c_str());
+		return false;
+	}
+
+	out << "{\n";
+	out << "\t\"path\": " << JSONString(info.path) << ",\n";
+	out << "\t\"exit_reason\": " << JSONString(info.exit_reason) << ",\n";
+	out << fmt::Format("\t\"seconds\": %.3f,\n", info.seconds);
+	out << fmt::Format("\t\"frames\": %llu,\n", info.frames);
+	out << fmt::Format("\t\"fps\": %.2f,\n", info.seconds > 0.0 ? info.frames / info.seconds : 0.0);
+	out << fmt::Format("\t\"process_cpu_time\": %.3f,\n", GetProcessCPUTime());
+	out << fmt::Format("\t\"peak_memory\": %llu,\n", GetPeakMemory());
+
+	const std::vector<HeadlessThreadStats> threads = g_headless_report.GetThreads();
+	out << "\t\"threads\": [\n";
+	for (u32 i = 0; i < threads.size(); i++)
+	{
+		const HeadlessThreadStats& t = threads[i];
+
+		out << "\t\t{\"name\": " << JSONString(t.name) << ", \"type\": " << JSONString(t.type);
+		out << fmt::Format(", \"instructions\": %llu, \"cpu_time\": %.3f, \"mips\": %.3f}",
+			t.instructions, t.cpu_time, info.seconds > 0.0 ? t.instructions / info.seconds / 1000000.0 : 0.0);
+		out << (i + 1 < threads.size() ? ",\n" : "\n");
+	}
+	out << "\t],\n";
+
+	const SpinWaitStats spin = g_headless_report.GetSpinWait();
+	out << fmt::Format("\t\"spin_wait\": {\"memory\": %llu, \"reservation\": %llu, \"channel\": %llu, \"sync\": %llu, \"notified\": %llu, \"seconds\": %.3f},\n",
+		spin.parks[SPIN_WAIT_MEMORY], spin.parks[SPIN_WAIT_RESERVATION], spin.parks[SPIN_WAIT_CHANNEL], spin.parks[SPIN_WAIT_SYNC],
+		spin.notified, spin.wait_us / 1000000.0);
+
+	// syscalls by number, module functions by NID
+	const std::vector<HLECallEntry> calls = g_hle_profiler.Collect();
+	for (u32 kind = HLE_CALL_SYSCALL; kind <= HLE_CALL_FUNC; kind++)
+	{
+		out << (kind == HLE_CALL_SYSCALL ? "\t\"syscalls\": [\n" : "\t\"functions\": [\n");
+
+		bool first = true;
+		for (u32 i = 0; i < calls.size(); i++)
+		{
+			const HLECallEntry& e = calls[i];
+			if (e.kind != kind)
+			{
+				continue;
+			}
+
+			out << (first ? "" : ",\n");
+			out << fmt::Format("\t\t{\"id\": %u, \"name\": ", e.id) << JSONString(e.name);
+			out << fmt::Format(", \"count\": %llu, \"total_us\": %.1f}", e.stats.count, e.stats.total / 10.0);
+			first = false;
+		}
+
+		out << (first ? "" : "\n") << (kind == HLE_CALL_SYSCALL ? "\t],\n" : "\t]\n");
+	}
+
+	out << "}\n";
+	return true;
+}
+
+int HeadlessMain(int argc, char** argv)
+{
+	std::string path;
+	std::string report_path = "rpcs3_report.json";
+	u64 max_frames = 0;
+	double max_seconds = 0.0;
+
+	for (int i = 2; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "--frames" && i + 1 < argc)
+		{
+			max_frames = strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--seconds" && i + 1 < argc)
+		{
+			max_seconds = atof(argv[++i]);
+		}
+		else if (arg == "--report" && i + 1 < argc)
+		{
+			report_path = argv[++i];
+		}
+		else if (path.empty() && arg[0] != '-')
+		{
+			path = arg;
+		}
+		else
+		{
+			path.clear();
+			break;
+		}
+	}
+
+	if (path.empty())
+	{
+		fprintf(stderr, "Usage: %s --headless <(S)ELF> [--frames N] [--seconds S] [--report file.json]\n", argv[0]);
+		return 1;
+	}
+
+	if (!max_frames && max_seconds <= 0.0)
+	{
+		max_seconds = 60.0;
+	}
+
+	// a console application object: the GUI toolkit is never initialized
+	wxApp::SetInstance(new wxAppConsole());
+	wxInitializer initializer(argc, argv);
+	if (!initializer.IsOk())
+	{
+		fprintf(stderr, "Failed to initialize wxWidgets\n");
+		return 1;
+	}
+
+	Ini.Load();
+
+	// null devices for this run only, the settings are never saved
+	Ini.GSRenderMode.SetValue(0);
+	Ini.PadHandlerMode.SetValue(0);
+	Ini.KeyboardHandlerMode.SetValue(0);
+	Ini.MouseHandlerMode.SetValue(0);
+	Ini.AudioOutMode.SetValue(0);
+
+	Emu.SetHeadless(true);
+	Emu.Init();
+
+	g_hle_profiler.Enable(true);
+	g_headless_report.Enable(true);
+
+	HeadlessRunInfo info;
+	info.path = path;
+	info.seconds = 0.0;
+	info.frames = 0;
+
+	Emu.SetPath(path);
+	Emu.Load();
+
+	if (!Emu.IsReady())
+	{
+		ConLog.Error("Headless: failed to load '%s'", path.c_str());
+		info.exit_reason = "load_failed";
+		WriteReport(report_path, info);
+		return 1;
+	}
+
+	Timer timer;
+	timer.Start();
+	Emu.Run();
+
+	while (true)
+	{
+		Sleep(10);
+
+		if (Emu.IsStopped())
+		{
+			info.exit_reason = "stopped";
+			break;
+		}
+
+		info.frames = Emu.GetGSManager().GetRender().m_flip_count;
+
+		if (max_frames && info.frames >= max_frames)
+		{
+			info.exit_reason = "frames";
+			break;
+		}
+
+		if (max_seconds > 0.0 && timer.GetElapsedTimeInSec() >= max_seconds)
+		{
+			info.exit_reason = "time";
+			break;
+		}
+
+		if (Emu.IsPaused())
+		{
+			info.exit_reason = "paused";
+			break;
+		}
+	}
+
+	info.seconds = timer.GetElapsedTimeInSec();
+
+	// the threads add their statistics while exiting
+	Emu.Stop();
+
+	g_headless_report.Enable(false);
+	g_hle_profiler.Enable(false);
+
+	ConLog.Write("Headless: %s after %.1f s, %llu frames", info.exit_reason.c_str(), info.seconds, info.frames);
+
+	return WriteReport(report_path, info) ? 0 : 1;
+}
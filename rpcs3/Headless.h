@@ -0,0 +1,45 @@
+#pragma once
+#include "Emu/CPU/SpinWait.h"
+
+// Headless batch runner (Linux):
+//   rpcs3 --headless <(S)ELF> [--frames N] [--seconds S] [--report file.json]
+// Boots the executable without initializing the GUI toolkit (windowless null renderer, null
+// pad/keyboard/mouse, no audio output), runs it until N frames were flipped, S seconds passed
+// (60 by default) or the emulator stopped or paused (process exit, fatal error), then writes a
+// JSON performance report: frame rate, host CPU time and guest instructions of every thread,
+// HLE call counts, busy-wait parking and the peak host memory.
+
+struct HeadlessThreadStats
+{
+	std::string name;
+	std::string type; // CPU thread type, or "RSX"
+	u64 instructions; // guest instructions executed (0 for host threads)
+	double cpu_time; // host CPU time in seconds
+};
+
+class HeadlessReport
+{
+	std::atomic<bool> m_enabled;
+	std::mutex m_mutex;
+	std::vector<HeadlessThreadStats> m_threads;
+	SpinWaitStats m_spin_wait;
+
+public:
+	HeadlessReport();
+
+	void Enable(bool enable) { m_enabled = enable; }
+	bool IsEnabled() const { return m_enabled; }
+
+	// called by emulator threads when they exit (the CPU time is the calling thread's)
+	void AddThread(const std::string& name, const std::string& type, u64 instructions);
+
+	std::vector<HeadlessThreadStats> GetThreads();
+
+	// busy-wait parking of the run (set when the emulator stops)
+	void SetSpinWait(const SpinWaitStats& stats);
+	SpinWaitStats GetSpinWait();
+};
+
+extern HeadlessReport g_headless_report;
+
+int HeadlessMain(int argc, char** argv);
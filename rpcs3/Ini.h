@@ -98,6 +98,8 @@ private:
 public:
 	IniEntry<u8> CPUDecoderMode;
 	IniEntry<bool> CPUIgnoreRWErrors;
+	IniEntry<bool> CPUStrictFlags;
+	IniEntry<bool> CPUThreadParking;
 	IniEntry<u8> GSRenderMode;
 	IniEntry<u8> GSResolution;
 	IniEntry<u8> GSAspectRatio;
@@ -110,7 +112,9 @@ public:
 	IniEntry<u8> MouseHandlerMode;
 	IniEntry<u8> AudioOutMode;
 	IniEntry<bool> AudioDumpToFile;
+	IniEntry<bool> AudioResample48k;
 	IniEntry<bool> HLELogging;
+	IniEntry<bool> HLEBinaryLog;
 	IniEntry<bool> HLEHookStFunc;
 	IniEntry<bool> HLESaveTTY;
 	IniEntry<bool> HLEExitOnStop;
@@ -150,6 +154,8 @@ public:
 		path = DefPath + "/" + "CPU";
 		CPUDecoderMode.Init("DecoderMode", path);
 		CPUIgnoreRWErrors.Init("IgnoreRWErrors", path);
+		CPUStrictFlags.Init("StrictFlags", path);
+		CPUThreadParking.Init("ThreadParking", path);
 
 		path = DefPath + "/" + "GS";
 		GSRenderMode.Init("RenderMode", path);
@@ -195,9 +201,11 @@ public:
 		path = DefPath + "/" + "Audio";
 		AudioOutMode.Init("AudioOutMode", path);
 		AudioDumpToFile.Init("AudioDumpToFile", path);
+		AudioResample48k.Init("AudioResample48k", path);
 
 		path = DefPath + "/" + "HLE";
 		HLELogging.Init("HLELogging", path);
+		HLEBinaryLog.Init("HLEBinaryLog", path);
 		HLEHookStFunc.Init("HLEHookStFunc", path);
 		HLESaveTTY.Init("HLESaveTTY", path);
 		HLEExitOnStop.Init("HLEExitOnStop", path);
@@ -211,6 +219,8 @@ public:
 	{
 		CPUDecoderMode.Load(2);
 		CPUIgnoreRWErrors.Load(false);
+		CPUStrictFlags.Load(false);
+		CPUThreadParking.Load(true);
 		GSRenderMode.Load(1);
 		GSResolution.Load(4);
 		GSAspectRatio.Load(2);
@@ -223,7 +233,9 @@ public:
 		MouseHandlerMode.Load(0);
 		AudioOutMode.Load(1);
 		AudioDumpToFile.Load(0);
+		AudioResample48k.Load(false);
 		HLELogging.Load(false);
+		HLEBinaryLog.Load(false);
 		HLEHookStFunc.Load(false);
 		HLESaveTTY.Load(false);
 		HLEExitOnStop.Load(false);
@@ -260,6 +272,8 @@ public:
 	{
 		CPUDecoderMode.Save();
 		CPUIgnoreRWErrors.Save();
+		CPUStrictFlags.Save();
+		CPUThreadParking.Save();
 		GSRenderMode.Save();
 		GSResolution.Save();
 		GSAspectRatio.Save();
@@ -272,7 +286,9 @@ public:
 		MouseHandlerMode.Save();
 		AudioOutMode.Save();
 		AudioDumpToFile.Save();
+		AudioResample48k.Save();
 		HLELogging.Save();
+		HLEBinaryLog.Save();
 		HLEHookStFunc.Save();
 		HLESaveTTY.Save();
 		HLEExitOnStop.Save();
@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "ELF64.h"
 #include "Emu/Cell/PPUInstrTable.h"
+#include "Emu/CPU/GuestProfiler.h"
 using namespace PPU_instr;
 
 void WriteEhdr(wxFile& f, Elf64_Ehdr& ehdr)
@@ -238,6 +239,7 @@ bool ELF64Loader::LoadPhdrData(u64 offset)
 				if(phdr_arr[i].p_memsz)
 				{
 					Memory.MainMem.AllocFixed(offset + phdr_arr[i].p_vaddr, phdr_arr[i].p_memsz);
+					g_guest_profiler.AddSegment(offset + phdr_arr[i].p_vaddr, phdr_arr[i].p_memsz, fmt::Format("seg%d", i));
 
 					if(phdr_arr[i].p_filesz)
 					{
@@ -383,6 +385,8 @@ bool ELF64Loader::LoadPhdrData(u64 offset)
 							out_tbl += dst + i*section;
 							out_tbl += GetFuncNumById(nid);
 
+							g_guest_profiler.AddFunction(dst + i*section, section, fmt::Format("%s::0x%08x", module_name.c_str(), nid));
+
 							mem32_ptr_t out_dst(dst + i*section);
 							out_dst += OR(11, 2, 2, 0);
 							out_dst += SC(2);
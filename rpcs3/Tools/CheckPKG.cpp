@@ -0,0 +1,96 @@
+#include "stdafx.h"
+#include "Crypto/unpkg.h"
+#include "Emu/FS/vfsDevicePKG.h"
+#include <wx/init.h>
+
+// rpcs3_check_pkg: checks the PKG device of the VFS with a real package.
+// Usage: rpcs3_check_pkg <file>
+// Mounts the given package and verifies that every file in it is reported by VFS::ExistsFile
+// and can be opened and read afterwards; the exit code is 1 on failure. wxWidgets is
+// initialized with a console application object, so no display is needed.
+
+static bool CheckPKG(const std::string& pkg_path)
+{
+	static const std::string mount = "/dev_check_pkg/";
+
+	vfsDevicePKG* device = new vfsDevicePKG(pkg_path);
+	std::shared_ptr<PKGReader> reader = device->GetReader();
+	if (!reader)
+	{
+		delete device;
+		fprintf(stderr, "check_pkg: can't open '%s'\n", pkg_path.c_str());
+		return false;
+	}
+
+	Emu.GetVFS().Mount(mount, "/check_pkg/", device);
+
+	u32 files = 0, failed = 0;
+
+	for (const PKGReader::Entry& entry : reader->entries)
+	{
+		if ((entry.type & 0xff) == PKG_FILE_ENTRY_FOLDER)
+		{
+			continue;
+		}
+
+		const std::string path = mount + entry.name;
+		files++;
+
+		// twice: the second lookup goes through the VFS caches
+		if (!Emu.GetVFS().ExistsFile(path) || !Emu.GetVFS().ExistsFile(path))
+		{
+			fprintf(stderr, "check_pkg: ExistsFile('%s') failed\n", path.c_str());
+			failed++;
+			continue;
+		}
+
+		std::unique_ptr<vfsFileBase> f(Emu.GetVFS().OpenFile(path, vfsRead));
+		if (!f || !f->IsOpened() || f->GetSize() != entry.size)
+		{
+			fprintf(stderr, "check_pkg: OpenFile('%s') failed\n", path.c_str());
+			failed++;
+			continue;
+		}
+
+		u8 data[16];
+		const u64 size = std::min<u64>(entry.size, sizeof(data));
+		if (f->Read(data, size) != size)
+		{
+			fprintf(stderr, "check_pkg: Read('%s') failed\n", path.c_str());
+			failed++;
+		}
+	}
+
+	if (Emu.GetVFS().ExistsFile(mount + "check_pkg_missing_file"))
+	{
+		fprintf(stderr, "check_pkg: ExistsFile() found a missing file\n");
+		failed++;
+	}
+
+	Emu.GetVFS().UnMount(mount);
+
+	fprintf(stderr, "check_pkg: %u files, %u failed\n", files, failed);
+	return failed == 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 2)
+	{
+		fprintf(stderr, "Usage: %s <file>\n", argv[0]);
+		return 1;
+	}
+
+	// a console application object: initializing the GUI toolkit would require a display
+	wxApp::SetInstance(new wxAppConsole());
+	wxInitializer initializer(argc, argv);
+	if (!initializer.IsOk())
+	{
+		fprintf(stderr, "Failed to initialize wxWidgets\n");
+		return 1;
+	}
+
+	Ini.Load();
+
+	return CheckPKG(argv[1]) ? 0 : 1;
+}
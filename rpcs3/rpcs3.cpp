@@ -2,6 +2,7 @@
 #include "rpcs3.h"
 #include "Ini.h"
 #include "Emu/System.h"
+#include "Headless.h"
 
 #ifdef _WIN32
 #include <wx/msw/wrapwin.h>
@@ -13,7 +14,25 @@
 
 const wxEventType wxEVT_DBG_COMMAND = wxNewEventType();
 
+#if defined(RPCS3_NO_MAIN)
+// rpcs3_bench and the tools have their own main() and never create the application
+IMPLEMENT_APP_NO_MAIN(Rpcs3App)
+#elif defined(_WIN32)
 IMPLEMENT_APP(Rpcs3App)
+#else
+IMPLEMENT_APP_NO_MAIN(Rpcs3App)
+
+int main(int argc, char** argv)
+{
+	// the headless runner must not initialize the GUI toolkit (there may be no display)
+	if (argc > 1 && !strcmp(argv[1], "--headless"))
+	{
+		return HeadlessMain(argc, argv);
+	}
+
+	return wxEntry(argc, argv);
+}
+#endif
 Rpcs3App* TheApp;
 
 bool Rpcs3App::OnInit()
@@ -70,6 +89,14 @@ void Rpcs3App::SendDbgCommand(DbgCommand id, CPUThread* thr)
 	AddPendingEvent(event);
 }
 
+void SendDbgCommand(DbgCommand id, CPUThread* thr)
+{
+	if (!Emu.IsHeadless())
+	{
+		wxGetApp().SendDbgCommand(id, thr);
+	}
+}
+
 Rpcs3App::Rpcs3App()
 {
 	#ifdef __UNIX__
@@ -65,6 +65,9 @@ public:
 
 DECLARE_APP(Rpcs3App)
 
+// forwards to Rpcs3App::SendDbgCommand; does nothing in headless mode (there is no application)
+void SendDbgCommand(DbgCommand id, CPUThread* thr=nullptr);
+
 //extern CPUThread& GetCPU(const u8 core);
 
 extern Rpcs3App* TheApp;